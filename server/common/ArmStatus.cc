@@ -32,7 +32,10 @@ ArmInfo::ArmInfo(void)
 : running(false),
   stat(ARM_WORK_STAT_INIT),
   numUpdate(0),
-  numFailure(0)
+  numFailure(0),
+  lastPollCostMSec(0),
+  lastPollNumFetchedRows(0),
+  totalNumFetchedRows(0)
 {
 }
 
@@ -103,6 +106,16 @@ void ArmStatus::setArmInfo(const ArmInfo &armInfo)
 	m_impl->rwlock.unlock();
 }
 
+void ArmStatus::logPollStats(const size_t &costMSec,
+                             const size_t &numFetchedRows)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->armInfo.lastPollCostMSec = costMSec;
+	m_impl->armInfo.lastPollNumFetchedRows = numFetchedRows;
+	m_impl->armInfo.totalNumFetchedRows += numFetchedRows;
+	m_impl->rwlock.unlock();
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -45,7 +45,12 @@ struct ArmInfo
 
 	size_t           numUpdate;
 	size_t           numFailure;
-	
+
+	// Statistics of the last polling
+	size_t           lastPollCostMSec;
+	size_t           lastPollNumFetchedRows;
+	uint64_t         totalNumFetchedRows;
+
 	// Constructor
 	ArmInfo(void);
 };
@@ -70,6 +75,15 @@ public:
 	                const ArmWorkingStatus &status = ARM_WORK_STAT_FAILURE);
 	void setArmInfo(const ArmInfo &armInfo);
 
+	/**
+	 * Record the cost of a polling.
+	 *
+	 * @param costMSec The elapsed time of the polling in millisecond.
+	 * @param numFetchedRows
+	 * The number of rows fetched from the monitoring system.
+	 */
+	void logPollStats(const size_t &costMSec, const size_t &numFetchedRows);
+
 protected:
 
 private:
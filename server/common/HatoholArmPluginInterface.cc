@@ -32,6 +32,7 @@
 #include "HatoholArmPluginInterface.h"
 #include "HatoholException.h"
 #include "MonitoringServerInfo.h"
+#include "HatoholTracePoint.h"
 
 using namespace std;
 using namespace mlpl;
@@ -272,6 +273,7 @@ HatoholArmPluginInterface::~HatoholArmPluginInterface()
 
 void HatoholArmPluginInterface::send(const string &message)
 {
+	MLPL_TRACE_INSTANT(TRACE_HAPI_SEND, message.size());
 	Message request;
 	request.setReplyTo(m_impl->receiverAddr);
 	request.setContent(message);
@@ -291,6 +293,7 @@ void HatoholArmPluginInterface::send(
 		m_impl->replyWaiterQueue.push(replyWaiter);
 	}
 
+	MLPL_TRACE_INSTANT(TRACE_HAPI_SEND, smbuf.size());
 	Message request;
 	request.setReplyTo(m_impl->receiverAddr);
 	request.setContent(smbuf.getPointer<char>(0), smbuf.size());
@@ -326,6 +329,7 @@ void HatoholArmPluginInterface::reply(const mlpl::SmartBuffer &replyBuf)
 void HatoholArmPluginInterface::reply(const MessagingContext &msgCtx,
                                       const mlpl::SmartBuffer &replyBuf)
 {
+	MLPL_TRACE_INSTANT(TRACE_HAPI_SEND, replyBuf.size());
 	Message reply;
 	reply.setContent(replyBuf.getPointer<char>(0), replyBuf.size());
 	Sender sender = m_impl->session.createSender(msgCtx.replyAddress);
@@ -738,6 +742,7 @@ gpointer HatoholArmPluginInterface::mainThread(HatoholThreadArg *arg)
 		m_impl->currBuffer  = &sbuf;
 
 		try {
+			MLPL_TRACE_SCOPE(TRACE_HAPI_RECEIVE, sbuf.size());
 			onReceived(sbuf);
 		} catch (const exception &e) {
 			MLPL_ERR("Caught exception: %s\n", e.what());
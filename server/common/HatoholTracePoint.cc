@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "HatoholTracePoint.h"
+using namespace mlpl;
+
+struct TracePointRegistrar {
+	TracePointRegistrar(void)
+	{
+		Tracer::registerEvent(TRACE_ARM_MAIN_LOOP,  "ArmMainLoop");
+		Tracer::registerEvent(TRACE_DB_TRANSACTION, "DBTransaction");
+		Tracer::registerEvent(TRACE_FACE_REST_JOB,  "FaceRestJob");
+		Tracer::registerEvent(TRACE_HAPI_SEND,      "HapiSend");
+		Tracer::registerEvent(TRACE_HAPI_RECEIVE,   "HapiReceive");
+		Tracer::registerEvent(TRACE_ACTION_RUN,     "ActionRun");
+	}
+};
+static TracePointRegistrar registrar;
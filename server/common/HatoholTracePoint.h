@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HatoholTracePoint_h
+#define HatoholTracePoint_h
+
+#include <Tracer.h>
+
+/**
+ * IDs of the trace points used with mlpl::Tracer. The name of each ID
+ * is registered when this library is loaded.
+ */
+enum HatoholTracePoint {
+	// arg0: Server ID, arg1: UpdateType
+	TRACE_ARM_MAIN_LOOP = 1,
+	TRACE_DB_TRANSACTION,
+	TRACE_FACE_REST_JOB,
+	// arg0: size of the message
+	TRACE_HAPI_SEND,
+	TRACE_HAPI_RECEIVE,
+	// arg0: Action ID, arg1: Action type
+	TRACE_ACTION_RUN,
+};
+
+#endif // HatoholTracePoint_h
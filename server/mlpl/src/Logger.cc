@@ -19,6 +19,8 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <list>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <string>
 #include <syslog.h>
@@ -31,17 +33,22 @@ using namespace mlpl;
 #include <string.h>
 #include "StringUtils.h"
 #include "SmartTime.h"
+#include "Mutex.h"
+#include "SimpleSemaphore.h"
+#include "AtomicValue.h"
+#include "Reaper.h"
 
 static const char* LogHeaders [MLPL_NUM_LOG_LEVEL] = {
 	"BUG", "CRIT", "ERR", "WARN", "INFO", "DBG",
 };
 
-LogLevel Logger::m_currLogLevel = MLPL_LOG_LEVEL_NOT_SET;
+volatile int Logger::m_currLogLevel = MLPL_LOG_LEVEL_NOT_SET;
 pthread_rwlock_t Logger::m_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 bool Logger::syslogoutputFlag = true;
 ReadWriteLock Logger::lock;
 const char *Logger::LEVEL_ENV_VAR_NAME = "MLPL_LOGGER_LEVEL";
 const char *Logger::MLPL_LOGGER_FLAGS = "MLPL_LOGGER_FLAGS";
+const char *Logger::ASYNC_ENV_VAR_NAME = "MLPL_LOGGER_ASYNC";
 bool Logger::syslogConnected = false;
 bool Logger::extraInfoFlag[256];
 pid_t Logger::pid = 0;
@@ -56,6 +63,309 @@ class Initializer : public Logger {
 };
 Initializer init;
 
+// ----------------------------------------------------------------------------
+// Asynchronous output
+// ----------------------------------------------------------------------------
+
+/*
+ * A single producer (the owner thread) and single consumer (a thread that
+ * holds AsyncOutput::drainLock) ring buffer. No lock is used.
+ */
+struct LogRing {
+	static const size_t NUM_SLOTS = 1024;
+	string *slots[NUM_SLOTS];
+	volatile size_t head; // updated only by the consumer
+	volatile size_t tail; // updated only by the producer
+
+	// Set when the owner thread exits. The consumer deletes the ring
+	// after it becomes empty.
+	volatile bool orphaned;
+
+	LogRing(void)
+	: head(0),
+	  tail(0),
+	  orphaned(false)
+	{
+	}
+
+	virtual ~LogRing()
+	{
+		clear();
+	}
+
+	bool empty(void) const
+	{
+		return head == tail;
+	}
+
+	/*
+	 * @param wasEmpty
+	 * Set to true if the ring was empty before the message is pushed.
+	 */
+	bool push(string *msg, bool &wasEmpty)
+	{
+		const size_t currTail = tail;
+		const size_t currHead = head;
+		if (currTail - currHead >= NUM_SLOTS)
+			return false;
+		wasEmpty = (currTail == currHead);
+		slots[currTail % NUM_SLOTS] = msg;
+		__sync_synchronize();
+		tail = currTail + 1;
+		return true;
+	}
+
+	string *pop(void)
+	{
+		const size_t currHead = head;
+		if (currHead == tail)
+			return NULL;
+		__sync_synchronize();
+		string *msg = slots[currHead % NUM_SLOTS];
+		__sync_synchronize();
+		head = currHead + 1;
+		return msg;
+	}
+
+	void clear(void)
+	{
+		string *msg;
+		while ((msg = pop()))
+			delete msg;
+	}
+};
+
+class AsyncOutput : public Logger {
+public:
+	static const size_t WRITER_INTERVAL_MSEC = 100;
+	static const size_t BLOCK_RETRY_USEC     = 1000;
+
+	// Lock order: writerLock -> drainLock -> registryLock
+	Mutex           writerLock;
+	Mutex           drainLock;
+	Mutex           registryLock;
+	list<LogRing *> rings;          // should be used with registryLock.
+	pthread_key_t   ringKey;
+	SimpleSemaphore wakeupSem;
+
+	volatile bool   enabled;
+	volatile int    policy;
+	bool            writerRunning;  // should be used with writerLock.
+	volatile bool   stopRequest;
+	pthread_t       writerThread;
+	bool            atforkRegistered; // should be used with writerLock.
+
+	AtomicValue<uint64_t> numDropped;
+	uint64_t              numReportedDropped; // with drainLock
+
+	static __thread LogRing *ring;
+	static __thread bool     draining;
+
+	static AsyncOutput &getInstance(void)
+	{
+		// This is never deleted, because the writer thread may be
+		// alive while static objects are destructed at exit.
+		static AsyncOutput *instance = new AsyncOutput();
+		return *instance;
+	}
+
+	AsyncOutput(void)
+	: wakeupSem(0),
+	  enabled(false),
+	  policy(MLPL_LOG_OVERFLOW_DROP),
+	  writerRunning(false),
+	  stopRequest(false),
+	  atforkRegistered(false),
+	  numDropped(0),
+	  numReportedDropped(0)
+	{
+		pthread_key_create(&ringKey, orphanRing);
+	}
+
+	bool push(const string &msg)
+	{
+		if (!enabled)
+			return false;
+		startWriterIfNeeded();
+		if (!enabled)
+			return false;
+		LogRing *myRing = getRing();
+		string *msgCopy = new string(msg);
+		bool wasEmpty = false;
+		while (!myRing->push(msgCopy, wasEmpty)) {
+			if (policy == MLPL_LOG_OVERFLOW_BLOCK) {
+				wakeupSem.post();
+				usleep(BLOCK_RETRY_USEC);
+				continue;
+			}
+			delete msgCopy;
+			if (policy == MLPL_LOG_OVERFLOW_SYNC)
+				return false;
+			numDropped.add(1);
+			return true;
+		}
+		if (wasEmpty)
+			wakeupSem.post();
+		return true;
+	}
+
+	void drain(void)
+	{
+		drainLock.lock();
+		Reaper<Mutex> unlocker(&drainLock, Mutex::unlock);
+		draining = true;
+		vector<string *> msgs;
+		registryLock.lock();
+		list<LogRing *>::iterator it = rings.begin();
+		while (it != rings.end()) {
+			LogRing *currRing = *it;
+			// Check it before popping so that no message pushed
+			// before the owner exits is left.
+			const bool orphaned = currRing->orphaned;
+			__sync_synchronize();
+			string *msg;
+			while ((msg = currRing->pop()))
+				msgs.push_back(msg);
+			if (orphaned) {
+				delete currRing;
+				rings.erase(it++);
+			} else {
+				++it;
+			}
+		}
+		registryLock.unlock();
+
+		const uint64_t currDropped = numDropped.get();
+		if (currDropped != numReportedDropped) {
+			msgs.push_back(new string(StringUtils::sprintf(
+			  "[WARN] <%s:%d> Dropped %" PRIu64 " log messages "
+			  "due to the overflow.\n", __FILE__, __LINE__,
+			  currDropped - numReportedDropped)));
+			numReportedDropped = currDropped;
+		}
+
+		if (!msgs.empty())
+			writeMessages(msgs);
+		for (size_t i = 0; i < msgs.size(); i++)
+			delete msgs[i];
+		draining = false;
+	}
+
+	void startWriterIfNeeded(void)
+	{
+		// Unlocked check for the fast path. It is checked again with
+		// the lock.
+		if (writerRunning)
+			return;
+		writerLock.lock();
+		Reaper<Mutex> unlocker(&writerLock, Mutex::unlock);
+		if (writerRunning || !enabled)
+			return;
+		if (!atforkRegistered) {
+			pthread_atfork(prepareForkCb, parentForkCb,
+			               childForkCb);
+			atexit(flushAtExit);
+			atforkRegistered = true;
+		}
+		stopRequest = false;
+		if (pthread_create(&writerThread, NULL, writerMain, this)) {
+			// Messages are written synchronously
+			enabled = false;
+			return;
+		}
+		writerRunning = true;
+	}
+
+	void stopWriter(void)
+	{
+		writerLock.lock();
+		Reaper<Mutex> unlocker(&writerLock, Mutex::unlock);
+		enabled = false;
+		if (writerRunning) {
+			stopRequest = true;
+			wakeupSem.post();
+			pthread_join(writerThread, NULL);
+			writerRunning = false;
+		}
+		drain();
+	}
+
+protected:
+	LogRing *getRing(void)
+	{
+		if (ring)
+			return ring;
+		ring = new LogRing();
+		registryLock.lock();
+		rings.push_back(ring);
+		registryLock.unlock();
+		pthread_setspecific(ringKey, ring);
+		return ring;
+	}
+
+	static void orphanRing(void *data)
+	{
+		LogRing *exitingRing = static_cast<LogRing *>(data);
+		__sync_synchronize();
+		exitingRing->orphaned = true;
+	}
+
+	static void *writerMain(void *data)
+	{
+		AsyncOutput *obj = static_cast<AsyncOutput *>(data);
+		while (!obj->stopRequest) {
+			obj->wakeupSem.timedWait(WRITER_INTERVAL_MSEC);
+			obj->drain();
+		}
+		return NULL;
+	}
+
+	static void flushAtExit(void)
+	{
+		// The writer thread is stopped so that it doesn't use
+		// static objects being destructed.
+		getInstance().stopWriter();
+	}
+
+	static void prepareForkCb(void)
+	{
+		AsyncOutput &obj = getInstance();
+		obj.writerLock.lock();
+		obj.drainLock.lock();
+		obj.registryLock.lock();
+	}
+
+	static void parentForkCb(void)
+	{
+		AsyncOutput &obj = getInstance();
+		obj.registryLock.unlock();
+		obj.drainLock.unlock();
+		obj.writerLock.unlock();
+	}
+
+	static void childForkCb(void)
+	{
+		// Only the calling thread exists in the child. The buffered
+		// messages are written by the parent. The writer thread is
+		// started again when the child logs.
+		AsyncOutput &obj = getInstance();
+		list<LogRing *>::iterator it = obj.rings.begin();
+		for (; it != obj.rings.end(); ++it) {
+			LogRing *currRing = *it;
+			currRing->head = currRing->tail;
+			if (currRing != ring)
+				currRing->orphaned = true;
+		}
+		obj.writerRunning = false;
+		obj.registryLock.unlock();
+		obj.drainLock.unlock();
+		obj.writerLock.unlock();
+	}
+};
+
+__thread LogRing *AsyncOutput::ring = NULL;
+__thread bool     AsyncOutput::draining = false;
+
 // ----------------------------------------------------------------------------
 // Public methods
 // ----------------------------------------------------------------------------
@@ -70,16 +380,18 @@ void Logger::log(LogLevel level, const char *fileName, int lineNumber,
 	string body = StringUtils::vsprintf(fmt, ap);
 	va_end(ap);
 
-	fprintf(stderr, "%s%s", header.c_str(), body.c_str());
-
-	lock.readLock();
-	if (syslogoutputFlag) {
-		connectSyslogIfNeeded();
-		lock.unlock();
-		syslog(LOG_INFO, "%s%s", header.c_str(), body.c_str());
-	} else {
-		lock.unlock();
+	setupAsyncOutputIfNeeded();
+	AsyncOutput &asyncOutput = AsyncOutput::getInstance();
+	const string msg = header + body;
+	if (level > MLPL_LOG_CRIT) {
+		if (asyncOutput.push(msg))
+			return;
+	} else if (asyncOutput.enabled && !AsyncOutput::draining) {
+		// Critical messages should not be lost even if the process
+		// is aborted just after this.
+		asyncOutput.drain();
 	}
+	writeMessage(msg);
 }
 
 // ----------------------------------------------------------------------------
@@ -87,17 +399,10 @@ void Logger::log(LogLevel level, const char *fileName, int lineNumber,
 // ----------------------------------------------------------------------------
 bool Logger::shouldLog(LogLevel level)
 {
-	bool ret = false;
-	pthread_rwlock_rdlock(&m_rwlock);
-	if (m_currLogLevel == MLPL_LOG_LEVEL_NOT_SET) {
-		pthread_rwlock_unlock(&m_rwlock);
+	// The level is set only once. So no lock is needed after that.
+	if (m_currLogLevel == MLPL_LOG_LEVEL_NOT_SET)
 		setCurrLogLevel();
-		pthread_rwlock_rdlock(&m_rwlock);
-	}
-	if (level <= m_currLogLevel)
-		ret = true;
-	pthread_rwlock_unlock(&m_rwlock);
-	return ret;
+	return level <= m_currLogLevel;
 }
 
 void Logger::enableSyslogOutput(void)
@@ -114,6 +419,33 @@ void Logger::disableSyslogOutput(void)
 	lock.unlock();
 }
 
+void Logger::enableAsyncOutput(LogOverflowPolicy policy)
+{
+	AsyncOutput &asyncOutput = AsyncOutput::getInstance();
+	asyncOutput.policy = policy;
+	asyncOutput.enabled = true;
+}
+
+void Logger::disableAsyncOutput(void)
+{
+	AsyncOutput::getInstance().stopWriter();
+}
+
+bool Logger::isAsyncOutputEnabled(void)
+{
+	return AsyncOutput::getInstance().enabled;
+}
+
+void Logger::flush(void)
+{
+	AsyncOutput::getInstance().drain();
+}
+
+uint64_t Logger::getNumDroppedMessages(void)
+{
+	return AsyncOutput::getInstance().numDropped.get();
+}
+
 void Logger::setCurrLogLevel(void)
 {
 	pthread_rwlock_wrlock(&m_rwlock);
@@ -149,6 +481,60 @@ void Logger::setCurrLogLevel(void)
 	pthread_rwlock_unlock(&m_rwlock);
 }
 
+void Logger::setupAsyncOutputIfNeeded(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	struct Setup {
+		static void run(void)
+		{
+			const char *env = getenv(ASYNC_ENV_VAR_NAME);
+			if (!env)
+				return;
+			const string envStr = env;
+			if (envStr == "DROP")
+				enableAsyncOutput(MLPL_LOG_OVERFLOW_DROP);
+			else if (envStr == "BLOCK")
+				enableAsyncOutput(MLPL_LOG_OVERFLOW_BLOCK);
+			else if (envStr == "SYNC")
+				enableAsyncOutput(MLPL_LOG_OVERFLOW_SYNC);
+		}
+	};
+	pthread_once(&once, Setup::run);
+}
+
+void Logger::writeMessage(const string &msg)
+{
+	fprintf(stderr, "%s", msg.c_str());
+
+	lock.readLock();
+	if (syslogoutputFlag) {
+		connectSyslogIfNeeded();
+		lock.unlock();
+		syslog(LOG_INFO, "%s", msg.c_str());
+	} else {
+		lock.unlock();
+	}
+}
+
+void Logger::writeMessages(const vector<string *> &msgs)
+{
+	// Write them to stderr at once.
+	string buf;
+	for (size_t i = 0; i < msgs.size(); i++)
+		buf += *msgs[i];
+	fwrite(buf.c_str(), 1, buf.size(), stderr);
+
+	lock.readLock();
+	if (!syslogoutputFlag) {
+		lock.unlock();
+		return;
+	}
+	connectSyslogIfNeeded();
+	lock.unlock();
+	for (size_t i = 0; i < msgs.size(); i++)
+		syslog(LOG_INFO, "%s", msgs[i]->c_str());
+}
+
 void Logger::connectSyslogIfNeeded(void)
 {
 	if (syslogConnected)
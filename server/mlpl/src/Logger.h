@@ -21,7 +21,9 @@
 #define Logger_h
 
 #include <pthread.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
 #include "ReadWriteLock.h"
 namespace mlpl {
 
@@ -37,10 +39,32 @@ enum LogLevel {
 	MLPL_LOG_LEVEL_NOT_SET,
 };
 
+/**
+ * What to do when the per-thread buffer of the asynchronous output is full.
+ */
+enum LogOverflowPolicy {
+	// Discard the message. The number of them is reported later.
+	MLPL_LOG_OVERFLOW_DROP,
+
+	// Wait until the writer thread makes a room.
+	MLPL_LOG_OVERFLOW_BLOCK,
+
+	// Write the message synchronously as the asynchronous output is
+	// disabled. The order of the messages may be changed.
+	MLPL_LOG_OVERFLOW_SYNC,
+};
+
 class Logger {
 public:
 	static const char *LEVEL_ENV_VAR_NAME;
 	static const char *MLPL_LOGGER_FLAGS;
+
+	/**
+	 * The name of the environment variable to enable the asynchronous
+	 * output. The value is one of "DROP", "BLOCK", and "SYNC" that
+	 * is the overflow policy.
+	 */
+	static const char *ASYNC_ENV_VAR_NAME;
 	static void log(LogLevel level,
 	                const char *fileName, int lineNumber,
 	                const char *fmt, ...)
@@ -48,8 +72,43 @@ public:
 	static bool shouldLog(LogLevel level);
 	static void enableSyslogOutput(void);
 	static void disableSyslogOutput(void);
+
+	/**
+	 * Enable the asynchronous output.
+	 *
+	 * After this function is called, log() only formats a message and
+	 * puts it into a buffer of the calling thread. A writer thread
+	 * writes the buffered messages to stderr and syslog in batches.
+	 * Messages with MLPL_LOG_CRIT or MLPL_LOG_BUG are still written
+	 * synchronously after the buffered ones.
+	 *
+	 * @param policy An overflow policy.
+	 */
+	static void enableAsyncOutput(
+	  LogOverflowPolicy policy = MLPL_LOG_OVERFLOW_DROP);
+
+	/**
+	 * Disable the asynchronous output. The buffered messages are
+	 * written before this function returns.
+	 */
+	static void disableAsyncOutput(void);
+
+	static bool isAsyncOutputEnabled(void);
+
+	/**
+	 * Write the buffered messages of all threads.
+	 */
+	static void flush(void);
+
+	/**
+	 * @return The number of messages dropped due to the overflow.
+	 */
+	static uint64_t getNumDroppedMessages(void);
 protected:
 	static void setCurrLogLevel(void);
+	static void setupAsyncOutputIfNeeded(void);
+	static void writeMessage(const std::string &msg);
+	static void writeMessages(const std::vector<std::string *> &msgs);
 	static void connectSyslogIfNeeded(void);
 	static std::string createHeader(LogLevel level, const char *fileName,
 	                                int lineNumber, std::string extraInfoString);
@@ -60,7 +119,8 @@ protected:
 	static void addCurrentTime(std::string &extraInfoSrting);
 	static void setupProcessId(void);
 private:
-	static LogLevel m_currLogLevel;
+	// This is read without a lock in shouldLog().
+	static volatile int m_currLogLevel;
 	static pthread_rwlock_t m_rwlock;
 	static bool syslogoutputFlag;
 	static ReadWriteLock lock;
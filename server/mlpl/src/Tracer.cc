@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include "Tracer.h"
+#include "Mutex.h"
+#include "Reaper.h"
+#include "StringUtils.h"
+#include "Logger.h"
+using namespace std;
+using namespace mlpl;
+
+const char *Tracer::DIR_ENV_VAR_NAME = "MLPL_TRACE_DIR";
+const char *Tracer::TRACE_FILE_MAGIC = "MLPLTRC";
+const uint32_t Tracer::TRACE_FILE_VERSION = 1;
+const size_t Tracer::DEFAULT_NUM_RECORDS = 65536;
+
+volatile int Tracer::m_state = Tracer::STATE_UNKNOWN;
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+static void closeFile(FILE *fp)
+{
+	fclose(fp);
+}
+
+struct ThreadRing {
+	uint32_t         generation;
+	int              fd;
+	size_t           mapSize;
+	TraceFileHeader *header;
+	TraceRecord     *records;
+	int32_t          tid;
+
+	ThreadRing(const uint32_t _generation)
+	: generation(_generation),
+	  fd(-1),
+	  mapSize(0),
+	  header(NULL),
+	  records(NULL),
+	  tid(syscall(SYS_gettid))
+	{
+	}
+
+	virtual ~ThreadRing()
+	{
+		if (header)
+			munmap(header, mapSize);
+		if (fd >= 0)
+			close(fd);
+	}
+
+	bool open(const string &directory, const size_t &numRecords)
+	{
+		const string path = StringUtils::sprintf(
+		  "%s/trace-%d-%d.ring", directory.c_str(), getpid(), tid);
+		fd = ::open(path.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+		if (fd < 0) {
+			MLPL_ERR("Failed to open: %s, errno: %d\n",
+			         path.c_str(), errno);
+			return false;
+		}
+		mapSize = sizeof(TraceFileHeader) +
+		          sizeof(TraceRecord) * numRecords;
+		if (ftruncate(fd, mapSize) == -1) {
+			MLPL_ERR("Failed to call ftruncate: %s, errno: %d\n",
+			         path.c_str(), errno);
+			return false;
+		}
+		void *addr = mmap(NULL, mapSize, PROT_READ|PROT_WRITE,
+		                  MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED) {
+			MLPL_ERR("Failed to call mmap: %s, errno: %d\n",
+			         path.c_str(), errno);
+			return false;
+		}
+		header = static_cast<TraceFileHeader *>(addr);
+		records = reinterpret_cast<TraceRecord *>(header + 1);
+
+		memset(header, 0, sizeof(TraceFileHeader));
+		strncpy(header->magic, Tracer::TRACE_FILE_MAGIC,
+		        sizeof(header->magic));
+		header->version    = Tracer::TRACE_FILE_VERSION;
+		header->recordSize = sizeof(TraceRecord);
+		header->numRecords = numRecords;
+		header->pid        = getpid();
+		header->tid        = tid;
+		return true;
+	}
+};
+
+struct TracerContext {
+	Mutex                      lock;
+	map<uint16_t, string>      names;      // should be used with lock.
+	string                     directory;  // should be used with lock.
+	size_t                     numRecords; // should be used with lock.
+
+	// Incremented when the output is changed. The ring of each thread
+	// is opened again when it differs from that of the ring.
+	volatile uint32_t          generation;
+
+	pthread_key_t              ringKey;
+	static __thread ThreadRing *ring;
+
+	static TracerContext &getInstance(void)
+	{
+		// This is never deleted, because threads may use it while
+		// static objects are destructed at exit.
+		static TracerContext *instance = new TracerContext();
+		return *instance;
+	}
+
+	TracerContext(void)
+	: numRecords(0),
+	  generation(0)
+	{
+		pthread_key_create(&ringKey, deleteRing);
+		pthread_atfork(prepareForkCb, parentForkCb, childForkCb);
+	}
+
+	ThreadRing *openRing(void)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		delete ring;
+		ring = new ThreadRing(generation);
+		pthread_setspecific(ringKey, ring);
+		if (!ring->open(directory, numRecords)) {
+			// The failed ring is kept not to try it again.
+			return NULL;
+		}
+		return ring;
+	}
+
+	// Should be called with lock
+	void writeNames(const map<uint16_t, string> &namesToWrite,
+	                const char *mode)
+	{
+		const string path = StringUtils::sprintf(
+		  "%s/trace-%d.names", directory.c_str(), getpid());
+		FILE *fp = fopen(path.c_str(), mode);
+		if (!fp) {
+			MLPL_ERR("Failed to open: %s, errno: %d\n",
+			         path.c_str(), errno);
+			return;
+		}
+		map<uint16_t, string>::const_iterator it =
+		  namesToWrite.begin();
+		for (; it != namesToWrite.end(); ++it)
+			fprintf(fp, "%u %s\n", it->first, it->second.c_str());
+		fclose(fp);
+	}
+
+	static void deleteRing(void *data)
+	{
+		delete static_cast<ThreadRing *>(data);
+	}
+
+	static void prepareForkCb(void)
+	{
+		getInstance().lock.lock();
+	}
+
+	static void parentForkCb(void)
+	{
+		getInstance().lock.unlock();
+	}
+
+	static void childForkCb(void)
+	{
+		// The child must not write to the files of the parent.
+		TracerContext &ctx = getInstance();
+		ctx.generation++;
+		if (!ctx.directory.empty())
+			ctx.writeNames(ctx.names, "w");
+		ctx.lock.unlock();
+	}
+};
+
+__thread ThreadRing *TracerContext::ring = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+bool Tracer::enable(const string &directory, const size_t &numRecords)
+{
+	TracerContext &ctx = TracerContext::getInstance();
+	ctx.lock.lock();
+	Reaper<Mutex> unlocker(&ctx.lock, Mutex::unlock);
+	if (numRecords == 0) {
+		MLPL_ERR("numRecords must not be 0.\n");
+		return false;
+	}
+	ctx.directory = directory;
+	ctx.numRecords = numRecords;
+	ctx.generation++;
+	ctx.writeNames(ctx.names, "w");
+	m_state = STATE_ENABLED;
+	return true;
+}
+
+void Tracer::disable(void)
+{
+	TracerContext &ctx = TracerContext::getInstance();
+	ctx.lock.lock();
+	m_state = STATE_DISABLED;
+	ctx.lock.unlock();
+}
+
+void Tracer::registerEvent(const uint16_t &eventId, const char *name)
+{
+	TracerContext &ctx = TracerContext::getInstance();
+	ctx.lock.lock();
+	Reaper<Mutex> unlocker(&ctx.lock, Mutex::unlock);
+	ctx.names[eventId] = name;
+	if (m_state != STATE_ENABLED)
+		return;
+	map<uint16_t, string> names;
+	names[eventId] = name;
+	ctx.writeNames(names, "a");
+}
+
+void Tracer::record(const uint16_t &eventId, const TracePhase &phase,
+                    const uint64_t &arg0, const uint64_t &arg1)
+{
+	TracerContext &ctx = TracerContext::getInstance();
+	ThreadRing *ring = TracerContext::ring;
+	if (!ring || ring->generation != ctx.generation) {
+		ring = ctx.openRing();
+		if (!ring)
+			return;
+	}
+	TraceFileHeader *header = ring->header;
+	if (!header)
+		return;
+
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	const uint64_t count = header->writeCount;
+	TraceRecord &rec = ring->records[count % header->numRecords];
+	rec.timestamp = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec.arg0      = arg0;
+	rec.arg1      = arg1;
+	rec.tid       = ring->tid;
+	rec.eventId   = eventId;
+	rec.phase     = phase;
+	rec.reserved  = 0;
+
+	// Readers may see the file while it is being written.
+	__sync_synchronize();
+	header->writeCount = count + 1;
+}
+
+bool Tracer::readRingFile(const string &path, TraceFileHeader &header,
+                          vector<TraceRecord> &records)
+{
+	FILE *fp = fopen(path.c_str(), "r");
+	if (!fp) {
+		MLPL_ERR("Failed to open: %s, errno: %d\n",
+		         path.c_str(), errno);
+		return false;
+	}
+	Reaper<FILE> closer(fp, closeFile);
+	if (fread(&header, sizeof(header), 1, fp) != 1) {
+		MLPL_ERR("Failed to read the header: %s\n", path.c_str());
+		return false;
+	}
+	if (strncmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) ||
+	    header.version != TRACE_FILE_VERSION ||
+	    header.recordSize != sizeof(TraceRecord) ||
+	    header.numRecords == 0) {
+		MLPL_ERR("Not a trace file: %s\n", path.c_str());
+		return false;
+	}
+
+	vector<TraceRecord> ring(header.numRecords);
+	if (fread(&ring[0], sizeof(TraceRecord), ring.size(), fp) !=
+	    ring.size()) {
+		MLPL_ERR("Failed to read records: %s\n", path.c_str());
+		return false;
+	}
+
+	// The oldest record is next to the latest one if the ring wrapped.
+	uint64_t first = 0;
+	if (header.writeCount > header.numRecords)
+		first = header.writeCount - header.numRecords;
+	for (uint64_t count = first; count < header.writeCount; count++)
+		records.push_back(ring[count % header.numRecords]);
+	return true;
+}
+
+bool Tracer::readNamesFile(const string &path, map<uint16_t, string> &names)
+{
+	FILE *fp = fopen(path.c_str(), "r");
+	if (!fp) {
+		MLPL_ERR("Failed to open: %s, errno: %d\n",
+		         path.c_str(), errno);
+		return false;
+	}
+	Reaper<FILE> closer(fp, closeFile);
+	unsigned int eventId;
+	char name[256];
+	while (fscanf(fp, "%u %255s", &eventId, name) == 2)
+		names[eventId] = name;
+	return true;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+void Tracer::setupFromEnv(void)
+{
+	TracerContext &ctx = TracerContext::getInstance();
+	ctx.lock.lock();
+	if (m_state != STATE_UNKNOWN) {
+		ctx.lock.unlock();
+		return;
+	}
+	const char *env = getenv(DIR_ENV_VAR_NAME);
+	if (!env) {
+		m_state = STATE_DISABLED;
+		ctx.lock.unlock();
+		return;
+	}
+	ctx.lock.unlock();
+	if (!enable(env))
+		disable();
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef Tracer_h
+#define Tracer_h
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+
+namespace mlpl {
+
+enum TracePhase {
+	MLPL_TRACE_PHASE_BEGIN,
+	MLPL_TRACE_PHASE_END,
+	MLPL_TRACE_PHASE_INSTANT,
+};
+
+// The layouts of the following structures are the file format.
+// So they must not be changed without updating TRACE_FILE_VERSION.
+struct TraceFileHeader {
+	char     magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint64_t numRecords;  // The capacity of the ring
+	uint64_t writeCount;  // The total number of written records
+	int32_t  pid;
+	int32_t  tid;
+	uint8_t  reserved[24];
+};
+
+struct TraceRecord {
+	uint64_t timestamp;   // nsec. of CLOCK_MONOTONIC
+	uint64_t arg0;
+	uint64_t arg1;
+	int32_t  tid;
+	uint16_t eventId;
+	uint8_t  phase;
+	uint8_t  reserved;
+};
+
+/**
+ * A binary trace facility for hot paths.
+ *
+ * Each thread writes fixed-size records to its own ring file:
+ * <directory>/trace-<pid>-<tid>.ring, which is mapped with mmap().
+ * So recording takes no lock and no system call except clock_gettime().
+ * Names of the event IDs are written to <directory>/trace-<pid>.names.
+ *
+ * The tracer is enabled when the environment variable MLPL_TRACE_DIR
+ * is set, or enable() is called.
+ */
+class Tracer {
+public:
+	static const char *DIR_ENV_VAR_NAME;
+	static const char *TRACE_FILE_MAGIC;
+	static const uint32_t TRACE_FILE_VERSION;
+	static const size_t DEFAULT_NUM_RECORDS;
+
+	static bool isEnabled(void)
+	{
+		if (m_state == STATE_UNKNOWN)
+			setupFromEnv();
+		return m_state == STATE_ENABLED;
+	}
+
+	/**
+	 * Enable the tracer.
+	 *
+	 * @param directory A directory where the ring files are created.
+	 * @param numRecords The number of records in a ring file.
+	 * @return true on success. Otherwise false.
+	 */
+	static bool enable(const std::string &directory,
+	                   const size_t &numRecords = DEFAULT_NUM_RECORDS);
+
+	/**
+	 * Disable the tracer. The ring files that have been written are
+	 * left as they are.
+	 */
+	static void disable(void);
+
+	/**
+	 * Register a name of an event ID. It is used to show the event
+	 * in the converted trace.
+	 */
+	static void registerEvent(const uint16_t &eventId, const char *name);
+
+	static void record(const uint16_t &eventId, const TracePhase &phase,
+	                   const uint64_t &arg0 = 0, const uint64_t &arg1 = 0);
+
+	/**
+	 * Read records in a ring file in the order of writing.
+	 *
+	 * @return true on success. Otherwise false.
+	 */
+	static bool readRingFile(const std::string &path,
+	                         TraceFileHeader &header,
+	                         std::vector<TraceRecord> &records);
+
+	/**
+	 * Read a names file written by the tracer.
+	 *
+	 * @return true on success. Otherwise false.
+	 */
+	static bool readNamesFile(const std::string &path,
+	                          std::map<uint16_t, std::string> &names);
+
+protected:
+	enum State {
+		STATE_UNKNOWN,
+		STATE_DISABLED,
+		STATE_ENABLED,
+	};
+
+	static void setupFromEnv(void);
+
+private:
+	static volatile int m_state;
+};
+
+/**
+ * Records MLPL_TRACE_PHASE_BEGIN on construction and
+ * MLPL_TRACE_PHASE_END on destruction.
+ */
+class TraceScope {
+public:
+	TraceScope(const uint16_t &eventId,
+	           const uint64_t &arg0 = 0, const uint64_t &arg1 = 0)
+	: m_eventId(eventId),
+	  m_enabled(Tracer::isEnabled())
+	{
+		if (m_enabled)
+			Tracer::record(m_eventId, MLPL_TRACE_PHASE_BEGIN,
+			               arg0, arg1);
+	}
+
+	virtual ~TraceScope()
+	{
+		if (m_enabled)
+			Tracer::record(m_eventId, MLPL_TRACE_PHASE_END);
+	}
+
+private:
+	const uint16_t m_eventId;
+	const bool     m_enabled;
+};
+
+} // namespace mlpl
+
+#define MLPL_TRACE(ID, PHASE, ...) \
+do { \
+  if (mlpl::Tracer::isEnabled()) \
+    mlpl::Tracer::record(ID, PHASE, ##__VA_ARGS__); \
+} while (0)
+
+#define MLPL_TRACE_INSTANT(ID, ...) \
+  MLPL_TRACE(ID, mlpl::MLPL_TRACE_PHASE_INSTANT, ##__VA_ARGS__)
+
+#define MLPL_TRACE_SCOPE_NAME_(LINE) mlplTraceScope ## LINE
+#define MLPL_TRACE_SCOPE_NAME(LINE) MLPL_TRACE_SCOPE_NAME_(LINE)
+#define MLPL_TRACE_SCOPE(ID, ...) \
+  mlpl::TraceScope MLPL_TRACE_SCOPE_NAME(__LINE__)(ID, ##__VA_ARGS__)
+
+#endif // Tracer_h
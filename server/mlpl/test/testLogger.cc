@@ -346,6 +346,8 @@ void cut_teardown(void)
 		g_error_free(g_error);
 		g_error = NULL;
 	}
+	unsetenv(Logger::ASYNC_ENV_VAR_NAME);
+	Logger::disableAsyncOutput();
 }
 
 // ---------------------------------------------------------------------------
@@ -411,6 +413,45 @@ void test_envLevelBUG(void)
 	assertLogOutput("BUG", "BUG",  true);
 }
 
+void data_envAsync(void)
+{
+	gcut_add_datum("DROP",  "policy", G_TYPE_STRING, "DROP",  NULL);
+	gcut_add_datum("BLOCK", "policy", G_TYPE_STRING, "BLOCK", NULL);
+	gcut_add_datum("SYNC",  "policy", G_TYPE_STRING, "SYNC",  NULL);
+}
+
+void test_envAsync(gconstpointer data)
+{
+	// The buffered message should be written at exit.
+	const char *policy = gcut_data_get_string(data, "policy");
+	cppcut_assert_equal(
+	  0, setenv(Logger::ASYNC_ENV_VAR_NAME, policy, 1));
+	assertLogOutput("INFO", "DBG",  false);
+	assertLogOutput("INFO", "INFO", true);
+	assertLogOutput("INFO", "CRIT", true);
+}
+
+void test_enableAsyncOutput(void)
+{
+	Logger::enableAsyncOutput(MLPL_LOG_OVERFLOW_BLOCK);
+	cppcut_assert_equal(true, Logger::isAsyncOutputEnabled());
+	Logger::disableAsyncOutput();
+	cppcut_assert_equal(false, Logger::isAsyncOutputEnabled());
+}
+
+void test_asyncOutputDropNothingWithBlock(void)
+{
+	Logger::disableSyslogOutput();
+	Logger::enableAsyncOutput(MLPL_LOG_OVERFLOW_BLOCK);
+	const uint64_t numDropped = Logger::getNumDroppedMessages();
+	// More than the size of the per-thread buffer
+	for (size_t i = 0; i < 2000; i++)
+		Logger::log(MLPL_LOG_INFO, __FILE__, __LINE__, "%zd\n", i);
+	Logger::flush();
+	cppcut_assert_equal(numDropped, Logger::getNumDroppedMessages());
+	Logger::enableSyslogOutput();
+}
+
 void test_syslogoutput(void)
 {
 	assertSyslogOutput("Test message", "Test message",  true);
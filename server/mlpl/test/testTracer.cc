@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <cppcutter.h>
+#include "Tracer.h"
+#include "StringUtils.h"
+
+using namespace std;
+using namespace mlpl;
+
+namespace testTracer {
+
+static string g_traceDir;
+
+static string getRingFilePath(void)
+{
+	return StringUtils::sprintf("%s/trace-%d-%ld.ring", g_traceDir.c_str(),
+	                            getpid(), syscall(SYS_gettid));
+}
+
+static void _assertReadRecords(vector<TraceRecord> &records)
+{
+	TraceFileHeader header;
+	cppcut_assert_equal(
+	  true, Tracer::readRingFile(getRingFilePath(), header, records));
+	cppcut_assert_equal(getpid(), header.pid);
+}
+#define assertReadRecords(R) cut_trace(_assertReadRecords(R))
+
+void cut_setup(void)
+{
+	g_traceDir = StringUtils::sprintf("/tmp/testTracer-%d", getpid());
+	cut_remove_path(g_traceDir.c_str(), NULL);
+	cppcut_assert_equal(0, mkdir(g_traceDir.c_str(), 0755));
+}
+
+void cut_teardown(void)
+{
+	Tracer::disable();
+	cut_remove_path(g_traceDir.c_str(), NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_isEnabled(void)
+{
+	cppcut_assert_equal(true, Tracer::enable(g_traceDir));
+	cppcut_assert_equal(true, Tracer::isEnabled());
+	Tracer::disable();
+	cppcut_assert_equal(false, Tracer::isEnabled());
+}
+
+void test_record(void)
+{
+	cppcut_assert_equal(true, Tracer::enable(g_traceDir));
+	{
+		MLPL_TRACE_SCOPE(5, 10, 20);
+		MLPL_TRACE_INSTANT(6, 30);
+	}
+
+	vector<TraceRecord> records;
+	assertReadRecords(records);
+	cppcut_assert_equal((size_t)3, records.size());
+
+	const uint16_t expectedIds[] = {5, 6, 5};
+	const uint8_t expectedPhases[] = {
+	  MLPL_TRACE_PHASE_BEGIN,
+	  MLPL_TRACE_PHASE_INSTANT,
+	  MLPL_TRACE_PHASE_END,
+	};
+	const uint64_t expectedArgs0[] = {10, 30, 0};
+	for (size_t i = 0; i < records.size(); i++) {
+		cppcut_assert_equal(expectedIds[i], records[i].eventId);
+		cppcut_assert_equal(expectedPhases[i], records[i].phase);
+		cppcut_assert_equal(expectedArgs0[i], records[i].arg0);
+		cppcut_assert_equal((int32_t)syscall(SYS_gettid),
+		                    records[i].tid);
+	}
+	cppcut_assert_equal(true,
+	                    records[0].timestamp <= records[2].timestamp);
+}
+
+void test_notRecordedWhenDisabled(void)
+{
+	cppcut_assert_equal(true, Tracer::enable(g_traceDir));
+	MLPL_TRACE_INSTANT(1);
+	Tracer::disable();
+	MLPL_TRACE_INSTANT(2);
+
+	vector<TraceRecord> records;
+	assertReadRecords(records);
+	cppcut_assert_equal((size_t)1, records.size());
+	cppcut_assert_equal((uint16_t)1, records[0].eventId);
+}
+
+void test_wrapAround(void)
+{
+	const size_t numRecords = 4;
+	cppcut_assert_equal(true, Tracer::enable(g_traceDir, numRecords));
+	for (uint64_t i = 0; i < 10; i++)
+		MLPL_TRACE_INSTANT(1, i);
+
+	// Only the latest records are kept.
+	vector<TraceRecord> records;
+	assertReadRecords(records);
+	cppcut_assert_equal(numRecords, records.size());
+	for (size_t i = 0; i < records.size(); i++)
+		cppcut_assert_equal((uint64_t)(6 + i), records[i].arg0);
+}
+
+void test_registerEvent(void)
+{
+	Tracer::registerEvent(100, "BeforeEnabled");
+	cppcut_assert_equal(true, Tracer::enable(g_traceDir));
+	Tracer::registerEvent(101, "AfterEnabled");
+
+	const string path = StringUtils::sprintf(
+	  "%s/trace-%d.names", g_traceDir.c_str(), getpid());
+	map<uint16_t, string> names;
+	cppcut_assert_equal(true, Tracer::readNamesFile(path, names));
+	cppcut_assert_equal(string("BeforeEnabled"), names[100]);
+	cppcut_assert_equal(string("AfterEnabled"), names[101]);
+}
+
+} // namespace testTracer
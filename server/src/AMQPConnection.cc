@@ -17,6 +17,7 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <inttypes.h>
 #include "AMQPConnection.h"
 
 using namespace std;
@@ -488,11 +489,30 @@ bool AMQPConnection::startConsuming(void)
 	if (!isConnected())
 		return false;
 
+	if (isAckRequired()) {
+		const uint32_t prefetch_size = 0;
+		const uint16_t prefetch_count =
+			getConnectionInfo().getPrefetchCount();
+		const amqp_boolean_t global = false;
+		const amqp_basic_qos_ok_t *qosResponse =
+			amqp_basic_qos(getConnection(),
+				       getChannel(),
+				       prefetch_size,
+				       prefetch_count,
+				       global);
+		if (!qosResponse) {
+			const amqp_rpc_reply_t reply =
+				amqp_get_rpc_reply(getConnection());
+			logErrorResponse("set prefetch count", reply);
+			return false;
+		}
+	}
+
 	const amqp_bytes_t queue =
 		amqp_cstring_bytes(getQueueName().c_str());
 	const amqp_bytes_t consumer_tag = amqp_empty_bytes;
 	const amqp_boolean_t no_local = false;
-	const amqp_boolean_t no_ack = true;
+	const amqp_boolean_t no_ack = !isAckRequired();
 	const amqp_boolean_t exclusive = false;
 	const amqp_table_t arguments = amqp_empty_table;
 	const amqp_basic_consume_ok_t *response;
@@ -516,6 +536,11 @@ bool AMQPConnection::startConsuming(void)
 }
 
 bool AMQPConnection::consume(AMQPMessage &message)
+{
+	return consume(message, getTimeout() * 1000);
+}
+
+bool AMQPConnection::consume(AMQPMessage &message, const size_t &timeoutMSec)
 {
 	if (!isConnected())
 		return false;
@@ -523,8 +548,8 @@ bool AMQPConnection::consume(AMQPMessage &message)
 	amqp_maybe_release_buffers(getConnection());
 
 	struct timeval timeout = {
-		getTimeout(),
-		0
+		static_cast<time_t>(timeoutMSec / 1000),
+		static_cast<suseconds_t>((timeoutMSec % 1000) * 1000)
 	};
 	const int flags = 0;
 	amqp_envelope_t envelope;
@@ -541,6 +566,7 @@ bool AMQPConnection::consume(AMQPMessage &message)
 		  static_cast<int>(contentType->len));
 		message.body.assign(static_cast<char*>(body->bytes),
 				    static_cast<int>(body->len));
+		message.deliveryTag = envelope.delivery_tag;
 		amqp_destroy_envelope(&envelope);
 	}
 
@@ -562,6 +588,29 @@ bool AMQPConnection::consume(AMQPMessage &message)
 	return true;
 }
 
+bool AMQPConnection::ack(const uint64_t &deliveryTag, const bool &multiple)
+{
+	if (!isConnected())
+		return false;
+
+	const int status = amqp_basic_ack(getConnection(),
+					  getChannel(),
+					  deliveryTag,
+					  multiple);
+	if (status != AMQP_STATUS_OK) {
+		MLPL_ERR("failed to ack message: %" PRIu64 ": %d: %s\n",
+			 deliveryTag, status, amqp_error_string2(status));
+		disposeConnection();
+		return false;
+	}
+	return true;
+}
+
+bool AMQPConnection::isAckRequired(void)
+{
+	return getConnectionInfo().getPrefetchCount() > 0;
+}
+
 bool AMQPConnection::publish(const AMQPMessage &message)
 {
 	if (!isConnected())
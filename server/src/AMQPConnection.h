@@ -22,6 +22,7 @@
 #include "AMQPConnectionInfo.h"
 #include <glib.h>
 #include <unistd.h>
+#include <vector>
 #include <Logger.h>
 #include <StringUtils.h>
 #include <UsedCountable.h>
@@ -35,8 +36,18 @@ typedef UsedCountablePtr<AMQPConnection> AMQPConnectionPtr;
 struct AMQPMessage {
 	std::string contentType;
 	std::string body;
+	uint64_t deliveryTag;
+
+	AMQPMessage()
+	: deliveryTag(0)
+	{
+	}
 };
 
+typedef std::vector<AMQPMessage>          AMQPMessageVect;
+typedef AMQPMessageVect::iterator         AMQPMessageVectIterator;
+typedef AMQPMessageVect::const_iterator   AMQPMessageVectConstIterator;
+
 struct AMQPJSONMessage : public AMQPMessage {
 	AMQPJSONMessage()
 	{
@@ -56,6 +67,19 @@ public:
 	bool isConnected(void);
 	bool startConsuming(void);
 	bool consume(AMQPMessage &message);
+	bool consume(AMQPMessage &message, const size_t &timeoutMSec);
+
+	/**
+	 * Acknowledge delivered messages. This is needed only when
+	 * isAckRequired() is true.
+	 *
+	 * @param deliveryTag A delivery tag of the message.
+	 * @param multiple
+	 * If this is true, all messages up to and including deliveryTag
+	 * are acknowledged.
+	 */
+	bool ack(const uint64_t &deliveryTag, const bool &multiple = false);
+	bool isAckRequired(void);
 	bool publish(const AMQPMessage &message);
 	bool purgeQueue(void);
 	bool deleteQueue(void);
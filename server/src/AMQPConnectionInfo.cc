@@ -27,6 +27,9 @@
 
 static const char  *DEFAULT_URL     = "amqp://localhost";
 static const time_t DEFAULT_TIMEOUT = 1;
+static const uint16_t DEFAULT_PREFETCH_COUNT = 0;
+static const size_t DEFAULT_BATCH_SIZE = 1;
+static const size_t DEFAULT_BATCH_TIMEOUT_MSEC = 0;
 
 using namespace std;
 using namespace mlpl;
@@ -37,7 +40,10 @@ struct AMQPConnectionInfo::Impl {
 	  m_URLBuf(NULL),
 	  m_parsedURL(),
 	  m_queueName(),
-	  m_timeout(DEFAULT_TIMEOUT)
+	  m_timeout(DEFAULT_TIMEOUT),
+	  m_prefetchCount(DEFAULT_PREFETCH_COUNT),
+	  m_batchSize(DEFAULT_BATCH_SIZE),
+	  m_batchTimeoutMSec(DEFAULT_BATCH_TIMEOUT_MSEC)
 	{
 		amqp_default_connection_info(&m_parsedURL);
 		setURL(DEFAULT_URL);
@@ -68,6 +74,9 @@ struct AMQPConnectionInfo::Impl {
 	amqp_connection_info m_parsedURL;
 	string m_queueName;
 	time_t m_timeout;
+	uint16_t m_prefetchCount;
+	size_t m_batchSize;
+	size_t m_batchTimeoutMSec;
 	string m_tlsCertificatePath;
 	string m_tlsKeyPath;
 	string m_tlsCACertificatePath;
@@ -96,12 +105,18 @@ AMQPConnectionInfo::AMQPConnectionInfo(const AMQPConnectionInfo &info)
 {
 	m_impl->setURL(info.m_impl->m_URL);
 	m_impl->m_queueName = info.m_impl->m_queueName;
+	m_impl->m_prefetchCount = info.m_impl->m_prefetchCount;
+	m_impl->m_batchSize = info.m_impl->m_batchSize;
+	m_impl->m_batchTimeoutMSec = info.m_impl->m_batchTimeoutMSec;
 }
 
 AMQPConnectionInfo &AMQPConnectionInfo::operator=(const AMQPConnectionInfo &info)
 {
 	m_impl->setURL(info.m_impl->m_URL);
 	m_impl->m_queueName = info.m_impl->m_queueName;
+	m_impl->m_prefetchCount = info.m_impl->m_prefetchCount;
+	m_impl->m_batchSize = info.m_impl->m_batchSize;
+	m_impl->m_batchTimeoutMSec = info.m_impl->m_batchTimeoutMSec;
 	return *this;
 }
 
@@ -169,6 +184,36 @@ void AMQPConnectionInfo::setTimeout(const time_t &timeout)
 	m_impl->m_timeout = timeout;
 }
 
+uint16_t AMQPConnectionInfo::getPrefetchCount(void) const
+{
+	return m_impl->m_prefetchCount;
+}
+
+void AMQPConnectionInfo::setPrefetchCount(const uint16_t &prefetchCount)
+{
+	m_impl->m_prefetchCount = prefetchCount;
+}
+
+size_t AMQPConnectionInfo::getBatchSize(void) const
+{
+	return m_impl->m_batchSize;
+}
+
+void AMQPConnectionInfo::setBatchSize(const size_t &batchSize)
+{
+	m_impl->m_batchSize = batchSize;
+}
+
+size_t AMQPConnectionInfo::getBatchTimeoutMSec(void) const
+{
+	return m_impl->m_batchTimeoutMSec;
+}
+
+void AMQPConnectionInfo::setBatchTimeoutMSec(const size_t &timeoutMSec)
+{
+	m_impl->m_batchTimeoutMSec = timeoutMSec;
+}
+
 const string &AMQPConnectionInfo::getTLSCertificatePath(void) const
 {
 	return m_impl->m_tlsCertificatePath;
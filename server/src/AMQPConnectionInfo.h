@@ -20,6 +20,7 @@
 #ifndef AMQPConnectionInfo_h
 #define AMQPConnectionInfo_h
 
+#include <stdint.h>
 #include <string>
 #include <memory>
 #include "Params.h"
@@ -47,6 +48,28 @@ public:
 	time_t getTimeout(void) const;
 	void setTimeout(const time_t &timeout);
 
+	/**
+	 * The number of unacknowledged messages the broker may deliver
+	 * (basic.qos). 0 means that messages are acknowledged
+	 * automatically on delivery.
+	 */
+	uint16_t getPrefetchCount(void) const;
+	void setPrefetchCount(const uint16_t &prefetchCount);
+
+	/**
+	 * The maximum number of messages that AMQPConsumer passes to the
+	 * handler at once.
+	 */
+	size_t getBatchSize(void) const;
+	void setBatchSize(const size_t &batchSize);
+
+	/**
+	 * The maximum time in msec. that AMQPConsumer waits for following
+	 * messages after it got the first message of a batch.
+	 */
+	size_t getBatchTimeoutMSec(void) const;
+	void setBatchTimeoutMSec(const size_t &timeoutMSec);
+
 	const std::string &getTLSCertificatePath(void) const;
 	void setTLSCertificatePath(const std::string &path);
 
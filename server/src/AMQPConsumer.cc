@@ -24,6 +24,7 @@
 #include <unistd.h>
 #include <Logger.h>
 #include <Reaper.h>
+#include <SmartTime.h>
 #include <StringUtils.h>
 #include <amqp_tcp_socket.h>
 #include <amqp_ssl_socket.h>
@@ -44,6 +45,48 @@ struct AMQPConsumer::Impl {
 
 	AMQPConnectionPtr m_connection;
 	AMQPMessageHandler *m_handler;
+
+	/**
+	 * Wait for a message with the timeout of the connection, then
+	 * drain following messages until the batch size is reached or
+	 * the batch timeout expires.
+	 */
+	void consumeBatch(AMQPMessageVect &messages)
+	{
+		AMQPMessage message;
+		if (!m_connection->consume(message))
+			return;
+		messages.push_back(message);
+
+		const AMQPConnectionInfo &info =
+		  m_connection->getConnectionInfo();
+		const size_t batchSize = info.getBatchSize();
+		const double batchTimeoutMSec = info.getBatchTimeoutMSec();
+		const SmartTime startTime(SmartTime::INIT_CURR_TIME);
+		while (messages.size() < batchSize) {
+			SmartTime elapsed(SmartTime::INIT_CURR_TIME);
+			elapsed -= startTime;
+			const double remainingMSec =
+			  batchTimeoutMSec - elapsed.getAsMSec();
+			if (remainingMSec <= 0)
+				break;
+			AMQPMessage nextMessage;
+			const size_t timeoutMSec = remainingMSec;
+			if (!m_connection->consume(nextMessage, timeoutMSec))
+				break;
+			messages.push_back(nextMessage);
+		}
+	}
+
+	void acknowledge(const AMQPMessageVect &messages)
+	{
+		if (!m_connection->isAckRequired())
+			return;
+		// Delivery tags on a channel are monotonically increasing.
+		// So the last one acknowledges the whole batch.
+		const bool multiple = true;
+		m_connection->ack(messages.back().deliveryTag, multiple);
+	}
 };
 
 AMQPConsumer::AMQPConsumer(const AMQPConnectionInfo &connectionInfo,
@@ -89,12 +132,20 @@ gpointer AMQPConsumer::mainThread(HatoholThreadArg *arg)
 			continue;
 		}
 
-		AMQPMessage message;
-		const bool consumed = m_impl->m_connection->consume(message);
-		if (!consumed)
+		AMQPMessageVect messages;
+		m_impl->consumeBatch(messages);
+		if (messages.empty())
+			continue;
+
+		// Unacknowledged messages are delivered again after the
+		// connection is lost. Don't handle them twice.
+		if (m_impl->m_connection->isAckRequired() &&
+		    !m_impl->m_connection->isConnected())
 			continue;
 
-		m_impl->m_handler->handle(*m_impl->m_connection, message);
+		m_impl->m_handler->handleBatch(*m_impl->m_connection,
+					       messages);
+		m_impl->acknowledge(messages);
 	}
 	return NULL;
 }
@@ -26,3 +26,15 @@ AMQPMessageHandler::AMQPMessageHandler()
 AMQPMessageHandler::~AMQPMessageHandler()
 {
 }
+
+bool AMQPMessageHandler::handleBatch(AMQPConnection &connection,
+				     const AMQPMessageVect &messages)
+{
+	bool succeeded = true;
+	AMQPMessageVectConstIterator it = messages.begin();
+	for (; it != messages.end(); ++it) {
+		if (!handle(connection, *it))
+			succeeded = false;
+	}
+	return succeeded;
+}
@@ -32,6 +32,14 @@ public:
 
 	virtual bool handle(AMQPConnection &connection,
 			    const AMQPMessage &message) = 0;
+
+	/**
+	 * Handle messages that are consumed at once. The default
+	 * implementation calls handle() for each message.
+	 * Subclasses can override it to store the messages together.
+	 */
+	virtual bool handleBatch(AMQPConnection &connection,
+				 const AMQPMessageVect &messages);
 };
 
 #endif // AMQPMessageHandler_h
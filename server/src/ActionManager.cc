@@ -17,6 +17,7 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <deque>
 #include <errno.h>
@@ -37,6 +38,8 @@
 #include "ChildProcessManager.h"
 #include "IncidentSenderManager.h"
 #include "ThreadLocalDBCache.h"
+#include "ActionRuleIndex.h"
+#include "HatoholTracePoint.h"
 
 using namespace std;
 using namespace mlpl;
@@ -47,6 +50,7 @@ struct ActionManager::ResidentNotifyInfo {
 	uint64_t  logId;
 	EventInfo eventInfo; // a replica
 	string    sessionId;
+	uint32_t  sequence;
 
 	ResidentNotifyInfo(ResidentInfo *_residentInfo);
 	virtual ~ResidentNotifyInfo();
@@ -79,12 +83,14 @@ struct SpawnPostprocCommandActionCtx {
 	ActorInfo *actorInfoCopy;
 	size_t     reservationId;
 	WaitingCommandActionInfo *waitCmdInfo;
+	double     waitTimeMSec;
 
 	// constructor
 	SpawnPostprocCommandActionCtx(void)
 	: actorInfoCopy(NULL),
 	  reservationId(-1),
-	  waitCmdInfo(NULL)
+	  waitCmdInfo(NULL),
+	  waitTimeMSec(0)
 	{
 	}
 };
@@ -102,6 +108,14 @@ struct ResidentInfo :
 	ResidentNotifyQueue notifyQueue; // should be used with queueLock.
 	ResidentStatus      status;      // should be used with queueLock.
 
+	// The first 'numInFlight' elements of notifyQueue have been sent
+	// to hatohol-resident-yard and wait for the ack.
+	size_t              numInFlight;  // should be used with queueLock.
+	uint32_t            nextSequence; // should be used with queueLock.
+
+	// Keeps the order of the sequence numbers in the pipe.
+	Mutex               sendLock;
+
 	NamedPipe pipeRd, pipeWr;
 	string pipeName;
 	string modulePath;
@@ -113,6 +127,8 @@ struct ResidentInfo :
 	  pid(0),
 	  inRunningResidentMap(false),
 	  status(RESIDENT_STAT_INIT),
+	  numInFlight(0),
+	  nextSequence(0),
 	  pipeRd(NamedPipe::END_TYPE_MASTER_READ),
 	  pipeWr(NamedPipe::END_TYPE_MASTER_WRITE)
 	{
@@ -209,7 +225,8 @@ RunningResidentMap ResidentInfo::runningResidentMap;
 // ---------------------------------------------------------------------------
 ActionManager::ResidentNotifyInfo::ResidentNotifyInfo(ResidentInfo *_residentInfo)
 : residentInfo(_residentInfo),
-  logId(INVALID_ACTION_LOG_ID)
+  logId(INVALID_ACTION_LOG_ID),
+  sequence(0)
 {
 	SessionManager *sessionMgr = SessionManager::getInstance();
 	sessionId = sessionMgr->create(residentInfo->actionDef.ownerUserId,
@@ -230,6 +247,7 @@ struct WaitingCommandActionInfo {
 	ActionDef actionDef;
 	EventInfo eventInfo;
 	StringVector argVect;
+	SmartTime queuedTime;
 
 	// The following variable is used only when the waiting action passes
 	// a reservation ID from the collectedCallback to the
@@ -246,6 +264,8 @@ struct CommandActionContext {
 	static deque<WaitingCommandActionInfo *> waitingList;
 	static set<uint64_t> runningSet;  // key is logId
 	static set<size_t>   reservedSet;
+	static map<uint64_t, SmartTime> startTimeMap; // key is logId
+	static ActionManager::CommandActionStats stats;
 
 	// methods
 	static void reset(void)
@@ -259,6 +279,8 @@ struct CommandActionContext {
 		waitingList.clear();
 		runningSet.clear();
 		reservedSet.clear();
+		startTimeMap.clear();
+		stats = ActionManager::CommandActionStats();
 	}
 
 	/**
@@ -266,12 +288,17 @@ struct CommandActionContext {
 	 * actors and reserved actors (the number of onstage actors) is less
 	 * than the limit, this function returns a reservationId that is
 	 * needed to add the actor to runningSet. Otherwise the action
-	 * is added to the queue and executed later.
+	 * is added to the queue and executed later. If the queue is also
+	 * full, the action is logged as a failure and is not executed.
 	 *
 	 * @param reservationId
 	 * A reservation ID. This is returned only when the number of onstage
 	 * actors less than the limit. Otherwise it is not changed.
 	 *
+	 * @param rejectedLogId
+	 * The log ID of the action rejected because the queue is full.
+	 * Otherwise it is not changed.
+	 *
 	 * @param actionDef A reference of ActionDef.
 	 * @param eventInfo A reference of EventInfo.
 	 * @param dbAction  A reference of DBTablesAction.
@@ -282,7 +309,8 @@ struct CommandActionContext {
 	 * is returned.
 	 */
 	static WaitingCommandActionInfo *reserve(
-	  size_t &reservationId, const ActionDef &actionDef,
+	  size_t &reservationId, ActionLogIdType &rejectedLogId,
+	  const ActionDef &actionDef,
 	  const EventInfo &eventInfo, DBTablesAction &dbAction,
 	  const StringVector &argVect)
 	{
@@ -291,6 +319,19 @@ struct CommandActionContext {
 
 		// check the number of running actions
 		if (isFullHouse()) {
+			if (isWaitingListFull()) {
+				stats.numRejected++;
+				lock.unlock();
+				rejectedLogId = dbAction.createActionLog(
+				  actionDef, eventInfo,
+				  ACTLOG_EXECFAIL_QUEUE_FULL);
+				MLPL_WARN("Command action queue is full. "
+				          "ActionID: %" FMT_ACTION_ID
+				          ", LogID: %" FMT_ACTION_LOG_ID "\n",
+				          actionDef.id, rejectedLogId);
+				return NULL;
+			}
+			stats.numQueued++;
 			waitCmdInfo =
 			  insertToWaitingCommandActionList(
 			    actionDef, eventInfo, dbAction, argVect);
@@ -311,10 +352,16 @@ struct CommandActionContext {
 		lock.unlock();
 	}
 
-	static void add(const size_t reservationId, const uint64_t logId)
+	static void add(const size_t reservationId, const uint64_t logId,
+	                const double &waitTimeMSec)
 	{
 		lock.lock();
 		removeReservationId(reservationId);
+		startTimeMap[logId] = SmartTime(SmartTime::INIT_CURR_TIME);
+		stats.numStarted++;
+		stats.totalWaitTimeMSec += waitTimeMSec;
+		if (waitTimeMSec > stats.maxWaitTimeMSec)
+			stats.maxWaitTimeMSec = waitTimeMSec;
 
 		// insert the log ID
 		pair<set<uint64_t>::iterator, bool> result =
@@ -331,6 +378,19 @@ struct CommandActionContext {
 		HATOHOL_ASSERT(it != runningSet.end(),
 		               "Not found log ID: %" PRIu64 "\n", logId);
 		runningSet.erase(it);
+
+		map<uint64_t, SmartTime>::iterator timeIt =
+		  startTimeMap.find(logId);
+		if (timeIt != startTimeMap.end()) {
+			SmartTime runTime(SmartTime::INIT_CURR_TIME);
+			runTime -= timeIt->second;
+			const double runTimeMSec = runTime.getAsMSec();
+			stats.numFinished++;
+			stats.totalRunTimeMSec += runTimeMSec;
+			if (runTimeMSec > stats.maxRunTimeMSec)
+				stats.maxRunTimeMSec = runTimeMSec;
+			startTimeMap.erase(timeIt);
+		}
 		lock.unlock();
 	}
 
@@ -344,6 +404,15 @@ struct CommandActionContext {
 		return numTotalActions >= numActorLimit;
 	}
 
+	static bool isWaitingListFull(void)
+	{
+		// This function assumes that 'lock' is being locked.
+		ConfigManager *confMgr = ConfigManager::getInstance();
+		const size_t numWaitingLimit =
+		  confMgr->getMaxNumberOfWaitingCommandAction();
+		return waitingList.size() >= numWaitingLimit;
+	}
+
 	static size_t reserveAndInsert(void)
 	{
 		// This function assumes that 'lock' is being locked.
@@ -376,6 +445,7 @@ protected:
 		waitCmdInfo->actionDef = actionDef;
 		waitCmdInfo->eventInfo = eventInfo;
 		waitCmdInfo->argVect   = argVect;
+		waitCmdInfo->queuedTime = SmartTime(SmartTime::INIT_CURR_TIME);
 		waitingList.push_back(waitCmdInfo);
 		return waitCmdInfo;
 	}
@@ -413,6 +483,8 @@ deque<WaitingCommandActionInfo *>
   CommandActionContext::waitingList;
 set<size_t> CommandActionContext::reservedSet;
 set<uint64_t> CommandActionContext::runningSet;
+map<uint64_t, SmartTime> CommandActionContext::startTimeMap;
+ActionManager::CommandActionStats CommandActionContext::stats;
 
 class ActorInfoCopier {
 public:
@@ -455,6 +527,21 @@ struct ActionManager::Impl {
 string ActionManager::Impl::pathForAction;
 string ActionManager::Impl::ldLibraryPathForAction;
 
+// ---------------------------------------------------------------------------
+// CommandActionStats
+// ---------------------------------------------------------------------------
+ActionManager::CommandActionStats::CommandActionStats(void)
+: numStarted(0),
+  numFinished(0),
+  numQueued(0),
+  numRejected(0),
+  totalWaitTimeMSec(0),
+  maxWaitTimeMSec(0),
+  totalRunTimeMSec(0),
+  maxRunTimeMSec(0)
+{
+}
+
 // ---------------------------------------------------------------------------
 // Public methods
 // ---------------------------------------------------------------------------
@@ -487,6 +574,13 @@ void ActionManager::reset(void)
 	CommandActionContext::reset();
 }
 
+void ActionManager::getCommandActionStats(CommandActionStats &stats)
+{
+	CommandActionContext::lock.lock();
+	stats = CommandActionContext::stats;
+	CommandActionContext::lock.unlock();
+}
+
 ActionManager::ActionManager(void)
 : m_impl(new Impl())
 {
@@ -522,22 +616,41 @@ void ActionManager::checkEvents(const EventInfoList &eventList)
 {
 	ThreadLocalDBCache cache;
 	DBTablesAction &dbAction = cache.getAction();
+	ServerEventIdSet loggedEventIdSet;
+	dbAction.getLoggedEvents(loggedEventIdSet, eventList);
+
+	EventInfoList targetEventList;
 	EventInfoListConstIterator it = eventList.begin();
 	for (; it != eventList.end(); ++it) {
-		ActionDefList actionDefList;
 		const EventInfo &eventInfo = *it;
 		if (eventInfo.id != DISCONNECT_SERVER_EVENT_ID) {
 			if (shouldSkipByTime(eventInfo))
 				continue;
-			if (shouldSkipByLog(eventInfo, dbAction))
+			if (loggedEventIdSet.count(
+			      ServerEventId(eventInfo.serverId, eventInfo.id)))
 				continue;
 		}
-		ActionsQueryOption option(USER_ID_SYSTEM);
-		// TODO: sort IncidentSender type actions by priority
-		option.setActionType(ACTION_ALL);
-		option.setTargetEventInfo(&eventInfo);
-		dbAction.getActionList(actionDefList, option);
-		ActionDefListIterator actIt = actionDefList.begin();
+		targetEventList.push_back(eventInfo);
+	}
+
+	// TODO: sort IncidentSender type actions by priority
+	vector<ActionDefList> actionDefListVect;
+	ActionRuleIndex::getInstance()->match(actionDefListVect,
+	                                      targetEventList);
+	it = targetEventList.begin();
+	for (size_t i = 0; it != targetEventList.end(); ++it, ++i) {
+		const EventInfo &eventInfo = *it;
+		const ActionDefList &actionDefList = actionDefListVect[i];
+		if (actionDefList.empty())
+			continue;
+
+		// The same event may appear twice in a list.
+		const ServerEventId id(eventInfo.serverId, eventInfo.id);
+		if (eventInfo.id != DISCONNECT_SERVER_EVENT_ID &&
+		    !loggedEventIdSet.insert(id).second)
+			continue;
+
+		ActionDefListConstIterator actIt = actionDefList.begin();
 		ActionIdType incidentSenderActionId = 0;
 		for (; actIt != actionDefList.end(); ++actIt) {
 			bool skip = shouldSkipIncidentSender(
@@ -606,6 +719,7 @@ HatoholError ActionManager::runAction(const ActionDef &actionDef,
                                       const EventInfo &_eventInfo,
                                       DBTablesAction &dbAction)
 {
+	MLPL_TRACE_SCOPE(TRACE_ACTION_RUN, actionDef.id, actionDef.type);
 	EventInfo eventInfo(_eventInfo);
 	fillTriggerInfoInEventInfo(eventInfo);
 
@@ -764,9 +878,16 @@ void ActionManager::execCommandAction(const ActionDef &actionDef,
 	argVect.push_back(StringUtils::sprintf("%d", eventInfo.severity));
 
 	size_t reservationId = -1;
+	ActionLogIdType rejectedLogId = INVALID_ACTION_LOG_ID;
 	WaitingCommandActionInfo *waitCmdInfo =
-	  CommandActionContext::reserve(reservationId, actionDef, eventInfo,
+	  CommandActionContext::reserve(reservationId, rejectedLogId,
+	                                actionDef, eventInfo,
 	                                dbAction, argVect);
+	if (rejectedLogId != INVALID_ACTION_LOG_ID) {
+		if (_actorInfo)
+			_actorInfo->logId = rejectedLogId;
+		return;
+	}
 	// If the number of running command actions exceeds the limit,
 	// reserveCommandAction() returns a pointer of
 	// WaitingCommandActionInfo. In the case, the action is queued
@@ -802,8 +923,10 @@ void ActionManager::spawnPostprocCommandAction(ActorInfo *actorInfo,
 	// AcotorInfo is copied at the end of this method.
 	ActorInfoCopier actorInfoCopier(ctx->actorInfoCopy, actorInfo, logId);
 
-	if (actorInfo) // Successfully executed
-		CommandActionContext::add(ctx->reservationId, logId);
+	if (actorInfo) { // Successfully executed
+		CommandActionContext::add(ctx->reservationId, logId,
+		                          ctx->waitTimeMSec);
+	}
 	else // Failed to execute the actor
 		CommandActionContext::cancel(ctx->reservationId);
 	if (!actorInfo)
@@ -1039,9 +1162,9 @@ void ActionManager::moduleLoadedCb(GIOStatus stat, SmartBuffer &sbuf,
  * - The default GLIB event dispacther thread (main)
  *     [callback registered by pullData()]
  */
-void ActionManager::gotNotifyEventAckCb(GIOStatus stat, SmartBuffer &sbuf,
-                                        size_t size,
-                                        ResidentNotifyInfo *notifyInfo)
+void ActionManager::gotNotifyEventBatchAckHeaderCb(
+  GIOStatus stat, SmartBuffer &sbuf, size_t size,
+  ResidentNotifyInfo *notifyInfo)
 {
 	ResidentInfo *residentInfo = notifyInfo->residentInfo;
 	ActionManager *obj = residentInfo->actionManager;
@@ -1052,34 +1175,94 @@ void ActionManager::gotNotifyEventAckCb(GIOStatus stat, SmartBuffer &sbuf,
 	}
 
 	int pktType = ResidentCommunicator::getPacketType(sbuf);
-	if (pktType != RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK) {
+	if (pktType != RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH_ACK) {
 		MLPL_ERR("Unexpected packet: %d\n", pktType);
 		obj->closeResident(notifyInfo,
 		                   ACTLOG_EXECFAIL_PIPE_READ_DATA_UNEXPECTED);
 		return;
 	}
 
-	// get the result code
-	sbuf.resetIndex();
-	sbuf.incIndex(RESIDENT_PROTO_HEADER_LEN);
-	uint32_t resultCode = *sbuf.getPointer<uint32_t>();
+	residentInfo->setPullCallbackArg(notifyInfo);
+	residentInfo->pullData(ResidentCommunicator::getBodySize(sbuf),
+	                       gotNotifyEventBatchAckBodyCb);
+}
 
-	// log the end of action
-	HATOHOL_ASSERT(notifyInfo->logId != INVALID_ACTION_LOG_ID,
-	               "log ID: %" PRIx64, notifyInfo->logId);
-	DBTablesAction::LogEndExecActionArg logArg;
-	logArg.logId = notifyInfo->logId;
-	logArg.status = ACTLOG_STAT_SUCCEEDED,
-	logArg.exitCode = resultCode;
+/*
+ * executed on the following thread(s)
+ * - The default GLIB event dispacther thread (main)
+ *     [callback registered by pullData()]
+ */
+void ActionManager::gotNotifyEventBatchAckBodyCb(
+  GIOStatus stat, SmartBuffer &sbuf, size_t size,
+  ResidentNotifyInfo *notifyInfo)
+{
+	ResidentInfo *residentInfo = notifyInfo->residentInfo;
+	ActionManager *obj = residentInfo->actionManager;
+	if (stat != G_IO_STATUS_NORMAL) {
+		MLPL_ERR("Error: status: %x\n", stat);
+		obj->closeResident(notifyInfo, ACTLOG_EXECFAIL_PIPE_READ_ERR);
+		return;
+	}
+
+	// The acks come in the order of the sequence. So the first one
+	// must be for the top of notifyQueue.
+	const uint32_t firstSequence = *sbuf.getPointerAndIncIndex<uint32_t>();
+	const uint16_t numEvents = *sbuf.getPointerAndIncIndex<uint16_t>();
+	residentInfo->queueLock.lock();
+	const size_t numInFlight = residentInfo->numInFlight;
+	residentInfo->queueLock.unlock();
+	const size_t expectedSize =
+	  RESIDENT_PROTO_BATCH_BODY_BASE_LEN +
+	  RESIDENT_PROTO_EVENT_ACK_CODE_LEN * numEvents;
+	if (firstSequence != notifyInfo->sequence || numEvents == 0 ||
+	    numEvents > numInFlight || size != expectedSize) {
+		MLPL_ERR("Unexpected ack: sequence: %" PRIu32 " (%" PRIu32 "), "
+		         "events: %" PRIu16 ", in flight: %zd, size: %zd\n",
+		         firstSequence, notifyInfo->sequence, numEvents,
+		         numInFlight, size);
+		obj->closeResident(notifyInfo,
+		                   ACTLOG_EXECFAIL_PIPE_READ_DATA_UNEXPECTED);
+		return;
+	}
 
 	ThreadLocalDBCache cache;
-	cache.getAction().logEndExecAction(logArg);
+	DBTablesAction &dbAction = cache.getAction();
+	for (uint16_t i = 0; i < numEvents; i++) {
+		const uint32_t resultCode =
+		  *sbuf.getPointerAndIncIndex<uint32_t>();
 
-	// remove the notifyInfo 
-	residentInfo->deleteFrontNotifyInfo();
+		// log the end of action
+		ResidentNotifyInfo *ackedInfo = NULL;
+		residentInfo->queueLock.lock();
+		ackedInfo = residentInfo->notifyQueue.front();
+		residentInfo->queueLock.unlock();
+		HATOHOL_ASSERT(ackedInfo->logId != INVALID_ACTION_LOG_ID,
+		               "log ID: %" PRIx64, ackedInfo->logId);
+		DBTablesAction::LogEndExecActionArg logArg;
+		logArg.logId = ackedInfo->logId;
+		logArg.status = ACTLOG_STAT_SUCCEEDED,
+		logArg.exitCode = resultCode;
+		dbAction.logEndExecAction(logArg);
 
-	// send the next notificaiton if it exists
-	residentInfo->setStatus(RESIDENT_STAT_IDLE);
+		// remove the notifyInfo
+		residentInfo->deleteFrontNotifyInfo();
+	}
+
+	// wait for the remaining acks
+	residentInfo->queueLock.lock();
+	residentInfo->numInFlight -= numEvents;
+	ResidentNotifyInfo *nextInfo = NULL;
+	if (residentInfo->numInFlight > 0)
+		nextInfo = residentInfo->notifyQueue.front();
+	else
+		residentInfo->status = RESIDENT_STAT_IDLE;
+	residentInfo->queueLock.unlock();
+	if (nextInfo) {
+		residentInfo->setPullCallbackArg(nextInfo);
+		residentInfo->pullHeader(gotNotifyEventBatchAckHeaderCb);
+	}
+
+	// send the next notificaitons if they exist
 	obj->tryNotifyEvent(residentInfo);
 }
 
@@ -1252,52 +1435,87 @@ ResidentInfo *ActionManager::launchResidentActionYard
  *     [from execResidentAction()]
  * - The default GLIB event dispacther thread (main)
  *     [from moduleLoadedCb()]
- *     [from gotNotifyEventAckCb]
+ *     [from gotNotifyEventBatchAckBodyCb()]
  */
 void ActionManager::tryNotifyEvent(ResidentInfo *residentInfo)
 {
-	residentInfo->queueLock.lock();
-	ResidentNotifyInfo *notifyInfo = NULL;
-	if (residentInfo->status != RESIDENT_STAT_IDLE) {
+	residentInfo->sendLock.lock();
+	Reaper<Mutex> unlocker(&residentInfo->sendLock, Mutex::unlock);
+	while (true) {
+		vector<ResidentNotifyInfo *> notifyInfoVect;
+		bool needPull = false;
+		residentInfo->queueLock.lock();
+		if (residentInfo->status == RESIDENT_STAT_IDLE ||
+		    residentInfo->status == RESIDENT_STAT_WAIT_NOTIFY_ACK) {
+			const size_t numWindow =
+			  RESIDENT_PROTO_NOTIFY_WINDOW_SIZE -
+			  residentInfo->numInFlight;
+			const size_t numEvents = min(
+			  min(numWindow, RESIDENT_PROTO_MAX_EVENTS_IN_BATCH),
+			  residentInfo->notifyQueue.size() -
+			  residentInfo->numInFlight);
+			for (size_t i = 0; i < numEvents; i++) {
+				ResidentNotifyInfo *notifyInfo =
+				  residentInfo->notifyQueue[
+				    residentInfo->numInFlight + i];
+				notifyInfo->sequence =
+				  residentInfo->nextSequence++;
+				notifyInfoVect.push_back(notifyInfo);
+			}
+			residentInfo->numInFlight += numEvents;
+		}
+		if (!notifyInfoVect.empty() &&
+		    residentInfo->status == RESIDENT_STAT_IDLE) {
+			residentInfo->status = RESIDENT_STAT_WAIT_NOTIFY_ACK;
+			needPull = true;
+		}
 		residentInfo->queueLock.unlock();
-		return;
-	}
-	if (!residentInfo->notifyQueue.empty()) {
-		notifyInfo = residentInfo->notifyQueue.front();
-		residentInfo->status = RESIDENT_STAT_WAIT_NOTIFY_ACK;
+		if (notifyInfoVect.empty())
+			break;
+		notifyEventBatch(residentInfo, notifyInfoVect, needPull);
 	}
-	residentInfo->queueLock.unlock();
-	if (notifyInfo)
-		notifyEvent(residentInfo, notifyInfo);
 }
 
 /*
  * executed on the following thread(s)
  * - Threads that call checkEvents()
- *     [from notifyEvent()]
+ *     [from tryNotifyEvent()]
  * - The default GLIB event dispacther thread (main)
- *     [from notifyEvent()]
+ *     [from tryNotifyEvent()]
  */
-void ActionManager::notifyEvent(ResidentInfo *residentInfo,
-                                ResidentNotifyInfo *notifyInfo)
+void ActionManager::notifyEventBatch(
+  ResidentInfo *residentInfo,
+  const vector<ResidentNotifyInfo *> &notifyInfoVect, const bool &needPull)
 {
+	// update action logs
+	ThreadLocalDBCache cache;
+	DBTablesAction &dbAction = cache.getAction();
+	size_t eventsSize = 0;
+	for (size_t i = 0; i < notifyInfoVect.size(); i++) {
+		const ResidentNotifyInfo *notifyInfo = notifyInfoVect[i];
+		HATOHOL_ASSERT(notifyInfo->logId != INVALID_ACTION_LOG_ID,
+		               "An action log ID is not set.");
+		dbAction.updateLogStatusToStart(notifyInfo->logId);
+		eventsSize += ResidentCommunicator::getNotifyEventBodySize(
+		                notifyInfo->eventInfo);
+	}
+
 	ResidentCommunicator comm;
-	comm.setNotifyEventBody(residentInfo->actionDef.id,
-	                        notifyInfo->eventInfo,
-	                        notifyInfo->sessionId);
+	comm.setNotifyEventBatchHeader(notifyInfoVect.front()->sequence,
+	                               notifyInfoVect.size(), eventsSize);
+	for (size_t i = 0; i < notifyInfoVect.size(); i++) {
+		const ResidentNotifyInfo *notifyInfo = notifyInfoVect[i];
+		comm.addNotifyEventBatchItem(residentInfo->actionDef.id,
+		                             notifyInfo->eventInfo,
+		                             notifyInfo->sessionId);
+	}
 	comm.push(residentInfo->pipeWr);
 
-	// wait for result code
-	residentInfo->setPullCallbackArg(notifyInfo);
-	residentInfo->pullData(RESIDENT_PROTO_HEADER_LEN +
-	                       RESIDENT_PROTO_EVENT_ACK_CODE_LEN,
-	                       gotNotifyEventAckCb);
-
-	// create or update an action log
-	HATOHOL_ASSERT(notifyInfo->logId != INVALID_ACTION_LOG_ID,
-	               "An action log ID is not set.");
-	ThreadLocalDBCache cache;
-	cache.getAction().updateLogStatusToStart(notifyInfo->logId);
+	// wait for result codes
+	if (!needPull)
+		return;
+	residentInfo->setPullCallbackArg(notifyInfoVect.front());
+	residentInfo->pullHeader(gotNotifyEventBatchAckHeaderCb);
 }
 
 /*
@@ -1415,6 +1633,9 @@ void ActionManager::commandActorPostCollectedCb(const ActorInfo *actorInfo)
 	postprocCtx.actorInfoCopy = NULL;
 	postprocCtx.reservationId = waitCmdInfo->reservationId;
 	postprocCtx.waitCmdInfo = waitCmdInfo;
+	SmartTime waitTime(SmartTime::INIT_CURR_TIME);
+	waitTime -= waitCmdInfo->queuedTime;
+	postprocCtx.waitTimeMSec = waitTime.getAsMSec();
 	ThreadLocalDBCache cache;
 	execCommandActionCore(waitCmdInfo->actionDef, waitCmdInfo->eventInfo,
 	                      cache.getAction(),
@@ -1481,7 +1702,8 @@ void ActionManager::closeResident(ResidentInfo *residentInfo)
  * - The default GLIB event dispacther thread (main)
  *     [callback registered by pullData()]
  *     [from residentActionTimeoutCb()]
- *     [from gotNotifyEventAckCb()]
+ *     [from gotNotifyEventBatchAckHeaderCb()]
+ *     [from gotNotifyEventBatchAckBodyCb()]
  *     [from launchedCb()]
  *     [from moduleLoadedCb()]
  */
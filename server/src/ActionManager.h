@@ -21,6 +21,7 @@
 #define ActionManager_h
 
 #include <memory>
+#include <vector>
 #include "Params.h"
 #include "SmartBuffer.h"
 #include "DBTablesAction.h"
@@ -54,8 +55,34 @@ public:
 	static const char *ENV_NAME_SESSION_ID;
 
 	struct ResidentNotifyInfo;
+
+	struct CommandActionStats {
+		size_t numStarted;
+		size_t numFinished;
+		size_t numQueued;
+		size_t numRejected;
+
+		// The time from the request to the spawn. It is 0 for the
+		// actions executed without waiting in the queue.
+		double totalWaitTimeMSec;
+		double maxWaitTimeMSec;
+
+		// The time from the spawn to the exit of the process.
+		double totalRunTimeMSec;
+		double maxRunTimeMSec;
+
+		CommandActionStats(void);
+	};
+
 	static void reset(void);
 
+	/**
+	 * Get the statistics of the command actions since the last reset().
+	 *
+	 * @param stats The statistics are copied to this.
+	 */
+	static void getCommandActionStats(CommandActionStats &stats);
+
 	ActionManager(void);
 	virtual ~ActionManager();
 	void checkEvents(const EventInfoList &eventList);
@@ -96,9 +123,12 @@ protected:
 	                       size_t size, ResidentNotifyInfo *notifyInfo);
 	static void moduleLoadedCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	                           size_t size, ResidentNotifyInfo *notifyInfo);
-	static void gotNotifyEventAckCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
-	                                size_t size,
-	                                ResidentNotifyInfo *residentInfo);
+	static void gotNotifyEventBatchAckHeaderCb(
+	  GIOStatus stat, mlpl::SmartBuffer &sbuf, size_t size,
+	  ResidentNotifyInfo *notifyInfo);
+	static void gotNotifyEventBatchAckBodyCb(
+	  GIOStatus stat, mlpl::SmartBuffer &sbuf, size_t size,
+	  ResidentNotifyInfo *notifyInfo);
 	static void sendParameters(ResidentInfo *residentInfo);
 	static gboolean commandActionTimeoutCb(gpointer data);
 	static void residentActionTimeoutCb(NamedPipe *namedPipe,
@@ -194,8 +224,11 @@ protected:
 	                                       DBTablesAction &dbAction,
 	                                       ActorInfo *actorInfoCopy);
 	/**
-	 * notify hatohol-resident-yard of an event only when it is idle and
-	 * there is at least one element in residentInfo->notifyQueue.
+	 * notify hatohol-resident-yard of the events in
+	 * residentInfo->notifyQueue that have not been sent yet.
+	 * The events are sent in batches without waiting for the ack of the
+	 * previous ones as long as the number of the events waiting for the
+	 * ack doesn't exceed RESIDENT_PROTO_NOTIFY_WINDOW_SIZE.
 	 * Othewise the request is processed later.
 	 *
 	 * @param residentInfo A residentInfo instance.
@@ -203,19 +236,22 @@ protected:
 	void tryNotifyEvent(ResidentInfo *residentInfo);
 
 	/**
-	 * notify hatohol-resident-yard of an event at the top of notifyQueue.
+	 * notify hatohol-resident-yard of events with a batch packet.
 	 * NOTE: This function is assumed to be called only from
 	 * tryNotifyEvent().
 	 *
 	 * @param residentInfo A residentInfo instance.
 	 *
-	 * @param notifyInfo.
-	 * A ResidentNotifyInfo instance. If the member: logId is
-	 * INVALID_ACTION_LOG_ID, the new log record is created.
-	 * Otherwise the record with it will be updated.
+	 * @param notifyInfoVect
+	 * ResidentNotifyInfo instances with consecutive sequence numbers.
+	 *
+	 * @param needPull
+	 * If this is true, the pull of the ack is started.
 	 */
-	void notifyEvent(ResidentInfo *residentInfo,
-	                 ResidentNotifyInfo *notifyInfo);
+	void notifyEventBatch(
+	  ResidentInfo *residentInfo,
+	  const std::vector<ResidentNotifyInfo *> &notifyInfoVect,
+	  const bool &needPull);
 
 	void execIncidentSenderAction(const ActionDef &actionDef,
 				      const EventInfo &eventInfo,
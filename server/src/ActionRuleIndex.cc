@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <algorithm>
+#include <Mutex.h>
+#include <ReadWriteLock.h>
+#include <Reaper.h>
+#include "ActionRuleIndex.h"
+#include "ThreadLocalDBCache.h"
+#include "UnifiedDataStore.h"
+
+using namespace std;
+using namespace mlpl;
+
+typedef uint64_t ActionRuleIndexGeneration;
+
+// A bucket is identified by the server ID and the trigger ID.
+// ALL_SERVERS and ALL_TRIGGERS are used for the actions without them.
+typedef pair<ServerIdType, TriggerIdType> ActionBucketKey;
+typedef map<ActionBucketKey, vector<size_t> > ActionBucketMap;
+typedef ActionBucketMap::const_iterator ActionBucketMapConstIterator;
+
+typedef pair<ServerIdType, LocalHostIdType> ServerHostKey;
+typedef map<ServerHostKey, HostgroupIdSet> HostgroupsOfHostMap;
+
+struct ActionRules {
+	// Actions in the order returned from the DB
+	vector<ActionDef> actionDefVect;
+	ActionBucketMap   bucketMap;
+
+	void load(void)
+	{
+		ThreadLocalDBCache cache;
+		ActionDefList actionDefList;
+		ActionsQueryOption option(USER_ID_SYSTEM);
+		option.setActionType(ACTION_ALL);
+		cache.getAction().getActionList(actionDefList, option);
+
+		ActionDefListIterator it = actionDefList.begin();
+		for (; it != actionDefList.end(); ++it) {
+			const ActionCondition &cond = it->condition;
+			ActionBucketKey key(ALL_SERVERS, ALL_TRIGGERS);
+			if (cond.isEnable(ACTCOND_SERVER_ID))
+				key.first = cond.serverId;
+			if (cond.isEnable(ACTCOND_TRIGGER_ID))
+				key.second = cond.triggerId;
+			bucketMap[key].push_back(actionDefVect.size());
+			actionDefVect.push_back(*it);
+		}
+	}
+
+	void appendBucket(vector<size_t> &indexes,
+	                  const ServerIdType &serverId,
+	                  const TriggerIdType &triggerId) const
+	{
+		ActionBucketMapConstIterator it =
+		  bucketMap.find(ActionBucketKey(serverId, triggerId));
+		if (it == bucketMap.end())
+			return;
+		indexes.insert(indexes.end(),
+		               it->second.begin(), it->second.end());
+	}
+
+	void getCandidates(vector<size_t> &indexes,
+	                   const EventInfo &eventInfo) const
+	{
+		appendBucket(indexes, ALL_SERVERS, ALL_TRIGGERS);
+		if (eventInfo.serverId != ALL_SERVERS)
+			appendBucket(indexes, eventInfo.serverId, ALL_TRIGGERS);
+		if (eventInfo.triggerId != ALL_TRIGGERS) {
+			appendBucket(indexes, ALL_SERVERS, eventInfo.triggerId);
+			if (eventInfo.serverId != ALL_SERVERS) {
+				appendBucket(indexes, eventInfo.serverId,
+				             eventInfo.triggerId);
+			}
+		}
+		sort(indexes.begin(), indexes.end());
+	}
+};
+
+// The same conditions as ActionsQueryOption::getCondition()
+static bool matchCondition(const ActionCondition &cond,
+                           const EventInfo &eventInfo,
+                           const HostgroupIdSet *hostgroupIdSet)
+{
+	if (cond.isEnable(ACTCOND_SERVER_ID) &&
+	    cond.serverId != eventInfo.serverId)
+		return false;
+	if (cond.isEnable(ACTCOND_HOST_ID) &&
+	    cond.hostIdInServer != eventInfo.hostIdInServer)
+		return false;
+	if (cond.isEnable(ACTCOND_HOST_GROUP_ID) &&
+	    !hostgroupIdSet->count(cond.hostgroupId))
+		return false;
+	if (cond.isEnable(ACTCOND_TRIGGER_ID) &&
+	    cond.triggerId != eventInfo.triggerId)
+		return false;
+	if (cond.isEnable(ACTCOND_TRIGGER_STATUS) &&
+	    cond.triggerStatus != eventInfo.status)
+		return false;
+	if (cond.isEnable(ACTCOND_TRIGGER_SEVERITY)) {
+		if (cond.triggerSeverityCompType == CMP_EQ)
+			return eventInfo.severity == cond.triggerSeverity;
+		if (cond.triggerSeverityCompType == CMP_EQ_GT)
+			return eventInfo.severity >= cond.triggerSeverity;
+		return false;
+	}
+	return true;
+}
+
+static const HostgroupIdSet &getHostgroupsOfHost(
+  HostgroupsOfHostMap &hostgroupsOfHostMap, const EventInfo &eventInfo)
+{
+	const ServerHostKey key(eventInfo.serverId, eventInfo.hostIdInServer);
+	HostgroupsOfHostMap::iterator it = hostgroupsOfHostMap.find(key);
+	if (it != hostgroupsOfHostMap.end())
+		return it->second;
+
+	HostgroupIdSet &hostgroupIdSet = hostgroupsOfHostMap[key];
+	HostgroupMemberVect hostgrpMembers;
+	HostgroupMembersQueryOption option(USER_ID_SYSTEM);
+	option.setTargetServerId(eventInfo.serverId);
+	option.setTargetHostId(eventInfo.hostIdInServer);
+	UnifiedDataStore::getInstance()->getHostgroupMembers(hostgrpMembers,
+	                                                     option);
+	for (size_t i = 0; i < hostgrpMembers.size(); i++)
+		hostgroupIdSet.insert(hostgrpMembers[i].hostgroupIdInServer);
+	return hostgroupIdSet;
+}
+
+struct ActionRuleIndex::Impl {
+	static Mutex            initLock;
+	static ActionRuleIndex *instance;
+
+	ReadWriteLock rwlock;
+	bool          loaded;
+	ActionRules   rules;
+
+	// Rules loaded before an invalidation are discarded.
+	ActionRuleIndexGeneration generation;
+
+	Impl(void)
+	: loaded(false),
+	  generation(0)
+	{
+	}
+
+	template<typename Reader>
+	void read(Reader &reader)
+	{
+		rwlock.readLock();
+		if (loaded) {
+			reader(rules);
+			rwlock.unlock();
+			return;
+		}
+		const ActionRuleIndexGeneration loadedGeneration = generation;
+		rwlock.unlock();
+
+		ActionRules newRules;
+		newRules.load();
+		reader(newRules);
+
+		rwlock.writeLock();
+		Reaper<ReadWriteLock> unlocker(&rwlock, ReadWriteLock::unlock);
+		if (loaded || generation != loadedGeneration)
+			return;
+		rules = newRules;
+		loaded = true;
+	}
+};
+
+Mutex            ActionRuleIndex::Impl::initLock;
+ActionRuleIndex *ActionRuleIndex::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void ActionRuleIndex::reset(void)
+{
+	getInstance()->invalidate();
+}
+
+ActionRuleIndex *ActionRuleIndex::getInstance(void)
+{
+	Impl::initLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new ActionRuleIndex();
+	Impl::initLock.unlock();
+	return Impl::instance;
+}
+
+void ActionRuleIndex::match(vector<ActionDefList> &actionDefListVect,
+                            const EventInfoList &eventList)
+{
+	actionDefListVect.resize(eventList.size());
+	if (eventList.empty())
+		return;
+
+	struct {
+		vector<ActionDefList> *actionDefListVect;
+		const EventInfoList   *eventList;
+
+		void operator()(const ActionRules &rules)
+		{
+			HostgroupsOfHostMap hostgroupsOfHostMap;
+			EventInfoListConstIterator it = eventList->begin();
+			for (size_t i = 0; it != eventList->end(); ++it, ++i)
+				match(rules, *it, (*actionDefListVect)[i],
+				      hostgroupsOfHostMap);
+		}
+
+		void match(const ActionRules &rules,
+		           const EventInfo &eventInfo,
+		           ActionDefList &actionDefList,
+		           HostgroupsOfHostMap &hostgroupsOfHostMap)
+		{
+			vector<size_t> indexes;
+			rules.getCandidates(indexes, eventInfo);
+
+			const HostgroupIdSet *hostgroupIdSet = NULL;
+			for (size_t j = 0; j < indexes.size(); j++) {
+				const ActionDef &actionDef =
+				  rules.actionDefVect[indexes[j]];
+				const ActionCondition &cond =
+				  actionDef.condition;
+				if (!hostgroupIdSet &&
+				    cond.isEnable(ACTCOND_HOST_GROUP_ID)) {
+					hostgroupIdSet = &getHostgroupsOfHost(
+					  hostgroupsOfHostMap, eventInfo);
+				}
+				if (matchCondition(cond, eventInfo,
+				                   hostgroupIdSet))
+					actionDefList.push_back(actionDef);
+			}
+		}
+	} reader;
+	reader.actionDefListVect = &actionDefListVect;
+	reader.eventList = &eventList;
+	m_impl->read(reader);
+}
+
+void ActionRuleIndex::invalidate(void)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generation++;
+	m_impl->loaded = false;
+	m_impl->rules = ActionRules();
+	m_impl->rwlock.unlock();
+}
+
+bool ActionRuleIndex::isLoaded(void) const
+{
+	m_impl->rwlock.readLock();
+	const bool loaded = m_impl->loaded;
+	m_impl->rwlock.unlock();
+	return loaded;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+ActionRuleIndex::ActionRuleIndex(void)
+: m_impl(new Impl())
+{
+}
+
+ActionRuleIndex::~ActionRuleIndex()
+{
+}
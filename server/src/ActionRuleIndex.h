@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ActionRuleIndex_h
+#define ActionRuleIndex_h
+
+#include <vector>
+#include <memory>
+#include "DBTablesAction.h"
+
+/**
+ * A process-wide index of the conditions of the actions.
+ *
+ * All valid actions are loaded at the first match and are bucketed by
+ * the server ID and the trigger ID of their conditions. The other
+ * conditions are evaluated in memory. The index is rebuilt only after
+ * invalidate(), which is called when the actions, the users or the
+ * incident trackers are changed. The host groups of the hosts of events
+ * are looked up only when a candidate action has a host group condition.
+ */
+class ActionRuleIndex {
+public:
+	static void reset(void);
+	static ActionRuleIndex *getInstance(void);
+
+	/**
+	 * Find the actions whose conditions match the events. The result is
+	 * the same as DBTablesAction::getActionList() with ACTION_ALL,
+	 * USER_ID_SYSTEM and ActionsQueryOption::setTargetEventInfo().
+	 *
+	 * @param actionDefListVect
+	 * The i-th element is filled with the actions for the i-th event.
+	 * @param eventList Target events.
+	 */
+	void match(std::vector<ActionDefList> &actionDefListVect,
+	           const EventInfoList &eventList);
+
+	void invalidate(void);
+	bool isLoaded(void) const;
+
+protected:
+	ActionRuleIndex(void);
+	virtual ~ActionRuleIndex();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // ActionRuleIndex_h
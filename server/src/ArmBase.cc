@@ -29,6 +29,7 @@
 #include "DBTablesMonitoring.h"
 #include "UnifiedDataStore.h"
 #include "ThreadLocalDBCache.h"
+#include "HatoholTracePoint.h"
 
 using namespace std;
 using namespace mlpl;
@@ -434,12 +435,17 @@ gpointer ArmBase::mainThread(HatoholThreadArg *arg)
 		FetcherJob *job = m_impl->popJob();
 		UpdateType updateType = job ? job->updateType : UPDATE_POLLING;
 		int sleepTime = m_impl->getSecondsToNextPolling();
+		MLPL_TRACE(TRACE_ARM_MAIN_LOOP, MLPL_TRACE_PHASE_BEGIN,
+		           m_impl->serverInfo.id, updateType);
 
 		ArmPollingResult armPollingResult;
 		if (updateType == UPDATE_ITEM_REQUEST) {
 			HATOHOL_ASSERT(job, "Invalid FetcherJob");
 			armPollingResult = mainThreadOneProcFetchItems();
-			job->run();
+			// The closure of a failed fetch is deleted without
+			// being called.
+			if (armPollingResult == COLLECT_OK)
+				job->run();
 		} else if (updateType == UPDATE_HISTORY_REQUEST) {
 			HATOHOL_ASSERT(job && job->historyQuery,
 				       "Invalid FetcherJob");
@@ -453,7 +459,8 @@ gpointer ArmBase::mainThread(HatoholThreadArg *arg)
 		} else 	if (updateType == UPDATE_TRIGGER_REQUEST) {
 			HATOHOL_ASSERT(job, "Invalid FetcherJob");
 			armPollingResult = mainThreadOneProcFetchTriggers();
-			job->run(updateType);
+			if (armPollingResult == COLLECT_OK)
+				job->run(updateType);
 		} else {
 			armPollingResult = mainThreadOneProc();
 		}
@@ -482,6 +489,7 @@ gpointer ArmBase::mainThread(HatoholThreadArg *arg)
 
 		if (updateType == UPDATE_POLLING)
 			m_impl->stampLastPollingTime();
+		MLPL_TRACE(TRACE_ARM_MAIN_LOOP, MLPL_TRACE_PHASE_END);
 
 		if (hasExitRequest())
 			break;
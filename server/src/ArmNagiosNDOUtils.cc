@@ -18,8 +18,14 @@
  */
 
 #include <time.h>
+#include <deque>
+#include <Mutex.h>
+#include <Reaper.h>
+#include <SimpleSemaphore.h>
+#include <AtomicValue.h>
 #include "ArmNagiosNDOUtils.h"
 #include "DBAgentMySQL.h"
+#include "HatoholThreadBase.h"
 #include "Utils.h"
 #include "UnifiedDataStore.h"
 #include "ItemGroupStream.h"
@@ -38,6 +44,16 @@ static const char *TABLE_NAME_HOSTGROUPS    = "nagios_hostgroups";
 static const char *TABLE_NAME_HOSTGROUP_MEMBERS = "nagios_hostgroup_members";
 static const char *TABLE_NAME_OBJECTS       = "nagios_objects";
 
+// The number of rows fetched by a query for the incremental updates.
+static const size_t EVENT_PAGE_SIZE   = 1000;
+static const size_t TRIGGER_PAGE_SIZE = 1000;
+
+// Remaining events are fetched in the next polling.
+static const size_t MAX_EVENT_PAGES_PER_POLL = 10;
+
+// The number of connections used for the concurrent queries in a polling.
+static const size_t NUM_POOLED_CONNECTIONS = 3;
+
 enum
 {
 	STATE_OK       = 0,
@@ -440,6 +456,205 @@ static const DBAgent::TableProfile tableProfileObjects =
 // ---------------------------------------------------------------------------
 // Private context
 // ---------------------------------------------------------------------------
+static DBAgentMySQL *createDBAgent(const MonitoringServerInfo &serverInfo)
+{
+	DBAgentMySQL *dbAgent = new DBAgentMySQL(
+	  serverInfo.dbName.c_str(), serverInfo.userName.c_str(),
+	  serverInfo.password.c_str(),
+	  serverInfo.getHostAddress().c_str(), serverInfo.port);
+	dbAgent->setResultStreaming(true);
+	return dbAgent;
+}
+
+static bool isConnectionError(const HatoholException &he)
+{
+	return he.getErrCode() == HTERR_FAILED_CONNECT_MYSQL ||
+	       he.getErrCode() == HTERR_VALID_DBAGENT_NO_LONGER_EXISTS;
+}
+
+/**
+ * A query run on a connection of NDOConnectionPool.
+ */
+struct NDOFetchTask {
+	typedef void (ArmNagiosNDOUtils::*FetchFunc)(DBAgentMySQL &dbAgent);
+
+	ArmNagiosNDOUtils                  *arm;
+	FetchFunc                           fetchFunc;
+	std::unique_ptr<HatoholException>   error;
+
+	NDOFetchTask(ArmNagiosNDOUtils *_arm, FetchFunc _fetchFunc)
+	: arm(_arm),
+	  fetchFunc(_fetchFunc)
+	{
+	}
+};
+
+/**
+ * Connections to the NDOUtils DB, each of which has its own thread.
+ * The connections are opened on demand, and closed on a connection
+ * error so that they are opened again in the next polling.
+ */
+struct NDOConnectionPool {
+	struct Worker : public HatoholThreadBase {
+		NDOConnectionPool &pool;
+		DBAgentMySQL      *dbAgent; // should be used with pool.lock
+
+		Worker(NDOConnectionPool &_pool)
+		: pool(_pool),
+		  dbAgent(NULL)
+		{
+		}
+
+		virtual ~Worker()
+		{
+			delete dbAgent;
+		}
+
+		void closeDBAgent(void)
+		{
+			pool.lock.lock();
+			DBAgentMySQL *agent = dbAgent;
+			dbAgent = NULL;
+			pool.lock.unlock();
+			delete agent;
+		}
+
+		DBAgentMySQL &getDBAgent(void)
+		{
+			pool.lock.lock();
+			Reaper<Mutex> unlocker(&pool.lock, Mutex::unlock);
+			if (pool.disposed) {
+				THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+				  HTERR_VALID_DBAGENT_NO_LONGER_EXISTS,
+				  "The connection pool has been disposed.\n");
+			}
+			if (!dbAgent) {
+				dbAgent = createDBAgent(pool.serverInfo);
+				pool.numCreatedConnections++;
+			}
+			return *dbAgent;
+		}
+
+		void run(NDOFetchTask &task)
+		{
+			try {
+				DBAgentMySQL &agent = getDBAgent();
+				(task.arm->*task.fetchFunc)(agent);
+			} catch (const HatoholException &he) {
+				task.error.reset(new HatoholException(he));
+				if (isConnectionError(he))
+					closeDBAgent();
+			} catch (const exception &e) {
+				task.error.reset(new HatoholException(
+				  e.what(), __FILE__, __LINE__));
+			}
+		}
+
+	protected:
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			NDOFetchTask *task;
+			while ((task = pool.waitTask())) {
+				run(*task);
+				pool.doneSemaphore.post();
+			}
+			return NULL;
+		}
+	};
+
+	const MonitoringServerInfo &serverInfo;
+	Mutex                 lock;
+	deque<NDOFetchTask *> taskQueue;     // should be used with lock
+	bool                  disposed;      // should be used with lock
+	SimpleSemaphore       taskSemaphore;
+	SimpleSemaphore       doneSemaphore;
+	vector<Worker *>      workers;       // should be used with lock
+	size_t                numCreatedConnections; // should be used with lock
+
+	NDOConnectionPool(const MonitoringServerInfo &_serverInfo)
+	: serverInfo(_serverInfo),
+	  disposed(false),
+	  taskSemaphore(0),
+	  doneSemaphore(0),
+	  numCreatedConnections(0)
+	{
+	}
+
+	virtual ~NDOConnectionPool()
+	{
+		// An empty queue makes the workers exit.
+		for (size_t i = 0; i < workers.size(); i++)
+			taskSemaphore.post();
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i]->waitExit();
+			delete workers[i];
+		}
+	}
+
+	/**
+	 * Run the tasks concurrently and wait for all of them.
+	 * If any of them fails, the exception of the first failed task
+	 * in the given order is thrown after all of them are finished.
+	 */
+	void run(vector<NDOFetchTask *> &tasks)
+	{
+		lock.lock();
+		// The workers are created on the first use. dispose() may
+		// be called from another thread at the same time.
+		if (workers.empty()) {
+			for (size_t i = 0; i < NUM_POOLED_CONNECTIONS; i++) {
+				workers.push_back(new Worker(*this));
+				workers.back()->start();
+			}
+		}
+		for (size_t i = 0; i < tasks.size(); i++)
+			taskQueue.push_back(tasks[i]);
+		lock.unlock();
+		for (size_t i = 0; i < tasks.size(); i++)
+			taskSemaphore.post();
+		for (size_t i = 0; i < tasks.size(); i++)
+			doneSemaphore.wait();
+
+		for (size_t i = 0; i < tasks.size(); i++) {
+			if (tasks[i]->error)
+				throw *tasks[i]->error;
+		}
+	}
+
+	NDOFetchTask *waitTask(void)
+	{
+		taskSemaphore.wait();
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		if (taskQueue.empty())
+			return NULL;
+		NDOFetchTask *task = taskQueue.front();
+		taskQueue.pop_front();
+		return task;
+	}
+
+	size_t getNumberOfCreatedConnections(void)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		return numCreatedConnections;
+	}
+
+	/**
+	 * Abort the running queries. The pool can no longer be used.
+	 */
+	void dispose(void)
+	{
+		lock.lock();
+		disposed = true;
+		for (size_t i = 0; i < workers.size(); i++) {
+			if (workers[i]->dbAgent)
+				workers[i]->dbAgent->dispose();
+		}
+		lock.unlock();
+	}
+};
+
 struct ArmNagiosNDOUtils::Impl
 {
 	DBAgentMySQL        *dbAgent;
@@ -451,11 +666,61 @@ struct ArmNagiosNDOUtils::Impl
 	DBAgent::SelectExArg selectHostgroupMembersArg;
 	string               selectTriggerBaseCondition;
 	string               selectEventBaseCondition;
+
+	struct EventPageCommittedCb : public Closure1<bool> {
+		Impl     &impl;
+		uint64_t  statehistoryId;
+
+		EventPageCommittedCb(Impl &_impl,
+		                     const uint64_t &_statehistoryId)
+		: impl(_impl),
+		  statehistoryId(_statehistoryId)
+		{
+		}
+
+		virtual void operator()(const bool &committed) override
+		{
+			impl.onEventPageCommitted(statehistoryId, committed);
+		}
+	};
+
+	// Watermarks of the incremental queries. Events are fetched in the
+	// order of statehistory_id, and triggers are fetched in the order
+	// of (status_update_time, service_object_id).
+	bool                 eventWatermarkLoaded;
+	uint64_t             lastStatehistoryId;
+	bool                 triggerWatermarkLoaded;
+	time_t               lastStatusUpdateTime;
+	int                  lastServiceObjectId;
+	AtomicValue<size_t>  numFetchedRows;
+
+	// lastStatehistoryId is advanced as soon as the events are added to
+	// UnifiedDataStore, because they may be still in IngestionQueue at
+	// the next poll. The following is advanced by the writer after they
+	// are committed, and the next poll goes back to it when some of them
+	// are dropped.
+	Mutex                eventCommitLock;
+	uint64_t             committedStatehistoryId; // with eventCommitLock
+	bool                 eventDropped;            // with eventCommitLock
+
+	// Cursors of the paged queries, which are advanced by fetch
+	// methods. The above watermarks are advanced after the rows
+	// are stored.
+	uint64_t             eventCursor;
+	time_t               triggerCursorTime;
+	int                  triggerCursorObjectId;
+
+	// Fetched rows that are not stored yet.
+	vector<ItemTablePtr> triggerPages;
+	vector<ItemTablePtr> eventPages;
+
 	UnifiedDataStore    *dataStore;
 	MonitoringServerInfo serverInfo;
 	HostInfoCache        hostInfoCache;
+	bool                 storedHostsChanged;
 	map<int, string>     hostMap;
 	map<int, string>     hostgroupMap;
+	NDOConnectionPool    connectionPool;
 
 	// methods
 	Impl(const MonitoringServerInfo &_serverInfo)
@@ -466,9 +731,22 @@ struct ArmNagiosNDOUtils::Impl
 	  selectHostBuilder(tableProfileHosts),
 	  selectHostgroupBuilder(tableProfileHostgroups),
 	  selectHostgroupMembersArg(tableProfileHostgroupMembers),
+	  eventWatermarkLoaded(false),
+	  lastStatehistoryId(0),
+	  triggerWatermarkLoaded(false),
+	  lastStatusUpdateTime(0),
+	  lastServiceObjectId(0),
+	  numFetchedRows(0),
+	  committedStatehistoryId(0),
+	  eventDropped(false),
+	  eventCursor(0),
+	  triggerCursorTime(0),
+	  triggerCursorObjectId(0),
 	  dataStore(NULL),
 	  serverInfo(_serverInfo),
-	  hostInfoCache(&_serverInfo.id)
+	  hostInfoCache(&_serverInfo.id),
+	  storedHostsChanged(true),
+	  connectionPool(serverInfo)
 	{
 		dataStore = UnifiedDataStore::getInstance();
 	}
@@ -481,10 +759,40 @@ struct ArmNagiosNDOUtils::Impl
 	void connect(void)
 	{
 		HATOHOL_ASSERT(!dbAgent, "dbAgent is NOT NULL.");
-		dbAgent = new DBAgentMySQL(
-		  serverInfo.dbName.c_str(), serverInfo.userName.c_str(),
-		  serverInfo.password.c_str(),
-		  serverInfo.getHostAddress().c_str(), serverInfo.port);
+		dbAgent = createDBAgent(serverInfo);
+
+		// The watermarks are loaded from our DB again, because
+		// rows may be lost while the connection is broken.
+		eventWatermarkLoaded = false;
+		triggerWatermarkLoaded = false;
+	}
+
+	void onEventPageCommitted(const uint64_t &statehistoryId,
+	                          const bool &committed)
+	{
+		// Batches of a server are written in order. So the committed
+		// watermark isn't advanced over the dropped events.
+		AutoMutex autoMutex(&eventCommitLock);
+		if (!committed)
+			eventDropped = true;
+		else if (!eventDropped)
+			committedStatehistoryId = statehistoryId;
+	}
+
+	void select(DBAgentMySQL &agent, DBAgent::SelectExArg &arg)
+	{
+		agent.select(arg);
+		numFetchedRows.add(arg.dataTable->getNumberOfRows());
+	}
+
+	static string makeDateTimeString(const time_t &time)
+	{
+		struct tm tm;
+		localtime_r(&time, &tm);
+		return StringUtils::sprintf(
+		  "'%04d-%02d-%02d %02d:%02d:%02d'",
+		  1900+tm.tm_year, tm.tm_mon+1, tm.tm_mday,
+		  tm.tm_hour, tm.tm_min, tm.tm_sec);
 	}
 
 	HostIdType getGlobalHostId(const LocalHostIdType &hostIdInServer)
@@ -520,7 +828,11 @@ ArmNagiosNDOUtils::~ArmNagiosNDOUtils()
 {
 	if (m_impl->dbAgent)
 		m_impl->dbAgent->dispose();
+	m_impl->connectionPool.dispose();
 	requestExitAndWait();
+
+	// The callbacks of the events in IngestionQueue refer to m_impl.
+	m_impl->dataStore->flushIngestion(getServerInfo().id);
 }
 
 // ---------------------------------------------------------------------------
@@ -547,9 +859,23 @@ void ArmNagiosNDOUtils::makeSelectTriggerBuilder(void)
 	builder.add(IDX_HOSTS_DISPLAY_NAME);
 
 	// contiditon
+	const string updateTimeColumn =
+	  tableProfileServiceStatus.getFullColumnName(
+	    IDX_SERVICESTATUS_STATUS_UPDATE_TIME);
+	const string objectIdColumn =
+	  tableProfileServiceStatus.getFullColumnName(
+	    IDX_SERVICESTATUS_SERVICE_OBJECT_ID);
+	// The key of the last row is given to the format:
+	// (time, time, objectId)
 	m_impl->selectTriggerBaseCondition = StringUtils::sprintf(
-	  "%s>=",
-	  tableProfileServiceStatus.getFullColumnName(IDX_SERVICESTATUS_STATUS_UPDATE_TIME).c_str());
+	  "%s>%%s or (%s=%%s and %s>%%d)",
+	  updateTimeColumn.c_str(), updateTimeColumn.c_str(),
+	  objectIdColumn.c_str());
+
+	DBAgent::SelectExArg &arg = builder.getSelectExArg();
+	arg.orderBy = StringUtils::sprintf(
+	  "%s,%s", updateTimeColumn.c_str(), objectIdColumn.c_str());
+	arg.limit = TRIGGER_PAGE_SIZE;
 }
 
 void ArmNagiosNDOUtils::makeSelectEventBuilder(void)
@@ -573,11 +899,18 @@ void ArmNagiosNDOUtils::makeSelectEventBuilder(void)
 	builder.add(IDX_HOSTS_DISPLAY_NAME);
 
 	// contiditon
+	const string statehistoryIdColumn =
+	  tableProfileStateHistory.getFullColumnName(
+	    IDX_STATEHISTORY_STATEHISTORY_ID);
 	m_impl->selectEventBaseCondition = StringUtils::sprintf(
-	  "%s=%d and %s>=",
+	  "%s=%d and %s>",
 	  tableProfileStateHistory.getFullColumnName(IDX_STATEHISTORY_STATE_TYPE).c_str(),
-	  HARD_STATE,
-	  tableProfileStateHistory.getFullColumnName(IDX_STATEHISTORY_STATEHISTORY_ID).c_str());
+	  HARD_STATE, statehistoryIdColumn.c_str());
+
+	// The primary key is used for both of the range and the order.
+	DBAgent::SelectExArg &arg = builder.getSelectExArg();
+	arg.orderBy = statehistoryIdColumn;
+	arg.limit = EVENT_PAGE_SIZE;
 }
 
 void ArmNagiosNDOUtils::makeSelectItemBuilder(void)
@@ -627,60 +960,125 @@ void ArmNagiosNDOUtils::makeSelectHostgroupMembersArg(void)
 
 void ArmNagiosNDOUtils::addConditionForTriggerQuery(const bool &isUpdateTrigger)
 {
-	time_t lastUpdateTime;
-	struct tm tm;
-	if (isUpdateTrigger) {
+	if (!isUpdateTrigger) {
+		m_impl->lastStatusUpdateTime = 0;
+	} else if (!m_impl->triggerWatermarkLoaded) {
 		ThreadLocalDBCache cache;
 		const MonitoringServerInfo &svInfo = getServerInfo();
-		lastUpdateTime =
+		m_impl->lastStatusUpdateTime =
 			cache.getMonitoring().getLastChangeTimeOfTrigger(svInfo.id);
-	} else {
-		lastUpdateTime = 0;
+		m_impl->triggerWatermarkLoaded = true;
 	}
-	localtime_r(&lastUpdateTime, &tm);
+	// Services that have the same status_update_time as the watermark
+	// are fetched again, because they may be updated in the same second.
+	m_impl->triggerCursorTime = m_impl->lastStatusUpdateTime;
+	m_impl->triggerCursorObjectId = -1;
+}
 
+void ArmNagiosNDOUtils::addConditionForTriggerPage(void)
+{
+	const string timeStr =
+	  Impl::makeDateTimeString(m_impl->triggerCursorTime);
 	DBAgent::SelectExArg &arg =
 	  m_impl->selectTriggerBuilder.getSelectExArg();
-	arg.condition = m_impl->selectTriggerBaseCondition;
-	arg.condition +=
-	   StringUtils::sprintf("'%04d-%02d-%02d %02d:%02d:%02d'",
-	                        1900+tm.tm_year, tm.tm_mon+1, tm.tm_mday,
-	                        tm.tm_hour, tm.tm_min, tm.tm_sec);
+	arg.condition = StringUtils::sprintf(
+	  m_impl->selectTriggerBaseCondition.c_str(),
+	  timeStr.c_str(), timeStr.c_str(), m_impl->triggerCursorObjectId);
 }
 
-void ArmNagiosNDOUtils::addConditionForEventQuery(void)
+void ArmNagiosNDOUtils::loadEventWatermark(void)
 {
-	ThreadLocalDBCache cache;
 	const MonitoringServerInfo &svInfo = getServerInfo();
-	const EventIdType lastEventId =
-	  cache.getMonitoring().getMaxEventId(svInfo.id);
-	string cond;
-	DBAgent::SelectExArg &arg = m_impl->selectEventBuilder.getSelectExArg();
-	arg.condition = m_impl->selectEventBaseCondition;
-	if (lastEventId == EVENT_NOT_FOUND) {
-		cond = "0";
-	} else {
-		if (!StringUtils::isNumber(lastEventId)) {
-			THROW_HATOHOL_EXCEPTION("Unexpected event ID: %s\n",
-			                        lastEventId.c_str());
+	bool eventDropped = false;
+	if (m_impl->eventWatermarkLoaded) {
+		m_impl->eventCommitLock.lock();
+		eventDropped = m_impl->eventDropped;
+		m_impl->eventCommitLock.unlock();
+	}
+	if (eventDropped) {
+		// The events after the dropped ones are fetched again.
+		m_impl->dataStore->flushIngestion(svInfo.id);
+		m_impl->eventCommitLock.lock();
+		m_impl->lastStatehistoryId = m_impl->committedStatehistoryId;
+		m_impl->eventDropped = false;
+		m_impl->eventCommitLock.unlock();
+		THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+		  HTERR_INTERNAL_ERROR,
+		  "Some events of server %" FMT_SERVER_ID " were dropped "
+		  "by the ingestion queue.", svInfo.id);
+	}
+
+	if (!m_impl->eventWatermarkLoaded) {
+		// The events in IngestionQueue have to be written before
+		// the max event ID is read.
+		const bool stored =
+		  m_impl->dataStore->flushIngestion(svInfo.id);
+		ThreadLocalDBCache cache;
+		const EventIdType lastEventId =
+		  cache.getMonitoring().getMaxEventId(svInfo.id);
+		if (lastEventId == EVENT_NOT_FOUND) {
+			m_impl->lastStatehistoryId = 0;
+		} else {
+			if (!StringUtils::isNumber(lastEventId)) {
+				THROW_HATOHOL_EXCEPTION(
+				  "Unexpected event ID: %s\n",
+				  lastEventId.c_str());
+			}
+			m_impl->lastStatehistoryId =
+			  StringUtils::toUint64(lastEventId);
+		}
+		m_impl->eventCommitLock.lock();
+		m_impl->committedStatehistoryId = m_impl->lastStatehistoryId;
+		m_impl->eventDropped = false;
+		m_impl->eventCommitLock.unlock();
+		m_impl->eventWatermarkLoaded = true;
+		if (!stored) {
+			THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+			  HTERR_INTERNAL_ERROR,
+			  "Some data of server %" FMT_SERVER_ID " were "
+			  "dropped by the ingestion queue.", svInfo.id);
 		}
-		const uint64_t eventId = Utils::sum(lastEventId, 1);
-		cond = StringUtils::toString(eventId);
 	}
-	arg.condition += cond;
+	m_impl->eventCursor = m_impl->lastStatehistoryId;
+}
+
+void ArmNagiosNDOUtils::addConditionForEventQuery(void)
+{
+	DBAgent::SelectExArg &arg = m_impl->selectEventBuilder.getSelectExArg();
+	arg.condition = m_impl->selectEventBaseCondition;
+	arg.condition += StringUtils::toString(m_impl->eventCursor);
 }
 
-void ArmNagiosNDOUtils::getTriggerInfoTable(TriggerInfoList &triggerInfoList)
+void ArmNagiosNDOUtils::fetchTriggers(DBAgentMySQL &dbAgent)
 {
 	// TODO: should use transaction
 	DBAgent::SelectExArg &arg =
 	  m_impl->selectTriggerBuilder.getSelectExArg();
-	m_impl->dbAgent->select(arg);
-	size_t numTriggers = arg.dataTable->getNumberOfRows();
-	MLPL_DBG("The number of triggers: %zd\n", numTriggers);
+	m_impl->triggerPages.clear();
+	size_t numRows;
+	do {
+		addConditionForTriggerPage();
+		m_impl->select(dbAgent, arg);
+		numRows = arg.dataTable->getNumberOfRows();
+		if (numRows == 0)
+			break;
+		m_impl->triggerPages.push_back(arg.dataTable);
+
+		// The rows are sorted by the key of the cursor.
+		const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+		ItemGroupStream itemGroupStream(grpList.back());
+		int currentStatus;
+		itemGroupStream >> m_impl->triggerCursorObjectId;
+		itemGroupStream >> currentStatus;
+		itemGroupStream >> m_impl->triggerCursorTime;
+	} while (numRows >= TRIGGER_PAGE_SIZE);
+}
 
+void ArmNagiosNDOUtils::appendTriggerInfoList(
+  TriggerInfoList &triggerInfoList, const ItemTablePtr &dataTable)
+{
 	const MonitoringServerInfo &svInfo = getServerInfo();
-	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+	const ItemGroupList &grpList = dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
 	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
 		int currentStatus, hostId;
@@ -721,11 +1119,13 @@ void ArmNagiosNDOUtils::getTriggerInfoTable(TriggerInfoList &triggerInfoList)
 	}
 }
 
-void ArmNagiosNDOUtils::getTrigger(const bool &isUpdateTrigger)
+void ArmNagiosNDOUtils::storeTriggers(const bool &isUpdateTrigger)
 {
 	TriggerInfoList triggerInfoList;
-	addConditionForTriggerQuery(isUpdateTrigger);
-	getTriggerInfoTable(triggerInfoList);
+	for (size_t i = 0; i < m_impl->triggerPages.size(); i++)
+		appendTriggerInfoList(triggerInfoList, m_impl->triggerPages[i]);
+	m_impl->triggerPages.clear();
+	MLPL_DBG("The number of triggers: %zd\n", triggerInfoList.size());
 
 	if (isUpdateTrigger) {
 		ThreadLocalDBCache cache;
@@ -734,23 +1134,67 @@ void ArmNagiosNDOUtils::getTrigger(const bool &isUpdateTrigger)
 		const MonitoringServerInfo &svInfo = getServerInfo();
 		ThreadLocalDBCache cache;
 		cache.getMonitoring().updateTrigger(triggerInfoList, svInfo.id);
+		// The watermark is the last key of all the services.
+		m_impl->triggerWatermarkLoaded = true;
 	}
+	m_impl->lastStatusUpdateTime = m_impl->triggerCursorTime;
 }
 
-void ArmNagiosNDOUtils::getEvent(void)
+void ArmNagiosNDOUtils::getTrigger(const bool &isUpdateTrigger)
 {
-	addConditionForEventQuery();
+	addConditionForTriggerQuery(isUpdateTrigger);
+	fetchTriggers(*m_impl->dbAgent);
+	storeTriggers(isUpdateTrigger);
+}
 
+void ArmNagiosNDOUtils::fetchEvents(DBAgentMySQL &dbAgent)
+{
 	// TODO: should use transaction
 	DBAgent::SelectExArg &arg = m_impl->selectEventBuilder.getSelectExArg();
-	m_impl->dbAgent->select(arg);
-	size_t numEvents = arg.dataTable->getNumberOfRows();
+	m_impl->eventPages.clear();
+	size_t numRows;
+	do {
+		addConditionForEventQuery();
+		m_impl->select(dbAgent, arg);
+		numRows = arg.dataTable->getNumberOfRows();
+		if (numRows == 0)
+			break;
+		m_impl->eventPages.push_back(arg.dataTable);
+
+		// The rows are sorted by statehistory_id.
+		const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+		ItemGroupStream itemGroupStream(grpList.back());
+		int statehistoryId;
+		itemGroupStream >> statehistoryId;
+		m_impl->eventCursor = statehistoryId;
+	} while (numRows >= EVENT_PAGE_SIZE &&
+	         m_impl->eventPages.size() < MAX_EVENT_PAGES_PER_POLL);
+}
+
+void ArmNagiosNDOUtils::storeEvents(void)
+{
+	size_t numEvents = 0;
+	for (size_t i = 0; i < m_impl->eventPages.size(); i++) {
+		numEvents += m_impl->eventPages[i]->getNumberOfRows();
+		addEventPage(m_impl->eventPages[i]);
+	}
+	m_impl->eventPages.clear();
 	MLPL_DBG("The number of events: %zd\n", numEvents);
+}
+
+void ArmNagiosNDOUtils::getEvent(void)
+{
+	loadEventWatermark();
+	fetchEvents(*m_impl->dbAgent);
+	storeEvents();
+}
 
-	// TODO: use addEventInfoList with the newly added data.
+void ArmNagiosNDOUtils::addEventPage(const ItemTablePtr &dataTable)
+{
 	const MonitoringServerInfo &svInfo = getServerInfo();
 	EventInfoList eventInfoList;
-	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
+	uint64_t lastStatehistoryId = m_impl->lastStatehistoryId;
+	const ItemGroupList &grpList = dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
 	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
 		int state, eventId, hostId;
@@ -761,6 +1205,7 @@ void ArmNagiosNDOUtils::getEvent(void)
 
 		itemGroupStream >> eventId;
 		eventInfo.id = StringUtils::sprintf("%020d", eventId);
+		lastStatehistoryId = eventId;
 		// type, status, and severity (state)
 		itemGroupStream >> state;
 		if (state == STATE_OK) {
@@ -789,14 +1234,25 @@ void ArmNagiosNDOUtils::getEvent(void)
 		itemGroupStream >> eventInfo.hostName;    // hosts.display_name
 		eventInfoList.push_back(eventInfo);
 	}
-	m_impl->dataStore->addEventList(eventInfoList);
+	m_impl->dataStore->addEventList(
+	  eventInfoList,
+	  new Impl::EventPageCommittedCb(*m_impl, lastStatehistoryId));
+
+	// The events are added to UnifiedDataStore, but may not be
+	// committed yet. The committed watermark is advanced by the above
+	// callback.
+	m_impl->lastStatehistoryId = lastStatehistoryId;
 }
 
-void ArmNagiosNDOUtils::getItem(void)
+void ArmNagiosNDOUtils::fetchItems(DBAgentMySQL &dbAgent)
 {
 	// TODO: should use transaction
+	m_impl->select(dbAgent, m_impl->selectItemBuilder.getSelectExArg());
+}
+
+void ArmNagiosNDOUtils::storeItems(void)
+{
 	DBAgent::SelectExArg &arg = m_impl->selectItemBuilder.getSelectExArg();
-	m_impl->dbAgent->select(arg);
 	size_t numItems = arg.dataTable->getNumberOfRows();
 	MLPL_DBG("The number of items: %zd\n", numItems);
 
@@ -835,13 +1291,23 @@ void ArmNagiosNDOUtils::getItem(void)
 	cache.getMonitoring().addItemInfoList(itemInfoList);
 }
 
-void ArmNagiosNDOUtils::getHost(void)
+void ArmNagiosNDOUtils::getItem(void)
 {
-	m_impl->hostMap.clear();
+	fetchItems(*m_impl->dbAgent);
+	storeItems();
+}
 
+void ArmNagiosNDOUtils::fetchHosts(DBAgentMySQL &dbAgent)
+{
 	// TODO: should use transaction
+	m_impl->select(dbAgent, m_impl->selectHostBuilder.getSelectExArg());
+}
+
+void ArmNagiosNDOUtils::storeHosts(void)
+{
+	m_impl->hostMap.clear();
+
 	DBAgent::SelectExArg &arg = m_impl->selectHostBuilder.getSelectExArg();
-	m_impl->dbAgent->select(arg);
 	size_t numHosts =
 	  arg.dataTable->getNumberOfRows();
 	MLPL_DBG("The number of hosts: %zd\n", numHosts);
@@ -868,16 +1334,27 @@ void ArmNagiosNDOUtils::getHost(void)
 	}
 	UnifiedDataStore *uds =  UnifiedDataStore::getInstance();
 
-	uds->syncHosts(svHostDefs, svInfo.id, m_impl->hostInfoCache);
+	uds->syncHosts(svHostDefs, svInfo.id, m_impl->hostInfoCache,
+	               &m_impl->storedHostsChanged);
 }
 
-void ArmNagiosNDOUtils::getHostgroup(void)
+void ArmNagiosNDOUtils::getHost(void)
 {
-	m_impl->hostgroupMap.clear();
+	fetchHosts(*m_impl->dbAgent);
+	storeHosts();
+}
 
+void ArmNagiosNDOUtils::fetchHostgroups(DBAgentMySQL &dbAgent)
+{
 	// TODO: should use transaction
+	m_impl->select(dbAgent, m_impl->selectHostgroupBuilder.getSelectExArg());
+}
+
+void ArmNagiosNDOUtils::storeHostgroups(void)
+{
+	m_impl->hostgroupMap.clear();
+
 	DBAgent::SelectExArg &arg = m_impl->selectHostgroupBuilder.getSelectExArg();
-	m_impl->dbAgent->select(arg);
 	size_t numHostgroups =
 	  arg.dataTable->getNumberOfRows();
 	MLPL_DBG("The number of hostgroups: %zd\n", numHostgroups);
@@ -904,10 +1381,20 @@ void ArmNagiosNDOUtils::getHostgroup(void)
 	UnifiedDataStore::getInstance()->upsertHostgroups(hostgroups);
 }
 
-void ArmNagiosNDOUtils::getHostgroupMembers(void)
+void ArmNagiosNDOUtils::getHostgroup(void)
+{
+	fetchHostgroups(*m_impl->dbAgent);
+	storeHostgroups();
+}
+
+void ArmNagiosNDOUtils::fetchHostgroupMembers(DBAgentMySQL &dbAgent)
 {
 	// TODO: should use transaction
-	m_impl->dbAgent->select(m_impl->selectHostgroupMembersArg);
+	m_impl->select(dbAgent, m_impl->selectHostgroupMembersArg);
+}
+
+void ArmNagiosNDOUtils::storeHostgroupMembers(void)
+{
 	size_t numHostgroupMembers =
 	  m_impl->selectHostgroupMembersArg.dataTable->getNumberOfRows();
 	MLPL_DBG("The number of hostgroupMembers: %zd\n", numHostgroupMembers);
@@ -943,6 +1430,12 @@ void ArmNagiosNDOUtils::getHostgroupMembers(void)
 	UnifiedDataStore::getInstance()->upsertHostgroupMembers(hostgroupMembers);
 }
 
+void ArmNagiosNDOUtils::getHostgroupMembers(void)
+{
+	fetchHostgroupMembers(*m_impl->dbAgent);
+	storeHostgroupMembers();
+}
+
 void ArmNagiosNDOUtils::connect(void)
 {
 	m_impl->connect();
@@ -983,25 +1476,71 @@ gpointer ArmNagiosNDOUtils::mainThread(HatoholThreadArg *arg)
 	return ArmBase::mainThread(arg);
 }
 
+void ArmNagiosNDOUtils::logPollStats(const SmartTime &startTime)
+{
+	SmartTime cost(SmartTime::INIT_CURR_TIME);
+	cost -= startTime;
+	ArmStatus *armStatus;
+	getArmStatus(armStatus);
+	armStatus->logPollStats(cost.getAsMSec(), m_impl->numFetchedRows);
+	m_impl->numFetchedRows = 0;
+}
+
+void ArmNagiosNDOUtils::pollConcurrently(void)
+{
+	const bool shouldFetchItems = !getCopyOnDemandEnabled();
+	loadEventWatermark();
+
+	// The queries that don't depend on each other run concurrently
+	// on the connections of the pool.
+	NDOFetchTask hostTask(this, &ArmNagiosNDOUtils::fetchHosts);
+	NDOFetchTask hostgroupTask(this, &ArmNagiosNDOUtils::fetchHostgroups);
+	NDOFetchTask hostgroupMembersTask(
+	  this, &ArmNagiosNDOUtils::fetchHostgroupMembers);
+	NDOFetchTask eventTask(this, &ArmNagiosNDOUtils::fetchEvents);
+	NDOFetchTask itemTask(this, &ArmNagiosNDOUtils::fetchItems);
+	vector<NDOFetchTask *> tasks;
+	tasks.push_back(&hostTask);
+	tasks.push_back(&hostgroupTask);
+	tasks.push_back(&hostgroupMembersTask);
+	tasks.push_back(&eventTask);
+	if (shouldFetchItems)
+		tasks.push_back(&itemTask);
+	m_impl->connectionPool.run(tasks);
+
+	// The results are stored in the same order as the serial polling.
+	// The trigger query depends on whether the hosts are changed.
+	// So it is run after the hosts are stored.
+	storeHosts();
+	storeHostgroups();
+	storeHostgroupMembers();
+	getTrigger(m_impl->storedHostsChanged);
+	storeEvents();
+	if (shouldFetchItems)
+		storeItems();
+}
+
+size_t ArmNagiosNDOUtils::getNumberOfCreatedPoolConnections(void)
+{
+	return m_impl->connectionPool.getNumberOfCreatedConnections();
+}
+
 ArmBase::ArmPollingResult ArmNagiosNDOUtils::mainThreadOneProc(void)
 {
+	const SmartTime startTime(SmartTime::INIT_CURR_TIME);
+	ArmPollingResult result = COLLECT_OK;
 	try {
 		if (!m_impl->dbAgent)
 			connect();
-		getHost();
-		getHostgroup();
-		getHostgroupMembers();
-		getTrigger(UnifiedDataStore::getInstance()->wasStoredHostsChanged());
-		getEvent();
-		if (!getCopyOnDemandEnabled())
-			getItem();
+		pollConcurrently();
 	} catch (const HatoholException &he) {
-		return handleHatoholException(he);
+		result = handleHatoholException(he);
 	} catch (const exception &e) {
 		MLPL_ERR("Got exception: %s\n", e.what());
-		return COLLECT_NG_INTERNAL_ERROR;
+		result = COLLECT_NG_INTERNAL_ERROR;
 	}
-	return COLLECT_OK;
+	logPollStats(startTime);
+	return result;
 }
 
 ArmBase::ArmPollingResult ArmNagiosNDOUtils::mainThreadOneProcFetchItems(void)
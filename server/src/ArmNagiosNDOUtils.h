@@ -27,6 +27,8 @@
 #include "JSONBuilder.h"
 #include "DBTablesConfig.h"
 
+class DBAgentMySQL;
+
 class ArmNagiosNDOUtils : public ArmBase
 {
 public:
@@ -41,17 +43,48 @@ protected:
 	void makeSelectHostgroupArg(void);
 	void makeSelectHostgroupMembersArg(void);
 	void addConditionForTriggerQuery(const bool &isUpdateTrigger);
+	void addConditionForTriggerPage(void);
+	void loadEventWatermark(void);
 	void addConditionForEventQuery(void);
+	void appendTriggerInfoList(TriggerInfoList &triggerInfoList,
+	                           const ItemTablePtr &dataTable);
+	void addEventPage(const ItemTablePtr &dataTable);
+
+	// These fetch rows on the given connection. They may be called
+	// concurrently on the threads of the connection pool.
+	void fetchTriggers(DBAgentMySQL &dbAgent);
+	void fetchEvents(DBAgentMySQL &dbAgent);
+	void fetchItems(DBAgentMySQL &dbAgent);
+	void fetchHosts(DBAgentMySQL &dbAgent);
+	void fetchHostgroups(DBAgentMySQL &dbAgent);
+	void fetchHostgroupMembers(DBAgentMySQL &dbAgent);
+
+	// These store the fetched rows with UnifiedDataStore.
+	void storeTriggers(const bool &isUpdateTrigger);
+	void storeEvents(void);
+	void storeItems(void);
+	void storeHosts(void);
+	void storeHostgroups(void);
+	void storeHostgroupMembers(void);
+
 	void getTrigger(const bool &isUpdateTrigger);
-	void getTriggerInfoTable(TriggerInfoList &triggerInfoList);
 	void getEvent(void);
 	void getItem(void);
 	void getHost(void);
 	void getHostgroup(void);
 	void getHostgroupMembers(void);
+	void pollConcurrently(void);
 	void connect(void);
 
+	/**
+	 * Get the number of the connections that have been made by the
+	 * pool used in pollConcurrently(). A connection is reused
+	 * over the pollings unless it gets an error.
+	 */
+	size_t getNumberOfCreatedPoolConnections(void);
+
 	ArmPollingResult handleHatoholException(const HatoholException &he);
+	void logPollStats(const mlpl::SmartTime &startTime);
 
 	// virtual methods
 	virtual gpointer mainThread(HatoholThreadArg *arg);
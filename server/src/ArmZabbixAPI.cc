@@ -45,11 +45,13 @@ struct ArmZabbixAPI::Impl
 {
 	const ServerIdType zabbixServerId;
 	HostInfoCache      hostInfoCache;
+	bool               storedHostsChanged;
 
 	// constructors
 	Impl(const MonitoringServerInfo &serverInfo)
 	: zabbixServerId(serverInfo.id),
-	  hostInfoCache(&serverInfo.id)
+	  hostInfoCache(&serverInfo.id),
+	  storedHostsChanged(true)
 	{
 	}
 };
@@ -114,6 +116,17 @@ void ArmZabbixAPI::updateHosts(void)
 
 void ArmZabbixAPI::updateEvents(void)
 {
+	// The events added in the previous poll may be in IngestionQueue.
+	// They have to be written before the last event ID is read.
+	// Otherwise they are fetched and their actions are run again.
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	if (!dataStore->flushIngestion(m_impl->zabbixServerId)) {
+		THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+		  HTERR_INTERNAL_ERROR,
+		  "Some events of server %" FMT_SERVER_ID " were dropped "
+		  "by the ingestion queue.", m_impl->zabbixServerId);
+	}
+
 	const uint64_t serverLastEventId = getEndEventId(false);
 	if (serverLastEventId == EVENT_ID_NOT_FOUND) {
 		MLPL_DBG("Last event ID is not found in Zabbix server\n");
@@ -262,7 +275,8 @@ void ArmZabbixAPI::makeHatoholHosts(ItemTablePtr hosts)
 	UnifiedDataStore *uds = UnifiedDataStore::getInstance();
 	THROW_HATOHOL_EXCEPTION_IF_NOT_OK(
 	  uds->syncHosts(svHostDefs, m_impl->zabbixServerId,
-	                 m_impl->hostInfoCache));
+	                 m_impl->hostInfoCache,
+	                 &m_impl->storedHostsChanged));
 }
 
 uint64_t ArmZabbixAPI::getMaximumNumberGetEventPerOnce(void)
@@ -303,7 +317,7 @@ ArmBase::ArmPollingResult ArmZabbixAPI::mainThreadOneProc(void)
 	try {
 		updateHosts();
 		updateGroups();
-		if (UnifiedDataStore::getInstance()->wasStoredHostsChanged()){
+		if (m_impl->storedHostsChanged) {
 			ItemTablePtr triggers = updateTriggers();
 			makeHatoholTriggers(triggers);
 		} else {
@@ -18,14 +18,25 @@
  */
 
 #include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <limits>
+#include <cstring>
 #include <semaphore.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <Logger.h>
 #include <AtomicValue.h>
+#include <Mutex.h>
+#include <SimpleSemaphore.h>
+#include <SmartBuffer.h>
 #include "ChildProcessManager.h"
 #include "HatoholException.h"
 #include "Reaper.h"
 #include "EventSemaphore.h"
+#include "SpawnYardProtocol.h"
 
 using namespace std;
 using namespace mlpl;
@@ -80,9 +91,14 @@ struct ChildProcessManager::Impl {
 	ReadWriteLock childrenMapLock;
 	ChildMap      childrenMap;
 
+	ReadWriteLock        spawnYardsLock;
+	vector<SpawnYard *>  spawnYards;
+	AtomicValue<size_t>  spawnYardIndex;
+
 	Impl(void)
 	: resetRequest(false),
-	  resetSem(0)
+	  resetSem(0),
+	  spawnYardIndex(0)
 	{
 		HATOHOL_ASSERT(sem_init(&waitChildSem, 0, 0) == 0,
 		               "Failed to call sem_init(): %d\n", errno);
@@ -115,6 +131,42 @@ struct ChildProcessManager::Impl {
 		}
 	}
 
+	/**
+	 * Add a created child to childrenMap.
+	 * This method should be used with the write lock of childrenMapLock.
+	 */
+	void addChild(const CreateArg &arg)
+	{
+		ChildInfo *childInfo = new ChildInfo(arg.pid, arg.eventCb);
+		pair<ChildMapIterator, bool> result =
+		  childrenMap.insert(pair<pid_t, ChildInfo *>(arg.pid,
+		                                              childInfo));
+		if (!result.second) {
+			// TODO: Recovery
+			HATOHOL_ASSERT(true,
+			  "The previous data might still remain: %d\n",
+			  arg.pid);
+		}
+	}
+
+	/**
+	 * Choose a spawn yard for the child.
+	 * This method should be used with the read lock of spawnYardsLock.
+	 *
+	 * @return A SpawnYard instance or NULL if there's no spawn yard
+	 * that can create the child.
+	 */
+	SpawnYard *pickSpawnYard(const CreateArg &arg)
+	{
+		if (spawnYards.empty())
+			return NULL;
+		// A spawn yard doesn't take any flags.
+		if (arg.flags != G_SPAWN_DO_NOT_REAP_CHILD)
+			return NULL;
+		const size_t idx = spawnYardIndex.add(1);
+		return spawnYards[idx % spawnYards.size()];
+	}
+
 	void resetOnCollectThread(void)
 	{
 		childrenMapLock.writeLock();
@@ -143,6 +195,425 @@ private:
 ChildProcessManager *ChildProcessManager::Impl::instance = NULL;
 ReadWriteLock        ChildProcessManager::Impl::instanceLock;
 
+// ---------------------------------------------------------------------------
+// SpawnYard
+// ---------------------------------------------------------------------------
+struct ChildProcessManager::SpawnYard : public HatoholThreadBase {
+	struct Reply {
+		pid_t    pid;
+		uint16_t stage;
+		int      err;
+		// true if the spawn yard exited before the reply.
+		bool     lost;
+
+		Reply(void)
+		: pid(-1),
+		  stage(SPAWN_YARD_PROTO_STAGE_NONE),
+		  err(0),
+		  lost(false)
+		{
+		}
+	};
+
+	// The relayed exits are dispatched on this thread, because
+	// the callbacks may create another child with a spawn yard and
+	// wait for the reply read by mainThread() of it.
+	struct Dispatcher : public HatoholThreadBase {
+		ChildProcessManager * const manager;
+		Mutex             queueLock;
+		deque<siginfo_t>  queue;
+		SimpleSemaphore   queueSem;
+
+		Dispatcher(ChildProcessManager *_manager)
+		: manager(_manager),
+		  queueSem(0)
+		{
+		}
+
+		void push(const siginfo_t &siginfo)
+		{
+			queueLock.lock();
+			queue.push_back(siginfo);
+			queueLock.unlock();
+			queueSem.post();
+		}
+
+		void stop(void)
+		{
+			// si_pid: 0 is the request to exit.
+			siginfo_t siginfo;
+			memset(&siginfo, 0, sizeof(siginfo));
+			push(siginfo);
+			waitExit();
+		}
+
+	protected:
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			while (true) {
+				int err = queueSem.wait();
+				HATOHOL_ASSERT(err == 0,
+				  "Failed to call queueSem.wait(): %d\n", err);
+				queueLock.lock();
+				const siginfo_t siginfo = queue.front();
+				queue.pop_front();
+				queueLock.unlock();
+				if (siginfo.si_pid == 0)
+					break;
+				manager->collected(&siginfo, true);
+			}
+			return NULL;
+		}
+	};
+
+	ChildProcessManager * const manager;
+	const int   fd;
+	const pid_t pid;
+	Dispatcher  dispatcher;
+
+	// Only one request is sent at a time.
+	Mutex           requestLock;
+	SimpleSemaphore replySem;
+
+	// The following members are protected by 'lock'.
+	Mutex                 lock;
+	bool                  alive;
+	bool                  waitingReply;
+	Reply                 reply;
+	// The children that have been spawned but haven't been added to
+	// childrenMap yet, and the exits of them.
+	set<pid_t>            pendingChildren;
+	map<pid_t, siginfo_t> deferredExits;
+
+	static SpawnYard *launch(ChildProcessManager *manager,
+	                         const string &path)
+	{
+		int sock[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0,
+		               sock) == -1) {
+			MLPL_ERR("Failed to call socketpair: %d\n", errno);
+			return NULL;
+		}
+
+		const string fdStr = StringUtils::toString(sock[1]);
+		const gchar *argv[] = {path.c_str(), fdStr.c_str(), NULL};
+		// G_SPAWN_DO_NOT_REAP_CHILD isn't set. So the spawn yard is
+		// not a child of this process and mainThread() never collects
+		// it.
+		const GSpawnFlags flags = (GSpawnFlags)0;
+		GPid pid;
+		GError *error = NULL;
+		gboolean succeeded =
+		  g_spawn_async(NULL, (gchar **)argv, NULL, flags,
+		                inheritSocket, GINT_TO_POINTER(sock[1]),
+		                &pid, &error);
+		close(sock[1]);
+		if (!succeeded) {
+			MLPL_ERR("Failed to launch %s: %s\n", path.c_str(),
+			         error ? error->message : "Unknown reason");
+			if (error)
+				g_error_free(error);
+			close(sock[0]);
+			return NULL;
+		}
+		return new SpawnYard(manager, sock[0], pid);
+	}
+
+	virtual ~SpawnYard()
+	{
+		close(fd);
+	}
+
+	void startThreads(void)
+	{
+		dispatcher.start();
+		start();
+	}
+
+	/**
+	 * Stop the spawn yard. The spawn yard exits when the socket is
+	 * shut down.
+	 */
+	void stop(void)
+	{
+		shutdown(fd, SHUT_RDWR);
+		waitExit();
+		dispatcher.stop();
+	}
+
+	/**
+	 * Send a spawn request.
+	 * This method should be used with requestLock.
+	 *
+	 * @return
+	 * true if the request is sent. Then waitReply() should be called.
+	 * false if the request isn't sent. The child should be created by
+	 * another way.
+	 */
+	bool request(const CreateArg &arg)
+	{
+		SmartBuffer pkt;
+		if (!makeRequestPacket(arg, pkt))
+			return false;
+
+		lock.lock();
+		const bool canRequest = alive;
+		if (canRequest)
+			waitingReply = true;
+		lock.unlock();
+		if (!canRequest)
+			return false;
+
+		if (!spawnYardWrite(fd, static_cast<const char *>(pkt),
+		                    pkt.index())) {
+			// mainThread() finds the broken socket and wakes us.
+			Reply lostReply;
+			waitReply(lostReply);
+			return false;
+		}
+		return true;
+	}
+
+	void waitReply(Reply &_reply)
+	{
+		int err = replySem.wait();
+		HATOHOL_ASSERT(err == 0,
+		               "Failed to call replySem.wait(): %d\n", err);
+		lock.lock();
+		_reply = reply;
+		lock.unlock();
+	}
+
+	/**
+	 * Called after the child is added to childrenMap. If the child
+	 * has exited before it, the exit is dispatched from here.
+	 */
+	void settle(const pid_t &childPid)
+	{
+		lock.lock();
+		pendingChildren.erase(childPid);
+		map<pid_t, siginfo_t>::iterator it =
+		  deferredExits.find(childPid);
+		if (it != deferredExits.end()) {
+			dispatcher.push(it->second);
+			deferredExits.erase(it);
+		}
+		lock.unlock();
+	}
+
+	static GError *createError(const Reply &reply, const CreateArg &arg)
+	{
+		if (reply.lost) {
+			return g_error_new(G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED,
+			                   "hatohol-spawn-yard has exited");
+		}
+		switch (reply.stage) {
+		case SPAWN_YARD_PROTO_STAGE_FORK:
+			return g_error_new(G_SPAWN_ERROR, G_SPAWN_ERROR_FORK,
+			                   "Failed to fork (%s)",
+			                   g_strerror(reply.err));
+		case SPAWN_YARD_PROTO_STAGE_CHDIR:
+			return g_error_new(
+			  G_SPAWN_ERROR, G_SPAWN_ERROR_CHDIR,
+			  "Failed to change to directory '%s' (%s)",
+			  arg.workingDirectory.c_str(), g_strerror(reply.err));
+		}
+		return g_error_new(G_SPAWN_ERROR, execErrorToSpawnError(reply.err),
+		                   "Failed to execute child process \"%s\" (%s)",
+		                   arg.args[0].c_str(), g_strerror(reply.err));
+	}
+
+protected:
+	SpawnYard(ChildProcessManager *_manager, const int &_fd,
+	          const pid_t &_pid)
+	: manager(_manager),
+	  fd(_fd),
+	  pid(_pid),
+	  dispatcher(_manager),
+	  replySem(0),
+	  alive(true),
+	  waitingReply(false)
+	{
+	}
+
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		MLPL_INFO("started SpawnYard::mainThread: %d.\n", pid);
+		while (true) {
+			uint16_t type;
+			SmartBuffer body;
+			if (!readPacket(type, body))
+				break;
+			if (type == SPAWN_YARD_PROTO_PKT_TYPE_SPAWNED) {
+				if (!onSpawned(body))
+					break;
+			} else if (type == SPAWN_YARD_PROTO_PKT_TYPE_EXITED) {
+				if (!onExited(body))
+					break;
+			} else {
+				MLPL_ERR("Unexpected packet: %d\n", type);
+				break;
+			}
+		}
+
+		lock.lock();
+		alive = false;
+		const bool wakeRequester = waitingReply;
+		if (waitingReply) {
+			reply = Reply();
+			reply.lost = true;
+			waitingReply = false;
+		}
+		lock.unlock();
+		if (wakeRequester)
+			replySem.post();
+		MLPL_INFO("hatohol-spawn-yard (%d) has gone.\n", pid);
+		return NULL;
+	}
+
+private:
+	static void inheritSocket(gpointer data)
+	{
+		// Called in the child. The file descriptor is inherited by
+		// the spawn yard.
+		fcntl(GPOINTER_TO_INT(data), F_SETFD, 0);
+	}
+
+	static GSpawnError execErrorToSpawnError(const int &err)
+	{
+		switch (err) {
+		case EACCES:       return G_SPAWN_ERROR_ACCES;
+		case EPERM:        return G_SPAWN_ERROR_PERM;
+		case E2BIG:        return G_SPAWN_ERROR_TOO_BIG;
+		case ENOEXEC:      return G_SPAWN_ERROR_NOEXEC;
+		case ENAMETOOLONG: return G_SPAWN_ERROR_NAMETOOLONG;
+		case ENOENT:       return G_SPAWN_ERROR_NOENT;
+		case ENOMEM:       return G_SPAWN_ERROR_NOMEM;
+		case ENOTDIR:      return G_SPAWN_ERROR_NOTDIR;
+		case ELOOP:        return G_SPAWN_ERROR_LOOP;
+		case ETXTBSY:      return G_SPAWN_ERROR_TXTBUSY;
+		case EIO:          return G_SPAWN_ERROR_IO;
+		case ENFILE:       return G_SPAWN_ERROR_NFILE;
+		case EMFILE:       return G_SPAWN_ERROR_MFILE;
+		case EINVAL:       return G_SPAWN_ERROR_INVAL;
+		case EISDIR:       return G_SPAWN_ERROR_ISDIR;
+		case ELIBBAD:      return G_SPAWN_ERROR_LIBBAD;
+		}
+		return G_SPAWN_ERROR_FAILED;
+	}
+
+	static bool makeRequestPacket(const CreateArg &arg, SmartBuffer &pkt)
+	{
+		// A request that doesn't fit the protocol is rejected.
+		const size_t maxLen = numeric_limits<uint16_t>::max();
+		if (arg.args.size() > maxLen || arg.envs.size() > maxLen)
+			return false;
+		size_t bodySize = SPAWN_YARD_PROTO_SPAWN_NUM_ARGS_LEN +
+		                  SPAWN_YARD_PROTO_SPAWN_NUM_ENVS_LEN;
+		if (!addStringSize(arg.workingDirectory, bodySize))
+			return false;
+		for (size_t i = 0; i < arg.args.size(); i++) {
+			if (!addStringSize(arg.args[i], bodySize))
+				return false;
+		}
+		for (size_t i = 0; i < arg.envs.size(); i++) {
+			if (!addStringSize(arg.envs[i], bodySize))
+				return false;
+		}
+		if (bodySize > SPAWN_YARD_PROTO_MAX_BODY_SIZE)
+			return false;
+
+		pkt.alloc(SPAWN_YARD_PROTO_HEADER_LEN + bodySize);
+		pkt.add32(bodySize);
+		pkt.add16(SPAWN_YARD_PROTO_PKT_TYPE_SPAWN);
+		pkt.add16(arg.args.size());
+		pkt.add16(arg.envs.size());
+		pkt.add<uint16_t>(arg.workingDirectory);
+		for (size_t i = 0; i < arg.args.size(); i++)
+			pkt.add<uint16_t>(arg.args[i]);
+		for (size_t i = 0; i < arg.envs.size(); i++)
+			pkt.add<uint16_t>(arg.envs[i]);
+		return true;
+	}
+
+	static bool addStringSize(const string &str, size_t &bodySize)
+	{
+		if (str.size() > numeric_limits<uint16_t>::max())
+			return false;
+		bodySize += SPAWN_YARD_PROTO_SPAWN_STRING_LEN + str.size();
+		return true;
+	}
+
+	bool readPacket(uint16_t &type, SmartBuffer &body)
+	{
+		SmartBuffer header(SPAWN_YARD_PROTO_HEADER_LEN);
+		if (!spawnYardRead(fd, static_cast<char *>(header),
+		                   SPAWN_YARD_PROTO_HEADER_LEN)) {
+			return false;
+		}
+		const size_t bodySize = header.getValueAndIncIndex<uint32_t>();
+		type = header.getValueAndIncIndex<uint16_t>();
+		if (bodySize > SPAWN_YARD_PROTO_MAX_BODY_SIZE) {
+			MLPL_ERR("Too large packet: %zd\n", bodySize);
+			return false;
+		}
+		body.alloc(bodySize);
+		return spawnYardRead(fd, static_cast<char *>(body), bodySize);
+	}
+
+	bool onSpawned(SmartBuffer &body)
+	{
+		if (body.size() != SPAWN_YARD_PROTO_SPAWNED_BODY_LEN) {
+			MLPL_ERR("Invalid body size: %zd\n", body.size());
+			return false;
+		}
+		Reply newReply;
+		newReply.pid   = body.getValueAndIncIndex<int32_t>();
+		newReply.stage = body.getValueAndIncIndex<uint16_t>();
+		newReply.err   = body.getValueAndIncIndex<int32_t>();
+
+		lock.lock();
+		const bool expected = waitingReply;
+		if (expected) {
+			reply = newReply;
+			waitingReply = false;
+			if (reply.pid > 0)
+				pendingChildren.insert(reply.pid);
+		}
+		lock.unlock();
+		if (!expected) {
+			MLPL_BUG("Got an unexpected reply: %d\n", newReply.pid);
+			return false;
+		}
+		replySem.post();
+		return true;
+	}
+
+	bool onExited(SmartBuffer &body)
+	{
+		if (body.size() != SPAWN_YARD_PROTO_EXITED_BODY_LEN) {
+			MLPL_ERR("Invalid body size: %zd\n", body.size());
+			return false;
+		}
+		siginfo_t siginfo;
+		memset(&siginfo, 0, sizeof(siginfo));
+		siginfo.si_signo  = SIGCHLD;
+		siginfo.si_pid    = body.getValueAndIncIndex<int32_t>();
+		siginfo.si_code   = body.getValueAndIncIndex<int32_t>();
+		siginfo.si_status = body.getValueAndIncIndex<int32_t>();
+
+		// The child might not have been added to childrenMap yet.
+		// Then the exit is dispatched from settle().
+		lock.lock();
+		if (pendingChildren.count(siginfo.si_pid))
+			deferredExits[siginfo.si_pid] = siginfo;
+		else
+			dispatcher.push(siginfo);
+		lock.unlock();
+		return true;
+	}
+};
+
 // ---------------------------------------------------------------------------
 // EventCallback
 // ---------------------------------------------------------------------------
@@ -260,6 +731,20 @@ void ChildProcessManager::reset(void)
 
 HatoholError ChildProcessManager::create(CreateArg &arg)
 {
+	if (arg.args.empty())
+		return HTERR_INVALID_ARGS;
+
+	m_impl->spawnYardsLock.readLock();
+	Reaper<ReadWriteLock> unlocker(
+	  &m_impl->spawnYardsLock, ReadWriteLock::unlock);
+	SpawnYard *yard = m_impl->pickSpawnYard(arg);
+	if (yard) {
+		HatoholError err;
+		if (createBySpawnYard(*yard, arg, err))
+			return err;
+	}
+	unlocker.reap();
+
 	const gchar *workingDir =
 	  arg.workingDirectory.empty() ? NULL : arg.workingDirectory.c_str();
 	const GSpawnChildSetupFunc childSetup = NULL;
@@ -268,8 +753,6 @@ HatoholError ChildProcessManager::create(CreateArg &arg)
 
 	// argv
 	const size_t numArgs = arg.args.size();
-	if (numArgs == 0)
-		return HTERR_INVALID_ARGS;
 	const gchar *argv[numArgs+1];
 	for (size_t i = 0; i < numArgs; i++)
 		argv[i] = arg.args[i].c_str();
@@ -291,32 +774,48 @@ HatoholError ChildProcessManager::create(CreateArg &arg)
 		arg.eventCb->onExecuted(succeeded, error);
 	if (!succeeded) {
 		m_impl->childrenMapLock.unlock();
-		string reason = "<Unknown reason>";
-		if (error) {
-			reason = error->message;
-			g_error_free(error);
-		}
-		MLPL_ERR("Failed to create process: (%s), %s\n",
-		         argv[0], reason.c_str());
-		return HatoholError(HTERR_FAILED_TO_SPAWN, reason);
+		return spawnFailure(argv[0], error);
 	}
-
-	ChildInfo *childInfo = new ChildInfo(arg.pid, arg.eventCb);
-
-	pair<ChildMapIterator, bool> result =
-	  m_impl->childrenMap.insert(pair<
-	    pid_t, ChildInfo *>(arg.pid, childInfo));
+	m_impl->addChild(arg);
 	m_impl->childrenMapLock.unlock();
-	if (!result.second) {
-		// TODO: Recovery
-		HATOHOL_ASSERT(true,
-		  "The previous data might still remain: %d\n", arg.pid);
-	}
 	m_impl->postWaitChildSem();
 
 	return HTERR_OK;
 }
 
+size_t ChildProcessManager::startSpawnYards(const size_t &numYards,
+                                            const string &path)
+{
+	size_t numLaunched = 0;
+	m_impl->spawnYardsLock.writeLock();
+	for (size_t i = 0; i < numYards; i++) {
+		SpawnYard *yard = SpawnYard::launch(this, path);
+		if (!yard)
+			continue;
+		yard->startThreads();
+		m_impl->spawnYards.push_back(yard);
+		numLaunched++;
+	}
+	m_impl->spawnYardsLock.unlock();
+	MLPL_INFO("Launched %zd spawn yard(s).\n", numLaunched);
+	return numLaunched;
+}
+
+void ChildProcessManager::stopSpawnYards(void)
+{
+	// A create() that uses a spawn yard holds the read lock. So no one
+	// uses the removed spawn yards after the write lock is acquired.
+	vector<SpawnYard *> yards;
+	m_impl->spawnYardsLock.writeLock();
+	yards.swap(m_impl->spawnYards);
+	m_impl->spawnYardsLock.unlock();
+
+	for (size_t i = 0; i < yards.size(); i++) {
+		yards[i]->stop();
+		delete yards[i];
+	}
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -367,7 +866,8 @@ bool ChildProcessManager::isDead(const siginfo_t *siginfo)
 	return false;
 }
 
-void ChildProcessManager::collected(const siginfo_t *siginfo)
+void ChildProcessManager::collected(const siginfo_t *siginfo,
+                                    const bool &relayed)
 {
 	ChildInfo *childInfo = NULL;
 
@@ -381,7 +881,8 @@ void ChildProcessManager::collected(const siginfo_t *siginfo)
 		childInfo = it->second;
 	if (!childInfo) {
 		unlocker.reap();
-		m_impl->postWaitChildSem();
+		if (!relayed)
+			m_impl->postWaitChildSem();
 		MLPL_INFO("Collected unwatched child: %d\n", siginfo->si_pid);
 		return;
 	}
@@ -390,7 +891,8 @@ void ChildProcessManager::collected(const siginfo_t *siginfo)
 
 	if (childInfo->eventCb) {
 		if (!isDead(siginfo)) { // Ex. SIGSTOP
-			m_impl->postWaitChildSem();
+			if (!relayed)
+				m_impl->postWaitChildSem();
 			return;
 		}
 		childInfo->eventCb->onCollected(siginfo);
@@ -401,3 +903,52 @@ void ChildProcessManager::collected(const siginfo_t *siginfo)
 		childInfo->eventCb->onFinalized();
 	delete childInfo;
 }
+
+// ---------------------------------------------------------------------------
+// Private methods
+// ---------------------------------------------------------------------------
+bool ChildProcessManager::createBySpawnYard(SpawnYard &yard, CreateArg &arg,
+                                            HatoholError &err)
+{
+	AutoMutex autoMutex(&yard.requestLock);
+	if (!yard.request(arg))
+		return false;
+	SpawnYard::Reply reply;
+	yard.waitReply(reply);
+
+	GError *error = NULL;
+	if (reply.pid > 0)
+		arg.pid = reply.pid;
+	else
+		error = SpawnYard::createError(reply, arg);
+
+	// The reply is handled in the same way as g_spawn_async() in create()
+	// except for waitChildSem. The child is collected by the spawn yard.
+	m_impl->childrenMapLock.writeLock();
+	if (arg.eventCb)
+		arg.eventCb->onExecuted(!error, error);
+	if (error) {
+		m_impl->childrenMapLock.unlock();
+		err = spawnFailure(arg.args[0].c_str(), error);
+		return true;
+	}
+	m_impl->addChild(arg);
+	m_impl->childrenMapLock.unlock();
+	yard.settle(arg.pid);
+
+	err = HTERR_OK;
+	return true;
+}
+
+HatoholError ChildProcessManager::spawnFailure(const char *path,
+                                               GError *error)
+{
+	string reason = "<Unknown reason>";
+	if (error) {
+		reason = error->message;
+		g_error_free(error);
+	}
+	MLPL_ERR("Failed to create process: (%s), %s\n",
+	         path, reason.c_str());
+	return HatoholError(HTERR_FAILED_TO_SPAWN, reason);
+}
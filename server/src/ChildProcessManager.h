@@ -105,11 +105,37 @@ public:
 	/**
 	 * Create a child process.
 	 *
+	 * If spawn yards are running and arg.flags is the default, the child
+	 * is created by one of them. Otherwise it is created by this process.
+	 *
 	 * @param arg Information about the child to be created.
 	 * @return HatoholError instance.
 	 */
 	HatoholError create(CreateArg &arg);
 
+	/**
+	 * Launch hatohol-spawn-yard processes that create children on
+	 * behalf of this process.
+	 *
+	 * Forking a large process such as Hatohol is costly even with
+	 * copy-on-write, because its page tables are copied. A spawn yard is
+	 * small, so the cost of each create() becomes constant. The
+	 * arguments, the environment variables, and the working directory of
+	 * the children are passed as they are. The spawn yards that failed to
+	 * launch are just ignored.
+	 *
+	 * @param numYards The number of the spawn yards.
+	 * @param path     The path of hatohol-spawn-yard.
+	 * @return The number of the launched spawn yards.
+	 */
+	size_t startSpawnYards(const size_t &numYards, const std::string &path);
+
+	/**
+	 * Stop all spawn yards. The children created by them continue to run,
+	 * but they are no longer collected.
+	 */
+	void stopSpawnYards(void);
+
 protected:
 	// This class is sigleton. So the construtor should not be public.
 	ChildProcessManager(void);
@@ -117,11 +143,25 @@ protected:
 	virtual gpointer mainThread(HatoholThreadArg *arg) override;
 
 	bool isDead(const siginfo_t *siginfo);
-	void collected(const siginfo_t *siginfo);
+
+	/**
+	 * Dispatch the collection of a child to its EventCallback.
+	 *
+	 * @param siginfo The information of the child.
+	 * @param relayed
+	 * true if the child is collected by a spawn yard and is relayed to
+	 * this process. Otherwise it is collected by waitid() of mainThread().
+	 */
+	void collected(const siginfo_t *siginfo, const bool &relayed = false);
 
 private:
 	struct Impl;
+	struct SpawnYard;
 	std::unique_ptr<Impl> m_impl;
+
+	bool createBySpawnYard(SpawnYard &yard, CreateArg &arg,
+	                       HatoholError &err);
+	static HatoholError spawnFailure(const char *path, GError *error);
 };
 
 #endif // ChildProcessManager_h
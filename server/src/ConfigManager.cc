@@ -27,6 +27,7 @@
 #include "DBTablesConfig.h"
 #include "Reaper.h"
 #include "ThreadLocalDBCache.h"
+#include "IngestionQueue.h"
 using namespace std;
 using namespace mlpl;
 
@@ -46,8 +47,10 @@ int ConfigManager::ALLOW_ACTION_FOR_ALL_OLD_EVENTS;
 static int DEFAULT_ALLOWED_TIME_OF_ACTION_FOR_OLD_EVENTS
   = 60 * 60 * 24; // 24 hours
 const char *ConfigManager::DEFAULT_PID_FILE_PATH = LOCALSTATEDIR "/run/hatohol.pid";
+const int ConfigManager::DEFAULT_FETCH_STALENESS_SEC = 10;
 
 static int DEFAULT_MAX_NUM_RUNNING_COMMAND_ACTION = 10;
+static int DEFAULT_MAX_NUM_WAITING_COMMAND_ACTION = 1000;
 
 static gboolean parseFaceRestPort(
   const gchar *option_name, const gchar *value,
@@ -113,6 +116,7 @@ CommandLineOptions::CommandLineOptions(void)
 : pidFilePath(NULL),
   user(NULL),
   dbServer(NULL),
+  dbReplicas(NULL),
   dbName(NULL),
   dbUser(NULL),
   dbPassword(NULL),
@@ -122,7 +126,15 @@ CommandLineOptions::CommandLineOptions(void)
   disableCopyOnDemand(FALSE),
   loadOldEvents(FALSE),
   faceRestPort(-1),
-  faceRestNumWorkers(0)
+  faceRestNumWorkers(0),
+  fetchStalenessSec(-1),
+  eventRetentionDays(-1),
+  dbReplicaMaxLagSec(-1),
+  dbPoolSize(0),
+  ingestionNumWriters(-1),
+  ingestionQueueSize(0),
+  maxNumWaitingCommandAction(0),
+  numSpawnYards(-1)
 {
 }
 
@@ -139,6 +151,8 @@ struct ConfigManager::Impl {
 	bool                  foreground;
 	string                dbServerAddress;
 	int                   dbServerPort;
+	DBReplicaInfoVect     dbReplicas;
+	int                   dbReplicaMaxLagSec;
 	bool                  testMode;
 	ConfigState           copyOnDemand;
 	AtomicValue<int>      faceRestPort;
@@ -146,18 +160,31 @@ struct ConfigManager::Impl {
 	string                pidFilePath;
 	bool                  loadOldEvents;
 	int                   faceRestNumWorkers;
+	int                   fetchStalenessSec;
+	int                   eventRetentionDays;
+	int                   ingestionNumWriters;
+	size_t                ingestionQueueSize;
+	AtomicValue<int>      maxNumWaitingCommandAction;
+	int                   numSpawnYards;
 
 	// methods
 	Impl(void)
 	: foreground(false),
 	  dbServerAddress("localhost"),
 	  dbServerPort(0),
+	  dbReplicaMaxLagSec(DBConnectInfo::DEFAULT_MAX_REPLICA_LAG_SEC),
 	  testMode(false),
 	  copyOnDemand(UNKNOWN),
 	  faceRestPort(0),
 	  pidFilePath(DEFAULT_PID_FILE_PATH),
 	  loadOldEvents(false),
-	  faceRestNumWorkers(0)
+	  faceRestNumWorkers(0),
+	  fetchStalenessSec(DEFAULT_FETCH_STALENESS_SEC),
+	  eventRetentionDays(0),
+	  ingestionNumWriters(0),
+	  ingestionQueueSize(IngestionQueue::DEFAULT_MAX_QUEUE_SIZE),
+	  maxNumWaitingCommandAction(DEFAULT_MAX_NUM_WAITING_COMMAND_ACTION),
+	  numSpawnYards(0)
 	{
 	}
 
@@ -187,6 +214,25 @@ struct ConfigManager::Impl {
 		dbServerPort = atoi(&dbServer.c_str()[posColon+1]);
 	}
 
+	void parseDBReplicas(const string &replicas)
+	{
+		dbReplicas.clear();
+		StringVector replicaVect;
+		StringUtils::split(replicaVect, replicas, ',');
+		for (size_t i = 0; i < replicaVect.size(); i++) {
+			const string &replica = replicaVect[i];
+			DBReplicaInfo replicaInfo;
+			const size_t posColon = replica.find(":");
+			replicaInfo.host = string(replica, 0, posColon);
+			replicaInfo.port = 0;
+			if (posColon != string::npos) {
+				replicaInfo.port =
+				  atoi(&replica.c_str()[posColon+1]);
+			}
+			dbReplicas.push_back(replicaInfo);
+		}
+	}
+
 	bool loadConfFile(const string &path)
 	{
 		if (path.empty())
@@ -225,6 +271,12 @@ struct ConfigManager::Impl {
 	{
 		if (cmdLineOpts.dbServer)
 			parseDBServer(cmdLineOpts.dbServer);
+		if (cmdLineOpts.dbReplicas)
+			parseDBReplicas(cmdLineOpts.dbReplicas);
+		if (cmdLineOpts.dbReplicaMaxLagSec >= 0)
+			dbReplicaMaxLagSec = cmdLineOpts.dbReplicaMaxLagSec;
+		if (cmdLineOpts.dbPoolSize > 0)
+			ThreadLocalDBCache::setMaxPoolSize(cmdLineOpts.dbPoolSize);
 		DBHatohol::setDefaultDBParams(cmdLineOpts.dbName,
 		                              cmdLineOpts.dbUser,
 		                              cmdLineOpts.dbPassword);
@@ -246,6 +298,20 @@ struct ConfigManager::Impl {
 			loadOldEvents = cmdLineOpts.loadOldEvents;
 		if (cmdLineOpts.faceRestNumWorkers > 0)
 			faceRestNumWorkers = cmdLineOpts.faceRestNumWorkers;
+		if (cmdLineOpts.fetchStalenessSec >= 0)
+			fetchStalenessSec = cmdLineOpts.fetchStalenessSec;
+		if (cmdLineOpts.eventRetentionDays >= 0)
+			eventRetentionDays = cmdLineOpts.eventRetentionDays;
+		if (cmdLineOpts.ingestionNumWriters >= 0)
+			ingestionNumWriters = cmdLineOpts.ingestionNumWriters;
+		if (cmdLineOpts.ingestionQueueSize > 0)
+			ingestionQueueSize = cmdLineOpts.ingestionQueueSize;
+		if (cmdLineOpts.maxNumWaitingCommandAction > 0) {
+			maxNumWaitingCommandAction =
+			  cmdLineOpts.maxNumWaitingCommandAction;
+		}
+		if (cmdLineOpts.numSpawnYards >= 0)
+			numSpawnYards = cmdLineOpts.numSpawnYards;
 	}
 
 private:
@@ -266,6 +332,17 @@ private:
 		g_free(database);
 		g_free(user);
 		g_free(password);
+
+		gchar *replicas =
+			g_key_file_get_string(keyFile, group, "replicas", NULL);
+		if (replicas)
+			parseDBReplicas(replicas);
+		g_free(replicas);
+
+		gint poolSize =
+			g_key_file_get_integer(keyFile, group, "pool_size", NULL);
+		if (poolSize > 0)
+			ThreadLocalDBCache::setMaxPoolSize(poolSize);
 	}
 
 	void loadConfigFileFaceRestGroup(GKeyFile *keyFile)
@@ -312,6 +389,15 @@ bool ConfigManager::parseCommandLine(gint *argc, gchar ***argv,
 		{"db-server",
 		 'c', 0, G_OPTION_ARG_STRING,
 		 &cmdLineOpts->dbServer, "Database server", NULL},
+		{"db-replicas",
+		 0, 0, G_OPTION_ARG_STRING, &cmdLineOpts->dbReplicas,
+		 "Replicas of the database server (HOST[:PORT],...)", NULL},
+		{"db-replica-max-lag",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->dbReplicaMaxLagSec,
+		 "Maximum replication lag in seconds of a used replica", NULL},
+		{"db-pool-size",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->dbPoolSize,
+		 "Maximum number of shared DB connections", NULL},
 		{"db-name",
 		 'n', 0, G_OPTION_ARG_STRING,
 		 &cmdLineOpts->dbName, "Database name", NULL},
@@ -345,6 +431,29 @@ bool ConfigManager::parseCommandLine(gint *argc, gchar ***argv,
 		{"face-rest-workers",
 		 'T', 0, G_OPTION_ARG_CALLBACK, (gpointer)parseFaceRestNumWorkers,
 		 "Number of FaceRest worker threads", NULL},
+		{"fetch-staleness",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->fetchStalenessSec,
+		 "Seconds in which fetched items and triggers are regarded "
+		 "as fresh", NULL},
+		{"event-retention-days",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->eventRetentionDays,
+		 "Days for which events are kept (0: forever)", NULL},
+		{"ingestion-writers",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->ingestionNumWriters,
+		 "Number of threads that write monitoring data "
+		 "(0: written by arms)", NULL},
+		{"ingestion-queue-size",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->ingestionQueueSize,
+		 "Maximum number of queued batches of monitoring data", NULL},
+		{"max-waiting-command-actions",
+		 0, 0, G_OPTION_ARG_INT,
+		 &cmdLineOpts->maxNumWaitingCommandAction,
+		 "Maximum number of command actions waiting for execution",
+		 NULL},
+		{"spawn-yards",
+		 0, 0, G_OPTION_ARG_INT, &cmdLineOpts->numSpawnYards,
+		 "Number of processes that create actions "
+		 "(0: created by hatohol)", NULL},
 		{ NULL }
 	};
 
@@ -443,6 +552,16 @@ int ConfigManager::getDBServerPort(void) const
 	return m_impl->dbServerPort;
 }
 
+DBReplicaInfoVect ConfigManager::getDBReplicas(void) const
+{
+	return m_impl->dbReplicas;
+}
+
+int ConfigManager::getDBReplicaMaxLagSec(void) const
+{
+	return m_impl->dbReplicaMaxLagSec;
+}
+
 int ConfigManager::getAllowedTimeOfActionForOldEvents(void)
 {
 	return DEFAULT_ALLOWED_TIME_OF_ACTION_FOR_OLD_EVENTS;
@@ -453,6 +572,16 @@ int ConfigManager::getMaxNumberOfRunningCommandAction(void)
 	return DEFAULT_MAX_NUM_RUNNING_COMMAND_ACTION;
 }
 
+int ConfigManager::getMaxNumberOfWaitingCommandAction(void)
+{
+	return m_impl->maxNumWaitingCommandAction;
+}
+
+void ConfigManager::setMaxNumberOfWaitingCommandAction(const int &num)
+{
+	m_impl->maxNumWaitingCommandAction = num;
+}
+
 string ConfigManager::getActionCommandDirectory(void)
 {
 	AutoMutex autoLock(&m_impl->mutex);
@@ -522,6 +651,46 @@ void ConfigManager::setFaceRestNumWorkers(const int &num)
 	m_impl->faceRestNumWorkers = num;
 }
 
+int ConfigManager::getFetchStalenessSec(void) const
+{
+	return m_impl->fetchStalenessSec;
+}
+
+void ConfigManager::setFetchStalenessSec(const int &sec)
+{
+	m_impl->fetchStalenessSec = sec;
+}
+
+int ConfigManager::getEventRetentionDays(void) const
+{
+	return m_impl->eventRetentionDays;
+}
+
+void ConfigManager::setEventRetentionDays(const int &days)
+{
+	m_impl->eventRetentionDays = days;
+}
+
+int ConfigManager::getIngestionNumWriters(void) const
+{
+	return m_impl->ingestionNumWriters;
+}
+
+void ConfigManager::setIngestionNumWriters(const int &num)
+{
+	m_impl->ingestionNumWriters = num;
+}
+
+size_t ConfigManager::getIngestionQueueSize(void) const
+{
+	return m_impl->ingestionQueueSize;
+}
+
+int ConfigManager::getNumberOfSpawnYards(void) const
+{
+	return m_impl->numSpawnYards;
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -28,6 +28,7 @@ struct CommandLineOptions {
 	gchar    *pidFilePath;
 	gchar    *user;
 	gchar    *dbServer;
+	gchar    *dbReplicas;
 	gchar    *dbName;
 	gchar    *dbUser;
 	gchar    *dbPassword;
@@ -38,6 +39,14 @@ struct CommandLineOptions {
 	gboolean  loadOldEvents;
 	gint      faceRestPort;
 	gint      faceRestNumWorkers;
+	gint      fetchStalenessSec;
+	gint      eventRetentionDays;
+	gint      dbReplicaMaxLagSec;
+	gint      dbPoolSize;
+	gint      ingestionNumWriters;
+	gint      ingestionQueueSize;
+	gint      maxNumWaitingCommandAction;
+	gint      numSpawnYards;
 
 	CommandLineOptions(void);
 };
@@ -54,6 +63,7 @@ public:
 	static ConfigManager *getInstance(void);
 	static int ALLOW_ACTION_FOR_ALL_OLD_EVENTS;
 	static const char *DEFAULT_PID_FILE_PATH;
+	static const int DEFAULT_FETCH_STALENESS_SEC;
 
 	/**
 	 * Parse the argument.
@@ -80,6 +90,20 @@ public:
 	std::string getDBServerAddress(void) const;
 	int getDBServerPort(void) const;
 
+	/**
+	 * Get the replicas of the DB server, to which read-only queries
+	 * may be sent. They are specified by --db-replicas
+	 * <HOST[:PORT],...> or 'replicas' in the mysql group of the
+	 * config file.
+	 */
+	DBReplicaInfoVect getDBReplicas(void) const;
+
+	/**
+	 * Get the maximum replication lag in seconds of a usable replica.
+	 * It can be specified by --db-replica-max-lag <SEC>.
+	 */
+	int getDBReplicaMaxLagSec(void) const;
+
 	/**
 	 * Get the time to ignore an action for old events.
 	 * The events that are older than Tc - Ts shall be ignored, where
@@ -95,6 +119,16 @@ public:
 
 	int getMaxNumberOfRunningCommandAction(void);
 
+	/**
+	 * Get the maximum number of the command actions waiting for
+	 * the end of the running ones. A command action beyond it is not
+	 * executed and is logged with ACTLOG_EXECFAIL_QUEUE_FULL.
+	 * It can be specified by --max-waiting-command-actions <NUM>.
+	 */
+	int getMaxNumberOfWaitingCommandAction(void);
+
+	void setMaxNumberOfWaitingCommandAction(const int &num);
+
 	std::string getActionCommandDirectory(void);
 	void setActionCommandDirectory(const std::string &dir);
 	std::string getResidentYardDirectory(void);
@@ -133,6 +167,58 @@ public:
 
 	void setFaceRestNumWorkers(const int &num);
 
+	/**
+	 * Get the staleness SLA of on-demand fetches. A result fetched
+	 * within this period is used without fetching again.
+	 *
+	 * @retrun
+	 * If --fetch-staleness <SEC> is specified, it is returned.
+	 * Otherwise, DEFAULT_FETCH_STALENESS_SEC is returned.
+	 */
+	int getFetchStalenessSec(void) const;
+
+	void setFetchStalenessSec(const int &sec);
+
+	/**
+	 * Get the number of days for which events are kept.
+	 *
+	 * @retrun
+	 * If --event-retention-days <DAYS> is specified, it is returned.
+	 * Otherwise, 0 is returned. It means events are never purged.
+	 */
+	int getEventRetentionDays(void) const;
+
+	void setEventRetentionDays(const int &days);
+
+	/**
+	 * Get the number of the writer threads of IngestionQueue.
+	 *
+	 * @retrun
+	 * If --ingestion-writers <NUM> is specified, it is returned.
+	 * Otherwise, 0 is returned. It means monitoring data are written
+	 * to the DB synchronously by the arms.
+	 */
+	int getIngestionNumWriters(void) const;
+
+	void setIngestionNumWriters(const int &num);
+
+	/**
+	 * Get the maximum number of batches in IngestionQueue.
+	 * It can be specified by --ingestion-queue-size <NUM>.
+	 */
+	size_t getIngestionQueueSize(void) const;
+
+	/**
+	 * Get the number of hatohol-spawn-yard processes that create
+	 * the actors on behalf of Hatohol.
+	 *
+	 * @retrun
+	 * If --spawn-yards <NUM> is specified, it is returned.
+	 * Otherwise, 0 is returned. It means the actors are created by
+	 * Hatohol itself.
+	 */
+	int getNumberOfSpawnYards(void) const;
+
 protected:
 	void loadConfFile(void);
 	static gboolean parseLogLevel(
@@ -23,12 +23,16 @@
 #include "HatoholException.h"
 #include "SeparatorInjector.h"
 #include "DBTermCStringProvider.h"
+#include "HatoholTracePoint.h"
 using namespace std;
 using namespace mlpl;
 
+const int DBConnectInfo::DEFAULT_MAX_REPLICA_LAG_SEC = 5;
+
 DBConnectInfo::DBConnectInfo(void)
 : host("localhost"),
-  port(0)
+  port(0),
+  maxReplicaLagSec(DEFAULT_MAX_REPLICA_LAG_SEC)
 {
 }
 
@@ -44,6 +48,8 @@ void DBConnectInfo::reset(void)
 	user.clear();
 	password.clear();
 	dbName.clear();
+	replicas.clear();
+	maxReplicaLagSec = DEFAULT_MAX_REPLICA_LAG_SEC;
 }
 
 const char *DBConnectInfo::getHost(void) const
@@ -74,16 +80,20 @@ struct DBAgent::Impl
 
 DBTermCodec    DBAgent::Impl::dbTermCodec;
 
+const time_t DBAgent::TIME_PARTITION_SEC = 24 * 60 * 60;
+
 // ---------------------------------------------------------------------------
 // DBAgent::TableProfile
 // ---------------------------------------------------------------------------
 DBAgent::TableProfile::TableProfile(
   const char *_name,  const ColumnDef *_columnDefs,
-  const size_t &numIndexes, const IndexDef *_indexDefArray)
+  const size_t &numIndexes, const IndexDef *_indexDefArray,
+  const int &_timePartitionColumnIndex)
 : name(_name),
   columnDefs(_columnDefs),
   numColumns(numIndexes),
-  indexDefArray(_indexDefArray)
+  indexDefArray(_indexDefArray),
+  timePartitionColumnIndex(_timePartitionColumnIndex)
 {
 	// We assume there's one (combined) unique key at most every table.
 	// This limited is in order to realize upsert on SQLite3.
@@ -111,6 +121,11 @@ DBAgent::TableProfile::TableProfile(
 	               numUniqueKeys);
 }
 
+bool DBAgent::TableProfile::isTimePartitioned(void) const
+{
+	return timePartitionColumnIndex != NO_TIME_PARTITION;
+}
+
 std::string DBAgent::TableProfile::getFullColumnName(const size_t &index) const
 {
 	const ColumnDef &def = columnDefs[index];
@@ -342,6 +357,25 @@ DBAgent::~DBAgent()
 {
 }
 
+void DBAgent::addTimePartitions(const TableProfile &tableProfile,
+                                const time_t &untilTime)
+{
+}
+
+bool DBAgent::purgeOldRows(const TableProfile &tableProfile,
+                           const time_t &oldestTime)
+{
+	HATOHOL_ASSERT(tableProfile.isTimePartitioned(),
+	               "Not time-partitioned: %s", tableProfile.name);
+	DeleteArg arg(tableProfile);
+	const ColumnDef &columnDef =
+	  tableProfile.columnDefs[tableProfile.timePartitionColumnIndex];
+	arg.condition = StringUtils::sprintf("%s<%ld", columnDef.columnName,
+	                                     oldestTime);
+	deleteRows(arg);
+	return getNumberOfAffectedRows() > 0;
+}
+
 void DBAgent::dropTable(const std::string &tableName)
 {
 	string sql = "DROP TABLE ";
@@ -349,6 +383,21 @@ void DBAgent::dropTable(const std::string &tableName)
 	execSql(sql);
 }
 
+DBAgent &DBAgent::getReadAgent(void)
+{
+	return *this;
+}
+
+void DBAgent::selectOnReadAgent(const SelectExArg &arg)
+{
+	runTransaction(arg);
+}
+
+bool DBAgent::isAlive(void)
+{
+	return true;
+}
+
 void DBAgent::fixupIndexes(const TableProfile &tableProfile)
 {
 	typedef map<string, IndexInfo *>   IndexNameInfoMap;
@@ -431,6 +480,7 @@ void DBAgent::fixupIndexes(const TableProfile &tableProfile)
 
 void DBAgent::runTransaction(TransactionProc &proc)
 {
+	MLPL_TRACE_SCOPE(TRACE_DB_TRANSACTION);
 	if (!proc.preproc(*this))
 		return;
 	begin();
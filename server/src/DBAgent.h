@@ -21,6 +21,7 @@
 #define DBAgent_h
 
 #include <string>
+#include <vector>
 #include <memory>
 #include <glib.h>
 #include <stdint.h>
@@ -30,13 +31,28 @@
 
 static const int CURR_DATETIME = -1;
 
+struct DBReplicaInfo {
+	std::string host;
+	size_t      port;
+};
+
+typedef std::vector<DBReplicaInfo>         DBReplicaInfoVect;
+typedef DBReplicaInfoVect::const_iterator  DBReplicaInfoVectConstIterator;
+
 struct DBConnectInfo {
+	static const int DEFAULT_MAX_REPLICA_LAG_SEC;
+
 	std::string host;
 	size_t      port;
 	std::string user;
 	std::string password;
 	std::string dbName;
 
+	// Read-only queries may be sent to these servers.
+	// The user, the password and the DB name are the same as the above.
+	DBReplicaInfoVect replicas;
+	int               maxReplicaLagSec;
+
 	DBConnectInfo(void);
 	virtual ~DBConnectInfo();
 	void reset(void);
@@ -64,17 +80,27 @@ public:
 	};
 
 	struct TableProfile {
+		static const int    NO_TIME_PARTITION = -1;
+
 		const char         *name;
 		const ColumnDef    *columnDefs;
 		const size_t        numColumns;
 		const IndexDef     *indexDefArray;
 
+		// A column of the time in seconds by which the table is
+		// partitioned. It is also used to purge old rows.
+		const int           timePartitionColumnIndex;
+
 		// The following members are initialized in the constructor
 		std::vector<int>    uniqueKeyColumnIndexes;
 
 		TableProfile(const char *name,  const ColumnDef *columnDefs,
 		             const size_t &numIndexes,
-		             const IndexDef *indexDefArray = NULL);
+		             const IndexDef *indexDefArray = NULL,
+		             const int &timePartitionColumnIndex
+		               = NO_TIME_PARTITION);
+
+		bool isTimePartitioned(void) const;
 
 		/**
 		 * Get a full name of a column.
@@ -212,6 +238,11 @@ public:
 		AddColumnsArg(const TableProfile &tableProfile);
 	};
 
+	/**
+	 * The width of a partition of a time-partitioned table.
+	 */
+	static const time_t TIME_PARTITION_SEC;
+
 	DBAgent(void);
 	virtual ~DBAgent();
 
@@ -258,6 +289,60 @@ public:
 	 */
 	virtual void fixupIndexes(const TableProfile &tableProfile);
 
+	/**
+	 * Get a DBAgent for read-only queries. It may be connected to
+	 * a replica of the DB, whose content can be behind this one.
+	 * The default implementation returns this instance.
+	 *
+	 * @return A DBAgent instance.
+	 */
+	virtual DBAgent &getReadAgent(void);
+
+	/**
+	 * Select rows with the agent returned by getReadAgent().
+	 * The select is run on this instance when it fails there.
+	 * The default implementation runs it in a transaction of this
+	 * instance.
+	 *
+	 * @param arg A SelectExArg.
+	 */
+	virtual void selectOnReadAgent(const SelectExArg &arg);
+
+	/**
+	 * Check if the connection to the DB is usable. It is called for
+	 * a connection that has been idle for a while before it is reused.
+	 * The default implementation always returns true.
+	 *
+	 * @return true if the connection is usable. Otherwise false.
+	 */
+	virtual bool isAlive(void);
+
+	/**
+	 * Make partitions of a time-partitioned table so that rows until
+	 * the specified time are stored in their own partitions.
+	 * Nothing is done when the DB doesn't support partitions or the
+	 * table was created without them.
+	 *
+	 * @param tableProfile A time-partitioned table.
+	 * @param untilTime A time in seconds.
+	 */
+	virtual void addTimePartitions(const TableProfile &tableProfile,
+	                               const time_t &untilTime);
+
+	/**
+	 * Delete the rows whose time is older than the specified time.
+	 * A partitioned table drops the whole partitions, so that rows in
+	 * a partition that contains the time are left. Otherwise the rows
+	 * are deleted with deleteRows().
+	 *
+	 * @param tableProfile A time-partitioned table.
+	 * @param oldestTime The oldest time in seconds to be kept.
+	 *
+	 * @return true if rows may have been deleted. Otherwise false.
+	 */
+	virtual bool purgeOldRows(const TableProfile &tableProfile,
+	                          const time_t &oldestTime);
+
 	/**
 	 * Update a record if there is the record with the same value in the
 	 * specified column. Or this function executes an insert operation.
@@ -46,11 +46,16 @@ DBAgent* DBAgentFactory::create(const type_info &dbClassType,
 // ---------------------------------------------------------------------------
 DBAgent *DBAgentFactory::newDBAgentMySQL(const DBConnectInfo &connectInfo)
 {
-	return new DBAgentMySQL(connectInfo.dbName.c_str(),
-	                        connectInfo.getUser(),
-	                        connectInfo.getPassword(),
-	                        connectInfo.getHost(),
-	                        connectInfo.port);
+	DBAgentMySQL *dbAgent = new DBAgentMySQL(connectInfo.dbName.c_str(),
+	                                         connectInfo.getUser(),
+	                                         connectInfo.getPassword(),
+	                                         connectInfo.getHost(),
+	                                         connectInfo.port);
+	if (!connectInfo.replicas.empty()) {
+		dbAgent->setReplicas(connectInfo.replicas,
+		                     connectInfo.maxReplicaLagSec);
+	}
+	return dbAgent;
 }
 
 DBAgent *DBAgentFactory::newDBAgentSQLite3(const DBConnectInfo &connectInfo)
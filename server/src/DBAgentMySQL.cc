@@ -21,7 +21,9 @@
 #include <unistd.h>
 #include <semaphore.h>
 #include <errno.h>
+#include <cstring>
 #include <AtomicValue.h>
+#include <Mutex.h>
 #include <SimpleSemaphore.h>
 #include "DBAgentMySQL.h"
 #include "SQLUtils.h"
@@ -30,6 +32,22 @@
 using namespace std;
 using namespace mlpl;
 
+// The number of the partitions made for the future days at the creation
+static const size_t NUM_PRECREATED_TIME_PARTITIONS = 7;
+static const char *MAX_TIME_PARTITION_NAME = "pmax";
+
+const int DBAgentMySQL::REPLICA_CHECK_INTERVAL_SEC = 10;
+
+// A dead replica shouldn't block the reads longer than this.
+static const unsigned int REPLICA_TIMEOUT_SEC = 5;
+
+// Used to distribute the connections over the replicas.
+static size_t g_replicaCounter = 0;
+
+// The last time when the calling thread wrote rows. It isn't a member
+// because a pooled instance is used by different threads in turn.
+static __thread time_t tls_lastWriteTime = 0;
+
 static const size_t DEFAULT_NUM_RETRY = 5;
 static const size_t RETRY_INTERVAL[DEFAULT_NUM_RETRY] = {
   0, 10, 60, 60, 60 };
@@ -45,15 +63,30 @@ struct DBAgentMySQL::Impl {
 	string host;
 	unsigned int port;
 	bool inTransaction;
+	bool resultStreaming;
+	bool isReplica;
 	AtomicValue<bool> disposed;
 	SimpleSemaphore waitSem;
 
+	// for read-only queries on replicas
+	DBReplicaInfoVect replicas;
+	int               maxReplicaLagSec;
+	size_t            replicaIndex; // The replica used or tried next
+	unique_ptr<DBAgentMySQL> replica; // Replaced with replicaLock
+	Mutex             replicaLock;
+	time_t            replicaCheckedTime;
+
 	Impl(void)
 	: connected(false),
 	  port(0),
 	  inTransaction(false),
+	  resultStreaming(false),
+	  isReplica(false),
 	  disposed(false),
-	  waitSem(0)
+	  waitSem(0),
+	  maxReplicaLagSec(DBConnectInfo::DEFAULT_MAX_REPLICA_LAG_SEC),
+	  replicaIndex(0),
+	  replicaCheckedTime(0)
 	{
 	}
 
@@ -68,6 +101,21 @@ struct DBAgentMySQL::Impl {
 	{
 		return retryErrorSet.find(errorNumber) != retryErrorSet.end();
 	}
+
+	void setReplica(DBAgentMySQL *newReplica)
+	{
+		AutoMutex autoMutex(&replicaLock);
+		replica.reset(newReplica);
+		// dispose() may be called while the replica is connecting.
+		if (replica && disposed)
+			replica->dispose();
+	}
+
+	void useNextReplica(void)
+	{
+		setReplica(NULL);
+		replicaIndex = (replicaIndex + 1) % replicas.size();
+	}
 };
 
 string DBAgentMySQL::Impl::engineStr;
@@ -104,6 +152,26 @@ DBAgentMySQL::DBAgentMySQL(const char *db, const char *user, const char *passwd,
 	}
 }
 
+DBAgentMySQL::DBAgentMySQL(const DBAgentMySQL &primary,
+                           const DBReplicaInfo &replicaInfo)
+: m_impl(new Impl())
+{
+	m_impl->dbName   = primary.m_impl->dbName;
+	m_impl->user     = primary.m_impl->user;
+	m_impl->password = primary.m_impl->password;
+	m_impl->host     = replicaInfo.host;
+	m_impl->port     = replicaInfo.port;
+	m_impl->isReplica = true;
+	connect();
+	if (!m_impl->connected) {
+		THROW_HATOHOL_EXCEPTION_WITH_ERROR_CODE(
+		  HTERR_FAILED_CONNECT_MYSQL,
+		  "Failed to connect to MySQL replica: %s:%zd: %s\n",
+		  replicaInfo.host.c_str(), replicaInfo.port,
+		  mysql_error(&m_impl->mysql));
+	}
+}
+
 DBAgentMySQL::~DBAgentMySQL()
 {
 }
@@ -113,6 +181,103 @@ string DBAgentMySQL::getDBName(void) const
 	return m_impl->dbName;
 }
 
+void DBAgentMySQL::setReplicas(const DBReplicaInfoVect &replicas,
+                               const int &maxLagSec)
+{
+	m_impl->replicas = replicas;
+	m_impl->maxReplicaLagSec = maxLagSec;
+	m_impl->setReplica(NULL);
+	m_impl->replicaCheckedTime = 0;
+	if (!replicas.empty()) {
+		m_impl->replicaIndex =
+		  __sync_fetch_and_add(&g_replicaCounter, 1) % replicas.size();
+	}
+}
+
+int DBAgentMySQL::getReplicationLagSec(void)
+{
+	HATOHOL_ASSERT(m_impl->connected, "Not connected.");
+	execSql("SHOW SLAVE STATUS");
+
+	MYSQL_RES *result = mysql_store_result(&m_impl->mysql);
+	if (!result) {
+		THROW_HATOHOL_EXCEPTION(
+		  "Failed to call mysql_store_result: %s\n",
+		  mysql_error(&m_impl->mysql));
+	}
+
+	// Seconds_Behind_Master is NULL when the replication is stopped.
+	int lagSec = -1;
+	MYSQL_ROW row = mysql_fetch_row(result);
+	const unsigned int numFields = mysql_num_fields(result);
+	const MYSQL_FIELD *fields = mysql_fetch_fields(result);
+	for (unsigned int i = 0; row && i < numFields; i++) {
+		if (strcmp(fields[i].name, "Seconds_Behind_Master"))
+			continue;
+		if (row[i])
+			lagSec = atoi(row[i]);
+		break;
+	}
+	mysql_free_result(result);
+	return lagSec;
+}
+
+DBAgent &DBAgentMySQL::getReadAgent(void)
+{
+	if (m_impl->replicas.empty() || m_impl->inTransaction ||
+	    m_impl->disposed)
+		return *this;
+
+	// Rows written by this thread may not be on the replicas yet.
+	const time_t now = time(NULL);
+	if (now - tls_lastWriteTime <= m_impl->maxReplicaLagSec)
+		return *this;
+
+	if (now - m_impl->replicaCheckedTime >= REPLICA_CHECK_INTERVAL_SEC) {
+		m_impl->replicaCheckedTime = now;
+		selectReplica();
+	}
+	if (!m_impl->replica)
+		return *this;
+	return *m_impl->replica;
+}
+
+void DBAgentMySQL::selectOnReadAgent(const SelectExArg &arg)
+{
+	DBAgent &readAgent = getReadAgent();
+	if (&readAgent != this) {
+		// A single SELECT needs no transaction on the replica. No row
+		// is added to arg.dataTable when the query fails.
+		try {
+			readAgent.select(arg);
+			return;
+		} catch (const HatoholException &e) {
+			const DBReplicaInfo &replicaInfo =
+			  m_impl->replicas[m_impl->replicaIndex];
+			MLPL_WARN("Failed to select on a replica: %s:%zd: %s\n",
+			          replicaInfo.host.c_str(), replicaInfo.port,
+			          e.getFancyMessage().c_str());
+		}
+		// The primary is used until the next check.
+		m_impl->useNextReplica();
+		m_impl->replicaCheckedTime = time(NULL);
+	}
+	runTransaction(arg);
+}
+
+bool DBAgentMySQL::isAlive(void)
+{
+	if (m_impl->connected && mysql_ping(&m_impl->mysql) == 0)
+		return true;
+	MLPL_WARN("Lost the connection to MySQL: %s: (%u) %s\n",
+	          m_impl->dbName.c_str(), mysql_errno(&m_impl->mysql),
+	          mysql_error(&m_impl->mysql));
+	mysql_close(&m_impl->mysql);
+	m_impl->connected = false;
+	connect();
+	return m_impl->connected;
+}
+
 void DBAgentMySQL::getIndexes(std::vector<IndexStruct> &indexStructVect,
                               const std::string &tableName)
 {
@@ -143,6 +308,39 @@ void DBAgentMySQL::getIndexes(std::vector<IndexStruct> &indexStructVect,
 	mysql_free_result(result);
 }
 
+void DBAgentMySQL::getTimePartitions(
+  vector<TimePartitionStruct> &timePartitionVect, const string &tableName)
+{
+	HATOHOL_ASSERT(m_impl->connected, "Not connected.");
+	string query =
+	  StringUtils::sprintf(
+	    "SELECT PARTITION_NAME, PARTITION_DESCRIPTION "
+	    "FROM information_schema.PARTITIONS "
+	    "WHERE TABLE_SCHEMA='%s' AND TABLE_NAME='%s' "
+	    "AND PARTITION_NAME IS NOT NULL "
+	    "ORDER BY PARTITION_ORDINAL_POSITION",
+	    getDBName().c_str(), tableName.c_str());
+	execSql(query);
+
+	MYSQL_RES *result = mysql_store_result(&m_impl->mysql);
+	if (!result) {
+		THROW_HATOHOL_EXCEPTION(
+		  "Failed to call mysql_store_result: %s\n",
+		  mysql_error(&m_impl->mysql));
+	}
+
+	MYSQL_ROW row;
+	while ((row = mysql_fetch_row(result))) {
+		TimePartitionStruct partition;
+		partition.name = row[0];
+		partition.isMaxValue = (string(row[1]) == "MAXVALUE");
+		partition.lessThan =
+		  partition.isMaxValue ? 0 : atol(row[1]);
+		timePartitionVect.push_back(partition);
+	}
+	mysql_free_result(result);
+}
+
 bool DBAgentMySQL::isTableExisting(const string &tableName)
 {
 	HATOHOL_ASSERT(m_impl->connected, "Not connected.");
@@ -251,7 +449,8 @@ static string getColumnTypeQuery(const ColumnDef &columnDef)
 	return string();
 }
 
-static string getColumnDefinitionQuery(const ColumnDef &columnDef)
+static string getColumnDefinitionQuery(const ColumnDef &columnDef,
+                                       const bool &withPrimaryKey = true)
 {
 	string query;
 
@@ -266,7 +465,8 @@ static string getColumnDefinitionQuery(const ColumnDef &columnDef)
 	// key type
 	switch (columnDef.keyType) {
 	case SQL_KEY_PRI:
-		query += " PRIMARY KEY";
+		if (withPrimaryKey)
+			query += " PRIMARY KEY";
 		break;
 	case SQL_KEY_UNI:
 	case SQL_KEY_IDX: // To be created in createIndexIfNotExists()
@@ -286,15 +486,75 @@ static string getColumnDefinitionQuery(const ColumnDef &columnDef)
 	return query;
 }
 
+static string makeTimePartitionName(const time_t &lessThan)
+{
+	return StringUtils::sprintf("p%ld",
+	                            lessThan / DBAgent::TIME_PARTITION_SEC);
+}
+
+static string makeTimePartitionDefinition(const time_t &lessThan)
+{
+	return StringUtils::sprintf("PARTITION %s VALUES LESS THAN (%ld)",
+	                            makeTimePartitionName(lessThan).c_str(),
+	                            lessThan);
+}
+
+// MySQL requires the partitioning column in every unique key.
+static string makePrimaryKeyWithTimePartitionQuery(
+  const DBAgent::TableProfile &tableProfile)
+{
+	const int timeColumnIndex = tableProfile.timePartitionColumnIndex;
+	for (size_t i = 0; i < tableProfile.uniqueKeyColumnIndexes.size(); i++) {
+		const int columnIndex = tableProfile.uniqueKeyColumnIndexes[i];
+		HATOHOL_ASSERT(columnIndex == timeColumnIndex,
+		               "A unique key can't be used with partitions: "
+		               "%s.%s", tableProfile.name,
+		               tableProfile.columnDefs[columnIndex].columnName);
+	}
+
+	string query = "PRIMARY KEY (";
+	for (size_t i = 0; i < tableProfile.numColumns; i++) {
+		const ColumnDef &columnDef = tableProfile.columnDefs[i];
+		if (columnDef.keyType != SQL_KEY_PRI)
+			continue;
+		if (static_cast<int>(i) == timeColumnIndex)
+			continue;
+		query += columnDef.columnName;
+		query += ",";
+	}
+	query += tableProfile.columnDefs[timeColumnIndex].columnName;
+	query += ")";
+	return query;
+}
+
+static string makeTimePartitionClause(const DBAgent::TableProfile &tableProfile)
+{
+	const ColumnDef &columnDef =
+	  tableProfile.columnDefs[tableProfile.timePartitionColumnIndex];
+	string query = StringUtils::sprintf(" PARTITION BY RANGE (%s) (",
+	                                    columnDef.columnName);
+	const time_t today = time(NULL) / DBAgent::TIME_PARTITION_SEC *
+	                     DBAgent::TIME_PARTITION_SEC;
+	for (size_t i = 1; i <= NUM_PRECREATED_TIME_PARTITIONS; i++) {
+		const time_t lessThan = today + DBAgent::TIME_PARTITION_SEC * i;
+		query += makeTimePartitionDefinition(lessThan);
+		query += ",";
+	}
+	query += StringUtils::sprintf(
+	  "PARTITION %s VALUES LESS THAN MAXVALUE)", MAX_TIME_PARTITION_NAME);
+	return query;
+}
+
 void DBAgentMySQL::createTable(const TableProfile &tableProfile)
 {
 	HATOHOL_ASSERT(m_impl->connected, "Not connected.");
 	string query = StringUtils::sprintf("CREATE TABLE %s (",
 	                                    tableProfile.name);
 
+	const bool partitioned = tableProfile.isTimePartitioned();
 	for (size_t i = 0; i < tableProfile.numColumns; i++) {
 		const ColumnDef &columnDef = tableProfile.columnDefs[i];
-		query += getColumnDefinitionQuery(columnDef);
+		query += getColumnDefinitionQuery(columnDef, !partitioned);
 
 		// auto increment
 		if (columnDef.flags & SQL_COLUMN_FLAG_AUTO_INC)
@@ -303,9 +563,15 @@ void DBAgentMySQL::createTable(const TableProfile &tableProfile)
 		if (i < tableProfile.numColumns -1)
 			query += ",";
 	}
+	if (partitioned) {
+		query += ",";
+		query += makePrimaryKeyWithTimePartitionQuery(tableProfile);
+	}
 	query += ")";
 	if (!m_impl->engineStr.empty())
 		query += m_impl->engineStr;
+	if (partitioned)
+		query += makeTimePartitionClause(tableProfile);
 
 	execSql(query);
 }
@@ -388,6 +654,7 @@ void DBAgentMySQL::insert(const DBAgent::InsertArg &insertArg)
 		}
 	}
 	execSql(query);
+	tls_lastWriteTime = time(NULL);
 }
 
 
@@ -396,6 +663,7 @@ void DBAgentMySQL::update(const UpdateArg &updateArg)
 	HATOHOL_ASSERT(m_impl->connected, "Not connected.");
 	string sql = makeUpdateStatement(updateArg);
 	execSql(sql);
+	tls_lastWriteTime = time(NULL);
 }
 
 void DBAgentMySQL::select(const DBAgent::SelectArg &selectArg)
@@ -405,12 +673,7 @@ void DBAgentMySQL::select(const DBAgent::SelectArg &selectArg)
 	string query = makeSelectStatement(selectArg);
 	execSql(query);
 
-	MYSQL_RES *result = mysql_store_result(&m_impl->mysql);
-	if (!result) {
-		THROW_HATOHOL_EXCEPTION("Failed to call mysql_store_result: %s\n",
-		                      mysql_error(&m_impl->mysql));
-	}
-
+	MYSQL_RES *result = getSelectResult();
 	MYSQL_ROW row;
 	VariableItemTablePtr dataTable;
 	size_t numColumns = selectArg.columnIndexes.size();
@@ -426,7 +689,7 @@ void DBAgentMySQL::select(const DBAgent::SelectArg &selectArg)
 		}
 		dataTable->add(itemGroup);
 	}
-	mysql_free_result(result);
+	freeSelectResult(result);
 	selectArg.dataTable = dataTable;
 }
 
@@ -437,12 +700,7 @@ void DBAgentMySQL::select(const SelectExArg &selectExArg)
 	string query = makeSelectStatement(selectExArg);
 	execSql(query);
 
-	MYSQL_RES *result = mysql_store_result(&m_impl->mysql);
-	if (!result) {
-		THROW_HATOHOL_EXCEPTION("Failed to call mysql_store_result: %s\n",
-		                      mysql_error(&m_impl->mysql));
-	}
-
+	MYSQL_RES *result = getSelectResult();
 	MYSQL_ROW row;
 	VariableItemTablePtr dataTable;
 	size_t numColumns = selectExArg.statements.size();
@@ -456,7 +714,7 @@ void DBAgentMySQL::select(const SelectExArg &selectExArg)
 		}
 		dataTable->add(itemGroup);
 	}
-	mysql_free_result(result);
+	freeSelectResult(result);
 	selectExArg.dataTable = dataTable;
 
 	// check the result
@@ -474,6 +732,7 @@ void DBAgentMySQL::deleteRows(const DeleteArg &deleteArg)
 	HATOHOL_ASSERT(m_impl->connected, "Not connected.");
 	string query = makeDeleteStatement(deleteArg);
 	execSql(query);
+	tls_lastWriteTime = time(NULL);
 }
 
 uint64_t DBAgentMySQL::getLastInsertId(void)
@@ -560,16 +819,117 @@ void DBAgentMySQL::renameTable(const string &srcName, const string &destName)
 	execSql(query);
 }
 
+void DBAgentMySQL::setResultStreaming(const bool &enable)
+{
+	m_impl->resultStreaming = enable;
+}
+
 void DBAgentMySQL::dispose(void)
 {
 	m_impl->disposed = true;
 
 	m_impl->waitSem.post();
+
+	AutoMutex autoMutex(&m_impl->replicaLock);
+	if (m_impl->replica)
+		m_impl->replica->dispose();
 }
 
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
+void DBAgentMySQL::addTimePartitions(const TableProfile &tableProfile,
+                                     const time_t &untilTime)
+{
+	vector<TimePartitionStruct> partitions;
+	getTimePartitions(partitions, tableProfile.name);
+	if (partitions.empty())
+		return;
+
+	time_t lastLessThan = 0;
+	for (size_t i = 0; i < partitions.size(); i++) {
+		if (!partitions[i].isMaxValue)
+			lastLessThan = partitions[i].lessThan;
+	}
+	// All the ranged partitions may have been purged.
+	if (lastLessThan == 0) {
+		lastLessThan = time(NULL) / TIME_PARTITION_SEC *
+		               TIME_PARTITION_SEC;
+	}
+
+	string definitions;
+	SeparatorInjector commaInjector(",");
+	for (; lastLessThan <= untilTime; lastLessThan += TIME_PARTITION_SEC) {
+		commaInjector(definitions);
+		definitions += makeTimePartitionDefinition(
+		  lastLessThan + TIME_PARTITION_SEC);
+	}
+	if (definitions.empty())
+		return;
+
+	// The maximum partition is usually empty. So this is fast.
+	execSql(StringUtils::sprintf(
+	  "ALTER TABLE %s REORGANIZE PARTITION %s INTO "
+	  "(%s,PARTITION %s VALUES LESS THAN MAXVALUE)",
+	  tableProfile.name, MAX_TIME_PARTITION_NAME, definitions.c_str(),
+	  MAX_TIME_PARTITION_NAME));
+}
+
+bool DBAgentMySQL::purgeOldRows(const TableProfile &tableProfile,
+                                const time_t &oldestTime)
+{
+	vector<TimePartitionStruct> partitions;
+	getTimePartitions(partitions, tableProfile.name);
+	if (partitions.empty()) {
+		// The table was created before partitioning was supported.
+		return DBAgent::purgeOldRows(tableProfile, oldestTime);
+	}
+
+	string names;
+	SeparatorInjector commaInjector(",");
+	for (size_t i = 0; i < partitions.size(); i++) {
+		const TimePartitionStruct &partition = partitions[i];
+		if (partition.isMaxValue || partition.lessThan > oldestTime)
+			continue;
+		commaInjector(names);
+		names += partition.name;
+	}
+	if (names.empty())
+		return false;
+	execSql(StringUtils::sprintf("ALTER TABLE %s DROP PARTITION %s",
+	                             tableProfile.name, names.c_str()));
+	return true;
+}
+
+void DBAgentMySQL::selectReplica(void)
+{
+	// Try the replicas from the current one until a fresh one is found.
+	const size_t numReplicas = m_impl->replicas.size();
+	for (size_t i = 0; i < numReplicas; i++) {
+		const DBReplicaInfo &replicaInfo =
+		  m_impl->replicas[m_impl->replicaIndex];
+		try {
+			if (!m_impl->replica) {
+				m_impl->setReplica(
+				  new DBAgentMySQL(*this, replicaInfo));
+			}
+			const int lagSec =
+			  m_impl->replica->getReplicationLagSec();
+			if (lagSec >= 0 && lagSec <= m_impl->maxReplicaLagSec)
+				return;
+			MLPL_WARN("Replica isn't available: %s:%zd, lag: %d\n",
+			          replicaInfo.host.c_str(), replicaInfo.port,
+			          lagSec);
+		} catch (const HatoholException &e) {
+			MLPL_WARN("Failed to use a replica: %s:%zd: %s\n",
+			          replicaInfo.host.c_str(), replicaInfo.port,
+			          e.getFancyMessage().c_str());
+		}
+		m_impl->useNextReplica();
+	}
+	// The primary is used until the next check.
+}
+
 const char *DBAgentMySQL::getCStringOrNullIfEmpty(const string &str)
 {
 	return str.empty() ? NULL : str.c_str();
@@ -585,6 +945,12 @@ void DBAgentMySQL::connect(void)
 	const char *db     = getCStringOrNullIfEmpty(m_impl->dbName);
 	mysql_init(&m_impl->mysql);
 	mysql_options(&m_impl->mysql, MYSQL_READ_DEFAULT_GROUP, "hatohol");
+	if (m_impl->isReplica) {
+		mysql_options(&m_impl->mysql, MYSQL_OPT_CONNECT_TIMEOUT,
+		              &REPLICA_TIMEOUT_SEC);
+		mysql_options(&m_impl->mysql, MYSQL_OPT_READ_TIMEOUT,
+		              &REPLICA_TIMEOUT_SEC);
+	}
 	MYSQL *result = mysql_real_connect(&m_impl->mysql, host, user, passwd,
 	                                   db, m_impl->port,
 	                                   unixSocket, clientFlag);
@@ -620,7 +986,8 @@ bool DBAgentMySQL::throwExceptionIfDisposed(void) const
 void DBAgentMySQL::queryWithRetry(const string &statement)
 {
 	unsigned int errorNumber = 0;
-	size_t numRetry = DEFAULT_NUM_RETRY;
+	// The caller of a replica uses the primary instead of retrying.
+	const size_t numRetry = m_impl->isReplica ? 1 : DEFAULT_NUM_RETRY;
 	for (size_t i = 0; i < numRetry; i++) {
 		if (throwExceptionIfDisposed())
 			break;
@@ -668,6 +1035,36 @@ void DBAgentMySQL::queryWithRetry(const string &statement)
 	}
 }
 
+MYSQL_RES *DBAgentMySQL::getSelectResult(void)
+{
+	MYSQL_RES *result;
+	if (m_impl->resultStreaming)
+		result = mysql_use_result(&m_impl->mysql);
+	else
+		result = mysql_store_result(&m_impl->mysql);
+	if (!result) {
+		THROW_HATOHOL_EXCEPTION("Failed to get the result (%s): %s\n",
+		  m_impl->resultStreaming ?
+		    "mysql_use_result" : "mysql_store_result",
+		  mysql_error(&m_impl->mysql));
+	}
+	return result;
+}
+
+void DBAgentMySQL::freeSelectResult(MYSQL_RES *result)
+{
+	// mysql_fetch_row() returns NULL also on an error while the result
+	// is streamed.
+	string error;
+	if (m_impl->resultStreaming && mysql_errno(&m_impl->mysql))
+		error = mysql_error(&m_impl->mysql);
+	mysql_free_result(result);
+	if (!error.empty()) {
+		THROW_HATOHOL_EXCEPTION("Failed to fetch a row: %s\n",
+		                        error.c_str());
+	}
+}
+
 string DBAgentMySQL::getColumnValueString(const ColumnDef *columnDef,
 					  const ItemData *itemData)
 {
@@ -33,6 +33,14 @@ public:
 		std::string columnName;
 	};
 
+	struct TimePartitionStruct {
+		std::string name;
+		time_t      lessThan;
+		bool        isMaxValue;
+	};
+
+	static const int REPLICA_CHECK_INTERVAL_SEC;
+
 	static void init(void);
 
 	// constructor and destructor
@@ -43,9 +51,58 @@ public:
 	             unsigned int port = 0);    //   default port is used
 	virtual ~DBAgentMySQL();
 	std::string getDBName(void) const;
+
+	/**
+	 * Set replicas for read-only queries. See getReadAgent().
+	 *
+	 * @param replicas Replicas of the DB.
+	 * @param maxLagSec
+	 * A replica whose replication lag is greater than this is not used.
+	 */
+	void setReplicas(const DBReplicaInfoVect &replicas,
+	                 const int &maxLagSec =
+	                   DBConnectInfo::DEFAULT_MAX_REPLICA_LAG_SEC);
+
+	/**
+	 * Get the replication lag of the connected server.
+	 *
+	 * @return
+	 * The lag in seconds, or -1 if the server isn't a running replica.
+	 */
+	int getReplicationLagSec(void);
+
+	/**
+	 * Get a connection to one of the replicas set by setReplicas().
+	 * The replica is checked every REPLICA_CHECK_INTERVAL_SEC. This
+	 * instance is returned when no replica is usable, it is in a
+	 * transaction, or the calling thread wrote rows with any instance
+	 * in the last maxLagSec seconds.
+	 */
+	virtual DBAgent &getReadAgent(void) override;
+
+	/**
+	 * Select rows on the replica returned by getReadAgent(). When
+	 * the select fails there, the replica isn't used until the next
+	 * check and the select is run on this instance.
+	 */
+	virtual void selectOnReadAgent(const SelectExArg &arg) override;
+
+	/**
+	 * Ping the server. The connection is established again
+	 * if it has been lost.
+	 */
+	virtual bool isAlive(void) override;
 	void getIndexes(std::vector<IndexStruct> &indexStructVect,
 	                const std::string &tableName);
 
+	/**
+	 * Get the partitions of a table in the order of the range.
+	 * The vector is empty if the table isn't partitioned.
+	 */
+	void getTimePartitions(
+	  std::vector<TimePartitionStruct> &timePartitionVect,
+	  const std::string &tableName);
+
 	// virtual methods
 	virtual bool isTableExisting(const std::string &tableName);
 	virtual bool isRecordExisting(const std::string &tableName,
@@ -70,6 +127,10 @@ public:
 	virtual uint64_t getLastInsertId(void);
 	virtual uint64_t getNumberOfAffectedRows(void);
 	virtual bool lastUpsertDidUpdate(void) override;
+	virtual void addTimePartitions(const TableProfile &tableProfile,
+	                               const time_t &untilTime) override;
+	virtual bool purgeOldRows(const TableProfile &tableProfile,
+	                          const time_t &oldestTime) override;
 	/**
 	 * Dispose DBAgentMySQL object and stop retrying connection to MySQL.
 	 *
@@ -79,15 +140,39 @@ public:
 	 * an error code HTERR_VALID_DBAGENT_NO_LONGER_EXISTS
 	 * is thrown on the thread calling any of their methods.
 	 * Note that the instance must not be used after this method is called.
+	 * The connection to the replica is also disposed.
 	 */
 	void dispose(void);
 
+	/**
+	 * Set how select() receives the result.
+	 *
+	 * If this is enabled, rows are streamed from the server with
+	 * mysql_use_result() instead of buffered in the client library at
+	 * once with mysql_store_result(). It reduces the peak memory for
+	 * a large result. The default is false.
+	 *
+	 * @param enable true to stream the result.
+	 */
+	void setResultStreaming(const bool &enable);
+
 protected:
+	/**
+	 * Connect to a replica of the primary. The connection times out
+	 * in a few seconds and the queries on it aren't retried so that
+	 * the caller can use the primary instead.
+	 */
+	DBAgentMySQL(const DBAgentMySQL &primary,
+	             const DBReplicaInfo &replicaInfo);
+
 	static const char *getCStringOrNullIfEmpty(const std::string &str);
+	void selectReplica(void);
 	void connect(void);
 	void sleepAndReconnect(unsigned int sleepTimeSec);
 	bool throwExceptionIfDisposed(void) const;
 	void queryWithRetry(const std::string &statement);
+	MYSQL_RES *getSelectResult(void);
+	void freeSelectResult(MYSQL_RES *result);
 
 	// virtual methods
 	virtual std::string getColumnValueString(
@@ -21,9 +21,13 @@
 #include <cstdio>
 #include <stdarg.h>
 #include <inttypes.h>
+#include <sys/stat.h>
 #include <gio/gio.h>
+#include <map>
 #include <Mutex.h>
 #include <Logger.h>
+#include <Reaper.h>
+#include <SimpleSemaphore.h>
 #include <SeparatorInjector.h>
 using namespace std;
 using namespace mlpl;
@@ -31,9 +35,13 @@ using namespace mlpl;
 #include "DBAgentSQLite3.h"
 #include "HatoholException.h"
 #include "ConfigManager.h"
+#include "HatoholThreadBase.h"
 
 const static int TRANSACTION_TIME_OUT_MSEC = 30 * 1000;
 const char *DBAgentSQLite3::DEFAULT_DB_NAME = "DBAgentSQLite3-default";
+const int64_t DBAgentSQLite3::WAL_MMAP_SIZE = 256 * 1024 * 1024;
+const int     DBAgentSQLite3::WAL_CACHE_SIZE_KIB = 64 * 1024;
+const size_t  DBAgentSQLite3::WAL_CHECKPOINT_INTERVAL_MSEC = 1000;
 static __thread bool tls_lastUpsertDidUpdate = false;
 
 class DBTermCodecSQLite3 : public DBTermCodec {
@@ -54,15 +62,173 @@ string STR_NAME; \
 	va_end(ap); \
 } \
 
+// ---------------------------------------------------------------------------
+// WALCheckpointer
+// ---------------------------------------------------------------------------
+// Checkpoints the WAL files with its own connections, so that writers
+// don't stall on the automatic checkpoint and the WAL files don't keep
+// growing.
+struct WALCheckpointer : public HatoholThreadBase {
+	struct DBEntry {
+		sqlite3 *db;      // NULL until the DB file is opened.
+		ino_t    inode;   // of the file that db has opened.
+		size_t   numUsers;
+
+		DBEntry(void)
+		: db(NULL),
+		  inode(0),
+		  numUsers(0)
+		{
+		}
+	};
+	typedef map<string, DBEntry>     DBMap;
+	typedef DBMap::iterator          DBMapIterator;
+
+	Mutex           lock;
+	DBMap           dbMap; // key: DB path. should be used with lock.
+	SimpleSemaphore sleepSemaphore;
+
+	static WALCheckpointer &getInstance(void)
+	{
+		static WALCheckpointer instance;
+		return instance;
+	}
+
+	WALCheckpointer(void)
+	: sleepSemaphore(0)
+	{
+	}
+
+	virtual ~WALCheckpointer()
+	{
+		exitSync();
+		DBMapIterator it = dbMap.begin();
+		for (; it != dbMap.end(); ++it)
+			close(it->second);
+	}
+
+	virtual void waitExit(void) override
+	{
+		sleepSemaphore.post();
+		HatoholThreadBase::waitExit();
+	}
+
+	void add(const string &dbPath)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		DBEntry &entry = dbMap[dbPath];
+		entry.numUsers++;
+		reopenIfReplaced(dbPath, entry);
+		if (!isStarted())
+			start();
+	}
+
+	/**
+	 * Remove a DB that was added with add(). The connection is closed
+	 * when the DB is removed as many times as it is added.
+	 */
+	void remove(const string &dbPath)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		DBMapIterator it = dbMap.find(dbPath);
+		if (it == dbMap.end())
+			return;
+		DBEntry &entry = it->second;
+		entry.numUsers--;
+		if (entry.numUsers > 0)
+			return;
+		close(entry);
+		dbMap.erase(it);
+	}
+
+protected:
+	// The following methods should be used with lock.
+
+	static void close(DBEntry &entry)
+	{
+		if (!entry.db)
+			return;
+		sqlite3_close(entry.db);
+		entry.db = NULL;
+	}
+
+	// A DB file can be deleted and created again at the same path.
+	// The connection to the old file is replaced in that case.
+	static void reopenIfReplaced(const string &dbPath, DBEntry &entry)
+	{
+		struct stat st;
+		if (stat(dbPath.c_str(), &st) == -1) {
+			close(entry);
+			return;
+		}
+		if (entry.db && entry.inode == st.st_ino)
+			return;
+		close(entry);
+
+		sqlite3 *db = NULL;
+		int result = sqlite3_open_v2(dbPath.c_str(), &db,
+		                             SQLITE_OPEN_READWRITE, NULL);
+		if (result != SQLITE_OK) {
+			MLPL_ERR("Failed to open sqlite: %d, %s\n",
+			         result, dbPath.c_str());
+			sqlite3_close(db);
+			return;
+		}
+		sqlite3_busy_timeout(db, TRANSACTION_TIME_OUT_MSEC);
+		entry.db = db;
+		entry.inode = st.st_ino;
+	}
+
+	void checkpoint(void)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		DBMapIterator it = dbMap.begin();
+		for (; it != dbMap.end(); ++it) {
+			DBEntry &entry = it->second;
+			reopenIfReplaced(it->first, entry);
+			if (!entry.db)
+				continue;
+			// PASSIVE doesn't wait for readers and writers.
+			int result = sqlite3_wal_checkpoint_v2(
+			  entry.db, NULL, SQLITE_CHECKPOINT_PASSIVE,
+			  NULL, NULL);
+			if (result != SQLITE_OK && result != SQLITE_BUSY) {
+				MLPL_ERR("Failed to checkpoint: %d, %s\n",
+				         result, it->first.c_str());
+				// It is opened again in the next cycle.
+				close(entry);
+			}
+		}
+	}
+
+	virtual gpointer mainThread(HatoholThreadArg *arg) override
+	{
+		while (!isExitRequested()) {
+			sleepSemaphore.timedWait(
+			  DBAgentSQLite3::WAL_CHECKPOINT_INTERVAL_MSEC);
+			checkpoint();
+		}
+		return NULL;
+	}
+};
+
+// ---------------------------------------------------------------------------
+// DBAgentSQLite3::Impl
+// ---------------------------------------------------------------------------
 struct DBAgentSQLite3::Impl {
 	static DBTermCodecSQLite3 dbTermCodec;
 
 	string        dbPath;
 	sqlite3      *db;
+	bool          walMode;
 
 	// methods
 	Impl(void)
-	: db(NULL)
+	: db(NULL),
+	  walMode(false)
 	{
 	}
 
@@ -70,6 +236,8 @@ struct DBAgentSQLite3::Impl {
 	{
 		if (!db)
 			return;
+		if (walMode)
+			WALCheckpointer::getInstance().remove(dbPath);
 		int result = sqlite3_close(db);
 		if (result != SQLITE_OK) {
 			// Should we throw an exception ?
@@ -100,10 +268,12 @@ const DBTermCodec *DBAgentSQLite3::getDBTermCodecStatic(void)
 	return &Impl::dbTermCodec;
 }
 
-DBAgentSQLite3::DBAgentSQLite3(const string &dbName, const std::string &dbDir)
+DBAgentSQLite3::DBAgentSQLite3(const string &dbName, const std::string &dbDir,
+                               const bool &walMode)
 : m_impl(new Impl())
 {
 	m_impl->dbPath = makeDBPathFromName(dbName, dbDir);
+	m_impl->walMode = walMode;
 	openDatabase();
 }
 
@@ -304,7 +474,8 @@ void DBAgentSQLite3::checkDBPath(const string &dbPath)
 	g_object_unref(gfile);
 }
 
-sqlite3 *DBAgentSQLite3::openDatabase(const string &dbPath)
+sqlite3 *DBAgentSQLite3::openDatabase(const string &dbPath,
+                                      const bool &walMode)
 {
 	sqlite3 *db = NULL;
 	int result = sqlite3_open_v2(dbPath.c_str(), &db,
@@ -315,9 +486,29 @@ sqlite3 *DBAgentSQLite3::openDatabase(const string &dbPath)
 		                      result, dbPath.c_str());
 	}
 	sqlite3_busy_timeout(db, TRANSACTION_TIME_OUT_MSEC);
+	if (walMode)
+		setupWALMode(db, dbPath);
 	return db;
 }
 
+void DBAgentSQLite3::setupWALMode(sqlite3 *db, const string &dbPath)
+{
+	// The journal mode is persistent in the DB file. The others are
+	// for each connection.
+	_execSql(db, "PRAGMA journal_mode=WAL");
+	// A commit may be lost by a power failure. But the DB isn't
+	// corrupted. It's enough for DBs that can be filled again.
+	_execSql(db, "PRAGMA synchronous=NORMAL");
+	_execSql(db, StringUtils::sprintf("PRAGMA mmap_size=%" PRId64,
+	                                  WAL_MMAP_SIZE));
+	// A negative value means the size in KiB.
+	_execSql(db, StringUtils::sprintf("PRAGMA cache_size=-%d",
+	                                  WAL_CACHE_SIZE_KIB));
+	// WALCheckpointer does it instead.
+	_execSql(db, "PRAGMA wal_autocheckpoint=0");
+	WALCheckpointer::getInstance().add(dbPath);
+}
+
 void DBAgentSQLite3::_execSql(sqlite3 *db, const string &sql)
 {
 	char *errmsg;
@@ -979,6 +1170,11 @@ string DBAgentSQLite3::getDBPath(void) const
 	return m_impl->dbPath;
 }
 
+bool DBAgentSQLite3::isWALMode(void) const
+{
+	return m_impl->walMode;
+}
+
 //
 // Non static methods
 //
@@ -988,7 +1184,7 @@ void DBAgentSQLite3::openDatabase(void)
 		return;
 
 	HATOHOL_ASSERT(!m_impl->dbPath.empty(), "dbPath is empty.");
-	m_impl->db = openDatabase(m_impl->dbPath);
+	m_impl->db = openDatabase(m_impl->dbPath, m_impl->walMode);
 }
 
 void DBAgentSQLite3::execSql(const char *fmt, ...)
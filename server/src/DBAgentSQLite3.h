@@ -33,13 +33,29 @@ public:
 	};
 	static const char *DEFAULT_DB_NAME;
 
+	// Parameters for the WAL mode
+	static const int64_t WAL_MMAP_SIZE;
+	static const int     WAL_CACHE_SIZE_KIB;
+	static const size_t  WAL_CHECKPOINT_INTERVAL_MSEC;
+
 	static void init(void);
 
 	static const DBTermCodec *getDBTermCodecStatic(void);
 
-	// constructor and destructor
+	/**
+	 * Constructor.
+	 *
+	 * @param name A name of the DB.
+	 * @param dbDir A directory of the DB file.
+	 * @param walMode
+	 * If true, the DB is opened in the WAL journal mode with memory
+	 * mapped I/O, a larger page cache and synchronous=NORMAL. Readers
+	 * on other connections then don't wait for a writer. The WAL file
+	 * is checkpointed by a background thread.
+	 */
 	DBAgentSQLite3(const std::string &name = DEFAULT_DB_NAME,
-	               const std::string &dbDir = "");
+	               const std::string &dbDir = "",
+	               const bool &walMode = false);
 	virtual ~DBAgentSQLite3();
 
 	void getIndexes(std::vector<IndexStruct> &indexStructVect,
@@ -74,13 +90,16 @@ public:
 	virtual bool lastUpsertDidUpdate(void) override;
 
 	std::string getDBPath(void) const;
+	bool isWALMode(void) const;
 
 protected:
 	static std::string makeDBPathFromName(
 	  const std::string &name = DEFAULT_DB_NAME,
 	  const std::string &dbDir = "");
 	static void checkDBPath(const std::string &dbPath);
-	static sqlite3 *openDatabase(const std::string &dbPath);
+	static sqlite3 *openDatabase(const std::string &dbPath,
+	                             const bool &walMode = false);
+	static void setupWALMode(sqlite3 *db, const std::string &dbPath);
 	static void execSql(sqlite3 *db, const char *fmt, ...);
 	static void _execSql(sqlite3 *db, const std::string &sql);
 	static bool isTableExisting(sqlite3 *db,
@@ -96,6 +96,8 @@ void DBHatohol::reset(void)
 	ConfigManager *confMgr = ConfigManager::getInstance();
 	connInfo.host = confMgr->getDBServerAddress();
 	connInfo.port = confMgr->getDBServerPort();
+	connInfo.replicas = confMgr->getDBReplicas();
+	connInfo.maxReplicaLagSec = confMgr->getDBReplicaMaxLagSec();
 
 	connInfo.user     = DEFAULT_USER_NAME;
 	connInfo.password = DEFAULT_PASSWORD;
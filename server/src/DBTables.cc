@@ -20,6 +20,7 @@
 #include "DBTables.h"
 #include "DB.h"
 #include "ItemGroupStream.h"
+#include "DataQueryOption.h"
 
 using namespace std;
 using namespace mlpl;
@@ -273,6 +274,15 @@ DBAgent &DBTables::getDBAgent(void)
 	return m_impl->dbAgent;
 }
 
+void DBTables::runReadTransaction(const DBAgent::SelectExArg &arg,
+                                  const DataQueryOption &option)
+{
+	if (option.getStaleDataAllowed())
+		m_impl->dbAgent.selectOnReadAgent(arg);
+	else
+		m_impl->dbAgent.runTransaction(arg);
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -26,6 +26,8 @@
 #include "Params.h"
 #include "DBAgent.h"
 
+class DataQueryOption;
+
 class DBTables {
 public:
 	struct Version {
@@ -78,6 +80,14 @@ public:
 
 	DBAgent &getDBAgent(void);
 
+	/**
+	 * Select rows in a transaction. They are selected on a replica of
+	 * the DB instead when the option allows data a few seconds old.
+	 * See DBAgent::selectOnReadAgent().
+	 */
+	void runReadTransaction(const DBAgent::SelectExArg &arg,
+	                        const DataQueryOption &option);
+
 protected:
 	static void checkMajorVersionMain(
 	  const SetupInfo &setupInfo, DBAgent &dbAgent);
@@ -18,6 +18,7 @@
  */
 
 #include <exception>
+#include <deque>
 #include <SeparatorInjector.h>
 #include "Utils.h"
 #include "ConfigManager.h"
@@ -26,9 +27,11 @@
 #include "DBTablesAction.h"
 #include "DBTablesMonitoring.h"
 #include "Mutex.h"
+#include "Reaper.h"
 #include "ItemGroupStream.h"
 #include "UnifiedDataStore.h"
 #include "DBTermCStringProvider.h"
+#include "ActionRuleIndex.h"
 using namespace std;
 using namespace mlpl;
 
@@ -365,6 +368,192 @@ struct deleteInvalidActionsContext {
 };
 static deleteInvalidActionsContext *g_deleteActionCtx = NULL;
 
+// The events whose action logs were created recently by this process.
+// The oldest ones are forgotten and are looked up in the DB again.
+struct RecentActionLogSet {
+	static const size_t MAX_SIZE = 10000;
+
+	Mutex                     lock;
+	ServerEventIdSet          idSet;
+	deque<ServerEventId>      idQueue;
+
+	void add(const ServerEventId &id)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		if (!idSet.insert(id).second)
+			return;
+		idQueue.push_back(id);
+		if (idQueue.size() <= MAX_SIZE)
+			return;
+		idSet.erase(idQueue.front());
+		idQueue.pop_front();
+	}
+
+	bool has(const ServerEventId &id)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		return idSet.count(id);
+	}
+
+	void clear(void)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		idSet.clear();
+		idQueue.clear();
+	}
+};
+static RecentActionLogSet g_recentActionLogSet;
+
+// The maximum number of the event IDs in an IN clause
+static const size_t MAX_EVENT_IDS_IN_QUERY = 100;
+
+// The transitions of an action log that have not been written yet.
+// The ones for the same log are merged in the order of the calls.
+struct PendingActionLog {
+	ActionLogStatus status;
+	bool            started;
+	int             startTime;
+	bool            ended;
+	int             endTime;
+	DBTablesAction::LogEndExecActionArg endArg;
+
+	PendingActionLog(void)
+	: status(ACTLOG_STAT_INVALID),
+	  started(false),
+	  startTime(0),
+	  ended(false),
+	  endTime(0)
+	{
+	}
+};
+typedef map<ActionLogIdType, PendingActionLog> PendingActionLogMap;
+
+// Updates of action logs are written in a transaction by the timer,
+// or when the number of them reaches MAX_SIZE.
+struct ActionLogWriteBuffer {
+	static const size_t MAX_SIZE = 1000;
+	static const guint  FLUSH_INTERVAL_MSEC = 100;
+
+	Mutex               lock;
+	PendingActionLogMap pendingMap;
+	guint               timerId;
+
+	// This is held while the taken logs are written so that
+	// the logs can be read after flush() on any thread.
+	Mutex               flushLock;
+
+	ActionLogWriteBuffer(void)
+	: timerId(INVALID_EVENT_ID)
+	{
+	}
+
+	// Returns true if the buffer should be flushed immediately.
+	bool add(const ActionLogIdType &logId, const PendingActionLog &log)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		PendingActionLog &pending = pendingMap[logId];
+		pending.status = log.status;
+		if (log.started) {
+			pending.started = true;
+			pending.startTime = log.startTime;
+		}
+		if (log.ended) {
+			pending.ended = true;
+			pending.endTime = log.endTime;
+			pending.endArg = log.endArg;
+		}
+		if (pendingMap.size() >= MAX_SIZE)
+			return true;
+		if (timerId == INVALID_EVENT_ID) {
+			timerId = g_timeout_add(FLUSH_INTERVAL_MSEC,
+			                        flushCycl, NULL);
+		}
+		return false;
+	}
+
+	bool empty(void)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		return pendingMap.empty();
+	}
+
+	void flush(DBAgent &dbAgent)
+	{
+		flushLock.lock();
+		Reaper<Mutex> flushUnlocker(&flushLock, Mutex::unlock);
+
+		struct TrxProc : public DBAgent::TransactionProc {
+			PendingActionLogMap pendingMap;
+
+			void operator ()(DBAgent &dbAgent) override
+			{
+				PendingActionLogMap::const_iterator it =
+				  pendingMap.begin();
+				for (; it != pendingMap.end(); ++it)
+					update(dbAgent, it->first, it->second);
+			}
+
+			void update(DBAgent &dbAgent,
+			            const ActionLogIdType &logId,
+			            const PendingActionLog &pending)
+			{
+				DBAgent::UpdateArg arg(tableProfileActionLogs);
+				const ColumnDef *def = COLUMN_DEF_ACTION_LOGS;
+				arg.condition = StringUtils::sprintf(
+				  "%s=%" FMT_ACTION_LOG_ID,
+				  def[IDX_ACTION_LOGS_ACTION_LOG_ID].columnName,
+				  logId);
+				arg.add(IDX_ACTION_LOGS_STATUS, pending.status);
+				if (pending.started) {
+					arg.add(IDX_ACTION_LOGS_START_TIME,
+					        pending.startTime);
+				}
+				if (pending.ended) {
+					const DBTablesAction::LogEndExecActionArg
+					  &endArg = pending.endArg;
+					if (!(endArg.nullFlags & ACTLOG_FLAG_END_TIME)) {
+						arg.add(IDX_ACTION_LOGS_END_TIME,
+						        pending.endTime);
+					}
+					arg.add(IDX_ACTION_LOGS_EXEC_FAILURE_CODE,
+					        endArg.failureCode);
+					if (!(endArg.nullFlags & ACTLOG_FLAG_EXIT_CODE)) {
+						arg.add(IDX_ACTION_LOGS_EXIT_CODE,
+						        endArg.exitCode);
+					}
+				}
+				dbAgent.update(arg);
+			}
+		} trx;
+
+		lock.lock();
+		trx.pendingMap.swap(pendingMap);
+		lock.unlock();
+		if (trx.pendingMap.empty())
+			return;
+		dbAgent.runTransaction(trx);
+	}
+
+	static gboolean flushCycl(gpointer data);
+};
+static ActionLogWriteBuffer g_actionLogWriteBuffer;
+
+gboolean ActionLogWriteBuffer::flushCycl(gpointer data)
+{
+	g_actionLogWriteBuffer.lock.lock();
+	g_actionLogWriteBuffer.timerId = INVALID_EVENT_ID;
+	g_actionLogWriteBuffer.lock.unlock();
+
+	ThreadLocalDBCache cache;
+	cache.getAction().flushActionLogs();
+	return G_SOURCE_REMOVE;
+}
+
 // ---------------------------------------------------------------------------
 // LogEndExecActionArg
 // ---------------------------------------------------------------------------
@@ -391,7 +580,13 @@ void DBTablesAction::init(void)
 
 void DBTablesAction::reset(void)
 {
+	if (!g_actionLogWriteBuffer.empty()) {
+		ThreadLocalDBCache cache;
+		cache.getAction().flushActionLogs();
+	}
 	getSetupInfo().initialized = false;
+	g_recentActionLogSet.clear();
+	ActionRuleIndex::reset();
 }
 
 const DBTables::SetupInfo &DBTablesAction::getConstSetupInfo(void)
@@ -402,6 +597,8 @@ const DBTables::SetupInfo &DBTablesAction::getConstSetupInfo(void)
 void DBTablesAction::stop(void)
 {
 	Utils::executeOnGLibEventLoop(stopIdleDeleteAction);
+	ThreadLocalDBCache cache;
+	cache.getAction().flushActionLogs();
 }
 
 const char *DBTablesAction::getTableNameActions(void)
@@ -465,6 +662,7 @@ HatoholError DBTablesAction::addAction(ActionDef &actionDef,
 	arg.add(ownerUserId);
 
 	getDBAgent().runTransaction(arg, &actionDef.id);
+	ActionRuleIndex::getInstance()->invalidate();
 	return HTERR_OK;
 }
 
@@ -514,6 +712,7 @@ HatoholError DBTablesAction::updateAction(ActionDef &actionDef,
 	arg.add(IDX_ACTIONS_OWNER_USER_ID, ownerUserId);
 
 	getDBAgent().runTransaction(arg);
+	ActionRuleIndex::getInstance()->invalidate();
 	return HTERR_OK;
 }
 
@@ -691,6 +890,7 @@ HatoholError DBTablesAction::deleteActions(const ActionIdList &idList,
 	} trx;
 	trx.arg.condition = makeConditionForDelete(idList, privilege);
 	getDBAgent().runTransaction(trx);
+	ActionRuleIndex::getInstance()->invalidate();
 
 	// Check the result
 	if (trx.numAffectedRows != idList.size()) {
@@ -782,45 +982,35 @@ uint64_t DBTablesAction::createActionLog(
 
 	ActionLogIdType logId;
 	getDBAgent().runTransaction(arg, &logId);
+	g_recentActionLogSet.add(ServerEventId(eventInfo.serverId,
+	                                       eventInfo.id));
 	return logId;
 }
 
 void DBTablesAction::logEndExecAction(const LogEndExecActionArg &logArg)
 {
-	DBAgent::UpdateArg arg(tableProfileActionLogs);
-
-	const char *actionLogIdColumnName =
-	  COLUMN_DEF_ACTION_LOGS[IDX_ACTION_LOGS_ACTION_LOG_ID].columnName;
-	arg.condition = StringUtils::sprintf("%s=%" FMT_ACTION_LOG_ID,
-	                                     actionLogIdColumnName,
-	                                     logArg.logId);
-	// status
-	arg.add(IDX_ACTION_LOGS_STATUS, logArg.status);
-	if (!(logArg.nullFlags & ACTLOG_FLAG_END_TIME))
-		arg.add(IDX_ACTION_LOGS_END_TIME, CURR_DATETIME);
-
-	// exec_failure_code
-	arg.add(IDX_ACTION_LOGS_EXEC_FAILURE_CODE, logArg.failureCode);
-
-	// exit_code
-	if (!(logArg.nullFlags & ACTLOG_FLAG_EXIT_CODE))
-		arg.add(IDX_ACTION_LOGS_EXIT_CODE, logArg.exitCode);
-
-	getDBAgent().runTransaction(arg);
+	PendingActionLog log;
+	log.status = logArg.status;
+	log.ended = true;
+	log.endTime = time(NULL);
+	log.endArg = logArg;
+	if (g_actionLogWriteBuffer.add(logArg.logId, log))
+		flushActionLogs();
 }
 
 void DBTablesAction::updateLogStatusToStart(const ActionLogIdType &logId)
 {
-	DBAgent::UpdateArg arg(tableProfileActionLogs);
-
-	const char *actionLogIdColumnName =
-	  COLUMN_DEF_ACTION_LOGS[IDX_ACTION_LOGS_ACTION_LOG_ID].columnName;
-	arg.condition = StringUtils::sprintf("%s=%" FMT_ACTION_LOG_ID,
-	                                     actionLogIdColumnName, logId);
-	arg.add(IDX_ACTION_LOGS_STATUS, ACTLOG_STAT_STARTED);
-	arg.add(IDX_ACTION_LOGS_START_TIME, CURR_DATETIME);
+	PendingActionLog log;
+	log.status = ACTLOG_STAT_STARTED;
+	log.started = true;
+	log.startTime = time(NULL);
+	if (g_actionLogWriteBuffer.add(logId, log))
+		flushActionLogs();
+}
 
-	getDBAgent().runTransaction(arg);
+void DBTablesAction::flushActionLogs(void)
+{
+	g_actionLogWriteBuffer.flush(getDBAgent());
 }
 
 bool DBTablesAction::getLog(ActionLog &actionLog, const ActionLogIdType &logId)
@@ -846,6 +1036,60 @@ bool DBTablesAction::getLog(
 	return getLog(actionLog, condition);
 }
 
+void DBTablesAction::getLoggedEvents(ServerEventIdSet &loggedEventIdSet,
+                                     const EventInfoList &eventList)
+{
+	typedef map<ServerIdType, set<EventIdType> > EventIdSetMap;
+	EventIdSetMap unknownEventIdSetMap;
+	EventInfoListConstIterator it = eventList.begin();
+	for (; it != eventList.end(); ++it) {
+		const ServerEventId id(it->serverId, it->id);
+		if (g_recentActionLogSet.has(id))
+			loggedEventIdSet.insert(id);
+		else
+			unknownEventIdSetMap[it->serverId].insert(it->id);
+	}
+
+	const ColumnDef *def = COLUMN_DEF_ACTION_LOGS;
+	const char *idColNameSvId = def[IDX_ACTION_LOGS_SERVER_ID].columnName;
+	const char *idColNameEvtId = def[IDX_ACTION_LOGS_EVENT_ID].columnName;
+	DBTermCStringProvider rhs(*getDBAgent().getDBTermCodec());
+	EventIdSetMap::const_iterator svIt = unknownEventIdSetMap.begin();
+	for (; svIt != unknownEventIdSetMap.end(); ++svIt) {
+		const ServerIdType &serverId = svIt->first;
+		const set<EventIdType> &eventIdSet = svIt->second;
+		set<EventIdType>::const_iterator evIt = eventIdSet.begin();
+		while (evIt != eventIdSet.end()) {
+			SeparatorInjector commaInjector(",");
+			string eventIds;
+			for (size_t n = 0; n < MAX_EVENT_IDS_IN_QUERY &&
+			                   evIt != eventIdSet.end(); ++n, ++evIt) {
+				commaInjector(eventIds);
+				eventIds += rhs(*evIt);
+			}
+
+			DBAgent::SelectExArg arg(tableProfileActionLogs);
+			arg.add(IDX_ACTION_LOGS_EVENT_ID);
+			arg.condition = StringUtils::sprintf(
+			  "%s=%" FMT_SERVER_ID " AND %s IN (%s)",
+			  idColNameSvId, serverId,
+			  idColNameEvtId, eventIds.c_str());
+			getDBAgent().runTransaction(arg);
+
+			const ItemGroupList &grpList =
+			  arg.dataTable->getItemGroupList();
+			ItemGroupListConstIterator itemGrpItr = grpList.begin();
+			for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
+				ItemGroupStream itemGroupStream(*itemGrpItr);
+				const ServerEventId id(
+				  serverId, itemGroupStream.read<string>());
+				loggedEventIdSet.insert(id);
+				g_recentActionLogSet.add(id);
+			}
+		}
+	}
+}
+
 bool DBTablesAction::isIncidentSenderEnabled(void)
 {
 	ActionDefList actionDefList;
@@ -893,6 +1137,7 @@ ItemDataNullFlagType DBTablesAction::getNullFlag
 
 bool DBTablesAction::getLog(ActionLog &actionLog, const string &condition)
 {
+	flushActionLogs();
 	DBAgent::SelectExArg arg(tableProfileActionLogs);
 	arg.condition = condition;
 	arg.add(IDX_ACTION_LOGS_ACTION_LOG_ID);
@@ -156,6 +156,11 @@ typedef std::set<ActionIdType>        ActionIdSet;
 typedef ActionIdSet::iterator         ActionIdSetIterator;
 typedef ActionIdSet::const_iterator   ActionIdSetConstIterator;
 
+typedef std::pair<ServerIdType, EventIdType> ServerEventId;
+typedef std::set<ServerEventId>              ServerEventIdSet;
+typedef ServerEventIdSet::iterator           ServerEventIdSetIterator;
+typedef ServerEventIdSet::const_iterator     ServerEventIdSetConstIterator;
+
 enum {
 	ACTLOG_FLAG_QUEUING_TIME = (1 << 0),
 	ACTLOG_FLAG_START_TIME   = (1 << 1),
@@ -236,6 +241,7 @@ enum ActionLogExecFailureCode {
 	ACTLOG_EXECFAIL_KILLED_SIGNAL,
 	ACTLOG_EXECFAIL_DUMPED_SIGNAL,
 	ACTLOG_EXECFAIL_UNEXPECTED_EXIT,
+	ACTLOG_EXECFAIL_QUEUE_FULL,
 };
 
 class ActionsQueryOption : public DataQueryOption {
@@ -331,17 +337,27 @@ public:
 	 * exec_failure_code, and exit_code. Note that other members in
 	 * logArg are ignored.
 	 *
+	 * The update is buffered and written with the others by
+	 * flushActionLogs(). end_time is the time of this call.
 	 */
 	void logEndExecAction(const LogEndExecActionArg &logArg);
 
 	/**
 	 * Update the status in action log to ACTLOG_STAT_STARTED.
 	 * The column: start_time is also updated to the current time.
+	 * The update is buffered as logEndExecAction().
 	 *
 	 * @param logId A logID to be updated.
 	 */
 	void updateLogStatusToStart(const ActionLogIdType &logId);
 
+	/**
+	 * Write the buffered updates of action logs in a transaction.
+	 * This is also called periodically on the GLib event loop,
+	 * before getLog() and at stop() and reset().
+	 */
+	void flushActionLogs(void);
+
 	/**
 	 * Get the action log.
 	 * @param actionLog
@@ -365,6 +381,20 @@ public:
 	bool getLog(ActionLog &actionLog, const ServerIdType &serverId,
 	            const EventIdType &eventId);
 
+	/**
+	 * Find the events that already have an action log.
+	 *
+	 * The events logged recently by this process are found in memory.
+	 * The others are looked up with a query per server.
+	 *
+	 * @param loggedEventIdSet
+	 * The server IDs and the event IDs of the found events are
+	 * inserted to this set.
+	 * @param eventList Target events.
+	 */
+	void getLoggedEvents(ServerEventIdSet &loggedEventIdSet,
+	                     const EventInfoList &eventList);
+
 	/**
 	 * Check whether IncidentSender type action exists or not
 	 *
@@ -29,6 +29,11 @@
 #include "ItemGroupStream.h"
 #include "SQLUtils.h"
 #include "DBClientJoinBuilder.h"
+#include "UserPrivilegeCache.h"
+#include "OverviewCounter.h"
+#include "HotEventRing.h"
+#include "HistoryCache.h"
+#include "ActionRuleIndex.h"
 using namespace std;
 using namespace mlpl;
 
@@ -752,10 +757,9 @@ string ServerQueryOption::getCondition(void) const
 		return condition;
 
 	// check allowed servers
-	ThreadLocalDBCache cache;
-	DBTablesUser &dbUser = cache.getUser();
 	ServerHostGrpSetMap srvHostGrpSetMap;
-	dbUser.getServerHostGrpSetMap(srvHostGrpSetMap, getUserId());
+	UserPrivilegeCache::getInstance()->getServerHostGrpSetMap(
+	  srvHostGrpSetMap, getUserId());
 
 	size_t numServers = srvHostGrpSetMap.size();
 	if (numServers == 0) {
@@ -1125,6 +1129,8 @@ HatoholError DBTablesConfig::addTargetServer(
 		}
 	} trx(this, *monitoringServerInfo, *armPluginInfo);
 	getDBAgent().runTransaction(trx);
+	if (trx.err == HTERR_OK)
+		UserPrivilegeCache::getInstance()->invalidateAll();
 	return trx.err;
 }
 
@@ -1203,6 +1209,12 @@ HatoholError DBTablesConfig::updateTargetServer(
 	   StringUtils::sprintf("id=%u", monitoringServerInfo->id);
 
 	getDBAgent().runTransaction(trx);
+	if (trx.err == HTERR_OK) {
+		UserPrivilegeCache::getInstance()->invalidateAll();
+		// The server may be another one now.
+		HistoryCache::getInstance()->invalidate(
+		  monitoringServerInfo->id);
+	}
 	return trx.err;
 }
 
@@ -1235,6 +1247,10 @@ HatoholError DBTablesConfig::deleteTargetServer(
 	                        serverId);
 	preprocForDeleteArmPluginInfo(serverId, trx.argArmPlugins.condition);
 	getDBAgent().runTransaction(trx);
+	UserPrivilegeCache::getInstance()->invalidateAll();
+	OverviewCounter::getInstance()->invalidate(serverId);
+	HotEventRing::getInstance()->invalidate(serverId);
+	HistoryCache::getInstance()->invalidate(serverId);
 	return HTERR_OK;
 }
 
@@ -1447,6 +1463,8 @@ HatoholError DBTablesConfig::addIncidentTracker(
 	arg.add(incidentTrackerInfo.password);
 
 	getDBAgent().runTransaction(arg, &incidentTrackerInfo.id);
+	// IncidentSender actions are valid only when the tracker exists.
+	ActionRuleIndex::getInstance()->invalidate();
 	return HTERR_OK;
 }
 
@@ -1551,6 +1569,7 @@ HatoholError DBTablesConfig::deleteIncidentTracker(
 	                                     colId.columnName, incidentTrackerId);
 
 	getDBAgent().runTransaction(arg);
+	ActionRuleIndex::getInstance()->invalidate();
 	return HTERR_OK;
 }
 
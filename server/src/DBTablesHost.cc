@@ -18,11 +18,15 @@
  */
 
 #include <cstdio>
+#include <unordered_map>
+#include <SeparatorInjector.h>
 #include "DBTablesHost.h"
 #include "ItemGroupStream.h"
 #include "ThreadLocalDBCache.h"
 #include "DBClientJoinBuilder.h"
 #include "DBTermCStringProvider.h"
+#include "UserPrivilegeCache.h"
+#include "OverviewCounter.h"
 using namespace std;
 using namespace mlpl;
 
@@ -35,6 +39,9 @@ static const char *TABLE_NAME_HOSTGROUP_MEMBER  = "hostgroup_member";
 
 const int DBTablesHost::TABLES_VERSION = 3;
 
+// The maximum number of the record IDs in an IN clause
+static const size_t MAX_SERVER_HOST_DEF_IDS_IN_QUERY = 100;
+
 void operator>>(ItemGroupStream &itemGroupStream, HostStatus &rhs)
 {
 	rhs = itemGroupStream.read<int, HostStatus>();
@@ -883,7 +890,7 @@ HatoholError DBTablesHost::getHostgroups(HostgroupVect &hostgroups,
 	arg.add(IDX_HOSTGROUP_LIST_NAME);
 	arg.condition = option.getCondition();
 
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
@@ -916,7 +923,11 @@ GenericIdType DBTablesHost::upsertHostgroupMember(
 	DBAgent &dbAgent = getDBAgent();
 	if (useTransaction) {
 		dbAgent.runTransaction(arg, &id);
+		UserPrivilegeCache::getInstance()->invalidateHostIdBitmaps();
+		OverviewCounter::getInstance()->addHostgroupMember(
+		  hostgroupMember);
 	} else {
+		// The caller invalidates the cache after the commit.
 		dbAgent.insert(arg);
 		id = dbAgent.getLastInsertId();
 	}
@@ -947,6 +958,12 @@ void DBTablesHost::upsertHostgroupMembers(
 		}
 	} proc(*this, hostgroupMembers);
 	getDBAgent().runTransaction(proc);
+	UserPrivilegeCache::getInstance()->invalidateHostIdBitmaps();
+
+	OverviewCounter *overviewCounter = OverviewCounter::getInstance();
+	HostgroupMemberVectConstIterator hgrpMemIt = hostgroupMembers.begin();
+	for (; hgrpMemIt != hostgroupMembers.end(); ++hgrpMemIt)
+		overviewCounter->addHostgroupMember(*hgrpMemIt);
 }
 
 HatoholError DBTablesHost::getHostgroupMembers(
@@ -962,7 +979,7 @@ HatoholError DBTablesHost::getHostgroupMembers(
 
 	arg.condition = option.getCondition();
 
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	hostgroupMembers.reserve(grpList.size());
@@ -996,7 +1013,7 @@ HatoholError DBTablesHost::getVirtualMachines(
 	  "%s=%" FMT_HOST_ID,
 	  COLUMN_DEF_VM_LIST[IDX_HOST_VM_LIST_HYPERVISOR_HOST_ID].columnName,
 	  hypervisorHostId);
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	// get the result
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
@@ -1030,7 +1047,7 @@ HatoholError DBTablesHost::getHypervisor(HostIdType &hypervisorHostId,
 	  "%s=%" FMT_HOST_ID,
 	  COLUMN_DEF_VM_LIST[IDX_HOST_VM_LIST_HOST_ID].columnName,
 	  hostId);
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	// get the result
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
@@ -1130,7 +1147,7 @@ HatoholError DBTablesHost::getServerHostDefs(
 	} else {
 		arg.condition = option.getCondition();
 	}
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	// get the result
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
@@ -1158,12 +1175,13 @@ bool DBTablesHost::wasStoredHostsChanged(void)
 
 HatoholError DBTablesHost::syncHosts(
   const ServerHostDefVect &svHostDefs, const ServerIdType &serverId,
-  HostHostIdMap *hostHostIdMapPtr)
+  HostHostIdMap *hostHostIdMapPtr, bool *storedHostsChanged)
 {
-	// Make a set that contains current hosts records
+	// Load the current hosts of the server once.
 	HostsQueryOption option(USER_ID_SYSTEM);
-	option.setStatus(HOST_STAT_NORMAL);
+	option.setStatus(HOST_STAT_ALL);
 	option.setTargetServerId(serverId);
+	option.setFilterForDataOfDefunctServers(false);
 
 	ServerHostDefVect _currHosts;
 	HatoholError err = getServerHostDefs(_currHosts, option);
@@ -1171,41 +1189,175 @@ HatoholError DBTablesHost::syncHosts(
 		return err;
 	const ServerHostDefVect &currHosts(_currHosts); // To avoid changing
 
-	map<string, const ServerHostDef *> currValidHosts;
+	typedef unordered_map<LocalHostIdType, const ServerHostDef *>
+	  ServerHostDefPtrMap;
+	ServerHostDefPtrMap currHostMap;
+	currHostMap.reserve(currHosts.size());
 	ServerHostDefVectConstIterator currHostsItr = currHosts.begin();
 	for (; currHostsItr != currHosts.end(); ++currHostsItr) {
 		const ServerHostDef &svHostDef = *currHostsItr;
-		currValidHosts[svHostDef.hostIdInServer] = &svHostDef;
+		currHostMap[svHostDef.hostIdInServer] = &svHostDef;
 	}
 
-	// Pick up hosts to be added.
-	ServerHostDefVect serverHostDefs;
+	// Compute the differences in memory.
+	struct Proc : public DBAgent::TransactionProc {
+		vector<const ServerHostDef *> addedHosts;
+		vector<const ServerHostDef *> renamedHosts;
+		map<HostStatus, vector<GenericIdType> > statusChangedIds;
+		DBTablesHost  &dbHost;
+		HostHostIdMap *hostHostIdMapPtr;
+
+		Proc(DBTablesHost &_dbHost, HostHostIdMap *_hostHostIdMapPtr)
+		: dbHost(_dbHost),
+		  hostHostIdMapPtr(_hostHostIdMapPtr)
+		{
+		}
+
+		bool empty(void) const
+		{
+			return addedHosts.empty() && renamedHosts.empty() &&
+			       statusChangedIds.empty();
+		}
+
+		void setHostId(const LocalHostIdType &hostIdInServer,
+		               const HostIdType &hostId)
+		{
+			if (hostHostIdMapPtr)
+				(*hostHostIdMapPtr)[hostIdInServer] = hostId;
+		}
+
+		void operator ()(DBAgent &dbAgent) override
+		{
+			vector<const ServerHostDef *>::const_iterator it =
+			  addedHosts.begin();
+			for (; it != addedHosts.end(); ++it)
+				addHost(**it);
+
+			for (it = renamedHosts.begin();
+			     it != renamedHosts.end(); ++it) {
+				updateHost(dbAgent, **it);
+			}
+
+			map<HostStatus, vector<GenericIdType> >::const_iterator
+			  statusIt = statusChangedIds.begin();
+			for (; statusIt != statusChangedIds.end(); ++statusIt)
+				updateStatus(dbAgent, statusIt->first,
+				             statusIt->second);
+		}
+
+		void addHost(const ServerHostDef &svHostDef)
+		{
+			// The record may have been added by another session
+			// after the snapshot was taken. upsertHost() removes
+			// the host added by this session and reuses the
+			// existing host ID in that case.
+			const HostIdType hostId =
+			  dbHost.upsertHost(svHostDef, false);
+			setHostId(svHostDef.hostIdInServer, hostId);
+		}
+
+		void updateHost(DBAgent &dbAgent, const ServerHostDef &svHostDef)
+		{
+			const ColumnDef *def = COLUMN_DEF_SERVER_HOST_DEF;
+			DBAgent::UpdateArg arg(tableProfileServerHostDef);
+			arg.add(IDX_HOST_SERVER_HOST_DEF_HOST_NAME,
+			        svHostDef.name);
+			arg.add(IDX_HOST_SERVER_HOST_DEF_HOST_STATUS,
+			        static_cast<int>(svHostDef.status));
+			arg.condition = StringUtils::sprintf(
+			  "%s=%" FMT_GEN_ID,
+			  def[IDX_HOST_SERVER_HOST_DEF_ID].columnName,
+			  svHostDef.id);
+			dbAgent.update(arg);
+		}
+
+		void updateStatus(DBAgent &dbAgent, const HostStatus &status,
+		                  const vector<GenericIdType> &ids)
+		{
+			const ColumnDef *def = COLUMN_DEF_SERVER_HOST_DEF;
+			vector<GenericIdType>::const_iterator it = ids.begin();
+			while (it != ids.end()) {
+				SeparatorInjector commaInjector(",");
+				string idList;
+				for (size_t n = 0;
+				     n < MAX_SERVER_HOST_DEF_IDS_IN_QUERY &&
+				     it != ids.end(); ++n, ++it) {
+					commaInjector(idList);
+					idList += StringUtils::sprintf(
+					            "%" FMT_GEN_ID, *it);
+				}
+				DBAgent::UpdateArg arg(tableProfileServerHostDef);
+				arg.add(IDX_HOST_SERVER_HOST_DEF_HOST_STATUS,
+				        static_cast<int>(status));
+				arg.condition = StringUtils::sprintf(
+				  "%s IN (%s)",
+				  def[IDX_HOST_SERVER_HOST_DEF_ID].columnName,
+				  idList.c_str());
+				dbAgent.update(arg);
+			}
+		}
+	} proc(*this, hostHostIdMapPtr);
+
+	ServerHostDefVect renamedHosts;
+	renamedHosts.reserve(svHostDefs.size());
 	ServerHostDefVectConstIterator newHostsItr = svHostDefs.begin();
 	for (; newHostsItr != svHostDefs.end(); ++newHostsItr) {
 		const ServerHostDef &newSvHostDef = *newHostsItr;
-		if (currValidHosts.erase(newSvHostDef.hostIdInServer) >= 1) {
-			// The host already exits. We have nothing to do.
+		ServerHostDefPtrMap::iterator currIt =
+		  currHostMap.find(newSvHostDef.hostIdInServer);
+		if (currIt == currHostMap.end()) {
+			proc.addedHosts.push_back(&newSvHostDef);
 			continue;
 		}
-		// TODO: avoid the copy
-		serverHostDefs.push_back(newSvHostDef);
+		const ServerHostDef &currSvHostDef = *currIt->second;
+		currHostMap.erase(currIt);
+		if (newSvHostDef.hostId != AUTO_ASSIGNED_ID) {
+			HATOHOL_ASSERT(
+			  currSvHostDef.hostId == newSvHostDef.hostId,
+			  "Host ID inconsistent: DB: %" FMT_HOST_ID ", "
+			  "Input: %" FMT_HOST_ID,
+			  currSvHostDef.hostId, newSvHostDef.hostId);
+		}
+		proc.setHostId(currSvHostDef.hostIdInServer,
+		               currSvHostDef.hostId);
+		if (newSvHostDef.name != currSvHostDef.name) {
+			// Keep the record ID and the host ID in the DB.
+			ServerHostDef renamedHost = newSvHostDef;
+			renamedHost.id = currSvHostDef.id;
+			renamedHost.hostId = currSvHostDef.hostId;
+			renamedHosts.push_back(renamedHost);
+		} else if (newSvHostDef.status != currSvHostDef.status) {
+			proc.statusChangedIds[newSvHostDef.status].push_back(
+			  currSvHostDef.id);
+		}
 	}
-
-	// Add hosts to be marked as invalid
-	map<string, const ServerHostDef *>::const_iterator
-	  hostMapItr = currValidHosts.begin();
-	for (; hostMapItr != currValidHosts.end(); ++hostMapItr) {
-		ServerHostDef invalidHost = *hostMapItr->second; // make a copy
-		invalidHost.status = HOST_STAT_REMOVED;
-		serverHostDefs.push_back(invalidHost);
+	// The pointers are taken after all hosts are pushed back
+	// because push_back() may move the elements.
+	ServerHostDefVectConstIterator renamedItr = renamedHosts.begin();
+	for (; renamedItr != renamedHosts.end(); ++renamedItr)
+		proc.renamedHosts.push_back(&*renamedItr);
+
+	// The remaining valid hosts are marked as invalid. As before,
+	// the hosts of a defunct server are left as they are.
+	const ServerIdSet &validServerIdSet =
+	  option.getDataQueryContext().getValidServerIdSet();
+	if (validServerIdSet.find(serverId) == validServerIdSet.end())
+		currHostMap.clear();
+	ServerHostDefPtrMap::const_iterator hostMapItr = currHostMap.begin();
+	for (; hostMapItr != currHostMap.end(); ++hostMapItr) {
+		const ServerHostDef &invalidHost = *hostMapItr->second;
+		if (invalidHost.status != HOST_STAT_NORMAL)
+			continue;
+		proc.statusChangedIds[HOST_STAT_REMOVED].push_back(
+		  invalidHost.id);
+		proc.setHostId(invalidHost.hostIdInServer, invalidHost.hostId);
 	}
 
-	if (serverHostDefs.empty()){
-		m_impl->storedHostsChanged = true;
-		return HTERR_OK;
-	}
-	upsertHosts(serverHostDefs, hostHostIdMapPtr);
-	m_impl->storedHostsChanged = false;
+	if (!proc.empty())
+		getDBAgent().runTransaction(proc);
+	m_impl->storedHostsChanged = proc.empty();
+	if (storedHostsChanged)
+		*storedHostsChanged = m_impl->storedHostsChanged;
 	return HTERR_OK;
 }
 
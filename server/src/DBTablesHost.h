@@ -371,10 +371,21 @@ public:
 	 *
 	 * If new hosts are added or any hosts are removed,
 	 * the method follows them (inserts or deletes uncessary records).
+	 * The current hosts of the server are loaded at once and the
+	 * differences are applied in a transaction. Status changes of
+	 * multiple hosts are written with one statement.
+	 *
+	 * @param storedHostsChanged
+	 * If this is not NULL, the value that wasStoredHostsChanged()
+	 * returns after this call is stored. Callers that get this
+	 * instance from ThreadLocalDBCache should use it instead of
+	 * wasStoredHostsChanged(), because the next instance they get
+	 * may be a different one.
 	 */
 	HatoholError syncHosts(
 	  const ServerHostDefVect &svHostDefs, const ServerIdType &serverId,
-	  HostHostIdMap *hostHostIdMapPtr = NULL);
+	  HostHostIdMap *hostHostIdMapPtr = NULL,
+	  bool *storedHostsChanged = NULL);
 
 protected:
 	static SetupInfo &getSetupInfo(void);
@@ -18,6 +18,8 @@
  */
 
 #include <memory>
+#include <algorithm>
+#include <iterator>
 #include <Mutex.h>
 #include "UnifiedDataStore.h"
 #include "DBAgentFactory.h"
@@ -29,6 +31,10 @@
 #include "ItemGroupStream.h"
 #include "DBClientJoinBuilder.h"
 #include "DBTermCStringProvider.h"
+#include "OverviewCounter.h"
+#include "HotEventRing.h"
+#include "ConfigManager.h"
+#include "Utils.h"
 
 // TODO: remove the follwoing include file after we complete migration of
 // host management with DBTablesHost.
@@ -60,6 +66,10 @@ const char *DBTablesMonitoring::TABLE_NAME_INCIDENTS  = "incidents";
 const int DBTablesMonitoring::MONITORING_DB_VERSION =
   DBTables::Version::getPackedVer(0, 1, 1);
 
+const size_t DBTablesMonitoring::EVENT_PARTITION_PREPARED_DAYS = 3;
+const guint DBTablesMonitoring::EVENT_PARTITION_ROTATION_INTERVAL_MSEC =
+  3600 * 1000; // 1hour
+
 void operator>>(ItemGroupStream &itemGroupStream, TriggerStatusType &rhs)
 {
 	rhs = itemGroupStream.read<int, TriggerStatusType>();
@@ -403,7 +413,8 @@ static const DBAgent::TableProfile tableProfileEvents =
   DBAGENT_TABLEPROFILE_INIT(DBTablesMonitoring::TABLE_NAME_EVENTS,
 			    COLUMN_DEF_EVENTS,
 			    NUM_IDX_EVENTS,
-			    indexDefsEvents);
+			    indexDefsEvents,
+			    IDX_EVENTS_TIME_SEC);
 
 // ----------------------------------------------------------------------------
 // Table: items
@@ -789,6 +800,12 @@ struct DBTablesMonitoring::Impl
 	}
 };
 
+struct rotateEventPartitionsContext {
+	guint timerId;
+	guint idleEventId;
+};
+static rotateEventPartitionsContext *g_rotateEventPartitionsCtx = NULL;
+
 // ---------------------------------------------------------------------------
 // EventInfo
 // ---------------------------------------------------------------------------
@@ -832,6 +849,12 @@ struct EventsQueryOption::Impl {
 	TriggerSeverityType minSeverity;
 	TriggerStatusType triggerStatus;
 	TriggerIdType triggerId;
+	bool hasCursor;
+	UnifiedEventIdType cursorUnifiedId;
+	timespec cursorTime;
+	CursorDirection cursorDirection;
+	time_t beginTime;
+	time_t endTime;
 
 	Impl()
 	: limitOfUnifiedId(NO_LIMIT),
@@ -839,8 +862,15 @@ struct EventsQueryOption::Impl {
 	  sortDirection(SORT_DONT_CARE),
 	  minSeverity(TRIGGER_SEVERITY_UNKNOWN),
 	  triggerStatus(TRIGGER_STATUS_ALL),
-	  triggerId(ALL_TRIGGERS)
+	  triggerId(ALL_TRIGGERS),
+	  hasCursor(false),
+	  cursorUnifiedId(0),
+	  cursorDirection(CURSOR_NEXT),
+	  beginTime(0),
+	  endTime(0)
 	{
+		cursorTime.tv_sec = 0;
+		cursorTime.tv_nsec = 0;
 	}
 };
 
@@ -914,6 +944,33 @@ string EventsQueryOption::getCondition(void) const
 			rhs(m_impl->triggerId));
 	}
 
+	// The condition on the partitioning column lets MySQL prune
+	// the partitions.
+	if (m_impl->beginTime) {
+		if (!condition.empty())
+			condition += " AND ";
+		condition += StringUtils::sprintf(
+			"%s>=%ld",
+			getColumnName(IDX_EVENTS_TIME_SEC).c_str(),
+			m_impl->beginTime);
+	}
+
+	if (m_impl->endTime) {
+		if (!condition.empty())
+			condition += " AND ";
+		condition += StringUtils::sprintf(
+			"%s<=%ld",
+			getColumnName(IDX_EVENTS_TIME_SEC).c_str(),
+			m_impl->endTime);
+	}
+
+	const string cursorCondition = makeCursorCondition();
+	if (!cursorCondition.empty()) {
+		if (!condition.empty())
+			condition += " AND ";
+		condition += cursorCondition;
+	}
+
 	return condition;
 }
 
@@ -932,8 +989,18 @@ void EventsQueryOption::setSortType(
 {
 	m_impl->sortType = type;
 	m_impl->sortDirection = direction;
+	applySortOrder();
+}
 
-	switch (type) {
+void EventsQueryOption::applySortOrder(void)
+{
+	SortDirection direction = m_impl->sortDirection;
+	if (isReversedByCursor()) {
+		direction = (direction == SORT_ASCENDING) ?
+		  SORT_DESCENDING : SORT_ASCENDING;
+	}
+
+	switch (m_impl->sortType) {
 	case SORT_UNIFIED_ID:
 	{
 		SortOrder order(
@@ -1006,6 +1073,105 @@ TriggerIdType EventsQueryOption::getTriggerId(void) const
 	return m_impl->triggerId;
 }
 
+void EventsQueryOption::setTimeRange(const time_t &beginTime,
+                                     const time_t &endTime)
+{
+	m_impl->beginTime = beginTime;
+	m_impl->endTime = endTime;
+}
+
+time_t EventsQueryOption::getBeginTime(void) const
+{
+	return m_impl->beginTime;
+}
+
+time_t EventsQueryOption::getEndTime(void) const
+{
+	return m_impl->endTime;
+}
+
+void EventsQueryOption::setCursor(const UnifiedEventIdType &unifiedId,
+                                  const timespec &time,
+                                  const CursorDirection &direction)
+{
+	m_impl->hasCursor = true;
+	m_impl->cursorUnifiedId = unifiedId;
+	m_impl->cursorTime = time;
+	m_impl->cursorDirection = direction;
+	applySortOrder();
+}
+
+void EventsQueryOption::clearCursor(void)
+{
+	m_impl->hasCursor = false;
+	applySortOrder();
+}
+
+bool EventsQueryOption::hasCursor(void) const
+{
+	return m_impl->hasCursor;
+}
+
+UnifiedEventIdType EventsQueryOption::getCursorUnifiedId(void) const
+{
+	return m_impl->cursorUnifiedId;
+}
+
+const timespec &EventsQueryOption::getCursorTime(void) const
+{
+	return m_impl->cursorTime;
+}
+
+EventsQueryOption::CursorDirection
+  EventsQueryOption::getCursorDirection(void) const
+{
+	return m_impl->cursorDirection;
+}
+
+bool EventsQueryOption::isReversedByCursor(void) const
+{
+	return m_impl->hasCursor &&
+	       m_impl->cursorDirection == CURSOR_PREV &&
+	       m_impl->sortDirection != SORT_DONT_CARE;
+}
+
+string EventsQueryOption::makeCursorCondition(void) const
+{
+	using StringUtils::sprintf;
+
+	if (!m_impl->hasCursor || m_impl->sortDirection == SORT_DONT_CARE)
+		return "";
+
+	// The matched events have greater keys when the cursor goes forward
+	// in the ascending order or backward in the descending order.
+	const bool greater =
+	  (m_impl->sortDirection == SORT_ASCENDING) ==
+	  (m_impl->cursorDirection == CURSOR_NEXT);
+	const char *op = greater ? ">" : "<";
+	const string unifiedIdColumn = getColumnName(IDX_EVENTS_UNIFIED_ID);
+
+	if (m_impl->sortType != SORT_TIME) {
+		return sprintf("%s%s%" FMT_UNIFIED_EVENT_ID,
+		               unifiedIdColumn.c_str(), op,
+		               m_impl->cursorUnifiedId);
+	}
+
+	// (time_sec, time_ns, unified_id) is compared with the cursor.
+	// The first term lets the DB use an index of time_sec.
+	const string secColumn = getColumnName(IDX_EVENTS_TIME_SEC);
+	const string nsColumn = getColumnName(IDX_EVENTS_TIME_NS);
+	const timespec &time = m_impl->cursorTime;
+	return sprintf(
+	  "%s%s=%ld AND (%s%s%ld OR (%s=%ld AND (%s%s%ld OR "
+	  "(%s=%ld AND %s%s%" FMT_UNIFIED_EVENT_ID "))))",
+	  secColumn.c_str(), op, (long)time.tv_sec,
+	  secColumn.c_str(), op, (long)time.tv_sec,
+	  secColumn.c_str(), (long)time.tv_sec,
+	  nsColumn.c_str(), op, (long)time.tv_nsec,
+	  nsColumn.c_str(), (long)time.tv_nsec,
+	  unifiedIdColumn.c_str(), op, m_impl->cursorUnifiedId);
+}
+
 //
 // TriggersQueryOption
 //
@@ -1321,9 +1487,25 @@ IncidentsQueryOption::IncidentsQueryOption(DataQueryContext *dataQueryContext)
 // ---------------------------------------------------------------------------
 // Public methods
 // ---------------------------------------------------------------------------
+void DBTablesMonitoring::init(void)
+{
+	g_rotateEventPartitionsCtx = new rotateEventPartitionsContext;
+	g_rotateEventPartitionsCtx->idleEventId = INVALID_EVENT_ID;
+	g_rotateEventPartitionsCtx->timerId =
+	  g_timeout_add(EVENT_PARTITION_ROTATION_INTERVAL_MSEC,
+	                rotateEventPartitionsCycl, g_rotateEventPartitionsCtx);
+}
+
 void DBTablesMonitoring::reset(void)
 {
 	getSetupInfo().initialized = false;
+	OverviewCounter::reset();
+	HotEventRing::reset();
+}
+
+void DBTablesMonitoring::stop(void)
+{
+	Utils::executeOnGLibEventLoop(stopRotateEventPartitions);
 }
 
 const DBTables::SetupInfo &DBTablesMonitoring::getConstSetupInfo(void)
@@ -1357,6 +1539,7 @@ void DBTablesMonitoring::addTriggerInfo(TriggerInfo *triggerInfo)
 		}
 	} trx(triggerInfo);
 	getDBAgent().runTransaction(trx);
+	OverviewCounter::getInstance()->addTriggerInfo(*triggerInfo);
 }
 
 void DBTablesMonitoring::addTriggerInfoList(const TriggerInfoList &triggerInfoList)
@@ -1378,6 +1561,7 @@ void DBTablesMonitoring::addTriggerInfoList(const TriggerInfoList &triggerInfoLi
 		}
 	} trx(triggerInfoList);
 	getDBAgent().runTransaction(trx);
+	OverviewCounter::getInstance()->addTriggerInfoList(triggerInfoList);
 }
 
 bool DBTablesMonitoring::getTriggerInfo(TriggerInfo &triggerInfo,
@@ -1437,7 +1621,7 @@ void DBTablesMonitoring::getTriggerInfoList(TriggerInfoList &triggerInfoList,
 	if (!arg.limit && arg.offset)
 		return;
 
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	// check the result and copy
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
@@ -1501,6 +1685,7 @@ void DBTablesMonitoring::setTriggerInfoList(
 		}
 	} trx(triggerInfoList, serverId);
 	getDBAgent().runTransaction(trx);
+	OverviewCounter::getInstance()->invalidate(serverId);
 }
 
 int DBTablesMonitoring::getLastChangeTimeOfTrigger(const ServerIdType &serverId)
@@ -1577,24 +1762,34 @@ void DBTablesMonitoring::addEventInfo(EventInfo *eventInfo)
 {
 	struct TrxProc : public DBAgent::TransactionProc {
 		EventInfo *eventInfo;
+		bool       updated;
 
 		TrxProc(EventInfo *_eventInfo)
-		: eventInfo(_eventInfo)
+		: eventInfo(_eventInfo),
+		  updated(false)
 		{
 		}
 
 		void operator ()(DBAgent &dbAgent) override
 		{
 			addEventInfoWithoutTransaction(dbAgent, *eventInfo);
+			updated = dbAgent.lastUpsertDidUpdate();
 		}
 	} trx(eventInfo);
 	getDBAgent().runTransaction(trx);
+
+	HotEventRing *hotEventRing = HotEventRing::getInstance();
+	if (trx.updated)
+		hotEventRing->invalidate(eventInfo->serverId);
+	else
+		hotEventRing->addEventInfo(*eventInfo);
 }
 
 void DBTablesMonitoring::addEventInfoList(EventInfoList &eventInfoList)
 {
 	struct TrxProc : public DBAgent::TransactionProc {
 		EventInfoList &eventInfoList;
+		ServerIdSet    updatedServerIdSet;
 
 		TrxProc(EventInfoList &_eventInfoList)
 		: eventInfoList(_eventInfoList)
@@ -1604,11 +1799,22 @@ void DBTablesMonitoring::addEventInfoList(EventInfoList &eventInfoList)
 		void operator ()(DBAgent &dbAgent) override
 		{
 			EventInfoListIterator it = eventInfoList.begin();
-			for (; it != eventInfoList.end(); ++it)
+			for (; it != eventInfoList.end(); ++it) {
 				addEventInfoWithoutTransaction(dbAgent, *it);
+				if (dbAgent.lastUpsertDidUpdate())
+					updatedServerIdSet.insert(it->serverId);
+			}
 		}
 	} trx(eventInfoList);
 	getDBAgent().runTransaction(trx);
+
+	// The unified ID of an updated event may not be reported. So the ring
+	// of its server is reloaded.
+	HotEventRing *hotEventRing = HotEventRing::getInstance();
+	ServerIdSetConstIterator it = trx.updatedServerIdSet.begin();
+	for (; it != trx.updatedServerIdSet.end(); ++it)
+		hotEventRing->invalidate(*it);
+	hotEventRing->addEventInfoList(eventInfoList);
 }
 
 HatoholError DBTablesMonitoring::getEventInfoList(
@@ -1669,9 +1875,12 @@ HatoholError DBTablesMonitoring::getEventInfoList(
 	if (!arg.limit && arg.offset)
 		return HTERR_OFFSET_WITHOUT_LIMIT;
 
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	// check the result and copy
+	const size_t numOrigEvents = eventInfoList.size();
+	const size_t numOrigIncidents =
+	  incidentInfoVect ? incidentInfoVect->size() : 0;
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
 	for (; itemGrpItr != grpList.end(); ++itemGrpItr) {
@@ -1720,6 +1929,17 @@ HatoholError DBTablesMonitoring::getEventInfoList(
 			incidentInfo.unifiedEventId = eventInfo.unifiedId;
 		}
 	}
+
+	// Restore the requested order
+	if (option.isReversedByCursor()) {
+		EventInfoListIterator eventItr = eventInfoList.begin();
+		advance(eventItr, numOrigEvents);
+		reverse(eventItr, eventInfoList.end());
+		if (incidentInfoVect) {
+			reverse(incidentInfoVect->begin() + numOrigIncidents,
+			        incidentInfoVect->end());
+		}
+	}
 	return HatoholError(HTERR_OK);
 }
 
@@ -1837,6 +2057,7 @@ void DBTablesMonitoring::addItemInfo(ItemInfo *itemInfo)
 		}
 	} trx(itemInfo);
 	getDBAgent().runTransaction(trx);
+	OverviewCounter::getInstance()->addItemInfo(*itemInfo);
 }
 
 void DBTablesMonitoring::addItemInfoList(const ItemInfoList &itemInfoList)
@@ -1857,6 +2078,7 @@ void DBTablesMonitoring::addItemInfoList(const ItemInfoList &itemInfoList)
 		}
 	} trx(itemInfoList);
 	getDBAgent().runTransaction(trx);
+	OverviewCounter::getInstance()->addItemInfoList(itemInfoList);
 }
 
 void DBTablesMonitoring::getItemInfoList(ItemInfoList &itemInfoList,
@@ -1901,7 +2123,7 @@ void DBTablesMonitoring::getItemInfoList(ItemInfoList &itemInfoList,
 	// Application Name
 	arg.appName = option.getAppName();
 
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	// check the result and copy
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
@@ -1989,6 +2211,62 @@ void DBTablesMonitoring::addMonitoringServerStatus(
 	getDBAgent().runTransaction(trx);
 }
 
+void DBTablesMonitoring::addMonitoringData(
+  EventInfoList &eventInfoList, const ItemInfoList &itemInfoList,
+  const MonitoringServerStatusList &serverStatusList)
+{
+	struct TrxProc : public DBAgent::TransactionProc {
+		EventInfoList                    &eventInfoList;
+		const ItemInfoList               &itemInfoList;
+		const MonitoringServerStatusList &serverStatusList;
+		ServerIdSet                       updatedServerIdSet;
+
+		TrxProc(EventInfoList &_eventInfoList,
+		        const ItemInfoList &_itemInfoList,
+		        const MonitoringServerStatusList &_serverStatusList)
+		: eventInfoList(_eventInfoList),
+		  itemInfoList(_itemInfoList),
+		  serverStatusList(_serverStatusList)
+		{
+		}
+
+		void operator ()(DBAgent &dbAgent) override
+		{
+			EventInfoListIterator eventIt = eventInfoList.begin();
+			for (; eventIt != eventInfoList.end(); ++eventIt) {
+				addEventInfoWithoutTransaction(dbAgent,
+				                               *eventIt);
+				if (dbAgent.lastUpsertDidUpdate()) {
+					updatedServerIdSet.insert(
+					  eventIt->serverId);
+				}
+			}
+
+			ItemInfoListConstIterator itemIt = itemInfoList.begin();
+			for (; itemIt != itemInfoList.end(); ++itemIt)
+				addItemInfoWithoutTransaction(dbAgent, *itemIt);
+
+			MonitoringServerStatusListConstIterator statusIt =
+			  serverStatusList.begin();
+			for (; statusIt != serverStatusList.end(); ++statusIt) {
+				addMonitoringServerStatusWithoutTransaction(
+				  dbAgent, *statusIt);
+			}
+		}
+	} trx(eventInfoList, itemInfoList, serverStatusList);
+	getDBAgent().runTransaction(trx);
+
+	if (!eventInfoList.empty()) {
+		HotEventRing *hotEventRing = HotEventRing::getInstance();
+		ServerIdSetConstIterator it = trx.updatedServerIdSet.begin();
+		for (; it != trx.updatedServerIdSet.end(); ++it)
+			hotEventRing->invalidate(*it);
+		hotEventRing->addEventInfoList(eventInfoList);
+	}
+	if (!itemInfoList.empty())
+		OverviewCounter::getInstance()->addItemInfoList(itemInfoList);
+}
+
 size_t DBTablesMonitoring::getNumberOfTriggers(
   const TriggersQueryOption &option, const std::string &additionalCondition)
 {
@@ -2310,6 +2588,25 @@ uint64_t DBTablesMonitoring::getLastUpdateTimeOfIncidents(
 	return itemGroupStream.read<uint64_t>();
 }
 
+void DBTablesMonitoring::rotateEventPartitions(const time_t &now)
+{
+	DBAgent &dbAgent = getDBAgent();
+	dbAgent.addTimePartitions(
+	  tableProfileEvents,
+	  now + DBAgent::TIME_PARTITION_SEC * EVENT_PARTITION_PREPARED_DAYS);
+
+	const int retentionDays =
+	  ConfigManager::getInstance()->getEventRetentionDays();
+	if (retentionDays <= 0)
+		return;
+	const bool purged = dbAgent.purgeOldRows(
+	  tableProfileEvents,
+	  now - DBAgent::TIME_PARTITION_SEC * retentionDays);
+	// The rings may hold the purged events.
+	if (purged)
+		HotEventRing::getInstance()->invalidateAll();
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -2440,6 +2737,45 @@ void DBTablesMonitoring::addIncidentInfoWithoutTransaction(
 	dbAgent.insert(arg);
 }
 
+gboolean DBTablesMonitoring::rotateEventPartitionsExec(gpointer data)
+{
+	struct : public ExceptionCatchable {
+		void operator ()(void) override
+		{
+			ThreadLocalDBCache cache;
+			cache.getMonitoring().rotateEventPartitions(time(NULL));
+		}
+	} rotator;
+	rotator.exec();
+
+	rotateEventPartitionsContext *ctx =
+	  static_cast<rotateEventPartitionsContext *>(data);
+	ctx->idleEventId = INVALID_EVENT_ID;
+	ctx->timerId = g_timeout_add(EVENT_PARTITION_ROTATION_INTERVAL_MSEC,
+	                             rotateEventPartitionsCycl, ctx);
+	return G_SOURCE_REMOVE;
+}
+
+gboolean DBTablesMonitoring::rotateEventPartitionsCycl(gpointer data)
+{
+	rotateEventPartitionsContext *ctx =
+	  static_cast<rotateEventPartitionsContext *>(data);
+	ctx->timerId = INVALID_EVENT_ID;
+	ctx->idleEventId = Utils::setGLibIdleEvent(rotateEventPartitionsExec,
+	                                           ctx);
+	return G_SOURCE_REMOVE;
+}
+
+void DBTablesMonitoring::stopRotateEventPartitions(gpointer data)
+{
+	if (!g_rotateEventPartitionsCtx)
+		return;
+	if (g_rotateEventPartitionsCtx->timerId != INVALID_EVENT_ID)
+		g_source_remove(g_rotateEventPartitionsCtx->timerId);
+	if (g_rotateEventPartitionsCtx->idleEventId != INVALID_EVENT_ID)
+		g_source_remove(g_rotateEventPartitionsCtx->idleEventId);
+}
+
 static bool updateDB(
   DBAgent &dbAgent, const DBTables::Version &oldPackedVer, void *data)
 {
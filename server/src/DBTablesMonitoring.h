@@ -60,7 +60,56 @@ public:
 	void setTriggerId(const TriggerIdType &triggerId);
 	TriggerIdType getTriggerId(void) const;
 
+	/**
+	 * Limit the events to those in a time range. On MySQL, the partitions
+	 * out of the range are not scanned with it.
+	 *
+	 * @param beginTime The begin time. 0 means no limit.
+	 * @param endTime The end time. 0 means no limit.
+	 */
+	void setTimeRange(const time_t &beginTime, const time_t &endTime);
+	time_t getBeginTime(void) const;
+	time_t getEndTime(void) const;
+
+	enum CursorDirection {
+		CURSOR_NEXT,
+		CURSOR_PREV,
+	};
+
+	/**
+	 * Set a keyset cursor that points an event.
+	 *
+	 * With CURSOR_NEXT, only the events after the pointed one in
+	 * the sort order are matched. With CURSOR_PREV, only the events
+	 * before it are matched. In that case, the statement is sorted in
+	 * the reverse order to get the nearest ones and
+	 * DBTablesMonitoring::getEventInfoList() returns them in the original
+	 * order. The cursor is ignored when the sort direction is
+	 * SORT_DONT_CARE.
+	 *
+	 * @param unifiedId The unified ID of the event.
+	 * @param time The time of the event.
+	 * @param direction A direction.
+	 */
+	void setCursor(const UnifiedEventIdType &unifiedId,
+	               const timespec &time,
+	               const CursorDirection &direction = CURSOR_NEXT);
+	void clearCursor(void);
+	bool hasCursor(void) const;
+	UnifiedEventIdType getCursorUnifiedId(void) const;
+	const timespec &getCursorTime(void) const;
+	CursorDirection getCursorDirection(void) const;
+
+	/**
+	 * @return true if the statement is sorted in the reverse order of
+	 * getSortDirection() because of a cursor.
+	 */
+	bool isReversedByCursor(void) const;
+
 private:
+	void applySortOrder(void);
+	std::string makeCursorCondition(void) const;
+
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
 };
@@ -118,7 +167,11 @@ public:
 class DBTablesMonitoring : public DBTables {
 public:
 	static const int         MONITORING_DB_VERSION;
+	static const size_t      EVENT_PARTITION_PREPARED_DAYS;
+	static const guint       EVENT_PARTITION_ROTATION_INTERVAL_MSEC;
+	static void init(void);
 	static void reset(void);
+	static void stop(void);
 	static const SetupInfo &getConstSetupInfo(void);
 
 	static const char *TABLE_NAME_TRIGGERS;
@@ -204,6 +257,19 @@ public:
 	void addMonitoringServerStatus(
 	  const MonitoringServerStatus &serverStatus);
 
+	/**
+	 * Add events, items and the status of monitoring servers with one
+	 * transaction. Nothing is added when it fails. The caches are
+	 * updated after the commit as addEventInfoList() and
+	 * addItemInfoList() do.
+	 *
+	 * @param eventInfoList
+	 * The events to be added. The unified IDs are set to them.
+	 */
+	void addMonitoringData(
+	  EventInfoList &eventInfoList, const ItemInfoList &itemInfoList,
+	  const MonitoringServerStatusList &serverStatusList);
+
 	/**
 	 * get the number of triggers with the given server ID, host group ID,
 	 * the severity. The triggers with status: TRIGGER_STATUS_OK is NOT
@@ -283,6 +349,18 @@ protected:
 	size_t getNumberOfTriggers(const TriggersQueryOption &option,
 				   const std::string &additionalCondition);
 
+	/**
+	 * Prepare the event partitions for the next days and drop the events
+	 * older than ConfigManager::getEventRetentionDays().
+	 *
+	 * @param now The current time.
+	 */
+	void rotateEventPartitions(const time_t &now);
+
+	static gboolean rotateEventPartitionsCycl(gpointer data);
+	static gboolean rotateEventPartitionsExec(gpointer data);
+	static void stopRotateEventPartitions(gpointer data);
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
@@ -23,6 +23,8 @@
 #include "ItemGroupStream.h"
 #include "DBHatohol.h"
 #include "DBTermCStringProvider.h"
+#include "UserPrivilegeCache.h"
+#include "ActionRuleIndex.h"
 using namespace std;
 using namespace mlpl;
 
@@ -474,6 +476,7 @@ void DBTablesUser::init(void)
 void DBTablesUser::reset(void)
 {
 	getSetupInfo().initialized = false;
+	UserPrivilegeCache::reset();
 }
 
 const DBTables::SetupInfo &DBTablesUser::getConstSetupInfo(void)
@@ -550,6 +553,9 @@ HatoholError DBTablesUser::addUserInfo(
 		}
 	} trx(userInfo);
 	getDBAgent().runTransaction(trx);
+	// The actions of a user are valid only when the user exists.
+	if (trx.err == HTERR_OK)
+		ActionRuleIndex::getInstance()->invalidate();
 	return trx.err;
 }
 
@@ -643,6 +649,8 @@ HatoholError DBTablesUser::updateUserInfo(
 		}
 	} trx(userInfo);
 	getDBAgent().runTransaction(trx);
+	if (trx.err == HTERR_OK)
+		UserPrivilegeCache::getInstance()->invalidate(userInfo.id);
 	return trx.err;
 }
 
@@ -718,6 +726,8 @@ HatoholError DBTablesUser::deleteUserInfo(
 		}
 	} trx(userId);
 	getDBAgent().runTransaction(trx);
+	UserPrivilegeCache::getInstance()->invalidate(userId);
+	ActionRuleIndex::getInstance()->invalidate();
 	return HTERR_OK;
 }
 
@@ -792,6 +802,7 @@ HatoholError DBTablesUser::addAccessInfo(AccessInfo &accessInfo,
 	arg.add(accessInfo.hostgroupId);
 
 	getDBAgent().runTransaction(arg, &accessInfo.id);
+	UserPrivilegeCache::getInstance()->invalidate(accessInfo.userId);
 	return HTERR_OK;
 }
 
@@ -806,6 +817,8 @@ HatoholError DBTablesUser::deleteAccessInfo(const AccessInfoIdType id,
 	arg.condition = StringUtils::sprintf("%s=%" FMT_ACCESS_INFO_ID,
 	                                     colId.columnName, id);
 	getDBAgent().runTransaction(arg);
+	// We don't know the owner of the deleted element here.
+	UserPrivilegeCache::getInstance()->invalidateAll();
 	return HTERR_OK;
 }
 
@@ -1097,7 +1110,7 @@ void DBTablesUser::getUserRoleInfoList(UserRoleInfoList &userRoleInfoList,
 	arg.add(IDX_USER_ROLES_FLAGS);
 	arg.condition = option.getCondition();
 
-	getDBAgent().runTransaction(arg);
+	runReadTransaction(arg, option);
 
 	const ItemGroupList &grpList = arg.dataTable->getItemGroupList();
 	ItemGroupListConstIterator itemGrpItr = grpList.begin();
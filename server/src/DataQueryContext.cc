@@ -19,17 +19,21 @@
 
 #include <cstdio>
 #include "DataQueryContext.h"
-#include "ThreadLocalDBCache.h"
+#include "UserPrivilegeCache.h"
+
+using namespace std;
 
 struct DataQueryContext::Impl {
 	OperationPrivilege   privilege;
 	ServerHostGrpSetMap *srvHostGrpSetMap;
 	ServerIdSet         *serverIdSet;
+	UserPrivilegeCache::Generation cacheGeneration;
 
 	Impl(const UserIdType &userId)
 	: privilege(userId),
 	  srvHostGrpSetMap(NULL),
-	  serverIdSet(NULL)
+	  serverIdSet(NULL),
+	  cacheGeneration(0)
 	{
 	}
 
@@ -81,10 +85,9 @@ const ServerHostGrpSetMap &DataQueryContext::getServerHostGrpSetMap(void)
 {
 	if (!m_impl->srvHostGrpSetMap) {
 		m_impl->srvHostGrpSetMap = new ServerHostGrpSetMap();
-		ThreadLocalDBCache cache;
-		DBTablesUser &dbUser = cache.getUser();
-		dbUser.getServerHostGrpSetMap(*m_impl->srvHostGrpSetMap,
-		                              m_impl->privilege.getUserId());
+		UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+		m_impl->cacheGeneration = cache->getServerHostGrpSetMap(
+		  *m_impl->srvHostGrpSetMap, m_impl->privilege.getUserId());
 	}
 	return *m_impl->srvHostGrpSetMap;
 }
@@ -99,10 +102,30 @@ const ServerIdSet &DataQueryContext::getValidServerIdSet(void)
 {
 	if (!m_impl->serverIdSet) {
 		m_impl->serverIdSet = new ServerIdSet();
-		ThreadLocalDBCache cache;
-		DBTablesConfig &dbConfig = cache.getConfig();
-		dbConfig.getServerIdSet(*m_impl->serverIdSet, this);
+		UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+		cache->getValidServerIdSet(*m_impl->serverIdSet, this);
 	}
 	return *m_impl->serverIdSet;
 }
 
+bool DataQueryContext::getCachedCondition(string &condition,
+                                          const string &key)
+{
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	return cache->getCondition(condition,
+	                           m_impl->privilege.getUserId(), key);
+}
+
+void DataQueryContext::cacheCondition(const string &key,
+                                      const string &condition)
+{
+	// The condition is supposed to be made from the result of
+	// getServerHostGrpSetMap(). Its generation is used to reject
+	// the condition made from stale information.
+	if (!m_impl->srvHostGrpSetMap)
+		return;
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	cache->setCondition(m_impl->privilege.getUserId(),
+	                    m_impl->cacheGeneration, key, condition);
+}
+
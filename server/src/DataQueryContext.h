@@ -40,6 +40,27 @@ public:
 	bool isValidServer(const ServerIdType &serverId);
 	const ServerIdSet &getValidServerIdSet(void);
 
+	/**
+	 * Get an SQL condition fragment cached in UserPrivilegeCache.
+	 *
+	 * @param condition The obtained condition is stored in this.
+	 * @param key A key that identifies the fragment.
+	 *
+	 * @return true if the fragment is found. Otherwise false.
+	 */
+	bool getCachedCondition(std::string &condition,
+	                        const std::string &key);
+
+	/**
+	 * Store an SQL condition fragment made from the result of
+	 * getServerHostGrpSetMap() to UserPrivilegeCache.
+	 *
+	 * @param key A key that identifies the fragment.
+	 * @param condition A condition to be stored.
+	 */
+	void cacheCondition(const std::string &key,
+	                    const std::string &condition);
+
 protected:
 	// To avoid an instance from being crated on a stack.
 	virtual ~DataQueryContext();
@@ -34,6 +34,7 @@ struct DataQueryOption::Impl {
 	DataQueryContextPtr dataQueryCtxPtr; // The body is shared
 	const DBTermCodec *dbTermCodec;
 	bool               tableNameAlways;
+	bool               staleDataAllowed;
 
 	// constuctor
 	Impl(const UserIdType &userId)
@@ -41,7 +42,8 @@ struct DataQueryOption::Impl {
 	  offset(0),
 	  dataQueryCtxPtr(new DataQueryContext(userId), false),
 	  dbTermCodec(NULL),
-	  tableNameAlways(false)
+	  tableNameAlways(false),
+	  staleDataAllowed(false)
 	{
 	}
 
@@ -50,7 +52,8 @@ struct DataQueryOption::Impl {
 	  offset(0),
 	  dataQueryCtxPtr(dataQueryContext),
 	  dbTermCodec(NULL),
-	  tableNameAlways(false)
+	  tableNameAlways(false),
+	  staleDataAllowed(false)
 	{
 	}
 
@@ -227,6 +230,16 @@ bool DataQueryOption::getTableNameAlways(void) const
 	return m_impl->tableNameAlways;
 }
 
+void DataQueryOption::setStaleDataAllowed(const bool &allow)
+{
+	m_impl->staleDataAllowed = allow;
+}
+
+bool DataQueryOption::getStaleDataAllowed(void) const
+{
+	return m_impl->staleDataAllowed;
+}
+
 void DataQueryOption::setOffset(size_t offset)
 {
 	m_impl->offset = offset;
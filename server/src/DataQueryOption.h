@@ -162,6 +162,23 @@ public:
 	 */
 	bool getTableNameAlways(void) const;
 
+	/**
+	 * Allow the query to be served by a replica of the DB, whose
+	 * content can be a few seconds old. It is disabled by default
+	 * so that privileges, caches and data used for updates are read
+	 * from the primary. See DBAgent::selectOnReadAgent().
+	 *
+	 * @param allow A flag to allow it.
+	 */
+	void setStaleDataAllowed(const bool &allow = true);
+
+	/**
+	 * Get the flag to allow the query to be served by a replica.
+	 *
+	 * @return true if it is allowed. Otherwise false.
+	 */
+	bool getStaleDataAllowed(void) const;
+
 protected:
 	enum AddConditionType {
 		ADD_TYPE_AND,
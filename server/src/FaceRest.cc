@@ -47,6 +47,7 @@
 #include "RestResourceServer.h"
 #include "RestResourceUser.h"
 #include "ConfigManager.h"
+#include "HatoholTracePoint.h"
 
 using namespace std;
 using namespace mlpl;
@@ -213,9 +214,11 @@ protected:
 		ResourceHandler *job;
 		MLPL_INFO("start face-rest worker\n");
 		while ((job = waitNextJob())) {
+			MLPL_TRACE(TRACE_FACE_REST_JOB, MLPL_TRACE_PHASE_BEGIN);
 			job->handleInTryBlock();
 			job->unpauseResponse();
 			job->unref();
+			MLPL_TRACE(TRACE_FACE_REST_JOB, MLPL_TRACE_PHASE_END);
 		}
 		MLPL_INFO("exited face-rest worker\n");
 		return NULL;
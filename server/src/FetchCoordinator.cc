@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <semaphore.h>
+#include <cmath>
+#include <map>
+#include <Mutex.h>
+#include <Reaper.h>
+#include <SmartTime.h>
+#include "FetchCoordinator.h"
+#include "ConfigManager.h"
+#include "HatoholException.h"
+#include "UnifiedDataStore.h"
+
+using namespace std;
+using namespace mlpl;
+
+const size_t FetchCoordinator::MIN_RUNNING_FETCHERS = 4;
+const size_t FetchCoordinator::MAX_RUNNING_FETCHERS = 32;
+const double FetchCoordinator::TARGET_ROUND_MSEC = 2000;
+const double FetchCoordinator::DEFAULT_LATENCY_MSEC = 1000;
+
+// The weight of a new sample in the moving average of the latency
+static const double LATENCY_SMOOTHING_FACTOR = 0.3;
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct FetchRequest {
+	Closure0 *closure;
+	size_t    numPendingServers;
+
+	FetchRequest(Closure0 *_closure)
+	: closure(_closure),
+	  numPendingServers(0)
+	{
+	}
+
+	virtual ~FetchRequest()
+	{
+		delete closure;
+	}
+
+	void complete(void)
+	{
+		if (closure)
+			(*closure)();
+		delete this;
+	}
+};
+
+typedef vector<FetchRequest *>            FetchRequestVect;
+typedef FetchRequestVect::iterator        FetchRequestVectIterator;
+
+struct ServerFetchState {
+	bool             inFlight; // queued or running
+	uint64_t         fetchId;  // identifies the in-flight fetch
+	SmartTime        startTime;
+	SmartTime        lastFetchedTime;
+	double           latencyMSec; // 0 means unknown.
+	FetchRequestVect waiters;
+
+	ServerFetchState(void)
+	: inFlight(false),
+	  fetchId(0),
+	  latencyMSec(0)
+	{
+	}
+
+	double getExpectedLatencyMSec(void) const
+	{
+		return latencyMSec > 0 ?
+		  latencyMSec : FetchCoordinator::DEFAULT_LATENCY_MSEC;
+	}
+
+	bool isFresh(const SmartTime &now, const int &stalenessSec) const
+	{
+		if (!lastFetchedTime.hasValidTime())
+			return false;
+		SmartTime elapsed(now);
+		elapsed -= lastFetchedTime;
+		return elapsed.getAsSec() < stalenessSec;
+	}
+
+	void updateLatency(const SmartTime &now)
+	{
+		SmartTime elapsed(now);
+		elapsed -= startTime;
+		const double sample = elapsed.getAsMSec();
+		if (latencyMSec <= 0) {
+			latencyMSec = sample;
+			return;
+		}
+		latencyMSec += LATENCY_SMOOTHING_FACTOR * (sample - latencyMSec);
+	}
+};
+
+typedef map<ServerIdType, ServerFetchState> ServerFetchStateMap;
+typedef ServerFetchStateMap::iterator       ServerFetchStateMapIterator;
+typedef ServerFetchStateMap::const_iterator ServerFetchStateMapConstIterator;
+
+struct FetchClosure : public ClosureTemplate0<FetchCoordinator>
+{
+	DataStore    *dataStore;
+	ServerIdType  serverId;
+	uint64_t      fetchId;
+	callback      abortedFunc;
+	bool          called;
+
+	FetchClosure(FetchCoordinator *coordinator, callback func,
+	             callback _abortedFunc, DataStore *_dataStore,
+	             const uint64_t &_fetchId)
+	: ClosureTemplate0<FetchCoordinator>(coordinator, func),
+	  dataStore(_dataStore),
+	  serverId(_dataStore->getMonitoringServerInfo().id),
+	  fetchId(_fetchId),
+	  abortedFunc(_abortedFunc),
+	  called(false)
+	{
+	}
+
+	virtual ~FetchClosure()
+	{
+		// A DataStore deletes the closure without calling it
+		// when the fetch fails.
+		if (!called)
+			(m_receiver->*abortedFunc)(this);
+		dataStore->unref();
+	}
+
+	virtual void operator()(void) override
+	{
+		called = true;
+		ClosureTemplate0<FetchCoordinator>::operator()();
+	}
+};
+
+struct FetchCoordinator::Impl
+{
+	mutable Mutex       lock;
+	ServerFetchStateMap stateMap;
+	DataStoreVector     fetchersQueue;
+	size_t              numRunningFetchers;
+
+	Impl(void)
+	: numRunningFetchers(0)
+	{
+	}
+
+	// The following methods shall be called with lock.
+
+	// By Little's law, the number of fetchers that finish the queued
+	// and the running fetches in TARGET_ROUND_MSEC is the sum of their
+	// latencies divided by it.
+	size_t calcMaxRunningFetchers(void) const
+	{
+		double totalLatencyMSec = 0;
+		ServerFetchStateMapConstIterator it = stateMap.begin();
+		for (; it != stateMap.end(); ++it) {
+			const ServerFetchState &state = it->second;
+			if (state.inFlight) {
+				totalLatencyMSec +=
+				  state.getExpectedLatencyMSec();
+			}
+		}
+		const size_t numFetchers =
+		  ceil(totalLatencyMSec / TARGET_ROUND_MSEC);
+		if (numFetchers < MIN_RUNNING_FETCHERS)
+			return MIN_RUNNING_FETCHERS;
+		if (numFetchers > MAX_RUNNING_FETCHERS)
+			return MAX_RUNNING_FETCHERS;
+		return numFetchers;
+	}
+
+	void dequeueFetchers(DataStoreVector &dataStores)
+	{
+		const size_t maxRunningFetchers = calcMaxRunningFetchers();
+		const SmartTime now(SmartTime::INIT_CURR_TIME);
+		while (!fetchersQueue.empty() &&
+		       numRunningFetchers < maxRunningFetchers) {
+			DataStore *dataStore = fetchersQueue.front();
+			fetchersQueue.erase(fetchersQueue.begin());
+			const ServerIdType &serverId =
+			  dataStore->getMonitoringServerInfo().id;
+			stateMap[serverId].startTime = now;
+			dataStores.push_back(dataStore);
+			numRunningFetchers++;
+		}
+	}
+
+	uint64_t getFetchId(const ServerIdType &serverId)
+	{
+		return stateMap[serverId].fetchId;
+	}
+
+	// A fetch that has already been finished is ignored.
+	void finishFetch(FetchRequestVect &completedRequests,
+	                 const ServerIdType &serverId, const uint64_t &fetchId,
+	                 const bool &succeeded)
+	{
+		ServerFetchState &state = stateMap[serverId];
+		if (!state.inFlight || state.fetchId != fetchId)
+			return;
+		if (succeeded) {
+			const SmartTime now(SmartTime::INIT_CURR_TIME);
+			state.updateLatency(now);
+			state.lastFetchedTime = now;
+		}
+		state.inFlight = false;
+		numRunningFetchers--;
+
+		FetchRequestVectIterator it = state.waiters.begin();
+		for (; it != state.waiters.end(); ++it) {
+			FetchRequest *request = *it;
+			request->numPendingServers--;
+			if (request->numPendingServers == 0)
+				completedRequests.push_back(request);
+		}
+		state.waiters.clear();
+	}
+};
+
+static void completeRequests(const FetchRequestVect &requests)
+{
+	for (size_t i = 0; i < requests.size(); i++)
+		requests[i]->complete();
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+FetchCoordinator::FetchCoordinator(void)
+: m_impl(new Impl())
+{
+}
+
+FetchCoordinator::~FetchCoordinator()
+{
+}
+
+bool FetchCoordinator::start(
+  const ServerIdType &targetServerId, Closure0 *closure)
+{
+	DataStoreVector allDataStores = getDataStoreVector();
+	const int stalenessSec =
+	  ConfigManager::getInstance()->getFetchStalenessSec();
+	const SmartTime now(SmartTime::INIT_CURR_TIME);
+	FetchRequest *request = new FetchRequest(closure);
+	DataStoreVector dataStoresToRun;
+
+	m_impl->lock.lock();
+	for (size_t i = 0; i < allDataStores.size(); i++) {
+		DataStore *dataStore = allDataStores[i];
+		const ServerIdType &serverId =
+		  dataStore->getMonitoringServerInfo().id;
+
+		bool shouldFetch = true;
+		if (targetServerId != ALL_SERVERS &&
+		    targetServerId != serverId)
+			shouldFetch = false;
+		else if (!isFetchSupported(dataStore))
+			shouldFetch = false;
+		if (!shouldFetch) {
+			dataStore->unref();
+			continue;
+		}
+
+		ServerFetchState &state = m_impl->stateMap[serverId];
+		if (state.inFlight) {
+			// Join the in-flight fetch.
+			state.waiters.push_back(request);
+			request->numPendingServers++;
+			dataStore->unref();
+			continue;
+		}
+		if (state.isFresh(now, stalenessSec)) {
+			dataStore->unref();
+			continue;
+		}
+		state.inFlight = true;
+		state.fetchId++;
+		state.waiters.push_back(request);
+		request->numPendingServers++;
+		m_impl->fetchersQueue.push_back(dataStore);
+	}
+	const bool started = request->numPendingServers > 0;
+	m_impl->dequeueFetchers(dataStoresToRun);
+	m_impl->lock.unlock();
+
+	if (!started) {
+		// The closure is not taken.
+		request->closure = NULL;
+		delete request;
+	}
+	runFetchers(dataStoresToRun);
+	return started;
+}
+
+void FetchCoordinator::fetch(const ServerIdType &targetServerId)
+{
+	struct SyncClosure : public Closure0 {
+		sem_t &semaphore;
+
+		SyncClosure(sem_t &_semaphore)
+		: semaphore(_semaphore)
+		{
+		}
+
+		virtual void operator()(void) override
+		{
+			if (sem_post(&semaphore) == -1)
+				MLPL_ERR("Failed to call sem_post: %d\n", errno);
+		}
+	};
+
+	sem_t semaphore;
+	sem_init(&semaphore, 0, 0);
+	SyncClosure *closure = new SyncClosure(semaphore);
+	if (start(targetServerId, closure)) {
+		if (sem_wait(&semaphore) == -1)
+			MLPL_ERR("Failed to call sem_wait: %d\n", errno);
+	} else {
+		delete closure;
+	}
+	sem_destroy(&semaphore);
+}
+
+size_t FetchCoordinator::getMaxRunningFetchers(void) const
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	return m_impl->calcMaxRunningFetchers();
+}
+
+double FetchCoordinator::getLatencyMSec(const ServerIdType &serverId) const
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	ServerFetchStateMapConstIterator it = m_impl->stateMap.find(serverId);
+	if (it == m_impl->stateMap.end())
+		return 0;
+	return it->second.latencyMSec;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+DataStoreVector FetchCoordinator::getDataStoreVector(void)
+{
+	return UnifiedDataStore::getInstance()->getDataStoreVector();
+}
+
+void FetchCoordinator::fetchedCallback(Closure0 *closure)
+{
+	FetchClosure *fetchClosure = dynamic_cast<FetchClosure *>(closure);
+	HATOHOL_ASSERT(fetchClosure, "Unexpected closure: %p", closure);
+	finishFetch(fetchClosure->serverId, fetchClosure->fetchId, true);
+}
+
+void FetchCoordinator::fetchAbortedCallback(Closure0 *closure)
+{
+	FetchClosure *fetchClosure = dynamic_cast<FetchClosure *>(closure);
+	HATOHOL_ASSERT(fetchClosure, "Unexpected closure: %p", closure);
+	finishFetch(fetchClosure->serverId, fetchClosure->fetchId, false);
+}
+
+// ---------------------------------------------------------------------------
+// Private methods
+// ---------------------------------------------------------------------------
+void FetchCoordinator::runFetchers(const DataStoreVector &dataStores)
+{
+	for (size_t i = 0; i < dataStores.size(); i++) {
+		DataStore *dataStore = dataStores[i];
+		const ServerIdType serverId =
+		  dataStore->getMonitoringServerInfo().id;
+		m_impl->lock.lock();
+		const uint64_t fetchId = m_impl->getFetchId(serverId);
+		m_impl->lock.unlock();
+		FetchClosure *closure = new FetchClosure(
+		  this, &FetchCoordinator::fetchedCallback,
+		  &FetchCoordinator::fetchAbortedCallback, dataStore, fetchId);
+		if (startFetch(dataStore, closure))
+			continue;
+
+		// The closure may be held by the DataStore even on failure.
+		// So it is not deleted here. Its later call or deletion is
+		// ignored because the fetch has been finished by its ID.
+		finishFetch(serverId, fetchId, false);
+	}
+}
+
+void FetchCoordinator::finishFetch(const ServerIdType &serverId,
+                                   const uint64_t &fetchId,
+                                   const bool &succeeded)
+{
+	FetchRequestVect completedRequests;
+	DataStoreVector dataStoresToRun;
+	m_impl->lock.lock();
+	m_impl->finishFetch(completedRequests, serverId, fetchId, succeeded);
+	m_impl->dequeueFetchers(dataStoresToRun);
+	m_impl->lock.unlock();
+
+	runFetchers(dataStoresToRun);
+	completeRequests(completedRequests);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FetchCoordinator_h
+#define FetchCoordinator_h
+
+#include <memory>
+#include "Params.h"
+#include "Closure.h"
+#include "DataStore.h"
+
+/**
+ * Coordinates on-demand fetches from monitoring servers.
+ *
+ * - A result that was fetched within the staleness SLA
+ *   (ConfigManager::getFetchStalenessSec()) is regarded as fresh and
+ *   the server is not fetched again.
+ * - A request for a server that is being fetched joins the in-flight
+ *   fetch instead of starting another one.
+ * - The number of concurrent fetches is sized from the measured latency
+ *   of each server so that the queued fetches finish within about
+ *   TARGET_ROUND_MSEC.
+ *
+ * A subclass decides what is fetched.
+ */
+class FetchCoordinator
+{
+public:
+	static const size_t MIN_RUNNING_FETCHERS;
+	static const size_t MAX_RUNNING_FETCHERS;
+	static const double TARGET_ROUND_MSEC;
+
+	/**
+	 * An expected latency of a server that has never been fetched.
+	 */
+	static const double DEFAULT_LATENCY_MSEC;
+
+	FetchCoordinator(void);
+	virtual ~FetchCoordinator();
+
+	/**
+	 * Start fetching.
+	 *
+	 * @param targetServerId A server to be fetched or ALL_SERVERS.
+	 * @param closure
+	 * A closure called when all the fetches that the request waits for
+	 * finish. It is deleted after the call. It can be NULL.
+	 *
+	 * @return
+	 * true if the closure will be called. false if all the results are
+	 * fresh or no server supports the fetch. In that case, the closure
+	 * is not taken.
+	 */
+	bool start(const ServerIdType &targetServerId = ALL_SERVERS,
+	           Closure0 *closure = NULL);
+
+	/**
+	 * Fetch and wait for the completion.
+	 */
+	void fetch(const ServerIdType &targetServerId = ALL_SERVERS);
+
+	size_t getMaxRunningFetchers(void) const;
+
+	/**
+	 * Get the measured latency of a server.
+	 *
+	 * @return
+	 * The latency in milliseconds or 0 if the server has not been
+	 * fetched.
+	 */
+	double getLatencyMSec(const ServerIdType &serverId) const;
+
+protected:
+	/**
+	 * Get candidates to be fetched. The returned DataStores shall be
+	 * referenced.
+	 */
+	virtual DataStoreVector getDataStoreVector(void);
+
+	virtual bool isFetchSupported(DataStore *dataStore) = 0;
+
+	/**
+	 * Start a fetch of a DataStore.
+	 *
+	 * @param closure
+	 * It shall be called when the fetch succeeds. When the fetch fails,
+	 * it shall be deleted without being called. Then the result is not
+	 * regarded as fresh.
+	 * @return true if the fetch is started. Otherwise false.
+	 */
+	virtual bool startFetch(DataStore *dataStore, Closure0 *closure) = 0;
+
+	void fetchedCallback(Closure0 *closure);
+	void fetchAbortedCallback(Closure0 *closure);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+
+	void runFetchers(const DataStoreVector &dataStores);
+	void finishFetch(const ServerIdType &serverId, const uint64_t &fetchId,
+	                 const bool &succeeded);
+};
+
+#endif // FetchCoordinator_h
@@ -38,6 +38,7 @@ using namespace mlpl;
 #include "ThreadLocalDBCache.h"
 #include "SessionManager.h"
 #include "UnifiedDataStore.h"
+#include "IngestionQueue.h"
 #include "ChildProcessManager.h"
 #include "DBTablesHost.h"
 #include "DBTablesLastInfo.h"
@@ -55,6 +56,7 @@ static void init(void)
 	DBAgentMySQL::init();
 	DBTablesUser::init();
 	DBTablesAction::init();
+	DBTablesMonitoring::init();
 
 	ItemData::init();
 
@@ -82,6 +84,7 @@ static void reset(const CommandLineOptions *cmdLineOpts,
 	ThreadLocalDBCache::reset();
 
 	UnifiedDataStore::getInstance()->reset();
+	IngestionQueue::reset();
 
 	ConfigManager::reset(cmdLineOpts);
 }
@@ -82,6 +82,7 @@ struct HatoholArmPluginGate::Impl
 	AtomicValue<GPid>    pid;
 	SimpleSemaphore      pluginTermSem;
 	HostInfoCache        hostInfoCache;
+	bool                 storedHostsChanged;
 	Mutex                exitSyncLock;
 	bool                 exitSyncDone;
 	bool                 createdSelfTriggers;
@@ -98,6 +99,7 @@ struct HatoholArmPluginGate::Impl
 	  pid(0),
 	  pluginTermSem(0),
 	  hostInfoCache(&_serverInfo.id),
+	  storedHostsChanged(true),
 	  exitSyncDone(false),
 	  createdSelfTriggers(false),
 	  pipeRd(NamedPipe::END_TYPE_MASTER_READ),
@@ -318,12 +320,15 @@ bool HatoholArmPluginGate::startOnDemandFetchItem(Closure0 *closure)
 		                     const HapiCommandHeader &cmdHeader)
 		                          override
 		{
-			cleanup();
+			cleanup(false);
 		}
 
-		void cleanup(void)
+		void cleanup(const bool &succeeded = true)
 		{
-			itemUpdatedSignal();
+			// The closure is deleted without being called
+			// on an error.
+			if (succeeded)
+				itemUpdatedSignal();
 			itemUpdatedSignal.clear();
 			this->unref();
 		}
@@ -429,12 +434,15 @@ bool HatoholArmPluginGate::startOnDemandFetchTrigger(Closure0 *closure)
 		                     const HapiCommandHeader &cmdHeader)
 		                          override
 		{
-			cleanup();
+			cleanup(false);
 		}
 
-		void cleanup(void)
+		void cleanup(const bool &succeeded = true)
 		{
-			triggerUpdatedSignal();
+			// The closure is deleted without being called
+			// on an error.
+			if (succeeded)
+				triggerUpdatedSignal();
 			triggerUpdatedSignal.clear();
 			this->unref();
 		}
@@ -809,6 +817,17 @@ void HatoholArmPluginGate::cmdHandlerGetTimestampOfLastTrigger(
 void HatoholArmPluginGate::cmdHandlerGetLastEventId(
   const HapiCommandHeader *header)
 {
+	// The events may be still in IngestionQueue. If a dropped one is
+	// older than the last stored event, it is lost because the plugin
+	// fetches events after the returned ID.
+	UnifiedDataStore *uds = UnifiedDataStore::getInstance();
+	if (!uds->flushIngestion(m_impl->serverInfo.id)) {
+		MLPL_ERR("Some events of server %" FMT_SERVER_ID " were "
+		         "dropped by the ingestion queue.\n",
+		         m_impl->serverInfo.id);
+		setPluginConnectStatus(COLLECT_NG_HATOHOL_INTERNAL_ERROR,
+		                       HAPERR_UNAVAILABLE_HAP);
+	}
 	ThreadLocalDBCache cache;
 	const EventIdType lastEventId =
 	  cache.getMonitoring().getMaxEventId(m_impl->serverInfo.id);
@@ -867,9 +886,7 @@ void HatoholArmPluginGate::cmdHandlerGetHostsChanged(
 	SmartBuffer resBuf;
 	HapiTriggerCollect *body =
 	  setupResponseBuffer<HapiTriggerCollect>(resBuf);
-	bool type;
-	type = UnifiedDataStore::getInstance()->wasStoredHostsChanged();
-	body->type = NtoL(type);
+	body->type = NtoL(m_impl->storedHostsChanged);
 	reply(resBuf);
 }
 
@@ -914,7 +931,8 @@ void HatoholArmPluginGate::cmdHandlerSendHosts(
 	UnifiedDataStore *uds = UnifiedDataStore::getInstance();
 	THROW_HATOHOL_EXCEPTION_IF_NOT_OK(
 	  uds->syncHosts(svHostDefs, m_impl->serverInfo.id,
-	                 m_impl->hostInfoCache));
+	                 m_impl->hostInfoCache,
+	                 &m_impl->storedHostsChanged));
 	replyOk();
 }
 
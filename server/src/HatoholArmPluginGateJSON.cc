@@ -33,39 +33,43 @@
 using namespace std;
 using namespace mlpl;
 
+static const uint16_t PREFETCH_COUNT = 256;
+static const size_t BATCH_SIZE = 128;
+static const size_t BATCH_TIMEOUT_MSEC = 100;
+
 class AMQPJSONMessageHandler : public AMQPMessageHandler
 {
 public:
-	AMQPJSONMessageHandler(const MonitoringServerInfo &serverInfo)
+	AMQPJSONMessageHandler(const MonitoringServerInfo &serverInfo,
+			       ArmStatus &armStatus)
 	: m_serverInfo(serverInfo),
+	  m_armStatus(armStatus),
 	  m_hosts()
 	{
 		initializeHosts();
 	}
 
-	bool handle(AMQPConnection &connection, const AMQPMessage &message)
+	bool handle(AMQPConnection &connection,
+		    const AMQPMessage &message) override
 	{
-		// TODO: check content-type
-		MLPL_DBG("message: <%s>/<%s>\n",
-			 message.contentType.c_str(),
-			 message.body.c_str());
+		EventInfoList eventInfoList;
+		parse(message, eventInfoList);
+		return addEventList(eventInfoList);
+	}
 
-		JsonParser *parser = json_parser_new();
-		GError *error = NULL;
-		if (json_parser_load_from_data(parser,
-					       message.body.c_str(),
-					       message.body.size(),
-					       &error)) {
-			process(json_parser_get_root(parser));
-		} else {
-			g_error_free(error);
-		}
-		g_object_unref(parser);
-		return true;
+	bool handleBatch(AMQPConnection &connection,
+			 const AMQPMessageVect &messages) override
+	{
+		EventInfoList eventInfoList;
+		AMQPMessageVectConstIterator it = messages.begin();
+		for (; it != messages.end(); ++it)
+			parse(*it, eventInfoList);
+		return addEventList(eventInfoList);
 	}
 
 private:
 	MonitoringServerInfo m_serverInfo;
+	ArmStatus &m_armStatus;
 	map<string, HostIdType> m_hosts;
 
 	void initializeHosts()
@@ -85,7 +89,48 @@ private:
 		}
 	}
 
-	void process(JsonNode *root)
+	void parse(const AMQPMessage &message, EventInfoList &eventInfoList)
+	{
+		// TODO: check content-type
+		MLPL_DBG("message: <%s>/<%s>\n",
+			 message.contentType.c_str(),
+			 message.body.c_str());
+
+		JsonParser *parser = json_parser_new();
+		GError *error = NULL;
+		if (json_parser_load_from_data(parser,
+					       message.body.c_str(),
+					       message.body.size(),
+					       &error)) {
+			process(json_parser_get_root(parser), eventInfoList);
+		} else {
+			g_error_free(error);
+		}
+		g_object_unref(parser);
+	}
+
+	bool addEventList(EventInfoList &eventInfoList)
+	{
+		if (eventInfoList.empty())
+			return true;
+		UnifiedDataStore *uds = UnifiedDataStore::getInstance();
+		uds->addEventList(eventInfoList);
+
+		// The messages are acknowledged after this returns. So we
+		// wait for the events in IngestionQueue to be committed.
+		if (!uds->flushIngestion(m_serverInfo.id)) {
+			MLPL_ERR("Some events of server %" FMT_SERVER_ID
+				 " were dropped by the ingestion queue.\n",
+				 m_serverInfo.id);
+			m_armStatus.logFailure(
+			  "Events were dropped by the ingestion queue.");
+			return false;
+		}
+		m_armStatus.logSuccess();
+		return true;
+	}
+
+	void process(JsonNode *root, EventInfoList &eventInfoList)
 	{
 		GateJSONEventMessage message(root);
 		StringList errors;
@@ -98,12 +143,12 @@ private:
 			return;
 		}
 
-		processEventMessage(message);
+		processEventMessage(message, eventInfoList);
 	}
 
-	void processEventMessage(GateJSONEventMessage &message)
+	void processEventMessage(GateJSONEventMessage &message,
+				 EventInfoList &eventInfoList)
 	{
-		EventInfoList eventInfoList;
 		EventInfo eventInfo;
 		initEventInfo(eventInfo);
 		eventInfo.serverId = m_serverInfo.id;
@@ -116,7 +161,6 @@ private:
 		eventInfo.hostIdInServer = eventInfo.hostName;
 		eventInfo.brief = message.getContent();
 		eventInfoList.push_back(eventInfo);
-		UnifiedDataStore::getInstance()->addEventList(eventInfoList);
 	}
 
 	HostIdType findOrCreateHostID(const string &hostName)
@@ -189,8 +233,12 @@ struct HatoholArmPluginGateJSON::Impl
 			armPluginInfo.tlsCACertificatePath);
 		m_connectionInfo.setTLSVerifyEnabled(
 			armPluginInfo.isTLSVerifyEnabled());
+		m_connectionInfo.setPrefetchCount(PREFETCH_COUNT);
+		m_connectionInfo.setBatchSize(BATCH_SIZE);
+		m_connectionInfo.setBatchTimeoutMSec(BATCH_TIMEOUT_MSEC);
 
-		m_handler = new AMQPJSONMessageHandler(serverInfo);
+		m_handler = new AMQPJSONMessageHandler(serverInfo,
+						       m_armStatus);
 		m_consumer = new AMQPConsumer(m_connectionInfo, m_handler);
 	}
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <StringUtils.h>
+#include "HistoryAggregator.h"
+#include "HatoholException.h"
+using namespace std;
+using namespace mlpl;
+
+static time_t getBucketIndex(const time_t &time, const time_t &beginTime,
+                             const time_t &bucketWidth)
+{
+	if (time < beginTime)
+		return 0;
+	return (time - beginTime) / bucketWidth;
+}
+
+// The following loops are written simply over a contiguous array so
+// that the compiler can vectorize them.
+static void reduce(HistoryBucket &bucket, const double *values,
+                   const size_t &numValues)
+{
+	double min = values[0];
+	double max = values[0];
+	double sum = 0;
+	for (size_t i = 0; i < numValues; i++)
+		min = values[i] < min ? values[i] : min;
+	for (size_t i = 0; i < numValues; i++)
+		max = values[i] > max ? values[i] : max;
+	for (size_t i = 0; i < numValues; i++)
+		sum += values[i];
+	bucket.numSamples = numValues;
+	bucket.min = min;
+	bucket.max = max;
+	bucket.avg = sum / numValues;
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+time_t HistoryAggregator::calcBucketWidth(const time_t &beginTime,
+                                          const time_t &endTime,
+                                          const size_t &maxPoints)
+{
+	HATOHOL_ASSERT(maxPoints > 0, "maxPoints must not be 0.");
+	if (endTime < beginTime)
+		return 1;
+	const time_t duration = endTime - beginTime + 1;
+	const time_t width = (duration + maxPoints - 1) / maxPoints;
+	return width > 0 ? width : 1;
+}
+
+bool HistoryAggregator::aggregate(HistoryBucketVect &buckets,
+                                  const HistoryInfoVect &historyInfoVect,
+                                  const time_t &beginTime,
+                                  const time_t &bucketWidth)
+{
+	HATOHOL_ASSERT(bucketWidth > 0, "bucketWidth must be positive.");
+
+	// The values are parsed at once into an array.
+	vector<double> values;
+	values.reserve(historyInfoVect.size());
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it) {
+		const string &value = it->value;
+		if (value.empty() || !StringUtils::isNumber(value))
+			return false;
+		values.push_back(atof(value.c_str()));
+	}
+
+	size_t first = 0;
+	while (first < historyInfoVect.size()) {
+		const time_t index =
+		  getBucketIndex(historyInfoVect[first].clock.tv_sec,
+		                 beginTime, bucketWidth);
+		size_t last = first + 1;
+		for (; last < historyInfoVect.size(); last++) {
+			const time_t nextIndex =
+			  getBucketIndex(historyInfoVect[last].clock.tv_sec,
+			                 beginTime, bucketWidth);
+			if (nextIndex != index)
+				break;
+		}
+
+		HistoryBucket bucket;
+		bucket.beginTime = beginTime + index * bucketWidth;
+		bucket.last = historyInfoVect[last - 1].value;
+		reduce(bucket, &values[first], last - first);
+		buckets.push_back(bucket);
+		first = last;
+	}
+	return true;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HistoryAggregator_h
+#define HistoryAggregator_h
+
+#include <string>
+#include <vector>
+#include "Params.h"
+#include "Monitoring.h"
+
+struct HistoryBucket {
+	time_t      beginTime;
+	size_t      numSamples;
+	double      min;
+	double      max;
+	double      avg;
+	std::string last;
+};
+
+typedef std::vector<HistoryBucket>        HistoryBucketVect;
+typedef HistoryBucketVect::iterator       HistoryBucketVectIterator;
+typedef HistoryBucketVect::const_iterator HistoryBucketVectConstIterator;
+
+/**
+ * Reduces the history of an item to the minimum, the maximum, the
+ * average and the last value in each bucket of a fixed time width.
+ * Buckets without samples are not made.
+ */
+class HistoryAggregator {
+public:
+	/**
+	 * Calculate a bucket width so that the number of buckets in the
+	 * range doesn't exceed maxPoints.
+	 *
+	 * @param beginTime The begin of the range (inclusive).
+	 * @param endTime The end of the range (inclusive).
+	 * @param maxPoints The maximum number of buckets. It must not be 0.
+	 * @return A bucket width in seconds. It is 1 at least.
+	 */
+	static time_t calcBucketWidth(const time_t &beginTime,
+	                              const time_t &endTime,
+	                              const size_t &maxPoints);
+
+	/**
+	 * Aggregate samples.
+	 *
+	 * @param buckets The aggregated buckets are added to this.
+	 * @param historyInfoVect Samples in the order of the time.
+	 * @param beginTime The begin time of the first bucket.
+	 * @param bucketWidth The width of a bucket in seconds.
+	 * @return
+	 * true on success. false if any value is not a number. In that
+	 * case, buckets is not changed.
+	 */
+	static bool aggregate(HistoryBucketVect &buckets,
+	                      const HistoryInfoVect &historyInfoVect,
+	                      const time_t &beginTime,
+	                      const time_t &bucketWidth);
+};
+
+#endif // HistoryAggregator_h
@@ -0,0 +1,534 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <map>
+#include <Mutex.h>
+#include <Reaper.h>
+#include "HistoryCache.h"
+#include "TimeSeriesBlock.h"
+using namespace std;
+using namespace mlpl;
+
+const size_t HistoryCache::DEFAULT_MAX_MEMORY_SIZE = 64 * 1024 * 1024;
+const time_t HistoryCache::RECENT_MARGIN_SEC = 60;
+const size_t HistoryCache::MAX_FETCH_RANGES = 4;
+const size_t HistoryCache::MAX_SAMPLES_PER_BLOCK = 512;
+
+// An approximate size of a node of std::map
+static const size_t MAP_NODE_OVERHEAD = 48;
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct OlderSample {
+	bool operator()(const HistoryInfo &lhs, const HistoryInfo &rhs) const
+	{
+		if (lhs.clock.tv_sec != rhs.clock.tv_sec)
+			return lhs.clock.tv_sec < rhs.clock.tv_sec;
+		return lhs.clock.tv_nsec < rhs.clock.tv_nsec;
+	}
+};
+
+struct SampleInRange {
+	const HistoryCache::TimeRange range;
+
+	SampleInRange(const HistoryCache::TimeRange &_range)
+	: range(_range)
+	{
+	}
+
+	bool operator()(const HistoryInfo &historyInfo) const
+	{
+		return historyInfo.clock.tv_sec >= range.beginTime &&
+		       historyInfo.clock.tv_sec <= range.endTime;
+	}
+};
+
+typedef pair<ServerIdType, ItemIdType> HistoryKey;
+
+struct HistoryEntry;
+typedef list<HistoryEntry *>               HistoryEntryList;
+typedef HistoryEntryList::iterator         HistoryEntryListIterator;
+typedef map<HistoryKey, HistoryEntry *>    HistoryEntryMap;
+typedef HistoryEntryMap::iterator          HistoryEntryMapIterator;
+
+// The key is a begin time and the value is an end time (inclusive).
+// The ranges are neither overlapped nor adjacent.
+typedef map<time_t, time_t>                CoveredRangeMap;
+typedef CoveredRangeMap::iterator          CoveredRangeMapIterator;
+typedef CoveredRangeMap::const_iterator    CoveredRangeMapConstIterator;
+
+struct HistoryEntry {
+	HistoryKey               key;
+	TimeSeriesBlockVect      blocks; // in the order of the time
+	CoveredRangeMap          coveredRanges;
+	size_t                   blocksSize;
+	HistoryEntryListIterator lruPosition;
+
+	HistoryEntry(const HistoryKey &_key)
+	: key(_key),
+	  blocksSize(0)
+	{
+	}
+
+	size_t getMemorySize(void) const
+	{
+		return sizeof(HistoryEntry) + key.second.size() + blocksSize +
+		       coveredRanges.size() * MAP_NODE_OVERHEAD;
+	}
+
+	void getMissingRanges(HistoryCache::TimeRangeVect &missingRanges,
+	                      const time_t &beginTime, const time_t &endTime)
+	  const
+	{
+		time_t cursor = beginTime;
+		CoveredRangeMapConstIterator it =
+		  coveredRanges.upper_bound(beginTime);
+		if (it != coveredRanges.begin())
+			--it;
+		for (; it != coveredRanges.end(); ++it) {
+			if (it->first > endTime)
+				break;
+			if (it->second < cursor)
+				continue;
+			if (it->first > cursor) {
+				missingRanges.push_back(
+				  HistoryCache::TimeRange(cursor,
+				                          it->first - 1));
+			}
+			cursor = it->second + 1;
+			if (cursor > endTime)
+				return;
+		}
+		missingRanges.push_back(
+		  HistoryCache::TimeRange(cursor, endTime));
+	}
+
+	// Only the blocks that overlap the range are decoded.
+	void getSamples(HistoryInfoVect &historyInfoVect,
+	                const time_t &beginTime, const time_t &endTime) const
+	{
+		TimeSeriesBlockVectConstIterator it = blocks.begin();
+		for (; it != blocks.end(); ++it) {
+			if (it->getEndTime() < beginTime)
+				continue;
+			if (it->getBeginTime() > endTime)
+				break;
+			const HistoryCache::TimeRange range(beginTime, endTime);
+			HistoryInfoVect decoded;
+			it->decode(decoded, key.first, key.second);
+			copy_if(decoded.begin(), decoded.end(),
+			        back_inserter(historyInfoVect),
+			        SampleInRange(range));
+		}
+	}
+
+	void cover(const time_t &beginTime, const time_t &endTime)
+	{
+		time_t mergedBegin = beginTime;
+		time_t mergedEnd = endTime;
+		CoveredRangeMapIterator it = coveredRanges.upper_bound(beginTime);
+		if (it != coveredRanges.begin()) {
+			--it;
+			if (it->second + 1 < beginTime)
+				++it;
+		}
+		while (it != coveredRanges.end() && it->first <= endTime + 1) {
+			mergedBegin = min(mergedBegin, it->first);
+			mergedEnd = max(mergedEnd, it->second);
+			coveredRanges.erase(it++);
+		}
+		coveredRanges[mergedBegin] = mergedEnd;
+	}
+
+	// The samples in the range are replaced with the new ones.
+	// The blocks that overlap the range are decoded, merged with the
+	// new samples and encoded again.
+	void replaceSamples(const time_t &beginTime, const time_t &endTime,
+	                    const HistoryInfoVect &newSamples)
+	{
+		size_t first = 0;
+		while (first < blocks.size() &&
+		       blocks[first].getEndTime() < beginTime)
+			first++;
+		size_t last = first;
+		while (last < blocks.size() &&
+		       blocks[last].getBeginTime() <= endTime)
+			last++;
+		// Partially filled neighbors are merged not to fragment.
+		if (first > 0 && !isFull(blocks[first - 1]))
+			first--;
+		if (last < blocks.size() && !isFull(blocks[last]))
+			last++;
+
+		const HistoryCache::TimeRange range(beginTime, endTime);
+		HistoryInfoVect merged;
+		for (size_t i = first; i < last; i++) {
+			blocks[i].decode(merged, key.first, key.second);
+			blocksSize -= blocks[i].getMemorySize();
+		}
+		merged.erase(remove_if(merged.begin(), merged.end(),
+		                       SampleInRange(range)),
+		             merged.end());
+		copy_if(newSamples.begin(), newSamples.end(),
+		        back_inserter(merged), SampleInRange(range));
+		stable_sort(merged.begin(), merged.end(), OlderSample());
+
+		TimeSeriesBlockVect encoded;
+		HistoryInfoVectConstIterator it = merged.begin();
+		for (; it != merged.end(); ++it) {
+			if (encoded.empty() || isFull(encoded.back()))
+				encoded.push_back(TimeSeriesBlock());
+			encoded.back().append(*it);
+		}
+		for (size_t i = 0; i < encoded.size(); i++) {
+			encoded[i].shrink();
+			blocksSize += encoded[i].getMemorySize();
+		}
+		blocks.erase(blocks.begin() + first, blocks.begin() + last);
+		blocks.insert(blocks.begin() + first,
+		              encoded.begin(), encoded.end());
+	}
+
+	static bool isFull(const TimeSeriesBlock &block)
+	{
+		return block.getNumberOfSamples() >=
+		       HistoryCache::MAX_SAMPLES_PER_BLOCK;
+	}
+};
+
+// A request whose missing ranges are being fetched
+struct HistoryFetchContext {
+	Mutex                      lock;
+	Closure1<HistoryInfoVect> *closure;
+	HistoryInfoVect            historyInfoVect;
+	size_t                     numPendingRanges;
+	bool                       dropped;
+
+	HistoryFetchContext(Closure1<HistoryInfoVect> *_closure)
+	: closure(_closure),
+	  numPendingRanges(0),
+	  dropped(false)
+	{
+	}
+
+	virtual ~HistoryFetchContext()
+	{
+		delete closure;
+	}
+
+	void complete(void)
+	{
+		if (!dropped) {
+			stable_sort(historyInfoVect.begin(),
+			            historyInfoVect.end(), OlderSample());
+			(*closure)(historyInfoVect);
+		}
+		delete this;
+	}
+
+	// Returns true if this is the last range.
+	bool finishRange(const HistoryInfoVect *fetched)
+	{
+		lock.lock();
+		Reaper<Mutex> unlocker(&lock, Mutex::unlock);
+		if (fetched) {
+			historyInfoVect.insert(historyInfoVect.end(),
+			                       fetched->begin(), fetched->end());
+		} else {
+			dropped = true;
+		}
+		numPendingRanges--;
+		return numPendingRanges == 0;
+	}
+};
+
+struct HistoryRangeClosure : public Closure1<HistoryInfoVect> {
+	HistoryFetchContext *context;
+	ServerIdType         serverId;
+	ItemIdType           itemId;
+	HistoryCache::TimeRange range;
+	time_t               fetchTime;
+	bool                 called;
+
+	HistoryRangeClosure(HistoryFetchContext *_context,
+	                    const ItemInfo &itemInfo,
+	                    const HistoryCache::TimeRange &_range,
+	                    const time_t &_fetchTime)
+	: context(_context),
+	  serverId(itemInfo.serverId),
+	  itemId(itemInfo.id),
+	  range(_range),
+	  fetchTime(_fetchTime),
+	  called(false)
+	{
+	}
+
+	virtual ~HistoryRangeClosure()
+	{
+		// The DataStore dropped the request.
+		if (!called && context->finishRange(NULL))
+			context->complete();
+	}
+
+	virtual void operator()(const HistoryInfoVect &historyInfoVect)
+	  override
+	{
+		if (called)
+			return;
+		called = true;
+		HistoryCache::getInstance()->add(
+		  serverId, itemId, range.beginTime, range.endTime, fetchTime,
+		  historyInfoVect);
+		if (context->finishRange(&historyInfoVect))
+			context->complete();
+	}
+};
+
+struct HistoryCache::Impl {
+	static Mutex         initLock;
+	static HistoryCache *instance;
+
+	mutable Mutex    lock;
+	HistoryEntryMap  entryMap;
+	HistoryEntryList lruList; // The front is the most recently used.
+	size_t           memorySize;
+	size_t           maxMemorySize;
+
+	Impl(void)
+	: memorySize(0),
+	  maxMemorySize(DEFAULT_MAX_MEMORY_SIZE)
+	{
+	}
+
+	virtual ~Impl()
+	{
+		clear();
+	}
+
+	// The following methods shall be called with lock.
+	void touch(HistoryEntry *entry)
+	{
+		lruList.splice(lruList.begin(), lruList, entry->lruPosition);
+	}
+
+	void remove(HistoryEntryMapIterator it)
+	{
+		HistoryEntry *entry = it->second;
+		memorySize -= entry->getMemorySize();
+		lruList.erase(entry->lruPosition);
+		entryMap.erase(it);
+		delete entry;
+	}
+
+	void evict(void)
+	{
+		while (memorySize > maxMemorySize && !lruList.empty())
+			remove(entryMap.find(lruList.back()->key));
+	}
+
+	void clear(void)
+	{
+		HistoryEntryMapIterator it = entryMap.begin();
+		for (; it != entryMap.end(); ++it)
+			delete it->second;
+		entryMap.clear();
+		lruList.clear();
+		memorySize = 0;
+	}
+};
+
+Mutex         HistoryCache::Impl::initLock;
+HistoryCache *HistoryCache::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void HistoryCache::reset(void)
+{
+	HistoryCache *historyCache = getInstance();
+	historyCache->invalidateAll();
+	historyCache->setMaxMemorySize(DEFAULT_MAX_MEMORY_SIZE);
+}
+
+HistoryCache *HistoryCache::getInstance(void)
+{
+	Impl::initLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new HistoryCache();
+	Impl::initLock.unlock();
+	return Impl::instance;
+}
+
+void HistoryCache::fetch(DataStorePtr dataStorePtr, const ItemInfo &itemInfo,
+                         const time_t &beginTime, const time_t &endTime,
+                         Closure1<HistoryInfoVect> *closure)
+{
+	HistoryFetchContext *context = new HistoryFetchContext(closure);
+	TimeRangeVect missingRanges;
+	get(context->historyInfoVect, missingRanges,
+	    itemInfo.serverId, itemInfo.id, beginTime, endTime);
+	if (missingRanges.empty()) {
+		context->complete();
+		return;
+	}
+
+	if (missingRanges.size() > MAX_FETCH_RANGES) {
+		const TimeRange range(missingRanges.front().beginTime,
+		                      missingRanges.back().endTime);
+		missingRanges.clear();
+		missingRanges.push_back(range);
+		// The samples in the range will be fetched again.
+		HistoryInfoVect &historyInfoVect = context->historyInfoVect;
+		historyInfoVect.erase(
+		  remove_if(historyInfoVect.begin(), historyInfoVect.end(),
+		            SampleInRange(range)),
+		  historyInfoVect.end());
+	}
+
+	// Every closure must be created before the first request because
+	// the context may be completed in startOnDemandFetchHistory().
+	const time_t fetchTime = time(NULL);
+	vector<HistoryRangeClosure *> rangeClosures;
+	TimeRangeVectConstIterator it = missingRanges.begin();
+	for (; it != missingRanges.end(); ++it) {
+		rangeClosures.push_back(
+		  new HistoryRangeClosure(context, itemInfo, *it, fetchTime));
+	}
+	context->numPendingRanges = rangeClosures.size();
+	for (size_t i = 0; i < rangeClosures.size(); i++) {
+		// The closure may be deleted in the call.
+		const TimeRange range = rangeClosures[i]->range;
+		dataStorePtr->startOnDemandFetchHistory(
+		  itemInfo, range.beginTime, range.endTime, rangeClosures[i]);
+	}
+}
+
+void HistoryCache::get(
+  HistoryInfoVect &historyInfoVect, TimeRangeVect &missingRanges,
+  const ServerIdType &serverId, const ItemIdType &itemId,
+  const time_t &beginTime, const time_t &endTime)
+{
+	if (beginTime > endTime)
+		return;
+
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	HistoryEntryMapIterator it =
+	  m_impl->entryMap.find(HistoryKey(serverId, itemId));
+	if (it == m_impl->entryMap.end()) {
+		missingRanges.push_back(TimeRange(beginTime, endTime));
+		return;
+	}
+	HistoryEntry *entry = it->second;
+	m_impl->touch(entry);
+	entry->getMissingRanges(missingRanges, beginTime, endTime);
+	entry->getSamples(historyInfoVect, beginTime, endTime);
+}
+
+void HistoryCache::add(
+  const ServerIdType &serverId, const ItemIdType &itemId,
+  const time_t &beginTime, const time_t &endTime, const time_t &fetchTime,
+  const HistoryInfoVect &historyInfoVect)
+{
+	const time_t coveredEnd = min(endTime, fetchTime - RECENT_MARGIN_SEC);
+	if (coveredEnd < beginTime)
+		return;
+
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	const HistoryKey key(serverId, itemId);
+	HistoryEntry *entry = NULL;
+	HistoryEntryMapIterator it = m_impl->entryMap.find(key);
+	if (it == m_impl->entryMap.end()) {
+		entry = new HistoryEntry(key);
+		m_impl->entryMap[key] = entry;
+		m_impl->lruList.push_front(entry);
+		entry->lruPosition = m_impl->lruList.begin();
+	} else {
+		entry = it->second;
+		m_impl->memorySize -= entry->getMemorySize();
+		m_impl->touch(entry);
+	}
+	entry->replaceSamples(beginTime, coveredEnd, historyInfoVect);
+	entry->cover(beginTime, coveredEnd);
+	m_impl->memorySize += entry->getMemorySize();
+	m_impl->evict();
+}
+
+void HistoryCache::invalidate(const ServerIdType &serverId)
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	HistoryEntryMapIterator it =
+	  m_impl->entryMap.lower_bound(HistoryKey(serverId, ItemIdType()));
+	while (it != m_impl->entryMap.end() && it->first.first == serverId)
+		m_impl->remove(it++);
+}
+
+void HistoryCache::invalidateAll(void)
+{
+	m_impl->lock.lock();
+	m_impl->clear();
+	m_impl->lock.unlock();
+}
+
+void HistoryCache::setMaxMemorySize(const size_t &maxMemorySize)
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	m_impl->maxMemorySize = maxMemorySize;
+	m_impl->evict();
+}
+
+size_t HistoryCache::getMaxMemorySize(void) const
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	return m_impl->maxMemorySize;
+}
+
+size_t HistoryCache::getMemorySize(void) const
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	return m_impl->memorySize;
+}
+
+size_t HistoryCache::getNumberOfEntries(void) const
+{
+	m_impl->lock.lock();
+	Reaper<Mutex> unlocker(&m_impl->lock, Mutex::unlock);
+	return m_impl->entryMap.size();
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+HistoryCache::HistoryCache(void)
+: m_impl(new Impl())
+{
+}
+
+HistoryCache::~HistoryCache()
+{
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HistoryCache_h
+#define HistoryCache_h
+
+#include <memory>
+#include <vector>
+#include "Params.h"
+#include "Monitoring.h"
+#include "DataStore.h"
+
+/**
+ * A process-wide cache of the history fetched from monitoring servers.
+ *
+ * The samples are held for each pair of a server ID and an item ID in
+ * the order of the time together with the time ranges that have been
+ * fetched. They are compressed in TimeSeriesBlock of up to
+ * MAX_SAMPLES_PER_BLOCK samples and only the blocks in a requested
+ * range are decoded. A request is answered from the cache for the covered part
+ * and only the missing sub-ranges are fetched from the DataStore.
+ * Because the monitoring server may not have received the latest
+ * samples yet, the RECENT_MARGIN_SEC seconds before the time of a fetch
+ * are not regarded as covered.
+ *
+ * When the total size exceeds the memory budget, the least recently
+ * used entries are evicted.
+ */
+class HistoryCache {
+public:
+	struct TimeRange {
+		time_t beginTime; // inclusive
+		time_t endTime;   // inclusive
+
+		TimeRange(const time_t &_beginTime, const time_t &_endTime)
+		: beginTime(_beginTime),
+		  endTime(_endTime)
+		{
+		}
+	};
+	typedef std::vector<TimeRange>        TimeRangeVect;
+	typedef TimeRangeVect::iterator       TimeRangeVectIterator;
+	typedef TimeRangeVect::const_iterator TimeRangeVectConstIterator;
+
+	static const size_t DEFAULT_MAX_MEMORY_SIZE;
+	static const time_t RECENT_MARGIN_SEC;
+
+	/**
+	 * When there are more missing ranges than this, a range that
+	 * covers all of them is fetched.
+	 */
+	static const size_t MAX_FETCH_RANGES;
+
+	static const size_t MAX_SAMPLES_PER_BLOCK;
+
+	static void reset(void);
+	static HistoryCache *getInstance(void);
+
+	/**
+	 * Get the history of an item. The ranges that are not in the cache
+	 * are fetched with DataStore::startOnDemandFetchHistory().
+	 *
+	 * @param dataStorePtr A DataStore of the server of the item.
+	 * @param itemInfo A target item.
+	 * @param beginTime A begin time of the history (inclusive).
+	 * @param endTime An end time of the history (inclusive).
+	 * @param closure
+	 * It is called with the samples in the order of the time and then
+	 * deleted. As DataStore::startOnDemandFetchHistory(), it is deleted
+	 * without being called when the DataStore drops the request.
+	 * It may be called before this method returns.
+	 */
+	void fetch(DataStorePtr dataStorePtr, const ItemInfo &itemInfo,
+	           const time_t &beginTime, const time_t &endTime,
+	           Closure1<HistoryInfoVect> *closure);
+
+	/**
+	 * Get the cached samples.
+	 *
+	 * @param historyInfoVect The samples in the range are added to this.
+	 * @param missingRanges
+	 * The sub-ranges that are not in the cache are added to this in
+	 * the order of the time.
+	 */
+	void get(HistoryInfoVect &historyInfoVect, TimeRangeVect &missingRanges,
+	         const ServerIdType &serverId, const ItemIdType &itemId,
+	         const time_t &beginTime, const time_t &endTime);
+
+	/**
+	 * Store samples fetched from a monitoring server.
+	 *
+	 * @param beginTime A begin time of the request (inclusive).
+	 * @param endTime An end time of the request (inclusive).
+	 * @param fetchTime The time when the request was sent.
+	 * @param historyInfoVect The fetched samples.
+	 */
+	void add(const ServerIdType &serverId, const ItemIdType &itemId,
+	         const time_t &beginTime, const time_t &endTime,
+	         const time_t &fetchTime,
+	         const HistoryInfoVect &historyInfoVect);
+
+	void invalidate(const ServerIdType &serverId);
+	void invalidateAll(void);
+
+	/**
+	 * Set the memory budget in bytes. Entries are evicted immediately
+	 * if the current size exceeds it.
+	 */
+	void setMaxMemorySize(const size_t &maxMemorySize);
+	size_t getMaxMemorySize(void) const;
+	size_t getMemorySize(void) const;
+	size_t getNumberOfEntries(void) const;
+
+protected:
+	HistoryCache(void);
+	virtual ~HistoryCache();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // HistoryCache_h
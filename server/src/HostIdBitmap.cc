@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "HostIdBitmap.h"
+
+using namespace std;
+
+static const size_t   CHUNK_BITS = 16;
+static const uint64_t LOW_MASK = (1 << CHUNK_BITS) - 1;
+static const size_t   NUM_BITSET_WORDS = (1 << CHUNK_BITS) / 64;
+
+// An array of 4096 uint16_t has the same size as the bitset.
+const size_t HostIdBitmap::MAX_ARRAY_CONTAINER_SIZE = 4096;
+
+// ---------------------------------------------------------------------------
+// Container
+// ---------------------------------------------------------------------------
+HostIdBitmap::Container::Container(void)
+: cardinality(0)
+{
+}
+
+bool HostIdBitmap::Container::isBitset(void) const
+{
+	return !bits.empty();
+}
+
+void HostIdBitmap::Container::add(const uint16_t &low)
+{
+	if (isBitset()) {
+		uint64_t &word = bits[low / 64];
+		const uint64_t mask = (uint64_t)1 << (low % 64);
+		if (!(word & mask)) {
+			word |= mask;
+			cardinality++;
+		}
+		return;
+	}
+
+	vector<uint16_t>::iterator it =
+	  lower_bound(array.begin(), array.end(), low);
+	if (it != array.end() && *it == low)
+		return;
+	array.insert(it, low);
+	cardinality++;
+	if (cardinality > MAX_ARRAY_CONTAINER_SIZE)
+		convertToBitset();
+}
+
+bool HostIdBitmap::Container::contains(const uint16_t &low) const
+{
+	if (isBitset())
+		return bits[low / 64] & ((uint64_t)1 << (low % 64));
+	return binary_search(array.begin(), array.end(), low);
+}
+
+void HostIdBitmap::Container::convertToBitset(void)
+{
+	bits.assign(NUM_BITSET_WORDS, 0);
+	vector<uint16_t>::const_iterator it = array.begin();
+	for (; it != array.end(); ++it)
+		bits[*it / 64] |= (uint64_t)1 << (*it % 64);
+	vector<uint16_t>().swap(array);
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+HostIdBitmap::HostIdBitmap(void)
+{
+}
+
+HostIdBitmap::~HostIdBitmap()
+{
+}
+
+void HostIdBitmap::add(const HostIdType &hostId)
+{
+	m_containerMap[hostId >> CHUNK_BITS].add(hostId & LOW_MASK);
+}
+
+bool HostIdBitmap::contains(const HostIdType &hostId) const
+{
+	ContainerMap::const_iterator it =
+	  m_containerMap.find(hostId >> CHUNK_BITS);
+	if (it == m_containerMap.end())
+		return false;
+	return it->second.contains(hostId & LOW_MASK);
+}
+
+size_t HostIdBitmap::size(void) const
+{
+	size_t num = 0;
+	ContainerMap::const_iterator it = m_containerMap.begin();
+	for (; it != m_containerMap.end(); ++it)
+		num += it->second.cardinality;
+	return num;
+}
+
+bool HostIdBitmap::empty(void) const
+{
+	return m_containerMap.empty();
+}
+
+void HostIdBitmap::clear(void)
+{
+	m_containerMap.clear();
+}
+
+void HostIdBitmap::getRanges(HostIdRangeVect &ranges) const
+{
+	struct {
+		HostIdRangeVect *ranges;
+		bool             hasLast;
+
+		void operator()(const HostIdType &hostId)
+		{
+			if (hasLast && ranges->back().second + 1 == hostId) {
+				ranges->back().second = hostId;
+				return;
+			}
+			ranges->push_back(HostIdRange(hostId, hostId));
+			hasLast = true;
+		}
+	} append;
+	append.ranges = &ranges;
+	append.hasLast = false;
+
+	ContainerMap::const_iterator it = m_containerMap.begin();
+	for (; it != m_containerMap.end(); ++it) {
+		const HostIdType high = it->first << CHUNK_BITS;
+		const Container &container = it->second;
+		if (!container.isBitset()) {
+			vector<uint16_t>::const_iterator low =
+			  container.array.begin();
+			for (; low != container.array.end(); ++low)
+				append(high | *low);
+			continue;
+		}
+		for (size_t i = 0; i < NUM_BITSET_WORDS; i++) {
+			uint64_t word = container.bits[i];
+			while (word) {
+				const int bit = __builtin_ctzll(word);
+				append(high | (i * 64 + bit));
+				word &= word - 1;
+			}
+		}
+	}
+}
+
+size_t HostIdBitmap::getNumberOfBitsetContainers(void) const
+{
+	size_t num = 0;
+	ContainerMap::const_iterator it = m_containerMap.begin();
+	for (; it != m_containerMap.end(); ++it) {
+		if (it->second.isBitset())
+			num++;
+	}
+	return num;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HostIdBitmap_h
+#define HostIdBitmap_h
+
+#include <map>
+#include <vector>
+#include "Params.h"
+
+typedef std::pair<HostIdType, HostIdType>  HostIdRange; // first, last
+typedef std::vector<HostIdRange>           HostIdRangeVect;
+typedef HostIdRangeVect::iterator          HostIdRangeVectIterator;
+typedef HostIdRangeVect::const_iterator    HostIdRangeVectConstIterator;
+
+/**
+ * A compressed set of global host IDs.
+ *
+ * IDs are partitioned by the upper bits into chunks of 65536 IDs like
+ * Roaring bitmaps. A sparse chunk is a sorted array of the lower 16 bits
+ * and a dense chunk is a plain bitmap. Because global host IDs are
+ * given sequentially, the hosts of a server tend to be packed into a few
+ * dense chunks.
+ *
+ * Private members are defined in this header for the performance.
+ */
+class HostIdBitmap {
+public:
+	static const size_t MAX_ARRAY_CONTAINER_SIZE;
+
+	HostIdBitmap(void);
+	virtual ~HostIdBitmap();
+
+	void add(const HostIdType &hostId);
+	bool contains(const HostIdType &hostId) const;
+
+	/**
+	 * Get the number of IDs in the bitmap.
+	 *
+	 * @return The number of IDs.
+	 */
+	size_t size(void) const;
+	bool empty(void) const;
+	void clear(void);
+
+	/**
+	 * Get runs of the consecutive IDs in ascending order.
+	 *
+	 * @param ranges
+	 * The obtained ranges are appended to this. Each element has the
+	 * first and the last ID of the run.
+	 */
+	void getRanges(HostIdRangeVect &ranges) const;
+
+	size_t getNumberOfBitsetContainers(void) const;
+
+private:
+	struct Container {
+		size_t                cardinality;
+		std::vector<uint16_t> array;  // sorted, used if bits is empty
+		std::vector<uint64_t> bits;
+
+		Container(void);
+		bool isBitset(void) const;
+		void add(const uint16_t &low);
+		bool contains(const uint16_t &low) const;
+		void convertToBitset(void);
+	};
+	typedef std::map<uint64_t, Container> ContainerMap;
+
+	ContainerMap m_containerMap;
+};
+
+typedef std::map<ServerIdType, HostIdBitmap>  ServerHostIdBitmapMap;
+typedef ServerHostIdBitmapMap::iterator       ServerHostIdBitmapMapIterator;
+typedef ServerHostIdBitmapMap::const_iterator ServerHostIdBitmapMapConstIterator;
+
+#endif // HostIdBitmap_h
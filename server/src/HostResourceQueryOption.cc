@@ -22,10 +22,17 @@
 #include "DBTablesMonitoring.h"
 #include "DBTermCStringProvider.h"
 #include "DBHatohol.h"
+#include "UserPrivilegeCache.h"
 
 using namespace std;
 using namespace mlpl;
 
+// With a few host groups, the condition with the host group IDs is small
+// enough and the join is cheap. With many host groups, the condition has
+// a long IN clause that can't use the index well.
+const size_t HostResourceQueryOption::HOST_ID_BITMAP_STRATEGY_THRESHOLD = 32;
+const size_t HostResourceQueryOption::MAX_HOST_ID_RANGES = 256;
+
 // ---------------------------------------------------------------------------
 // Synapse
 // ---------------------------------------------------------------------------
@@ -66,13 +73,15 @@ struct HostResourceQueryOption::Impl {
 	LocalHostIdType targetHostId;
 	HostgroupIdType targetHostgroupId;
 	bool            filterDataOfDefunctServers;
+	AuthorizationStrategy authorizationStrategy;
 
 	Impl(const Synapse &_synapse)
 	: synapse(_synapse),
 	  targetServerId(ALL_SERVERS),
 	  targetHostId(ALL_LOCAL_HOSTS),
 	  targetHostgroupId(ALL_HOST_GROUPS),
-	  filterDataOfDefunctServers(true)
+	  filterDataOfDefunctServers(true),
+	  authorizationStrategy(AUTHORIZATION_STRATEGY_AUTO)
 	{
 	}
 
@@ -82,8 +91,16 @@ struct HostResourceQueryOption::Impl {
 		targetHostId               = rhs.targetHostId;
 		targetHostgroupId          = rhs.targetHostgroupId;
 		filterDataOfDefunctServers = rhs.filterDataOfDefunctServers;
+		authorizationStrategy      = rhs.authorizationStrategy;
 		return *this;
 	}
+
+	bool hasGlobalHostIdColumns(void) const
+	{
+		return synapse.globalHostIdColumnIdx != INVALID_COLUMN_IDX &&
+		       synapse.hostgroupMapGlobalHostIdColumnIdx !=
+		         INVALID_COLUMN_IDX;
+	}
 };
 
 // ---------------------------------------------------------------------------
@@ -176,16 +193,50 @@ string HostResourceQueryOption::getCondition(void) const
 	  (m_impl->targetHostId != ALL_LOCAL_HOSTS) ?
 	    getHostIdColumnName() : "";
 
-	const ServerHostGrpSetMap &srvHostGrpSetMap =
-	  getDataQueryContext().getServerHostGrpSetMap();
-	addCondition(condition,
-	             makeCondition(srvHostGrpSetMap,
-	                           getServerIdColumnName(),
-	                           getHostgroupIdColumnName(),
-	                           hostIdColumnName,
-	                           m_impl->targetServerId,
-	                           m_impl->targetHostgroupId,
-	                           m_impl->targetHostId));
+	// The fragment depends only on the privilege of the user and
+	// the following parameters. So it can be reused among requests.
+	DataQueryContext &dataQueryContext = getDataQueryContext();
+	const bool useHostIdBitmap = isHostIdBitmapUsed();
+	const string cacheKey = StringUtils::sprintf(
+	  "%d\t%p\t%s\t%s\t%s\t%" FMT_SERVER_ID "\t%" FMT_HOST_GROUP_ID
+	  "\t%" FMT_LOCAL_HOST_ID,
+	  useHostIdBitmap,
+	  getDBTermCodec(),
+	  getServerIdColumnName().c_str(),
+	  getHostgroupIdColumnName().c_str(),
+	  hostIdColumnName.c_str(),
+	  m_impl->targetServerId,
+	  m_impl->targetHostgroupId.c_str(),
+	  m_impl->targetHostId.c_str());
+	string privilegeCondition;
+	if (!dataQueryContext.getCachedCondition(privilegeCondition,
+	                                         cacheKey)) {
+		const ServerHostGrpSetMap &srvHostGrpSetMap =
+		  dataQueryContext.getServerHostGrpSetMap();
+		if (useHostIdBitmap) {
+			ServerHostIdBitmapMap hostIdBitmapMap;
+			UserPrivilegeCache::getInstance()->getHostIdBitmapMap(
+			  hostIdBitmapMap, userId);
+			privilegeCondition = makeConditionWithHostIdBitmap(
+			  srvHostGrpSetMap, hostIdBitmapMap,
+			  getServerIdColumnName(),
+			  getColumnName(m_impl->synapse.globalHostIdColumnIdx),
+			  hostIdColumnName,
+			  m_impl->targetServerId,
+			  m_impl->targetHostId);
+		} else {
+			privilegeCondition = makeCondition(
+			  srvHostGrpSetMap,
+			  getServerIdColumnName(),
+			  getHostgroupIdColumnName(),
+			  hostIdColumnName,
+			  m_impl->targetServerId,
+			  m_impl->targetHostgroupId,
+			  m_impl->targetHostId);
+		}
+		dataQueryContext.cacheCondition(cacheKey, privilegeCondition);
+	}
+	addCondition(condition, privilegeCondition);
 	return condition;
 }
 
@@ -236,9 +287,11 @@ bool HostResourceQueryOption::isHostgroupUsed(void) const
 	const Synapse &synapse = m_impl->synapse;
 	if (!synapse.needToJoinHostgroup)
 		return false;
-	if (isHostgroupEnumerationInCondition())
+	if (m_impl->targetHostgroupId != ALL_HOST_GROUPS)
 		return true;
-	return m_impl->targetHostgroupId != ALL_HOST_GROUPS;
+	if (isHostIdBitmapUsed())
+		return false;
+	return isHostgroupEnumerationInCondition();
 }
 
 string HostResourceQueryOption::getColumnName(const size_t &idx) const
@@ -295,6 +348,46 @@ const bool &HostResourceQueryOption::getFilterForDataOfDefunctServers(void) cons
 	return m_impl->filterDataOfDefunctServers;
 }
 
+void HostResourceQueryOption::setAuthorizationStrategy(
+  const AuthorizationStrategy &strategy)
+{
+	m_impl->authorizationStrategy = strategy;
+}
+
+HostResourceQueryOption::AuthorizationStrategy
+  HostResourceQueryOption::getAuthorizationStrategy(void) const
+{
+	return m_impl->authorizationStrategy;
+}
+
+bool HostResourceQueryOption::isHostIdBitmapUsed(void) const
+{
+	const AuthorizationStrategy &strategy = m_impl->authorizationStrategy;
+	if (strategy == AUTHORIZATION_STRATEGY_HOSTGROUP)
+		return false;
+	if (!m_impl->hasGlobalHostIdColumns())
+		return false;
+	if (m_impl->targetHostgroupId != ALL_HOST_GROUPS)
+		return false;
+	if (!isHostgroupEnumerationInCondition())
+		return false;
+	if (strategy == AUTHORIZATION_STRATEGY_HOST_ID_BITMAP)
+		return true;
+
+	size_t numHostgroups = 0;
+	const ServerHostGrpSetMap &srvHostGrpSetMap =
+	  getDataQueryContext().getServerHostGrpSetMap();
+	ServerHostGrpSetMapConstIterator it = srvHostGrpSetMap.begin();
+	for (; it != srvHostGrpSetMap.end(); ++it)
+		numHostgroups += it->second.size();
+	if (numHostgroups < HOST_ID_BITMAP_STRATEGY_THRESHOLD)
+		return false;
+	const size_t numRanges =
+	  UserPrivilegeCache::getInstance()->getNumberOfHostIdRanges(
+	    getUserId());
+	return numRanges <= MAX_HOST_ID_RANGES;
+}
+
 // ---------------------------------------------------------------------------
 // Protected methods
 // ---------------------------------------------------------------------------
@@ -444,6 +537,120 @@ string HostResourceQueryOption::makeCondition(
 	return StringUtils::sprintf("(%s)", condition.c_str());
 }
 
+string HostResourceQueryOption::makeConditionWithHostIdBitmap(
+  const ServerHostGrpSetMap &srvHostGrpSetMap,
+  const ServerHostIdBitmapMap &hostIdBitmapMap,
+  const string &serverIdColumnName,
+  const string &globalHostIdColumnName,
+  const string &hostIdColumnName,
+  const ServerIdType    &targetServerId,
+  const LocalHostIdType &targetHostId) const
+{
+	if (srvHostGrpSetMap.empty()) {
+		MLPL_DBG("No allowed server\n");
+		return DBHatohol::getAlwaysFalseCondition();
+	}
+
+	if (targetServerId != ALL_SERVERS &&
+	    srvHostGrpSetMap.find(targetServerId) == srvHostGrpSetMap.end())
+	{
+		return DBHatohol::getAlwaysFalseCondition();
+	}
+
+	DBTermCStringProvider rhs(*getDBTermCodec());
+	string condition;
+	size_t numServers = 0;
+	ServerHostGrpSetMapConstIterator it = srvHostGrpSetMap.begin();
+	for (; it != srvHostGrpSetMap.end(); ++it) {
+		const ServerIdType &serverId = it->first;
+
+		if (targetServerId != ALL_SERVERS && targetServerId != serverId)
+			continue;
+
+		if (serverId == ALL_SERVERS)
+			return "";
+
+		string conditionServer = StringUtils::sprintf(
+		  "%s=%s", serverIdColumnName.c_str(), rhs(serverId));
+		const HostgroupIdSet &hostgroupIdSet = it->second;
+		if (hostgroupIdSet.find(ALL_HOST_GROUPS) ==
+		    hostgroupIdSet.end()) {
+			ServerHostIdBitmapMapConstIterator bitmapItr =
+			  hostIdBitmapMap.find(serverId);
+			// The host groups have no member.
+			if (bitmapItr == hostIdBitmapMap.end() ||
+			    bitmapItr->second.empty())
+				continue;
+			conditionServer = StringUtils::sprintf(
+			  "(%s AND %s)", conditionServer.c_str(),
+			  makeConditionHostIdRanges(
+			    bitmapItr->second, globalHostIdColumnName).c_str());
+		}
+		addCondition(condition, conditionServer, ADD_TYPE_OR);
+		++numServers;
+	}
+
+	if (numServers == 0)
+		return DBHatohol::getAlwaysFalseCondition();
+
+	if (targetHostId != ALL_LOCAL_HOSTS) {
+		return StringUtils::sprintf(
+		         "((%s) AND %s=%s)",
+		         condition.c_str(), hostIdColumnName.c_str(),
+		         rhs(targetHostId));
+	}
+
+	if (numServers == 1)
+		return condition;
+	return StringUtils::sprintf("(%s)", condition.c_str());
+}
+
+string HostResourceQueryOption::makeConditionHostIdRanges(
+  const HostIdBitmap &hostIdBitmap, const string &globalHostIdColumnName)
+  const
+{
+	// A run shorter than this is put into the IN clause.
+	static const HostIdType MIN_BETWEEN_RUN_LENGTH = 3;
+
+	HostIdRangeVect ranges;
+	hostIdBitmap.getRanges(ranges);
+
+	string condition;
+	string inList;
+	size_t numTerms = 0;
+	HostIdRangeVectConstIterator it = ranges.begin();
+	for (; it != ranges.end(); ++it) {
+		const HostIdType &first = it->first;
+		const HostIdType &last = it->second;
+		if (last - first + 1 >= MIN_BETWEEN_RUN_LENGTH) {
+			addCondition(condition,
+			  StringUtils::sprintf(
+			    "%s BETWEEN %" FMT_HOST_ID " AND %" FMT_HOST_ID,
+			    globalHostIdColumnName.c_str(), first, last),
+			  ADD_TYPE_OR);
+			++numTerms;
+			continue;
+		}
+		for (HostIdType hostId = first; hostId <= last; hostId++) {
+			if (!inList.empty())
+				inList += ",";
+			inList += StringUtils::sprintf("%" FMT_HOST_ID, hostId);
+		}
+	}
+	if (!inList.empty()) {
+		addCondition(condition,
+		  StringUtils::sprintf("%s IN (%s)",
+		                       globalHostIdColumnName.c_str(),
+		                       inList.c_str()),
+		  ADD_TYPE_OR);
+		++numTerms;
+	}
+
+	if (numTerms == 1)
+		return condition;
+	return StringUtils::sprintf("(%s)", condition.c_str());
+}
+
 string HostResourceQueryOption::getFromClauseForOneTable(void) const
 {
 	return getPrimaryTableName();
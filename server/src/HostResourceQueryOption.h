@@ -24,6 +24,7 @@
 #include "Params.h"
 #include "DBAgent.h"
 #include "DataQueryOption.h"
+#include "HostIdBitmap.h"
 
 class HostResourceQueryOption : public DataQueryOption {
 public:
@@ -60,6 +61,41 @@ public:
 		       = INVALID_COLUMN_IDX);
 	};
 
+	/**
+	 * How the accessible hosts of a non-admin user are expressed
+	 * in the condition.
+	 */
+	enum AuthorizationStrategy {
+		// Choose one of the followings by the number of the
+		// accessible host groups.
+		AUTHORIZATION_STRATEGY_AUTO,
+
+		// Server IDs and host group IDs with a join to the host group
+		// member table.
+		AUTHORIZATION_STRATEGY_HOSTGROUP,
+
+		// Ranges of the global host IDs made from the cached bitmaps.
+		// This is used only when the synapse has the global host ID
+		// columns.
+		AUTHORIZATION_STRATEGY_HOST_ID_BITMAP,
+	};
+
+	/**
+	 * The minimum number of the host groups accessible by the user
+	 * for AUTHORIZATION_STRATEGY_AUTO to choose
+	 * AUTHORIZATION_STRATEGY_HOST_ID_BITMAP.
+	 */
+	static const size_t HOST_ID_BITMAP_STRATEGY_THRESHOLD;
+
+	/**
+	 * The maximum number of the ranges of the accessible host IDs for
+	 * AUTHORIZATION_STRATEGY_AUTO to choose
+	 * AUTHORIZATION_STRATEGY_HOST_ID_BITMAP. Above it, the host group
+	 * join is used because the IN list and the BETWEEN terms get too
+	 * long for the DB to parse and plan cheaply.
+	 */
+	static const size_t MAX_HOST_ID_RANGES;
+
 	HostResourceQueryOption(const Synapse &synapse,
 	                        const UserIdType &userId = INVALID_USER_ID);
 	HostResourceQueryOption(const Synapse &synapse,
@@ -142,6 +178,17 @@ public:
 
 	std::string getJoinClause(void) const;
 
+	void setAuthorizationStrategy(const AuthorizationStrategy &strategy);
+	AuthorizationStrategy getAuthorizationStrategy(void) const;
+
+	/**
+	 * Check if the condition is made with
+	 * AUTHORIZATION_STRATEGY_HOST_ID_BITMAP.
+	 *
+	 * @return true if the host ID bitmaps are used. Otherwise false.
+	 */
+	bool isHostIdBitmapUsed(void) const;
+
 protected:
 	std::string getServerIdColumnName(void) const;
 	std::string getHostgroupIdColumnName(void) const;
@@ -167,6 +214,17 @@ protected:
 	std::string makeConditionHostgroup(
 	  const HostgroupIdSet &hostgroupIdSet,
 	  const std::string &hostgroupIdColumnName) const;
+	std::string makeConditionWithHostIdBitmap(
+	  const ServerHostGrpSetMap &srvHostGrpSetMap,
+	  const ServerHostIdBitmapMap &hostIdBitmapMap,
+	  const std::string &serverIdColumnName,
+	  const std::string &globalHostIdColumnName,
+	  const std::string &hostIdColumnName,
+	  const ServerIdType    &targetServerId = ALL_SERVERS,
+	  const LocalHostIdType &targetHostId = ALL_LOCAL_HOSTS) const;
+	std::string makeConditionHostIdRanges(
+	  const HostIdBitmap &hostIdBitmap,
+	  const std::string &globalHostIdColumnName) const;
 
 	virtual std::string getFromClauseForOneTable(void) const;
 	virtual std::string getFromClauseWithHostgroup(void) const;
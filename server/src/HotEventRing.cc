@@ -0,0 +1,560 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <Mutex.h>
+#include <ReadWriteLock.h>
+#include <Reaper.h>
+#include "HotEventRing.h"
+#include "DataQueryContext.h"
+#include "HatoholException.h"
+#include "ThreadLocalDBCache.h"
+
+using namespace std;
+using namespace mlpl;
+
+typedef uint64_t HotEventRingGeneration;
+
+const size_t HotEventRing::DEFAULT_CAPACITY = 1000;
+
+// The same order as EventsQueryOption::SORT_TIME
+struct EventTimeKey {
+	timespec           time;
+	UnifiedEventIdType unifiedId;
+
+	EventTimeKey(void)
+	: unifiedId(0)
+	{
+		time.tv_sec = 0;
+		time.tv_nsec = 0;
+	}
+
+	EventTimeKey(const EventInfo &eventInfo)
+	: time(eventInfo.time),
+	  unifiedId(eventInfo.unifiedId)
+	{
+	}
+
+	EventTimeKey(const timespec &_time, const UnifiedEventIdType &_unifiedId)
+	: time(_time),
+	  unifiedId(_unifiedId)
+	{
+	}
+
+	bool operator<(const EventTimeKey &rhs) const
+	{
+		if (time.tv_sec != rhs.time.tv_sec)
+			return time.tv_sec < rhs.time.tv_sec;
+		if (time.tv_nsec != rhs.time.tv_nsec)
+			return time.tv_nsec < rhs.time.tv_nsec;
+		return unifiedId < rhs.unifiedId;
+	}
+};
+
+struct ServerRing {
+	// The events in the ascending order of the unified ID.
+	deque<EventInfo>   events;
+
+	// All events whose unified ID is equal to or greater than this
+	// are in 'events'.
+	UnifiedEventIdType floorId;
+
+	// The newest key of the events that aren't in 'events'.
+	bool               hasOutsideEvent;
+	EventTimeKey       newestOutsideKey;
+
+	ServerRing(void)
+	: floorId(0),
+	  hasOutsideEvent(false)
+	{
+	}
+
+	void addOutsideEvent(const EventInfo &eventInfo)
+	{
+		const EventTimeKey key(eventInfo);
+		if (hasOutsideEvent && !(newestOutsideKey < key))
+			return;
+		newestOutsideKey = key;
+		hasOutsideEvent = true;
+	}
+
+	void add(const EventInfo &eventInfo, const size_t &capacity)
+	{
+		if (eventInfo.unifiedId < floorId) {
+			addOutsideEvent(eventInfo);
+			return;
+		}
+
+		// Events are committed almost in the order of the unified ID.
+		// So we search the position from the end.
+		deque<EventInfo>::iterator it = events.end();
+		while (it != events.begin()) {
+			deque<EventInfo>::iterator prev = it - 1;
+			if (prev->unifiedId < eventInfo.unifiedId)
+				break;
+			it = prev;
+		}
+		if (it != events.end() && it->unifiedId == eventInfo.unifiedId)
+			*it = eventInfo;
+		else
+			events.insert(it, eventInfo);
+
+		while (events.size() > capacity) {
+			addOutsideEvent(events.front());
+			floorId = events.front().unifiedId + 1;
+			events.pop_front();
+		}
+	}
+
+	void load(const ServerIdType &serverId, const size_t &capacity)
+	{
+		ThreadLocalDBCache cache;
+		DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
+
+		EventInfoList eventInfoList;
+		EventsQueryOption option(USER_ID_SYSTEM);
+		option.setTargetServerId(serverId);
+		option.setSortType(EventsQueryOption::SORT_UNIFIED_ID,
+		                   DataQueryOption::SORT_DESCENDING);
+		option.setMaximumNumber(capacity + 1);
+		dbMonitoring.getEventInfoList(eventInfoList, option);
+
+		if (eventInfoList.size() > capacity) {
+			eventInfoList.pop_back();
+			floorId = eventInfoList.back().unifiedId;
+
+			EventInfoList outsideList;
+			EventsQueryOption outsideOption(USER_ID_SYSTEM);
+			outsideOption.setTargetServerId(serverId);
+			outsideOption.setLimitOfUnifiedId(floorId - 1);
+			outsideOption.setSortType(
+			  EventsQueryOption::SORT_TIME,
+			  DataQueryOption::SORT_DESCENDING);
+			outsideOption.setMaximumNumber(1);
+			dbMonitoring.getEventInfoList(outsideList,
+			                              outsideOption);
+			if (!outsideList.empty())
+				addOutsideEvent(outsideList.front());
+		}
+
+		EventInfoList::reverse_iterator it = eventInfoList.rbegin();
+		for (; it != eventInfoList.rend(); ++it)
+			events.push_back(*it);
+	}
+};
+
+typedef map<ServerIdType, ServerRing>   ServerRingMap;
+typedef ServerRingMap::iterator         ServerRingMapIterator;
+typedef ServerRingMap::const_iterator   ServerRingMapConstIterator;
+
+struct EventMatcher {
+	LocalHostIdType     targetHostId;
+	UnifiedEventIdType  limitOfUnifiedId;
+	TriggerSeverityType minSeverity;
+	TriggerStatusType   triggerStatus;
+	TriggerIdType       triggerId;
+	bool                sortByTime;
+	bool                hasCursor;
+	EventTimeKey        cursorKey;
+
+	// Only the descending order is supported.
+	EventMatcher(const EventsQueryOption &option)
+	: targetHostId(option.getTargetHostId()),
+	  limitOfUnifiedId(option.getLimitOfUnifiedId()),
+	  minSeverity(option.getMinimumSeverity()),
+	  triggerStatus(option.getTriggerStatus()),
+	  triggerId(option.getTriggerId()),
+	  sortByTime(option.getSortType() == EventsQueryOption::SORT_TIME),
+	  hasCursor(option.hasCursor()),
+	  cursorKey(option.getCursorTime(), option.getCursorUnifiedId())
+	{
+	}
+
+	bool operator()(const EventInfo &eventInfo) const
+	{
+		if (targetHostId != ALL_LOCAL_HOSTS &&
+		    eventInfo.hostIdInServer != targetHostId)
+			return false;
+		if (limitOfUnifiedId && eventInfo.unifiedId > limitOfUnifiedId)
+			return false;
+		if (minSeverity != TRIGGER_SEVERITY_UNKNOWN &&
+		    eventInfo.severity < minSeverity)
+			return false;
+		if (triggerStatus != TRIGGER_STATUS_ALL &&
+		    eventInfo.status != triggerStatus)
+			return false;
+		if (triggerId != ALL_TRIGGERS && eventInfo.triggerId != triggerId)
+			return false;
+		if (hasCursor) {
+			if (sortByTime && !(EventTimeKey(eventInfo) < cursorKey))
+				return false;
+			if (!sortByTime &&
+			    eventInfo.unifiedId >= cursorKey.unifiedId)
+				return false;
+		}
+		return true;
+	}
+};
+
+struct NewerUnifiedId {
+	bool operator()(const EventInfo *lhs, const EventInfo *rhs) const
+	{
+		return lhs->unifiedId > rhs->unifiedId;
+	}
+};
+
+struct NewerTime {
+	bool operator()(const EventInfo *lhs, const EventInfo *rhs) const
+	{
+		return EventTimeKey(*rhs) < EventTimeKey(*lhs);
+	}
+};
+
+struct HotEventRing::Impl {
+	static Mutex         initLock;
+	static HotEventRing *instance;
+
+	ReadWriteLock rwlock;
+	ServerRingMap serverRingMap;
+	size_t        capacity;
+
+	// See the comment in OverviewCounter::Impl.
+	HotEventRingGeneration                    generation;
+	map<ServerIdType, HotEventRingGeneration> generationMap;
+
+	Impl(void)
+	: capacity(DEFAULT_CAPACITY),
+	  generation(0)
+	{
+	}
+
+	// This method shall be called with rwlock taken.
+	HotEventRingGeneration getGeneration(const ServerIdType &serverId)
+	{
+		map<ServerIdType, HotEventRingGeneration>::const_iterator
+		  it = generationMap.find(serverId);
+		if (it == generationMap.end())
+			return generation;
+		return generation + it->second;
+	}
+
+	// This method shall be called with the writer lock.
+	void add(const EventInfo &eventInfo)
+	{
+		ServerRingMapIterator it = serverRingMap.find(eventInfo.serverId);
+		if (it == serverRingMap.end()) {
+			generationMap[eventInfo.serverId]++;
+			return;
+		}
+		it->second.add(eventInfo, capacity);
+	}
+
+	enum Visibility {
+		INVISIBLE,
+		PARTIALLY_VISIBLE,
+		VISIBLE,
+	};
+
+	static Visibility getVisibility(DataQueryContext &dataQueryContext,
+	                                const ServerIdType &serverId)
+	{
+		const OperationPrivilege &privilege =
+		  dataQueryContext.getOperationPrivilege();
+		if (privilege.getUserId() == USER_ID_SYSTEM ||
+		    privilege.has(OPPRVLG_GET_ALL_SERVER))
+			return VISIBLE;
+
+		const ServerHostGrpSetMap &srvHostGrpSetMap =
+		  dataQueryContext.getServerHostGrpSetMap();
+		if (srvHostGrpSetMap.find(ALL_SERVERS) != srvHostGrpSetMap.end())
+			return VISIBLE;
+		ServerHostGrpSetMapConstIterator it =
+		  srvHostGrpSetMap.find(serverId);
+		if (it == srvHostGrpSetMap.end())
+			return INVISIBLE;
+		if (it->second.count(ALL_HOST_GROUPS))
+			return VISIBLE;
+		return PARTIALLY_VISIBLE;
+	}
+
+	static bool getTargetServers(ServerIdSet &serverIdSet,
+	                             const EventsQueryOption &option)
+	{
+		DataQueryContext &dataQueryContext =
+		  option.getDataQueryContext();
+		const ServerIdSet &validServerIdSet =
+		  dataQueryContext.getValidServerIdSet();
+		const ServerIdType targetServerId = option.getTargetServerId();
+		ServerIdSetConstIterator it = validServerIdSet.begin();
+		for (; it != validServerIdSet.end(); ++it) {
+			if (targetServerId != ALL_SERVERS &&
+			    *it != targetServerId)
+				continue;
+			const Visibility visibility =
+			  getVisibility(dataQueryContext, *it);
+			if (visibility == PARTIALLY_VISIBLE)
+				return false;
+			if (visibility == VISIBLE)
+				serverIdSet.insert(*it);
+		}
+		return true;
+	}
+
+	static bool isServable(const EventsQueryOption &option)
+	{
+		if (option.getUserId() == INVALID_USER_ID)
+			return false;
+		if (option.getSortDirection() != DataQueryOption::SORT_DESCENDING)
+			return false;
+		if (option.isReversedByCursor())
+			return false;
+		if (option.getMaximumNumber() == DataQueryOption::NO_LIMIT)
+			return false;
+		if (option.getTargetHostgroupId() != ALL_HOST_GROUPS)
+			return false;
+		if (!option.getFilterForDataOfDefunctServers())
+			return false;
+		// A time range mostly points to the events older than
+		// the ring.
+		if (option.getBeginTime() || option.getEndTime())
+			return false;
+		return true;
+	}
+
+	void load(const ServerIdSet &serverIdSet)
+	{
+		ServerIdSet unloadedServerIdSet;
+		map<ServerIdType, HotEventRingGeneration> loadedGenerationMap;
+		size_t loadedCapacity;
+
+		rwlock.readLock();
+		loadedCapacity = capacity;
+		ServerIdSetConstIterator it = serverIdSet.begin();
+		for (; it != serverIdSet.end(); ++it) {
+			if (serverRingMap.find(*it) != serverRingMap.end())
+				continue;
+			unloadedServerIdSet.insert(*it);
+			loadedGenerationMap[*it] = getGeneration(*it);
+		}
+		rwlock.unlock();
+
+		it = unloadedServerIdSet.begin();
+		for (; it != unloadedServerIdSet.end(); ++it) {
+			ServerRing serverRing;
+			serverRing.load(*it, loadedCapacity);
+
+			rwlock.writeLock();
+			Reaper<ReadWriteLock> unlocker(&rwlock,
+			                               ReadWriteLock::unlock);
+			if (getGeneration(*it) != loadedGenerationMap[*it])
+				continue;
+			if (capacity != loadedCapacity)
+				continue;
+			if (serverRingMap.find(*it) != serverRingMap.end())
+				continue;
+			serverRingMap[*it] = serverRing;
+		}
+	}
+
+	// This method shall be called with rwlock taken.
+	bool collect(EventInfoList &eventInfoList,
+	             const EventsQueryOption &option,
+	             const ServerIdSet &serverIdSet)
+	{
+		const bool sortByTime =
+		  (option.getSortType() == EventsQueryOption::SORT_TIME);
+		const size_t offset = option.getOffset();
+		const size_t numRequired = offset + option.getMaximumNumber();
+		const EventMatcher matcher(option);
+
+		vector<const EventInfo *> candidates;
+		UnifiedEventIdType maxFloorId = 0;
+		bool hasOutsideEvent = false;
+		EventTimeKey newestOutsideKey;
+
+		ServerIdSetConstIterator it = serverIdSet.begin();
+		for (; it != serverIdSet.end(); ++it) {
+			ServerRingMapConstIterator ringItr =
+			  serverRingMap.find(*it);
+			if (ringItr == serverRingMap.end())
+				return false;
+			const ServerRing &serverRing = ringItr->second;
+			maxFloorId = max(maxFloorId, serverRing.floorId);
+			if (serverRing.hasOutsideEvent &&
+			    (!hasOutsideEvent ||
+			     newestOutsideKey < serverRing.newestOutsideKey)) {
+				newestOutsideKey = serverRing.newestOutsideKey;
+				hasOutsideEvent = true;
+			}
+
+			size_t numMatched = 0;
+			deque<EventInfo>::const_reverse_iterator evItr =
+			  serverRing.events.rbegin();
+			for (; evItr != serverRing.events.rend(); ++evItr) {
+				if (!matcher(*evItr))
+					continue;
+				candidates.push_back(&*evItr);
+				// The older ones are never used.
+				if (!sortByTime && ++numMatched >= numRequired)
+					break;
+			}
+		}
+
+		const size_t numSorted = min(numRequired, candidates.size());
+		if (sortByTime) {
+			partial_sort(candidates.begin(),
+			             candidates.begin() + numSorted,
+			             candidates.end(), NewerTime());
+		} else {
+			partial_sort(candidates.begin(),
+			             candidates.begin() + numSorted,
+			             candidates.end(), NewerUnifiedId());
+		}
+
+		// An event outside the rings may be newer than the last one.
+		if (candidates.size() < numRequired) {
+			if (sortByTime ? hasOutsideEvent : maxFloorId)
+				return false;
+		} else {
+			const EventInfo &last = *candidates[numRequired - 1];
+			if (sortByTime) {
+				if (hasOutsideEvent &&
+				    !(newestOutsideKey < EventTimeKey(last)))
+					return false;
+			} else if (last.unifiedId < maxFloorId) {
+				return false;
+			}
+		}
+
+		for (size_t i = offset; i < numSorted; i++)
+			eventInfoList.push_back(*candidates[i]);
+		return true;
+	}
+};
+
+Mutex         HotEventRing::Impl::initLock;
+HotEventRing *HotEventRing::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void HotEventRing::reset(void)
+{
+	getInstance()->invalidateAll();
+}
+
+HotEventRing *HotEventRing::getInstance(void)
+{
+	Impl::initLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new HotEventRing();
+	Impl::initLock.unlock();
+	return Impl::instance;
+}
+
+bool HotEventRing::getEventInfoList(EventInfoList &eventInfoList,
+                                    const EventsQueryOption &option)
+{
+	if (!Impl::isServable(option))
+		return false;
+	if (option.getOffset() + option.getMaximumNumber() > getCapacity())
+		return false;
+
+	ServerIdSet serverIdSet;
+	if (!Impl::getTargetServers(serverIdSet, option))
+		return false;
+	m_impl->load(serverIdSet);
+
+	m_impl->rwlock.readLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	return m_impl->collect(eventInfoList, option, serverIdSet);
+}
+
+void HotEventRing::addEventInfo(const EventInfo &eventInfo)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	m_impl->add(eventInfo);
+}
+
+void HotEventRing::addEventInfoList(const EventInfoList &eventInfoList)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	EventInfoListConstIterator it = eventInfoList.begin();
+	for (; it != eventInfoList.end(); ++it)
+		m_impl->add(*it);
+}
+
+void HotEventRing::invalidate(const ServerIdType &serverId)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generationMap[serverId]++;
+	m_impl->serverRingMap.erase(serverId);
+	m_impl->rwlock.unlock();
+}
+
+void HotEventRing::invalidateAll(void)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generation++;
+	m_impl->serverRingMap.clear();
+	m_impl->rwlock.unlock();
+}
+
+void HotEventRing::setCapacity(const size_t &capacity)
+{
+	HATOHOL_ASSERT(capacity > 0, "The capacity must be greater than 0.");
+	m_impl->rwlock.writeLock();
+	m_impl->capacity = capacity;
+	m_impl->generation++;
+	m_impl->serverRingMap.clear();
+	m_impl->rwlock.unlock();
+}
+
+size_t HotEventRing::getCapacity(void) const
+{
+	m_impl->rwlock.readLock();
+	const size_t capacity = m_impl->capacity;
+	m_impl->rwlock.unlock();
+	return capacity;
+}
+
+bool HotEventRing::isLoaded(const ServerIdType &serverId) const
+{
+	m_impl->rwlock.readLock();
+	const bool loaded = m_impl->serverRingMap.count(serverId);
+	m_impl->rwlock.unlock();
+	return loaded;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+HotEventRing::HotEventRing(void)
+: m_impl(new Impl())
+{
+}
+
+HotEventRing::~HotEventRing()
+{
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HotEventRing_h
+#define HotEventRing_h
+
+#include <memory>
+#include "Params.h"
+#include "Monitoring.h"
+
+class EventsQueryOption;
+
+/**
+ * Process-wide rings that hold the newest events of each server.
+ *
+ * The ring of a server is loaded from the DB at the first query that
+ * needs it and then updated with the events stored by DBTablesMonitoring.
+ * A query is answered from the rings only when it is certain that the
+ * events outside the rings don't appear in the requested page. The
+ * following queries are always left to the DB.
+ * - Queries sorted in the ascending order, including the ones with a
+ *   CURSOR_PREV cursor.
+ * - Queries with a target host group.
+ * - Queries by users who can see only a part of a target server.
+ * - Queries that include the data of defunct servers.
+ * - Queries whose offset + limit exceeds the capacity of the ring.
+ */
+class HotEventRing {
+public:
+	static const size_t DEFAULT_CAPACITY;
+
+	static void reset(void);
+	static HotEventRing *getInstance(void);
+
+	/**
+	 * Get events from the rings.
+	 *
+	 * @param eventInfoList The obtained events are added to this.
+	 * @param option An EventsQueryOption instance.
+	 *
+	 * @return
+	 * true if the events are obtained. Otherwise false is returned and
+	 * eventInfoList is not changed. In that case, the caller should get
+	 * them from the DB.
+	 */
+	bool getEventInfoList(EventInfoList &eventInfoList,
+	                      const EventsQueryOption &option);
+
+	/**
+	 * The following methods shall be called after the data is committed.
+	 * addEventInfo() and addEventInfoList() must not be called with an
+	 * event that replaced an existing row, because its unified ID may
+	 * not be reported by the DB. Call invalidate() for its server instead.
+	 */
+	void addEventInfo(const EventInfo &eventInfo);
+	void addEventInfoList(const EventInfoList &eventInfoList);
+	void invalidate(const ServerIdType &serverId);
+	void invalidateAll(void);
+
+	/**
+	 * Set the maximum number of the events held for each server.
+	 * The loaded rings are discarded.
+	 *
+	 * @param capacity A capacity. It must be greater than 0.
+	 */
+	void setCapacity(const size_t &capacity);
+	size_t getCapacity(void) const;
+
+	bool isLoaded(const ServerIdType &serverId) const;
+
+protected:
+	HotEventRing(void);
+	virtual ~HotEventRing();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // HotEventRing_h
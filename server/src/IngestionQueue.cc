@@ -0,0 +1,595 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <list>
+#include <set>
+#include <map>
+#include <vector>
+#include <Mutex.h>
+#include <SimpleSemaphore.h>
+#include <SmartTime.h>
+#include "IngestionQueue.h"
+#include "HatoholThreadBase.h"
+#include "ThreadLocalDBCache.h"
+#include "ActionManager.h"
+using namespace std;
+using namespace mlpl;
+
+const size_t IngestionQueue::DEFAULT_MAX_QUEUE_SIZE = 1000;
+const size_t IngestionQueue::MAX_BATCHES_PER_COMMIT = 100;
+
+// A writer doesn't wait for a batch longer than this, so that it can
+// take batches of a server that another writer has finished.
+static const size_t WRITER_IDLE_WAIT_MSEC = 1000;
+
+static const size_t BLOCKED_WARNING_INTERVAL_MSEC = 10 * 1000;
+
+// ---------------------------------------------------------------------------
+// Private context
+// ---------------------------------------------------------------------------
+struct IngestionBatch {
+	enum Type {
+		EVENTS,
+		ITEMS,
+		SERVER_STATUS,
+	};
+
+	Type                   type;
+	ServerIdType           serverId;
+	size_t                 seq;
+	EventInfoList          eventList;
+	ItemInfoList           itemList;
+	MonitoringServerStatus serverStatus;
+	Closure1<bool>        *committedCb;
+
+	IngestionBatch(const Type &_type, const ServerIdType &_serverId)
+	: type(_type),
+	  serverId(_serverId),
+	  seq(0),
+	  committedCb(NULL)
+	{
+	}
+
+	~IngestionBatch()
+	{
+		delete committedCb;
+	}
+};
+
+typedef list<IngestionBatch *>             IngestionBatchList;
+typedef IngestionBatchList::iterator       IngestionBatchListIterator;
+typedef IngestionBatchList::const_iterator IngestionBatchListConstIterator;
+
+struct FlushWaiter {
+	size_t           seq; // Waits for the batches before this.
+	ServerIdType     serverId;
+	SimpleSemaphore *sem;
+};
+
+typedef list<FlushWaiter>          FlushWaiterList;
+typedef FlushWaiterList::iterator  FlushWaiterListIterator;
+
+typedef map<ServerIdType, set<size_t> >  ServerSeqsMap;
+typedef ServerSeqsMap::iterator          ServerSeqsMapIterator;
+typedef ServerSeqsMap::const_iterator    ServerSeqsMapConstIterator;
+
+typedef map<ServerIdType, size_t>        ServerDroppedMap;
+typedef ServerDroppedMap::iterator       ServerDroppedMapIterator;
+
+struct IngestionQueue::Impl {
+	struct Writer : public HatoholThreadBase {
+		// 'Impl' in this scope is that of HatoholThreadBase.
+		IngestionQueue::Impl &impl;
+
+		Writer(IngestionQueue::Impl &_impl)
+		: impl(_impl)
+		{
+		}
+
+		virtual void waitExit(void) override
+		{
+			impl.wakeSem.post();
+			HatoholThreadBase::waitExit();
+		}
+
+	protected:
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			while (true) {
+				IngestionBatchList group;
+				impl.takeGroup(group);
+				if (group.empty()) {
+					// The rest are taken by the other writers.
+					if (isExitRequested())
+						break;
+					impl.wakeSem.timedWait(
+					  WRITER_IDLE_WAIT_MSEC);
+					continue;
+				}
+				impl.process(group);
+				impl.finish(group);
+			}
+			return NULL;
+		}
+	};
+
+	static Mutex           initLock;
+	static IngestionQueue *instance;
+
+	Mutex                  lock;
+	IngestionBatchList     queue;          // should be used with lock.
+	set<ServerIdType>      busyServerIds;  // should be used with lock.
+	set<size_t>            unfinishedSeqs; // should be used with lock.
+	ServerSeqsMap          serverUnfinishedSeqsMap; // ditto.
+	FlushWaiterList        flushWaiters;   // should be used with lock.
+	IngestionQueue::Stats  stats;          // should be used with lock.
+
+	// The numbers of the dropped batches that are not reported by
+	// flush() yet. They should be used with lock.
+	ServerDroppedMap       serverDroppedMap;
+	size_t                 numDroppedAtLastFlush;
+	SimpleSemaphore        slotSem;
+	SimpleSemaphore        wakeSem;
+	vector<Writer *>       writers;
+	bool                   started;        // should be used with lock.
+
+	Impl(void)
+	: slotSem(DEFAULT_MAX_QUEUE_SIZE),
+	  wakeSem(0),
+	  numDroppedAtLastFlush(0),
+	  started(false)
+	{
+		stats.maxQueueSize = DEFAULT_MAX_QUEUE_SIZE;
+	}
+
+	void clear(void)
+	{
+		lock.lock();
+		IngestionBatchListIterator it = queue.begin();
+		for (; it != queue.end(); ++it)
+			delete *it;
+		queue.clear();
+		busyServerIds.clear();
+		unfinishedSeqs.clear();
+		serverUnfinishedSeqsMap.clear();
+		wakeFlushWaiters();
+		serverDroppedMap.clear();
+		numDroppedAtLastFlush = 0;
+		stats = IngestionQueue::Stats();
+		stats.maxQueueSize = DEFAULT_MAX_QUEUE_SIZE;
+		slotSem.init(DEFAULT_MAX_QUEUE_SIZE);
+		lock.unlock();
+	}
+
+	void enqueue(IngestionBatch *batch)
+	{
+		if (slotSem.tryWait() != 0) {
+			// Backpressure: The caller waits until a writer
+			// finishes some batches.
+			SmartTime waitTime(SmartTime::INIT_CURR_TIME);
+			while (slotSem.timedWait(BLOCKED_WARNING_INTERVAL_MSEC)
+			       != SimpleSemaphore::STAT_OK) {
+				MLPL_WARN("Waiting for a room of "
+				          "the ingestion queue.\n");
+			}
+			SmartTime elapsedTime(SmartTime::INIT_CURR_TIME);
+			elapsedTime -= waitTime;
+			const double blockedTimeMSec = elapsedTime.getAsMSec();
+
+			AutoMutex autoMutex(&lock);
+			stats.numBlocked++;
+			stats.totalBlockedTimeMSec += blockedTimeMSec;
+			if (blockedTimeMSec > stats.maxBlockedTimeMSec)
+				stats.maxBlockedTimeMSec = blockedTimeMSec;
+		}
+
+		lock.lock();
+		batch->seq = stats.numEnqueued++;
+		queue.push_back(batch);
+		unfinishedSeqs.insert(batch->seq);
+		serverUnfinishedSeqsMap[batch->serverId].insert(batch->seq);
+		if (unfinishedSeqs.size() > stats.maxQueueDepth)
+			stats.maxQueueDepth = unfinishedSeqs.size();
+		lock.unlock();
+		wakeSem.post();
+	}
+
+	// Batches of the servers that are being written by the other
+	// writers are left in the queue to keep the order.
+	void takeGroup(IngestionBatchList &group)
+	{
+		AutoMutex autoMutex(&lock);
+		set<ServerIdType> groupServerIds;
+		IngestionBatchListIterator it = queue.begin();
+		while (it != queue.end() &&
+		       group.size() < MAX_BATCHES_PER_COMMIT) {
+			const ServerIdType serverId = (*it)->serverId;
+			if (busyServerIds.find(serverId) !=
+			    busyServerIds.end()) {
+				++it;
+				continue;
+			}
+			groupServerIds.insert(serverId);
+			group.push_back(*it);
+			it = queue.erase(it);
+		}
+		busyServerIds.insert(groupServerIds.begin(),
+		                     groupServerIds.end());
+	}
+
+	void write(const IngestionBatchList &group,
+	           EventInfoList &committedEventList)
+	{
+		typedef map<ServerIdType, const MonitoringServerStatus *>
+		  ServerStatusMap;
+		typedef ServerStatusMap::const_iterator
+		  ServerStatusMapConstIterator;
+
+		EventInfoList   eventList;
+		ItemInfoList    itemList;
+		ServerStatusMap serverStatusMap; // Only the latest one is used.
+		IngestionBatchListConstIterator it = group.begin();
+		for (; it != group.end(); ++it) {
+			const IngestionBatch &batch = **it;
+			switch (batch.type) {
+			case IngestionBatch::EVENTS:
+				eventList.insert(eventList.end(),
+				                 batch.eventList.begin(),
+				                 batch.eventList.end());
+				break;
+			case IngestionBatch::ITEMS:
+				itemList.insert(itemList.end(),
+				                batch.itemList.begin(),
+				                batch.itemList.end());
+				break;
+			case IngestionBatch::SERVER_STATUS:
+				serverStatusMap[batch.serverId] =
+				  &batch.serverStatus;
+				break;
+			}
+		}
+
+		MonitoringServerStatusList serverStatusList;
+		ServerStatusMapConstIterator statusIt = serverStatusMap.begin();
+		for (; statusIt != serverStatusMap.end(); ++statusIt)
+			serverStatusList.push_back(*statusIt->second);
+
+		// All kinds of data are written with one transaction. So
+		// nothing is left in the DB when it fails and the batches
+		// can be written again.
+		ThreadLocalDBCache cache;
+		cache.getMonitoring().addMonitoringData(eventList, itemList,
+		                                        serverStatusList);
+		committedEventList.splice(committedEventList.end(), eventList);
+
+		lock.lock();
+		stats.numCommitted += group.size();
+		stats.numTransactions++;
+		lock.unlock();
+
+		for (it = group.begin(); it != group.end(); ++it)
+			notifyCommitted(**it, true);
+	}
+
+	void process(const IngestionBatchList &group)
+	{
+		EventInfoList committedEventList;
+		try {
+			write(group, committedEventList);
+		} catch (const exception &e) {
+			MLPL_ERR("Failed to write %zd batches: %s\n",
+			         group.size(), e.what());
+			committedEventList.clear();
+			if (group.size() > 1)
+				writeOneByOne(group, committedEventList);
+			else
+				countDropped(*group.front());
+		}
+		if (committedEventList.empty())
+			return;
+
+		// The hooks are called only for the committed events.
+		try {
+			ActionManager actionManager;
+			actionManager.checkEvents(committedEventList);
+		} catch (const exception &e) {
+			MLPL_ERR("Failed to check events: %s\n", e.what());
+		}
+	}
+
+	void writeOneByOne(const IngestionBatchList &group,
+	                   EventInfoList &committedEventList)
+	{
+		IngestionBatchListConstIterator it = group.begin();
+		for (; it != group.end(); ++it) {
+			IngestionBatchList batchList(1, *it);
+			try {
+				write(batchList, committedEventList);
+			} catch (const exception &e) {
+				MLPL_ERR("Drop a batch of server %"
+				         FMT_SERVER_ID ": %s\n",
+				         (*it)->serverId, e.what());
+				countDropped(**it);
+			}
+		}
+	}
+
+	void countDropped(IngestionBatch &batch)
+	{
+		lock.lock();
+		stats.numDropped++;
+		serverDroppedMap[batch.serverId]++;
+		lock.unlock();
+		notifyCommitted(batch, false);
+	}
+
+	void notifyCommitted(IngestionBatch &batch, const bool &committed)
+	{
+		if (!batch.committedCb)
+			return;
+		try {
+			(*batch.committedCb)(committed);
+		} catch (const exception &e) {
+			MLPL_ERR("Got exception in the callback: %s\n",
+			         e.what());
+		}
+		delete batch.committedCb;
+		batch.committedCb = NULL;
+	}
+
+	void finish(const IngestionBatchList &group)
+	{
+		lock.lock();
+		IngestionBatchListConstIterator it = group.begin();
+		for (; it != group.end(); ++it) {
+			const ServerIdType &serverId = (*it)->serverId;
+			busyServerIds.erase(serverId);
+			unfinishedSeqs.erase((*it)->seq);
+			ServerSeqsMapIterator seqsIt =
+			  serverUnfinishedSeqsMap.find(serverId);
+			seqsIt->second.erase((*it)->seq);
+			if (seqsIt->second.empty())
+				serverUnfinishedSeqsMap.erase(seqsIt);
+			delete *it;
+		}
+		wakeFlushWaiters();
+		lock.unlock();
+		for (size_t i = 0; i < group.size(); i++)
+			slotSem.post();
+
+		// Batches of the servers may be left in the queue.
+		wakeSem.post();
+	}
+
+	// Should be called with lock
+	bool isFinished(const ServerIdType &serverId, const size_t &seq) const
+	{
+		const set<size_t> *seqs = &unfinishedSeqs;
+		if (serverId != ALL_SERVERS) {
+			ServerSeqsMapConstIterator it =
+			  serverUnfinishedSeqsMap.find(serverId);
+			if (it == serverUnfinishedSeqsMap.end())
+				return true;
+			seqs = &it->second;
+		}
+		return seqs->empty() || *seqs->begin() >= seq;
+	}
+
+	// Should be called with lock
+	void wakeFlushWaiters(void)
+	{
+		FlushWaiterListIterator it = flushWaiters.begin();
+		while (it != flushWaiters.end()) {
+			if (!isFinished(it->serverId, it->seq)) {
+				++it;
+				continue;
+			}
+			it->sem->post();
+			it = flushWaiters.erase(it);
+		}
+	}
+
+	// Should be called with lock
+	bool takeDropped(const ServerIdType &serverId)
+	{
+		if (serverId == ALL_SERVERS) {
+			const bool dropped =
+			  stats.numDropped > numDroppedAtLastFlush;
+			numDroppedAtLastFlush = stats.numDropped;
+			return dropped;
+		}
+		ServerDroppedMapIterator it = serverDroppedMap.find(serverId);
+		if (it == serverDroppedMap.end())
+			return false;
+		serverDroppedMap.erase(it);
+		return true;
+	}
+
+	void writeAll(void)
+	{
+		while (true) {
+			IngestionBatchList group;
+			takeGroup(group);
+			if (group.empty())
+				break;
+			process(group);
+			finish(group);
+		}
+	}
+};
+
+Mutex           IngestionQueue::Impl::initLock;
+IngestionQueue *IngestionQueue::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Stats
+// ---------------------------------------------------------------------------
+IngestionQueue::Stats::Stats(void)
+: maxQueueSize(0),
+  queueDepth(0),
+  maxQueueDepth(0),
+  numEnqueued(0),
+  numCommitted(0),
+  numDropped(0),
+  numTransactions(0),
+  numBlocked(0),
+  totalBlockedTimeMSec(0),
+  maxBlockedTimeMSec(0)
+{
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void IngestionQueue::reset(void)
+{
+	IngestionQueue *ingestionQueue = getInstance();
+	ingestionQueue->stop();
+	ingestionQueue->m_impl->clear();
+}
+
+IngestionQueue *IngestionQueue::getInstance(void)
+{
+	Impl::initLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new IngestionQueue();
+	Impl::initLock.unlock();
+	return Impl::instance;
+}
+
+void IngestionQueue::start(const size_t &numWriters,
+                           const size_t &maxQueueSize)
+{
+	HATOHOL_ASSERT(!isStarted(), "Already started.");
+	HATOHOL_ASSERT(numWriters > 0, "The number of writers is 0.");
+	HATOHOL_ASSERT(maxQueueSize > 0, "The max queue size is 0.");
+
+	// The batches added before the start occupy the queue.
+	m_impl->lock.lock();
+	const size_t queueDepth = m_impl->unfinishedSeqs.size();
+	m_impl->slotSem.init(
+	  maxQueueSize > queueDepth ? maxQueueSize - queueDepth : 0);
+	m_impl->stats.maxQueueSize = maxQueueSize;
+	m_impl->lock.unlock();
+
+	for (size_t i = 0; i < numWriters; i++) {
+		Impl::Writer *writer = new Impl::Writer(*m_impl);
+		m_impl->writers.push_back(writer);
+		writer->start();
+	}
+	m_impl->lock.lock();
+	m_impl->started = true;
+	m_impl->lock.unlock();
+}
+
+void IngestionQueue::stop(void)
+{
+	if (!isStarted())
+		return;
+	m_impl->lock.lock();
+	m_impl->started = false;
+	m_impl->lock.unlock();
+	for (size_t i = 0; i < m_impl->writers.size(); i++) {
+		m_impl->writers[i]->exitSync();
+		delete m_impl->writers[i];
+	}
+	m_impl->writers.clear();
+}
+
+bool IngestionQueue::isStarted(void) const
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	return m_impl->started;
+}
+
+void IngestionQueue::addEventList(const EventInfoList &eventList,
+                                  Closure1<bool> *committedCb)
+{
+	if (eventList.empty()) {
+		if (committedCb)
+			(*committedCb)(true);
+		delete committedCb;
+		return;
+	}
+	IngestionBatch *batch =
+	  new IngestionBatch(IngestionBatch::EVENTS,
+	                     eventList.front().serverId);
+	batch->eventList = eventList;
+	batch->committedCb = committedCb;
+	m_impl->enqueue(batch);
+}
+
+void IngestionQueue::addItemList(const ItemInfoList &itemList)
+{
+	if (itemList.empty())
+		return;
+	IngestionBatch *batch =
+	  new IngestionBatch(IngestionBatch::ITEMS,
+	                     itemList.front().serverId);
+	batch->itemList = itemList;
+	m_impl->enqueue(batch);
+}
+
+void IngestionQueue::addMonitoringServerStatus(
+  const MonitoringServerStatus &serverStatus)
+{
+	IngestionBatch *batch =
+	  new IngestionBatch(IngestionBatch::SERVER_STATUS,
+	                     serverStatus.serverId);
+	batch->serverStatus = serverStatus;
+	m_impl->enqueue(batch);
+}
+
+bool IngestionQueue::flush(const ServerIdType &serverId)
+{
+	if (!isStarted()) {
+		m_impl->writeAll();
+	} else {
+		SimpleSemaphore sem(0);
+		m_impl->lock.lock();
+		FlushWaiter waiter =
+		  {m_impl->stats.numEnqueued, serverId, &sem};
+		m_impl->flushWaiters.push_back(waiter);
+		m_impl->wakeFlushWaiters();
+		m_impl->lock.unlock();
+		sem.wait();
+	}
+
+	AutoMutex autoMutex(&m_impl->lock);
+	return !m_impl->takeDropped(serverId);
+}
+
+void IngestionQueue::getStats(Stats &stats)
+{
+	AutoMutex autoMutex(&m_impl->lock);
+	stats = m_impl->stats;
+	stats.queueDepth = m_impl->unfinishedSeqs.size();
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+IngestionQueue::IngestionQueue(void)
+: m_impl(new Impl())
+{
+}
+
+IngestionQueue::~IngestionQueue()
+{
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IngestionQueue_h
+#define IngestionQueue_h
+
+#include <memory>
+#include "DBTablesMonitoring.h"
+#include "Closure.h"
+
+/**
+ * A bounded queue of monitoring data that are written to the DB by
+ * writer threads instead of the arm threads.
+ *
+ * Each add method enqueues a batch and returns soon. It blocks only
+ * when the queue is full, so that arms slow down as the DB does.
+ * A writer takes up to MAX_BATCHES_PER_COMMIT batches of many servers
+ * and writes all kinds of data in them with one transaction. Batches
+ * of a server are written in the order of enqueue even if there are
+ * some writers. ActionManager::checkEvents() is called for the events
+ * after they are committed.
+ *
+ * When a combined transaction fails, the batches are written one by
+ * one again and only the failed ones are dropped. An arm that reads
+ * the stored data back, such as the last event ID, should call
+ * flush() with its server ID before that, so that it doesn't see
+ * the DB without the batches in the queue.
+ */
+class IngestionQueue {
+public:
+	static const size_t DEFAULT_MAX_QUEUE_SIZE;
+	static const size_t MAX_BATCHES_PER_COMMIT;
+
+	struct Stats {
+		size_t maxQueueSize;
+		size_t queueDepth;    // Batches that are not written yet
+		size_t maxQueueDepth;
+		size_t numEnqueued;
+		size_t numCommitted;
+		size_t numDropped;
+		size_t numTransactions;
+
+		// The enqueues that waited for a room of the queue.
+		size_t numBlocked;
+		double totalBlockedTimeMSec;
+		double maxBlockedTimeMSec;
+
+		Stats(void);
+	};
+
+	/**
+	 * Delete the batches in the queue and reset the statistics.
+	 * This must not be called while the writers are running.
+	 */
+	static void reset(void);
+	static IngestionQueue *getInstance(void);
+
+	/**
+	 * Start writer threads.
+	 *
+	 * @param numWriters The number of the writer threads.
+	 * @param maxQueueSize The maximum number of batches in the queue.
+	 */
+	void start(const size_t &numWriters,
+	           const size_t &maxQueueSize = DEFAULT_MAX_QUEUE_SIZE);
+
+	/**
+	 * Stop the writer threads after all the batches are written.
+	 */
+	void stop(void);
+
+	bool isStarted(void) const;
+
+	/**
+	 * Add events to the queue.
+	 *
+	 * @param eventList A list of EventInfo of a server.
+	 * @param committedCb
+	 * A callback that is called by a writer with true after the events
+	 * are committed, or with false when they are dropped. It is called
+	 * before flush() of the server returns. The queue takes the
+	 * ownership and deletes it after the call. NULL can be passed.
+	 */
+	void addEventList(const EventInfoList &eventList,
+	                  Closure1<bool> *committedCb = NULL);
+	void addItemList(const ItemInfoList &itemList);
+	void addMonitoringServerStatus(
+	  const MonitoringServerStatus &serverStatus);
+
+	/**
+	 * Wait until the batches enqueued before the call are written.
+	 * If no writer is running, the batches are written by the caller.
+	 *
+	 * @param serverId
+	 * The server whose batches are waited for. If it is ALL_SERVERS,
+	 * the batches of all servers are waited for.
+	 *
+	 * @return
+	 * false if some batches of the server have been dropped since the
+	 * previous call with the same server ID. Otherwise true.
+	 */
+	bool flush(const ServerIdType &serverId = ALL_SERVERS);
+
+	/**
+	 * Get the statistics of the queue since the last reset().
+	 *
+	 * @param stats The statistics are copied to this.
+	 */
+	void getStats(Stats &stats);
+
+protected:
+	IngestionQueue(void);
+	virtual ~IngestionQueue();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // IngestionQueue_h
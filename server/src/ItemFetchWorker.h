@@ -20,28 +20,14 @@
 #ifndef ItemFetchWorker_h
 #define ItemFetchWorker_h
 
-#include "Params.h"
-#include "Closure.h"
-#include "DataStore.h"
+#include "FetchCoordinator.h"
 
-class ItemFetchWorker
+class ItemFetchWorker : public FetchCoordinator
 {
-public:
-	ItemFetchWorker(void);
-	virtual ~ItemFetchWorker();
-
-	bool start(const ServerIdType &targetServerId = ALL_SERVERS,
-	           Closure0 *closure = NULL);
-	bool updateIsNeeded(void);
-	void waitCompletion(void);
-
 protected:
-	void updatedCallback(Closure0 *closure);
-	bool runFetcher(DataStore *dataStore);
-
-private:
-	struct Impl;
-	std::unique_ptr<Impl> m_impl;
+	virtual bool isFetchSupported(DataStore *dataStore) override;
+	virtual bool startFetch(DataStore *dataStore, Closure0 *closure)
+	  override;
 };
 
 #endif // ItemFetchWorker_h
@@ -0,0 +1,492 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <set>
+#include <Mutex.h>
+#include <ReadWriteLock.h>
+#include <Reaper.h>
+#include "OverviewCounter.h"
+#include "DataQueryContext.h"
+#include "ThreadLocalDBCache.h"
+
+using namespace std;
+using namespace mlpl;
+
+typedef uint64_t OverviewCounterGeneration;
+
+struct TriggerSummary {
+	TriggerStatusType   status;
+	TriggerSeverityType severity;
+	LocalHostIdType     hostIdInServer;
+	TriggerValidity     validity;
+};
+
+typedef map<TriggerIdType, TriggerSummary> TriggerSummaryMap;
+typedef TriggerSummaryMap::iterator        TriggerSummaryMapIterator;
+typedef TriggerSummaryMap::const_iterator  TriggerSummaryMapConstIterator;
+
+typedef map<LocalHostIdType, size_t>       HostCountMap;
+
+struct HostgroupCounter {
+	size_t       numTriggers;
+	size_t       numBadTriggers[NUM_TRIGGER_SEVERITY];
+	size_t       numAllBadTriggers;
+	HostCountMap numTriggersOfHost;
+	HostCountMap numBadTriggersOfHost;
+
+	HostgroupCounter(void)
+	: numTriggers(0),
+	  numAllBadTriggers(0)
+	{
+		for (size_t i = 0; i < NUM_TRIGGER_SEVERITY; i++)
+			numBadTriggers[i] = 0;
+	}
+
+	static void change(HostCountMap &countMap,
+	                   const LocalHostIdType &hostId, const bool &add)
+	{
+		size_t &count = countMap[hostId];
+		if (add) {
+			count++;
+		} else if (--count == 0) {
+			countMap.erase(hostId);
+		}
+	}
+
+	void apply(const TriggerSummary &trigger, const bool &add)
+	{
+		const int delta = add ? 1 : -1;
+		numTriggers += delta;
+		change(numTriggersOfHost, trigger.hostIdInServer, add);
+		if (trigger.status != TRIGGER_STATUS_PROBLEM)
+			return;
+		numAllBadTriggers += delta;
+		if (trigger.severity >= 0 &&
+		    trigger.severity < NUM_TRIGGER_SEVERITY)
+			numBadTriggers[trigger.severity] += delta;
+		change(numBadTriggersOfHost, trigger.hostIdInServer, add);
+	}
+
+	void getCounts(OverviewCounter::TriggerCounts &counts) const
+	{
+		counts.numTriggers = numTriggers;
+		for (size_t i = 0; i < NUM_TRIGGER_SEVERITY; i++)
+			counts.numBadTriggers[i] = numBadTriggers[i];
+		counts.numAllBadTriggers = numAllBadTriggers;
+		counts.numHosts = numTriggersOfHost.size();
+		counts.numBadHosts = numBadTriggersOfHost.size();
+	}
+};
+
+typedef map<HostgroupIdType, HostgroupCounter> HostgroupCounterMap;
+typedef HostgroupCounterMap::const_iterator    HostgroupCounterMapConstIterator;
+
+struct ServerCounter {
+	TriggerSummaryMap                    triggerMap;
+	set<ItemIdType>                      itemIdSet;
+	map<LocalHostIdType, HostgroupIdSet> hostgroupsOfHost;
+
+	// The counter of the whole server has the key: ALL_HOST_GROUPS.
+	HostgroupCounterMap                  hostgroupCounterMap;
+
+	void apply(const TriggerSummary &trigger, const bool &add)
+	{
+		if (trigger.validity != TRIGGER_VALID)
+			return;
+		hostgroupCounterMap[ALL_HOST_GROUPS].apply(trigger, add);
+		map<LocalHostIdType, HostgroupIdSet>::const_iterator it =
+		  hostgroupsOfHost.find(trigger.hostIdInServer);
+		if (it == hostgroupsOfHost.end())
+			return;
+		HostgroupIdSetConstIterator hostgrpItr = it->second.begin();
+		for (; hostgrpItr != it->second.end(); ++hostgrpItr)
+			hostgroupCounterMap[*hostgrpItr].apply(trigger, add);
+	}
+
+	void addTriggerInfo(const TriggerInfo &triggerInfo)
+	{
+		TriggerSummaryMapIterator it =
+		  triggerMap.find(triggerInfo.id);
+		if (it != triggerMap.end())
+			apply(it->second, false);
+		TriggerSummary &trigger = triggerMap[triggerInfo.id];
+		trigger.status         = triggerInfo.status;
+		trigger.severity       = triggerInfo.severity;
+		trigger.hostIdInServer = triggerInfo.hostIdInServer;
+		trigger.validity       = triggerInfo.validity;
+		apply(trigger, true);
+	}
+
+	void addHostgroupMember(const LocalHostIdType &hostId,
+	                        const HostgroupIdType &hostgroupId)
+	{
+		if (!hostgroupsOfHost[hostId].insert(hostgroupId).second)
+			return;
+
+		// The membership is rarely changed. So we simply scan
+		// the triggers.
+		HostgroupCounter &counter = hostgroupCounterMap[hostgroupId];
+		TriggerSummaryMapConstIterator it = triggerMap.begin();
+		for (; it != triggerMap.end(); ++it) {
+			const TriggerSummary &trigger = it->second;
+			if (trigger.validity != TRIGGER_VALID)
+				continue;
+			if (trigger.hostIdInServer != hostId)
+				continue;
+			counter.apply(trigger, true);
+		}
+	}
+
+	void getTriggerCounts(OverviewCounter::TriggerCounts &counts,
+	                      const HostgroupIdType &hostgroupId) const
+	{
+		HostgroupCounterMapConstIterator it =
+		  hostgroupCounterMap.find(hostgroupId);
+		if (it == hostgroupCounterMap.end()) {
+			counts = OverviewCounter::TriggerCounts();
+			return;
+		}
+		it->second.getCounts(counts);
+	}
+
+	void load(const ServerIdType &serverId)
+	{
+		ThreadLocalDBCache cache;
+
+		HostgroupMemberVect hostgrpMembers;
+		HostgroupMembersQueryOption memberOption(USER_ID_SYSTEM);
+		memberOption.setTargetServerId(serverId);
+		cache.getHost().getHostgroupMembers(hostgrpMembers,
+		                                    memberOption);
+		HostgroupMemberVectConstIterator memberItr =
+		  hostgrpMembers.begin();
+		for (; memberItr != hostgrpMembers.end(); ++memberItr) {
+			hostgroupsOfHost[memberItr->hostIdInServer].insert(
+			  memberItr->hostgroupIdInServer);
+		}
+
+		TriggerInfoList triggerInfoList;
+		TriggersQueryOption triggerOption(USER_ID_SYSTEM);
+		triggerOption.setTargetServerId(serverId);
+		cache.getMonitoring().getTriggerInfoList(triggerInfoList,
+		                                         triggerOption);
+		TriggerInfoListConstIterator triggerItr =
+		  triggerInfoList.begin();
+		for (; triggerItr != triggerInfoList.end(); ++triggerItr)
+			addTriggerInfo(*triggerItr);
+
+		ItemInfoList itemInfoList;
+		ItemsQueryOption itemOption(USER_ID_SYSTEM);
+		itemOption.setTargetServerId(serverId);
+		cache.getMonitoring().getItemInfoList(itemInfoList, itemOption);
+		ItemInfoListConstIterator itemItr = itemInfoList.begin();
+		for (; itemItr != itemInfoList.end(); ++itemItr)
+			itemIdSet.insert(itemItr->id);
+	}
+};
+
+typedef map<ServerIdType, ServerCounter>   ServerCounterMap;
+typedef ServerCounterMap::iterator         ServerCounterMapIterator;
+typedef ServerCounterMap::const_iterator   ServerCounterMapConstIterator;
+
+struct OverviewCounter::Impl {
+	static Mutex            initLock;
+	static OverviewCounter *instance;
+
+	ReadWriteLock    rwlock;
+	ServerCounterMap serverCounterMap;
+
+	// A generation is advanced when data of a server that isn't loaded
+	// is changed. A loaded data is discarded if the generation of
+	// the server is changed during the load. invalidateAll() advances
+	// the global one.
+	OverviewCounterGeneration                    generation;
+	map<ServerIdType, OverviewCounterGeneration> generationMap;
+
+	Impl(void)
+	: generation(0)
+	{
+	}
+
+	// This method shall be called with rwlock taken.
+	OverviewCounterGeneration getGeneration(const ServerIdType &serverId)
+	{
+		map<ServerIdType, OverviewCounterGeneration>::const_iterator
+		  it = generationMap.find(serverId);
+		if (it == generationMap.end())
+			return generation;
+		return generation + it->second;
+	}
+
+	// This method shall be called with rwlock taken.
+	ServerCounter *findServerCounter(const ServerIdType &serverId)
+	{
+		ServerCounterMapIterator it = serverCounterMap.find(serverId);
+		if (it == serverCounterMap.end()) {
+			generationMap[serverId]++;
+			return NULL;
+		}
+		return &it->second;
+	}
+
+	bool canSeeAll(DataQueryContext &dataQueryContext,
+	               const ServerIdType &serverId,
+	               const HostgroupIdType &hostgroupId)
+	{
+		if (!dataQueryContext.isValidServer(serverId))
+			return false;
+
+		const OperationPrivilege &privilege =
+		  dataQueryContext.getOperationPrivilege();
+		if (privilege.getUserId() == USER_ID_SYSTEM ||
+		    privilege.has(OPPRVLG_GET_ALL_SERVER))
+			return true;
+
+		const ServerHostGrpSetMap &srvHostGrpSetMap =
+		  dataQueryContext.getServerHostGrpSetMap();
+		if (srvHostGrpSetMap.find(ALL_SERVERS) != srvHostGrpSetMap.end())
+			return true;
+		ServerHostGrpSetMapConstIterator it =
+		  srvHostGrpSetMap.find(serverId);
+		if (it == srvHostGrpSetMap.end())
+			return false;
+		const HostgroupIdSet &hostgroupIdSet = it->second;
+		if (hostgroupIdSet.count(ALL_HOST_GROUPS))
+			return true;
+		if (hostgroupId == ALL_HOST_GROUPS)
+			return false;
+		return hostgroupIdSet.count(hostgroupId);
+	}
+
+	template<typename Reader>
+	void read(const ServerIdType &serverId, Reader &reader)
+	{
+		rwlock.readLock();
+		ServerCounterMapConstIterator it =
+		  serverCounterMap.find(serverId);
+		if (it != serverCounterMap.end()) {
+			reader(it->second);
+			rwlock.unlock();
+			return;
+		}
+		const OverviewCounterGeneration loadedGeneration =
+		  getGeneration(serverId);
+		rwlock.unlock();
+
+		ServerCounter serverCounter;
+		serverCounter.load(serverId);
+		reader(serverCounter);
+
+		rwlock.writeLock();
+		Reaper<ReadWriteLock> unlocker(&rwlock, ReadWriteLock::unlock);
+		if (getGeneration(serverId) != loadedGeneration)
+			return;
+		if (serverCounterMap.find(serverId) != serverCounterMap.end())
+			return;
+		serverCounterMap[serverId] = serverCounter;
+	}
+};
+
+Mutex            OverviewCounter::Impl::initLock;
+OverviewCounter *OverviewCounter::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// TriggerCounts
+// ---------------------------------------------------------------------------
+OverviewCounter::TriggerCounts::TriggerCounts(void)
+: numTriggers(0),
+  numAllBadTriggers(0),
+  numHosts(0),
+  numBadHosts(0)
+{
+	for (size_t i = 0; i < NUM_TRIGGER_SEVERITY; i++)
+		numBadTriggers[i] = 0;
+}
+
+size_t OverviewCounter::TriggerCounts::getNumberOfBadTriggers(
+  const TriggerSeverityType &severity) const
+{
+	if (severity == TRIGGER_SEVERITY_ALL)
+		return numAllBadTriggers;
+	if (severity < 0 || severity >= NUM_TRIGGER_SEVERITY)
+		return 0;
+	return numBadTriggers[severity];
+}
+
+size_t OverviewCounter::TriggerCounts::getNumberOfGoodHosts(void) const
+{
+	return numHosts - numBadHosts;
+}
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void OverviewCounter::reset(void)
+{
+	getInstance()->invalidateAll();
+}
+
+OverviewCounter *OverviewCounter::getInstance(void)
+{
+	Impl::initLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new OverviewCounter();
+	Impl::initLock.unlock();
+	return Impl::instance;
+}
+
+bool OverviewCounter::getTriggerCounts(
+  TriggerCounts &counts, DataQueryContext &dataQueryContext,
+  const ServerIdType &serverId, const HostgroupIdType &hostgroupId)
+{
+	if (!m_impl->canSeeAll(dataQueryContext, serverId, hostgroupId))
+		return false;
+
+	struct {
+		TriggerCounts   *counts;
+		HostgroupIdType  hostgroupId;
+
+		void operator()(const ServerCounter &serverCounter)
+		{
+			serverCounter.getTriggerCounts(*counts, hostgroupId);
+		}
+	} reader;
+	reader.counts = &counts;
+	reader.hostgroupId = hostgroupId;
+	m_impl->read(serverId, reader);
+	return true;
+}
+
+bool OverviewCounter::getNumberOfItems(
+  size_t &numItems, DataQueryContext &dataQueryContext,
+  const ServerIdType &serverId)
+{
+	if (!m_impl->canSeeAll(dataQueryContext, serverId, ALL_HOST_GROUPS))
+		return false;
+
+	struct {
+		size_t *numItems;
+
+		void operator()(const ServerCounter &serverCounter)
+		{
+			*numItems = serverCounter.itemIdSet.size();
+		}
+	} reader;
+	reader.numItems = &numItems;
+	m_impl->read(serverId, reader);
+	return true;
+}
+
+void OverviewCounter::addTriggerInfo(const TriggerInfo &triggerInfo)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	ServerCounter *serverCounter =
+	  m_impl->findServerCounter(triggerInfo.serverId);
+	if (serverCounter)
+		serverCounter->addTriggerInfo(triggerInfo);
+}
+
+void OverviewCounter::addTriggerInfoList(
+  const TriggerInfoList &triggerInfoList)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	TriggerInfoListConstIterator it = triggerInfoList.begin();
+	for (; it != triggerInfoList.end(); ++it) {
+		ServerCounter *serverCounter =
+		  m_impl->findServerCounter(it->serverId);
+		if (serverCounter)
+			serverCounter->addTriggerInfo(*it);
+	}
+}
+
+void OverviewCounter::addItemInfo(const ItemInfo &itemInfo)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	ServerCounter *serverCounter =
+	  m_impl->findServerCounter(itemInfo.serverId);
+	if (serverCounter)
+		serverCounter->itemIdSet.insert(itemInfo.id);
+}
+
+void OverviewCounter::addItemInfoList(const ItemInfoList &itemInfoList)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	ItemInfoListConstIterator it = itemInfoList.begin();
+	for (; it != itemInfoList.end(); ++it) {
+		ServerCounter *serverCounter =
+		  m_impl->findServerCounter(it->serverId);
+		if (serverCounter)
+			serverCounter->itemIdSet.insert(it->id);
+	}
+}
+
+void OverviewCounter::addHostgroupMember(
+  const HostgroupMember &hostgroupMember)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	ServerCounter *serverCounter =
+	  m_impl->findServerCounter(hostgroupMember.serverId);
+	if (serverCounter) {
+		serverCounter->addHostgroupMember(
+		  hostgroupMember.hostIdInServer,
+		  hostgroupMember.hostgroupIdInServer);
+	}
+}
+
+void OverviewCounter::invalidate(const ServerIdType &serverId)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generationMap[serverId]++;
+	m_impl->serverCounterMap.erase(serverId);
+	m_impl->rwlock.unlock();
+}
+
+void OverviewCounter::invalidateAll(void)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generation++;
+	m_impl->serverCounterMap.clear();
+	m_impl->rwlock.unlock();
+}
+
+bool OverviewCounter::isLoaded(const ServerIdType &serverId) const
+{
+	m_impl->rwlock.readLock();
+	const bool loaded = m_impl->serverCounterMap.count(serverId);
+	m_impl->rwlock.unlock();
+	return loaded;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+OverviewCounter::OverviewCounter(void)
+: m_impl(new Impl())
+{
+}
+
+OverviewCounter::~OverviewCounter()
+{
+}
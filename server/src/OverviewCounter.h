@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OverviewCounter_h
+#define OverviewCounter_h
+
+#include <memory>
+#include "Params.h"
+#include "Monitoring.h"
+
+class DataQueryContext;
+struct HostgroupMember;
+
+/**
+ * Process-wide counters of the triggers, hosts and items for the overview.
+ *
+ * The counters of a server are loaded from the DB at the first access and
+ * then updated with the triggers, the items and the host group members
+ * stored by DBTablesMonitoring and DBTablesHost. Only the triggers whose
+ * validity is TRIGGER_VALID are counted. This is equivalent to
+ * EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING of TriggersQueryOption.
+ */
+class OverviewCounter {
+public:
+	struct TriggerCounts {
+		size_t numTriggers;
+		size_t numBadTriggers[NUM_TRIGGER_SEVERITY];
+		size_t numAllBadTriggers;
+		size_t numHosts;
+		size_t numBadHosts;
+
+		TriggerCounts(void);
+		size_t getNumberOfBadTriggers(
+		  const TriggerSeverityType &severity = TRIGGER_SEVERITY_ALL)
+		  const;
+		size_t getNumberOfGoodHosts(void) const;
+	};
+
+	static void reset(void);
+	static OverviewCounter *getInstance(void);
+
+	/**
+	 * Get the counts of the triggers and the hosts.
+	 *
+	 * @param counts The obtained counts are stored in this.
+	 * @param dataQueryContext A DataQueryContext of the requester.
+	 * @param serverId A target server ID.
+	 * @param hostgroupId
+	 * A target host group ID. ALL_HOST_GROUPS means the whole server.
+	 *
+	 * @return
+	 * true if the counts are obtained. false if the requester can see
+	 * only a part of the target. In that case, the caller should
+	 * count them with the DB.
+	 */
+	bool getTriggerCounts(TriggerCounts &counts,
+	                      DataQueryContext &dataQueryContext,
+	                      const ServerIdType &serverId,
+	                      const HostgroupIdType &hostgroupId
+	                        = ALL_HOST_GROUPS);
+
+	/**
+	 * Get the number of the items of a server.
+	 *
+	 * @param numItems The obtained number is stored in this.
+	 * @param dataQueryContext A DataQueryContext of the requester.
+	 * @param serverId A target server ID.
+	 *
+	 * @return The same as getTriggerCounts().
+	 */
+	bool getNumberOfItems(size_t &numItems,
+	                      DataQueryContext &dataQueryContext,
+	                      const ServerIdType &serverId);
+
+	/**
+	 * The following methods shall be called after the data is committed.
+	 */
+	void addTriggerInfo(const TriggerInfo &triggerInfo);
+	void addTriggerInfoList(const TriggerInfoList &triggerInfoList);
+	void addItemInfo(const ItemInfo &itemInfo);
+	void addItemInfoList(const ItemInfoList &itemInfoList);
+	void addHostgroupMember(const HostgroupMember &hostgroupMember);
+	void invalidate(const ServerIdType &serverId);
+	void invalidateAll(void);
+
+	bool isLoaded(const ServerIdType &serverId) const;
+
+protected:
+	OverviewCounter(void);
+	virtual ~OverviewCounter();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // OverviewCounter_h
@@ -111,17 +111,70 @@ void ResidentCommunicator::setModuleLoaded(uint32_t code)
 void ResidentCommunicator::setNotifyEventBody(
   const ActionIdType &actionId, const EventInfo &eventInfo,
   const string &sessionId)
+{
+	setHeader(getNotifyEventBodySize(eventInfo),
+	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT);
+	addNotifyEvent(actionId, eventInfo, sessionId);
+}
+
+void ResidentCommunicator::setNotifyEventAck(uint32_t resultCode)
+{
+	setHeader(RESIDENT_PROTO_EVENT_ACK_CODE_LEN,
+	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK);
+	m_impl->sbuf.add32(resultCode);
+}
+
+size_t ResidentCommunicator::getNotifyEventBodySize(const EventInfo &eventInfo)
 {
 	const size_t lenNullTerm = 1;
+	return RESIDENT_PROTO_EVENT_BODY_BASE_LEN +
+	       eventInfo.hostIdInServer.size() + lenNullTerm +
+	       eventInfo.id.size()             + lenNullTerm +
+	       eventInfo.triggerId.size()      + lenNullTerm;
+}
+
+void ResidentCommunicator::setNotifyEventBatchHeader(
+  uint32_t firstSequence, uint16_t numEvents, size_t eventsSize)
+{
+	const uint32_t bodySize =
+	  RESIDENT_PROTO_BATCH_BODY_BASE_LEN +
+	  RESIDENT_PROTO_BATCH_EVENT_SIZE_LEN * numEvents + eventsSize;
+	setHeader(bodySize, RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH);
+	m_impl->sbuf.add32(firstSequence);
+	m_impl->sbuf.add16(numEvents);
+}
+
+void ResidentCommunicator::addNotifyEventBatchItem(
+  const ActionIdType &actionId, const EventInfo &eventInfo,
+  const string &sessionId)
+{
+	m_impl->sbuf.add32(getNotifyEventBodySize(eventInfo));
+	addNotifyEvent(actionId, eventInfo, sessionId);
+}
+
+void ResidentCommunicator::setNotifyEventBatchAck(
+  uint32_t firstSequence, const vector<uint32_t> &resultCodes)
+{
 	const uint32_t bodySize =
-	  RESIDENT_PROTO_EVENT_BODY_BASE_LEN +
-	  eventInfo.hostIdInServer.size() + lenNullTerm +
-	  eventInfo.id.size()             + lenNullTerm +
-	  eventInfo.triggerId.size()      + lenNullTerm;
+	  RESIDENT_PROTO_BATCH_BODY_BASE_LEN +
+	  RESIDENT_PROTO_EVENT_ACK_CODE_LEN * resultCodes.size();
+	setHeader(bodySize, RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH_ACK);
+	m_impl->sbuf.add32(firstSequence);
+	m_impl->sbuf.add16(resultCodes.size());
+	for (size_t i = 0; i < resultCodes.size(); i++)
+		m_impl->sbuf.add32(resultCodes[i]);
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+void ResidentCommunicator::addNotifyEvent(
+  const ActionIdType &actionId, const EventInfo &eventInfo,
+  const string &sessionId)
+{
+	// The strings are placed after the fixed length part.
 	size_t bodyIdx =
-	  RESIDENT_PROTO_HEADER_LEN + RESIDENT_PROTO_EVENT_BODY_BASE_LEN;
-	setHeader(bodySize,
-	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT);
+	  m_impl->sbuf.index() + RESIDENT_PROTO_EVENT_BODY_BASE_LEN;
 	m_impl->sbuf.add32(actionId);
 	m_impl->sbuf.add32(eventInfo.serverId);
 	bodyIdx = m_impl->sbuf.insertString(eventInfo.hostIdInServer, bodyIdx);
@@ -133,11 +186,5 @@ void ResidentCommunicator::setNotifyEventBody(
 	m_impl->sbuf.add16(eventInfo.status);
 	m_impl->sbuf.add16(eventInfo.severity);
 	m_impl->sbuf.add(sessionId.c_str(), HATOHOL_SESSION_ID_LEN);
-}
-
-void ResidentCommunicator::setNotifyEventAck(uint32_t resultCode)
-{
-	setHeader(RESIDENT_PROTO_EVENT_ACK_CODE_LEN,
-	          RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK);
-	m_impl->sbuf.add32(resultCode);
+	m_impl->sbuf.setIndex(bodyIdx);
 }
@@ -22,6 +22,7 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 #include "ResidentProtocol.h"
 #include "NamedPipe.h"
 #include "HatoholException.h"
@@ -57,6 +58,33 @@ public:
 	                        const std::string &sessionId);
 	void setNotifyEventAck(uint32_t resuletCode);
 
+	/**
+	 * Get the size of an event in a notify event packet.
+	 */
+	static size_t getNotifyEventBodySize(const EventInfo &eventInfo);
+
+	/**
+	 * Set the header of a notify event batch packet. The events shall be
+	 * added with addNotifyEventBatchItem() in the order of the sequence.
+	 *
+	 * @param firstSequence A sequence number of the first event.
+	 * @param numEvents The number of the events.
+	 * @param eventsSize
+	 * The sum of getNotifyEventBodySize() of the events.
+	 */
+	void setNotifyEventBatchHeader(uint32_t firstSequence,
+	                               uint16_t numEvents, size_t eventsSize);
+	void addNotifyEventBatchItem(const ActionIdType &actionId,
+	                             const EventInfo &eventInfo,
+	                             const std::string &sessionId);
+	void setNotifyEventBatchAck(uint32_t firstSequence,
+	                            const std::vector<uint32_t> &resultCodes);
+
+protected:
+	void addNotifyEvent(const ActionIdType &actionId,
+	                    const EventInfo &eventInfo,
+	                    const std::string &sessionId);
+
 private:
 	struct Impl;
 	std::unique_ptr<Impl> m_impl;
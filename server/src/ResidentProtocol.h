@@ -32,6 +32,8 @@ enum
 	RESIDENT_PROTO_PKT_TYPE_PARAMETERS,
 	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT,
 	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_ACK,
+	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH,
+	RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH_ACK,
 };
 
 static const uint16_t HATOHOL_SESSION_ID_LEN = 36;
@@ -145,6 +147,41 @@ static const size_t RESIDENT_PROTO_EVENT_BODY_BASE_LEN =
 
 static const size_t RESIDENT_PROTO_EVENT_ACK_CODE_LEN = 4;
 
+// [Notify Event Batch]
+// Direction: Master -> Slave
+// packet type: RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH
+// <Body>
+// Bytes: Description
+//    4U: Sequence number of the first event.
+//    2U: Number of events (N).
+//  The following two fields are repeated N times.
+//    4U: Size of the event.
+//     V: An event in the same format as the body of [Notify Event].
+//
+// Sequence numbers are consecutive over the batches. The master may send
+// the next batch before the ack of the previous one as long as the number
+// of the events without an ack doesn't exceed
+// RESIDENT_PROTO_NOTIFY_WINDOW_SIZE.
+
+static const size_t RESIDENT_PROTO_BATCH_SEQUENCE_LEN   = 4;
+static const size_t RESIDENT_PROTO_BATCH_NUM_EVENTS_LEN = 2;
+static const size_t RESIDENT_PROTO_BATCH_EVENT_SIZE_LEN = 4;
+
+static const size_t RESIDENT_PROTO_BATCH_BODY_BASE_LEN =
+  RESIDENT_PROTO_BATCH_SEQUENCE_LEN + RESIDENT_PROTO_BATCH_NUM_EVENTS_LEN;
+
+static const size_t RESIDENT_PROTO_MAX_EVENTS_IN_BATCH = 16;
+static const size_t RESIDENT_PROTO_NOTIFY_WINDOW_SIZE  = 64;
+
+// [Notify Event Batch Ack]
+// Direction: Slave -> Master
+// packet type: RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH_ACK
+// <Body>
+// Bytes: Description
+//    4U: Sequence number of the first event.
+//    2U: Number of events (N).
+//  4U x N: result codes in the order of the events.
+
 //
 // Module information
 //
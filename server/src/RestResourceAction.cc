@@ -20,6 +20,7 @@
 #include "RestResourceAction.h"
 #include "DBTablesAction.h"
 #include "UnifiedDataStore.h"
+#include "ActionManager.h"
 
 using namespace std;
 using namespace mlpl;
@@ -82,6 +83,26 @@ static HatoholError parseQueryForGet(ActionsQueryOption &option,
 	return HTERR_OK;
 }
 
+static void addCommandActionStats(JSONBuilder &agent)
+{
+	ActionManager::CommandActionStats stats;
+	ActionManager::getCommandActionStats(stats);
+	agent.startObject("commandActionStats");
+	agent.add("numStarted",  stats.numStarted);
+	agent.add("numFinished", stats.numFinished);
+	agent.add("numQueued",   stats.numQueued);
+	agent.add("numRejected", stats.numRejected);
+	agent.add("totalWaitTimeMSec",
+	          static_cast<gint64>(stats.totalWaitTimeMSec));
+	agent.add("maxWaitTimeMSec",
+	          static_cast<gint64>(stats.maxWaitTimeMSec));
+	agent.add("totalRunTimeMSec",
+	          static_cast<gint64>(stats.totalRunTimeMSec));
+	agent.add("maxRunTimeMSec",
+	          static_cast<gint64>(stats.maxRunTimeMSec));
+	agent.endObject(); // commandActionStats
+}
+
 void RestResourceAction::handleGet(void)
 {
 	ActionsQueryOption option(m_dataQueryContextPtr);
@@ -141,6 +162,7 @@ void RestResourceAction::handleGet(void)
 			triggerMaps[cond.serverId][cond.triggerId] = "";
 	}
 	agent.endArray();
+	addCommandActionStats(agent);
 	const bool lookupTriggerBrief = true;
 	addServersMap(agent, &triggerMaps, lookupTriggerBrief);
 	agent.endObject();
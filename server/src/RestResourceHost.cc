@@ -19,6 +19,8 @@
 
 #include "RestResourceHost.h"
 #include "UnifiedDataStore.h"
+#include "HistoryAggregator.h"
+#include "HistoryCache.h"
 #include <string.h>
 
 using namespace std;
@@ -115,6 +117,59 @@ static HatoholError parseSortOrderFromQuery(
 	return HatoholError(HTERR_OK);
 }
 
+// A cursor token is a URL-safe Base64 encoded string of
+// "<direction>:<time sec>:<time nsec>:<unified ID>". It shall be handled
+// as an opaque string by clients.
+static const char EVENT_CURSOR_NEXT = 'N';
+static const char EVENT_CURSOR_PREV = 'P';
+
+static HatoholError parseEventCursorFromQuery(
+  EventsQueryOption &option, GHashTable *query)
+{
+	const char *key = "cursor";
+	const char *value = (const char *)g_hash_table_lookup(query, key);
+	if (!value)
+		return HTERR_NOT_FOUND_PARAMETER;
+
+	string encoded(value);
+	for (size_t i = 0; i < encoded.size(); i++) {
+		if (encoded[i] == '-')
+			encoded[i] = '+';
+		else if (encoded[i] == '_')
+			encoded[i] = '/';
+	}
+	while (encoded.size() % 4)
+		encoded += '=';
+	gsize decodedLength = 0;
+	guchar *decoded = g_base64_decode(encoded.c_str(), &decodedLength);
+	const string payload((const char *)decoded, decodedLength);
+	g_free(decoded);
+
+	char direction = '\0';
+	long sec = 0, nsec = 0;
+	UnifiedEventIdType unifiedId = 0;
+	int length = 0;
+	const int numScanned =
+	  sscanf(payload.c_str(), "%c:%ld:%ld:%" SCNu64 "%n",
+	         &direction, &sec, &nsec, &unifiedId, &length);
+	if (numScanned != 4 || length != (int)payload.size() ||
+	    (direction != EVENT_CURSOR_NEXT &&
+	     direction != EVENT_CURSOR_PREV)) {
+		string optionMessage
+		  = StringUtils::sprintf("%s: %s", key, value);
+		return HatoholError(HTERR_INVALID_PARAMETER, optionMessage);
+	}
+
+	timespec time;
+	time.tv_sec = sec;
+	time.tv_nsec = nsec;
+	option.setCursor(unifiedId, time,
+	                 direction == EVENT_CURSOR_PREV ?
+	                   EventsQueryOption::CURSOR_PREV :
+	                   EventsQueryOption::CURSOR_NEXT);
+	return HatoholError(HTERR_OK);
+}
+
 static HatoholError parseHostResourceQueryParameter(
   HostResourceQueryOption &option, GHashTable *query)
 {
@@ -261,9 +316,50 @@ HatoholError RestResourceHost::parseEventParameter(EventsQueryOption &option,
 		return err;
 	option.setLimitOfUnifiedId(limitOfUnifiedId);
 
+	// time range
+	time_t beginTime = 0, endTime = 0;
+	err = getParam<time_t>(query, "beginTime", "%ld", beginTime);
+	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+	err = getParam<time_t>(query, "endTime", "%ld", endTime);
+	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+	option.setTimeRange(beginTime, endTime);
+
+	// keyset cursor
+	err = parseEventCursorFromQuery(option, query);
+	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+
 	return HatoholError(HTERR_OK);
 }
 
+string RestResourceHost::makeEventCursor(
+  const EventInfo &eventInfo,
+  const EventsQueryOption::CursorDirection &direction)
+{
+	const string payload = StringUtils::sprintf(
+	  "%c:%ld:%ld:%" FMT_UNIFIED_EVENT_ID,
+	  direction == EventsQueryOption::CURSOR_PREV ?
+	    EVENT_CURSOR_PREV : EVENT_CURSOR_NEXT,
+	  (long)eventInfo.time.tv_sec, (long)eventInfo.time.tv_nsec,
+	  eventInfo.unifiedId);
+	gchar *encoded = g_base64_encode((const guchar *)payload.c_str(),
+	                                 payload.size());
+	string cursor(encoded);
+	g_free(encoded);
+
+	while (!cursor.empty() && cursor[cursor.size() - 1] == '=')
+		cursor.erase(cursor.size() - 1);
+	for (size_t i = 0; i < cursor.size(); i++) {
+		if (cursor[i] == '+')
+			cursor[i] = '-';
+		else if (cursor[i] == '/')
+			cursor[i] = '_';
+	}
+	return cursor;
+}
+
 static HatoholError parseItemParameter(ItemsQueryOption &option,
 				       GHashTable *query)
 {
@@ -300,6 +396,33 @@ static HatoholError parseItemParameter(ItemsQueryOption &option,
 	return HatoholError(HTERR_OK);
 }
 
+static void getHostgroupTriggerCounts(OverviewCounter::TriggerCounts &counts,
+				      FaceRest::ResourceHandler *job,
+				      const ServerIdType &serverId,
+				      const HostgroupIdType &hostgroupId)
+{
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	if (dataStore->getOverviewTriggerCounts(
+	      counts, *job->m_dataQueryContextPtr, serverId, hostgroupId)) {
+		return;
+	}
+
+	// The user can see only a part of the target. So we count them
+	// with the DB.
+	TriggersQueryOption option(job->m_dataQueryContextPtr);
+	option.setExcludeFlags(EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING);
+	option.setTargetServerId(serverId);
+	option.setTargetHostgroupId(hostgroupId);
+	for (int severity = 0; severity < NUM_TRIGGER_SEVERITY; severity++) {
+		counts.numBadTriggers[severity] =
+		  dataStore->getNumberOfBadTriggers(
+		    option, (TriggerSeverityType)severity);
+	}
+	counts.numBadHosts = dataStore->getNumberOfBadHosts(option);
+	counts.numHosts =
+	  dataStore->getNumberOfGoodHosts(option) + counts.numBadHosts;
+}
+
 static HatoholError addOverviewEachServer(FaceRest::ResourceHandler *job,
 					  JSONBuilder &agent,
 					  MonitoringServerInfo &svInfo,
@@ -323,27 +446,38 @@ static HatoholError addOverviewEachServer(FaceRest::ResourceHandler *job,
 		return err;
 	agent.add("numberOfHosts", svHostDefs.size());
 
-	ItemsQueryOption itemsQueryOption(job->m_dataQueryContextPtr);
-	itemsQueryOption.setTargetServerId(svInfo.id);
+	DataQueryContext &dataQueryContext = *job->m_dataQueryContextPtr;
 	bool fetchItemsSynchronously = true;
-	size_t numberOfItems =
-	  dataStore->getNumberOfItems(itemsQueryOption,
-				      fetchItemsSynchronously);
+	size_t numberOfItems = 0;
+	if (!dataStore->getOverviewNumberOfItems(numberOfItems,
+	                                         dataQueryContext, svInfo.id,
+	                                         fetchItemsSynchronously)) {
+		ItemsQueryOption itemsQueryOption(job->m_dataQueryContextPtr);
+		itemsQueryOption.setTargetServerId(svInfo.id);
+		numberOfItems = dataStore->getNumberOfItems(itemsQueryOption);
+	}
 	agent.add("numberOfItems", numberOfItems);
 
-	TriggerInfoList triggerInfoList;
-	TriggersQueryOption triggersQueryOption(job->m_dataQueryContextPtr);
-	triggersQueryOption.setTargetServerId(svInfo.id);
-	triggersQueryOption.setExcludeFlags(EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING);
-	agent.add("numberOfTriggers",
-		  dataStore->getNumberOfTriggers(triggersQueryOption));
-	const size_t numBadHosts =
-	  dataStore->getNumberOfBadHosts(triggersQueryOption);
-	agent.add("numberOfBadHosts", numBadHosts);
-	serverIsGoodStatus = (numBadHosts == 0);
-	size_t numBadTriggers = dataStore->getNumberOfBadTriggers(
-				  triggersQueryOption, TRIGGER_SEVERITY_ALL);
-	agent.add("numberOfBadTriggers", numBadTriggers);
+	OverviewCounter::TriggerCounts serverCounts;
+	if (!dataStore->getOverviewTriggerCounts(serverCounts,
+	                                         dataQueryContext,
+	                                         svInfo.id)) {
+		TriggersQueryOption option(job->m_dataQueryContextPtr);
+		option.setTargetServerId(svInfo.id);
+		option.setExcludeFlags(EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING);
+		serverCounts.numTriggers =
+		  dataStore->getNumberOfTriggers(option);
+		serverCounts.numBadHosts =
+		  dataStore->getNumberOfBadHosts(option);
+		serverCounts.numAllBadTriggers =
+		  dataStore->getNumberOfBadTriggers(option,
+		                                    TRIGGER_SEVERITY_ALL);
+	}
+	agent.add("numberOfTriggers", serverCounts.numTriggers);
+	agent.add("numberOfBadHosts", serverCounts.numBadHosts);
+	serverIsGoodStatus = (serverCounts.numBadHosts == 0);
+	agent.add("numberOfBadTriggers",
+	          serverCounts.getNumberOfBadTriggers(TRIGGER_SEVERITY_ALL));
 
 	// TODO: These elements should be fixed
 	// after the funtion concerned is added
@@ -376,24 +510,25 @@ static HatoholError addOverviewEachServer(FaceRest::ResourceHandler *job,
 	}
 	agent.endObject();
 
+	vector<OverviewCounter::TriggerCounts> hostgroupCounts(hostgroups.size());
+	for (size_t i = 0; i < hostgroups.size(); i++) {
+		getHostgroupTriggerCounts(hostgroupCounts[i], job, svInfo.id,
+		                          hostgroups[i].idInServer);
+	}
+
 	// SystemStatus
 	agent.startArray("systemStatus");
-	HostgroupVectConstIterator hostgrpItr = hostgroups.begin();
-	for (; hostgrpItr != hostgroups.end(); ++ hostgrpItr) {
-		const HostgroupIdType &hostgroupId = hostgrpItr->idInServer;
+	for (size_t i = 0; i < hostgroups.size(); i++) {
+		const HostgroupIdType &hostgroupId = hostgroups[i].idInServer;
 		for (int severity = 0;
 		     severity < NUM_TRIGGER_SEVERITY; severity++) {
-			TriggersQueryOption option(job->m_dataQueryContextPtr);
-			option.setExcludeFlags(EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING);
-			option.setTargetServerId(svInfo.id);
-			option.setTargetHostgroupId(hostgroupId);
 			agent.startObject();
 			agent.add("hostgroupId", hostgroupId);
 			agent.add("severity", severity);
 			agent.add(
 			  "numberOfTriggers",
-			  dataStore->getNumberOfBadTriggers
-			    (option, (TriggerSeverityType)severity));
+			  hostgroupCounts[i].getNumberOfBadTriggers(
+			    (TriggerSeverityType)severity));
 			agent.endObject();
 		}
 	}
@@ -401,19 +536,12 @@ static HatoholError addOverviewEachServer(FaceRest::ResourceHandler *job,
 
 	// HostStatus
 	agent.startArray("hostStatus");
-	hostgrpItr = hostgroups.begin();
-	for (; hostgrpItr != hostgroups.end(); ++ hostgrpItr) {
-		const HostgroupIdType &hostgroupId = hostgrpItr->idInServer;
-		TriggersQueryOption option(job->m_dataQueryContextPtr);
-		option.setExcludeFlags(EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING);
-		option.setTargetServerId(svInfo.id);
-		option.setTargetHostgroupId(hostgroupId);
-		size_t numBadHosts = dataStore->getNumberOfBadHosts(option);
+	for (size_t i = 0; i < hostgroups.size(); i++) {
 		agent.startObject();
-		agent.add("hostgroupId", hostgroupId);
+		agent.add("hostgroupId", hostgroups[i].idInServer);
 		agent.add("numberOfGoodHosts",
-		          dataStore->getNumberOfGoodHosts(option));
-		agent.add("numberOfBadHosts", numBadHosts);
+		          hostgroupCounts[i].getNumberOfGoodHosts());
+		agent.add("numberOfBadHosts", hostgroupCounts[i].numBadHosts);
 		agent.endObject();
 	}
 	agent.endArray();
@@ -475,6 +603,7 @@ static void addHosts(FaceRest::ResourceHandler *job, JSONBuilder &agent,
 	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
 	ServerHostDefVect svHostDefs;
 	HostsQueryOption option(job->m_dataQueryContextPtr);
+	option.setStaleDataAllowed();
 	option.setTargetServerId(targetServerId);
 	option.setTargetHostgroupId(targetHostgroupId);
 	option.setTargetHostId(targetHostId);
@@ -527,6 +656,7 @@ void RestResourceHost::handlerGetTrigger(void)
 	}
 
 	option.setExcludeFlags(EXCLUDE_INVALID_HOST);
+	option.setStaleDataAllowed();
 	TriggerInfoList triggerList;
 	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
 	dataStore->getTriggerList(triggerList, option);
@@ -563,6 +693,7 @@ void RestResourceHost::handlerGetTrigger(void)
 static uint64_t getLastUnifiedEventId(FaceRest::ResourceHandler *job)
 {
 	EventsQueryOption option(job->m_dataQueryContextPtr);
+	option.setStaleDataAllowed();
 	option.setMaximumNumber(1);
 	option.setSortType(EventsQueryOption::SORT_UNIFIED_ID,
 			   DataQueryOption::SORT_DESCENDING);
@@ -605,6 +736,7 @@ void RestResourceHost::handlerGetEvent(void)
 		replyError(err);
 		return;
 	}
+	option.setStaleDataAllowed();
 
 	bool addIncidents = dataStore->isIncidentSenderActionEnabled();
 	IncidentInfoVect incidentVect;
@@ -652,6 +784,14 @@ void RestResourceHost::handlerGetEvent(void)
 	}
 	agent.endArray();
 	agent.add("numberOfEvents", eventList.size());
+	if (!eventList.empty()) {
+		agent.add("nextCursor",
+		          makeEventCursor(eventList.back(),
+		                          EventsQueryOption::CURSOR_NEXT));
+		agent.add("prevCursor",
+		          makeEventCursor(eventList.front(),
+		                          EventsQueryOption::CURSOR_PREV));
+	}
 	addServersMap(agent, NULL, false);
 	agent.endObject();
 
@@ -678,8 +818,10 @@ void RestResourceHost::replyGetItem(void)
 {
 	ItemsQueryOption option(m_dataQueryContextPtr);
 	option.setExcludeFlags(EXCLUDE_INVALID_HOST);
+	option.setStaleDataAllowed();
 	ItemsQueryOption applicationOption(m_dataQueryContextPtr);
 	applicationOption.setExcludeFlags(EXCLUDE_INVALID_HOST);
+	applicationOption.setStaleDataAllowed();
 	HatoholError err = parseItemParameter(option, m_query);
 	if (err != HTERR_OK) {
 		replyError(err);
@@ -762,11 +904,16 @@ void RestResourceHost::handlerGetItem(void)
 struct GetHistoryClosure : ClosureTemplate1<RestResourceHost, HistoryInfoVect>
 {
 	DataStorePtr m_dataStorePtr;
+	time_t       m_beginTime;
+	time_t       m_bucketWidth; // 0 means that samples are not aggregated.
 
 	GetHistoryClosure(RestResourceHost *receiver,
-			  callback func, DataStorePtr dataStorePtr)
+			  callback func, DataStorePtr dataStorePtr,
+			  const time_t &beginTime, const time_t &bucketWidth)
 	: ClosureTemplate1<RestResourceHost, HistoryInfoVect>(receiver, func),
-	  m_dataStorePtr(dataStorePtr)
+	  m_dataStorePtr(dataStorePtr),
+	  m_beginTime(beginTime),
+	  m_bucketWidth(bucketWidth)
 	{
 		m_receiver->ref();
 	}
@@ -779,7 +926,7 @@ struct GetHistoryClosure : ClosureTemplate1<RestResourceHost, HistoryInfoVect>
 
 static HatoholError parseHistoryParameter(
   GHashTable *query, ServerIdType &serverId, ItemIdType &itemId,
-  time_t &beginTime, time_t &endTime)
+  time_t &beginTime, time_t &endTime, time_t &bucketWidth)
 {
 	if (!query)
 		return HatoholError(HTERR_INVALID_PARAMETER);
@@ -820,6 +967,34 @@ static HatoholError parseHistoryParameter(
 	if (err != HTERR_OK && err != HTERR_NOT_FOUND_PARAMETER)
 		return err;
 
+	// bucket: the width of an aggregation bucket in seconds.
+	// It takes precedence over maxPoints.
+	err = getParam<time_t>(query, "bucket", "%ld", bucketWidth);
+	if (err == HTERR_OK) {
+		if (bucketWidth <= 0) {
+			return HatoholError(HTERR_INVALID_PARAMETER,
+					    "bucket: must be positive");
+		}
+		return HatoholError(HTERR_OK);
+	}
+	if (err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+
+	// maxPoints
+	size_t maxPoints = 0;
+	err = getParam<size_t>(query, "maxPoints", "%zd", maxPoints);
+	if (err == HTERR_OK) {
+		if (maxPoints == 0) {
+			return HatoholError(HTERR_INVALID_PARAMETER,
+					    "maxPoints: must be positive");
+		}
+		bucketWidth = HistoryAggregator::calcBucketWidth(
+		  beginTime, endTime, maxPoints);
+		return HatoholError(HTERR_OK);
+	}
+	if (err != HTERR_NOT_FOUND_PARAMETER)
+		return err;
+
 	return HatoholError(HTERR_OK);
 }
 
@@ -830,9 +1005,11 @@ void RestResourceHost::handlerGetHistory(void)
 	const time_t SECONDS_IN_A_DAY = 60 * 60 * 24;
 	time_t endTime = time(NULL);
 	time_t beginTime = endTime - SECONDS_IN_A_DAY;
+	time_t bucketWidth = 0;
 
 	HatoholError err = parseHistoryParameter(m_query, serverId, itemId,
-						 beginTime, endTime);
+						 beginTime, endTime,
+						 bucketWidth);
 	if (err != HTERR_OK) {
 		replyError(err);
 		return;
@@ -861,10 +1038,11 @@ void RestResourceHost::handlerGetHistory(void)
 	GetHistoryClosure *closure =
 	  new GetHistoryClosure(
 	    this, &RestResourceHost::historyFetchedCallback,
-	    unifiedDataStore->getDataStore(serverId));
+	    unifiedDataStore->getDataStore(serverId), beginTime, bucketWidth);
 	if (closure->m_dataStorePtr.hasData()) {
-		closure->m_dataStorePtr->startOnDemandFetchHistory(
-		  itemInfo, beginTime, endTime, closure);
+		HistoryCache::getInstance()->fetch(
+		  closure->m_dataStorePtr, itemInfo, beginTime, endTime,
+		  closure);
 	} else {
 		HistoryInfoVect historyInfoVect;
 		(*closure)(historyInfoVect);
@@ -872,9 +1050,50 @@ void RestResourceHost::handlerGetHistory(void)
 	}
 }
 
+static void addHistoryBuckets(JSONBuilder &agent,
+                              const HistoryBucketVect &buckets)
+{
+	agent.startArray("history");
+	HistoryBucketVectConstIterator it = buckets.begin();
+	for (; it != buckets.end(); ++it) {
+		const HistoryBucket &bucket = *it;
+		agent.startObject();
+		// "value" is the average so that clients can draw it as well
+		// as raw samples.
+		agent.add("value", StringUtils::sprintf("%.15g", bucket.avg));
+		agent.add("clock", bucket.beginTime);
+		agent.add("ns",    0);
+		agent.add("min",   StringUtils::sprintf("%.15g", bucket.min));
+		agent.add("max",   StringUtils::sprintf("%.15g", bucket.max));
+		agent.add("last",  bucket.last);
+		agent.add("count", bucket.numSamples);
+		agent.endObject();
+	}
+	agent.endArray();
+}
+
 void RestResourceHost::historyFetchedCallback(
   Closure1<HistoryInfoVect> *closure, const HistoryInfoVect &historyInfoVect)
 {
+	// Samples of a text item are returned as they are.
+	GetHistoryClosure *historyClosure =
+	  dynamic_cast<GetHistoryClosure *>(closure);
+	HistoryBucketVect buckets;
+	if (historyClosure && historyClosure->m_bucketWidth > 0 &&
+	    HistoryAggregator::aggregate(buckets, historyInfoVect,
+	                                 historyClosure->m_beginTime,
+	                                 historyClosure->m_bucketWidth)) {
+		JSONBuilder agent;
+		agent.startObject();
+		addHatoholError(agent, HatoholError(HTERR_OK));
+		agent.add("bucket", historyClosure->m_bucketWidth);
+		addHistoryBuckets(agent, buckets);
+		agent.endObject();
+		replyJSONData(agent);
+		unpauseResponse();
+		return;
+	}
+
 	JSONBuilder agent;
 	agent.startObject();
 	addHatoholError(agent, HatoholError(HTERR_OK));
@@ -911,6 +1130,7 @@ static void addHostsIsMemberOfGroup(
 
 	HostgroupMemberVect hostgrpMembers;
 	HostgroupMembersQueryOption option(job->m_dataQueryContextPtr);
+	option.setStaleDataAllowed();
 	option.setTargetServerId(targetServerId);
 
 	option.setTargetHostgroupId(targetGroupId);
@@ -934,6 +1154,7 @@ void RestResourceHost::handlerGetHostgroup(void)
 		return;
 	}
 
+	option.setStaleDataAllowed();
 	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
 	HostgroupVect hostgroups;
 	err = dataStore->getHostgroups(hostgroups, option);
@@ -47,6 +47,9 @@ struct RestResourceHost : public FaceRest::ResourceHandler
 
 	static HatoholError parseEventParameter(EventsQueryOption &option,
 						GHashTable *query);
+	static std::string makeEventCursor(
+	  const EventInfo &eventInfo,
+	  const EventsQueryOption::CursorDirection &direction);
 	static bool parseExtendedInfo(const std::string &extendedInfo,
 	                              std::string &extendedInfoValue);
 
@@ -714,6 +714,10 @@ void RestResourceServer::handlerServerConnStat(void)
 		agent.add("failureComment",  armInfo.failureComment);
 		agent.add("numUpdate",       armInfo.numUpdate);
 		agent.add("numFailure",      armInfo.numFailure);
+		agent.add("lastPollCostMSec", armInfo.lastPollCostMSec);
+		agent.add("lastPollNumFetchedRows",
+		          armInfo.lastPollNumFetchedRows);
+		agent.add("totalNumFetchedRows", armInfo.totalNumFetchedRows);
 		agent.endObject(); // serverId
 	}
 	agent.endObject(); // serverConnStat
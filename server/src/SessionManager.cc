@@ -18,42 +18,59 @@
  */
 
 #include <cstdio>
-#include <map>
+#include <vector>
+#include <unordered_map>
+#include <functional>
 #include <uuid/uuid.h>
 #include "Logger.h"
 #include "SessionManager.h"
 #include <Mutex.h>
 #include "ReadWriteLock.h"
+#include "SimpleSemaphore.h"
+#include "HatoholThreadBase.h"
 #include "HatoholException.h"
 #include "Reaper.h"
 using namespace std;
 using namespace mlpl;
 
+static uint64_t getCurrTimeNSec(void)
+{
+	const SmartTime now(SmartTime::INIT_CURR_TIME);
+	const timespec &ts = now.getAsTimespec();
+	return ts.tv_sec * (uint64_t)SmartTime::NANO_SEC_PER_SEC + ts.tv_nsec;
+}
+
 // ---------------------------------------------------------------------------
 // Session
 // ---------------------------------------------------------------------------
 Session::Session(void)
 : userId(INVALID_USER_ID),
   loginTime(SmartTime::INIT_CURR_TIME),
-  lastAccessTime(SmartTime::INIT_CURR_TIME),
-  timerId(INVALID_EVENT_ID),
-  sessionMgr(NULL)
+  sessionMgr(NULL),
+  wheelLevel(-1),
+  wheelSlot(0)
 {
+	const timespec &ts = loginTime.getAsTimespec();
+	lastAccessNSec =
+	  ts.tv_sec * (uint64_t)SmartTime::NANO_SEC_PER_SEC + ts.tv_nsec;
 }
 
 Session::~Session()
 {
 }
 
-void Session::cancelTimer(void)
+SmartTime Session::getLastAccessTime(void) const
 {
-	if (timerId != INVALID_EVENT_ID) {
-		Utils::removeGSourceIfNeeded(timerId);
-		timerId = INVALID_EVENT_ID;
-		const int usedCount = getUsedCount();
-		HATOHOL_ASSERT(usedCount >= 2, "Used count: %d\n", usedCount);
-		unref();
-	}
+	const uint64_t nsec = lastAccessNSec;
+	timespec ts;
+	ts.tv_sec  = nsec / SmartTime::NANO_SEC_PER_SEC;
+	ts.tv_nsec = nsec % SmartTime::NANO_SEC_PER_SEC;
+	return SmartTime(ts);
+}
+
+void Session::touch(void)
+{
+	lastAccessNSec = getCurrTimeNSec();
 }
 
 // ---------------------------------------------------------------------------
@@ -67,41 +84,282 @@ const size_t SessionManager::INITIAL_TIMEOUT = 10 * 60; // 10 min.
 const size_t SessionManager::DEFAULT_TIMEOUT = -1;
 const size_t SessionManager::NO_TIMEOUT = 0;
 const char * SessionManager::ENV_NAME_TIMEOUT = "HATOHOL_SESSION_TIMEOUT";
+const size_t SessionManager::NUM_SHARDS = 16;
+const size_t SessionManager::TIMER_WHEEL_TICK_MSEC = 100;
+
+typedef unordered_map<string, Session *> SessionShardMap;
+typedef SessionShardMap::iterator        SessionShardMapIterator;
+
+struct SessionShard {
+	ReadWriteLock   rwlock;
+	SessionShardMap sessionMap;
+};
+
+/**
+ * A hierarchical timer wheel for the expiry of sessions.
+ *
+ * A session is put in the slot of its deadline. Sessions in the slots of
+ * the upper levels are moved to the lower level when the lower level
+ * goes around. Accesses to a session don't touch the wheel. Instead,
+ * the deadline is checked again with the last access time when the slot
+ * is swept, and the session is put in the wheel again if it has been
+ * accessed.
+ *
+ * All methods should be called with lock.
+ */
+struct SessionTimerWheel {
+	static const size_t SLOT_BITS = 6;
+	static const size_t NUM_SLOTS = 1 << SLOT_BITS;
+	static const size_t SLOT_MASK = NUM_SLOTS - 1;
+	static const int    NUM_LEVELS = 4;
+
+	Mutex           lock;
+	uint64_t        currTick;
+	list<Session *> slots[NUM_LEVELS][NUM_SLOTS];
+
+	SessionTimerWheel(void)
+	: currTick(getCurrTick())
+	{
+	}
+
+	static uint64_t getCurrTick(void)
+	{
+		return getCurrTimeNSec() / 1000000 /
+		       SessionManager::TIMER_WHEEL_TICK_MSEC;
+	}
+
+	static uint64_t getDeadlineTick(Session *session)
+	{
+		const uint64_t deadlineMSec =
+		  session->lastAccessNSec / 1000000 + session->timeout * 1000;
+		return deadlineMSec / SessionManager::TIMER_WHEEL_TICK_MSEC;
+	}
+
+	void add(Session *session, uint64_t tick)
+	{
+		if (tick < currTick)
+			tick = currTick;
+		uint64_t delta = tick - currTick;
+		int level = 0;
+		for (; level < NUM_LEVELS - 1; level++) {
+			if (delta < ((uint64_t)1 << (SLOT_BITS * (level + 1))))
+				break;
+		}
+		// A session whose deadline is beyond the wheel is checked
+		// again at the end of the wheel.
+		const uint64_t maxDelta =
+		  ((uint64_t)1 << (SLOT_BITS * NUM_LEVELS)) - 1;
+		if (delta > maxDelta)
+			tick = currTick + maxDelta;
+
+		const size_t slot = (tick >> (SLOT_BITS * level)) & SLOT_MASK;
+		list<Session *> &sessionList = slots[level][slot];
+		session->wheelLevel = level;
+		session->wheelSlot = slot;
+		session->wheelPosition =
+		  sessionList.insert(sessionList.end(), session);
+	}
+
+	bool remove(Session *session)
+	{
+		if (session->wheelLevel < 0)
+			return false;
+		slots[session->wheelLevel][session->wheelSlot].erase(
+		  session->wheelPosition);
+		session->wheelLevel = -1;
+		return true;
+	}
+
+	void cascade(const int &level)
+	{
+		const size_t slot =
+		  (currTick >> (SLOT_BITS * level)) & SLOT_MASK;
+		list<Session *> sessionList;
+		sessionList.swap(slots[level][slot]);
+		list<Session *>::iterator it = sessionList.begin();
+		for (; it != sessionList.end(); ++it)
+			add(*it, getDeadlineTick(*it));
+	}
+
+	/**
+	 * Advance the wheel by one tick.
+	 *
+	 * @param expiredList
+	 * Sessions whose deadline has come are removed from the wheel and
+	 * pushed to this list. They have the reference of the wheel.
+	 */
+	void advance(vector<Session *> &expiredList)
+	{
+		for (int level = 1; level < NUM_LEVELS; level++) {
+			if (currTick & ((1 << (SLOT_BITS * level)) - 1))
+				break;
+			cascade(level);
+		}
+
+		list<Session *> sessionList;
+		sessionList.swap(slots[0][currTick & SLOT_MASK]);
+		list<Session *>::iterator it = sessionList.begin();
+		for (; it != sessionList.end(); ++it) {
+			Session *session = *it;
+			const uint64_t deadline = getDeadlineTick(session);
+			if (deadline > currTick) {
+				// Accessed after it was put in the wheel.
+				add(session, deadline);
+				continue;
+			}
+			session->wheelLevel = -1;
+			expiredList.push_back(session);
+		}
+		currTick++;
+	}
+
+	void clear(void)
+	{
+		for (int level = 0; level < NUM_LEVELS; level++) {
+			for (size_t slot = 0; slot < NUM_SLOTS; slot++) {
+				list<Session *> &sessionList =
+				  slots[level][slot];
+				while (!sessionList.empty()) {
+					Session *session = sessionList.front();
+					sessionList.pop_front();
+					session->wheelLevel = -1;
+					session->unref();
+				}
+			}
+		}
+	}
+};
 
 struct SessionManager::Impl {
+	struct Sweeper : public HatoholThreadBase {
+		SessionManager::Impl &impl;
+		SimpleSemaphore       sleepSemaphore;
+
+		Sweeper(SessionManager::Impl &_impl)
+		: impl(_impl),
+		  sleepSemaphore(0)
+		{
+		}
+
+		virtual ~Sweeper()
+		{
+			exitSync();
+		}
+
+		virtual void waitExit(void) override
+		{
+			sleepSemaphore.post();
+			HatoholThreadBase::waitExit();
+		}
+
+	protected:
+		virtual gpointer mainThread(HatoholThreadArg *arg) override
+		{
+			while (!isExitRequested()) {
+				impl.sweep();
+				sleepSemaphore.timedWait(
+				  TIMER_WHEEL_TICK_MSEC);
+			}
+			return NULL;
+		}
+	};
+
 	static Mutex           initLock;
 	static SessionManager *instance;
 	static size_t defaultTimeout;
 
-	ReadWriteLock rwlock;
-	SessionIdMap  sessionIdMap;
+	SessionShard      shards[NUM_SHARDS];
+	SessionTimerWheel timerWheel;
+	Sweeper           sweeper;
+
+	Impl(void)
+	: sweeper(*this)
+	{
+		sweeper.start();
+	}
 
 	virtual ~Impl()
 	{
+		sweeper.exitSync();
 		clearAllSessions();
 	}
 
+	SessionShard &getShard(const string &sessionId)
+	{
+		return shards[hash<string>()(sessionId) % NUM_SHARDS];
+	}
+
 	void clearAllSessions(void)
 	{
-		rwlock.writeLock();
-		while (!sessionIdMap.empty()) {
-			SessionIdMapIterator it = sessionIdMap.begin();
-			Session *session = it->second;
-			rwlock.unlock();
-			Utils::executeOnGLibEventLoop<Session>(
-			  deleteSession, session);
-			rwlock.writeLock();
-			sessionIdMap.erase(it);
+		timerWheel.lock.lock();
+		timerWheel.clear();
+		timerWheel.lock.unlock();
+
+		for (size_t i = 0; i < NUM_SHARDS; i++) {
+			SessionShard &shard = shards[i];
+			shard.rwlock.writeLock();
+			SessionShardMapIterator it = shard.sessionMap.begin();
+			for (; it != shard.sessionMap.end(); ++it)
+				it->second->unref();
+			shard.sessionMap.clear();
+			shard.rwlock.unlock();
 		}
-		rwlock.unlock();
 	}
 
-	static void deleteSession(Session *session)
+	void schedule(Session *session)
+	{
+		session->ref();
+		timerWheel.lock.lock();
+		timerWheel.add(session,
+		               SessionTimerWheel::getDeadlineTick(session));
+		timerWheel.lock.unlock();
+	}
+
+	void unschedule(Session *session)
+	{
+		timerWheel.lock.lock();
+		const bool removed = timerWheel.remove(session);
+		timerWheel.lock.unlock();
+		if (removed)
+			session->unref();
+	}
+
+	/**
+	 * Remove a session from the shard only when it is the given one.
+	 *
+	 * @return true if the session is removed. Otherwise false.
+	 */
+	bool removeFromShard(Session *session)
 	{
-		// This method is called on the GLib's event loop.
-		// So we can call cancelTimer w/o lock.
-		session->cancelTimer();
-		session->unref();
+		SessionShard &shard = getShard(session->id);
+		shard.rwlock.writeLock();
+		SessionShardMapIterator it = shard.sessionMap.find(session->id);
+		const bool found =
+		  (it != shard.sessionMap.end() && it->second == session);
+		if (found)
+			shard.sessionMap.erase(it);
+		shard.rwlock.unlock();
+		if (found)
+			session->unref();
+		return found;
+	}
+
+	void sweep(void)
+	{
+		vector<Session *> expiredList;
+		const uint64_t nowTick = SessionTimerWheel::getCurrTick();
+		timerWheel.lock.lock();
+		while (timerWheel.currTick <= nowTick)
+			timerWheel.advance(expiredList);
+		timerWheel.lock.unlock();
+
+		// The shard locks are taken without the lock of the wheel.
+		for (size_t i = 0; i < expiredList.size(); i++) {
+			Session *session = expiredList[i];
+			MLPL_DBG("Session expired: %s\n", session->id.c_str());
+			removeFromShard(session);
+			session->unref(); // for the wheel
+		}
 	}
 };
 
@@ -154,27 +412,39 @@ string SessionManager::create(const UserIdType &userId, const size_t &timeout)
 		session->timeout =  m_impl->defaultTimeout;
 	else
 		session->timeout = timeout;
-	updateTimer(session);
-	return session->id;
+
+	// Make a copy, because the session may be removed by an other
+	// thread soon after it is inserted into the shard.
+	const string sessionId = session->id;
+	SessionShard &shard = m_impl->getShard(sessionId);
+	shard.rwlock.writeLock();
+	shard.sessionMap[sessionId] = session;
+	if (session->timeout != NO_TIMEOUT)
+		m_impl->schedule(session);
+	shard.rwlock.unlock();
+	return sessionId;
 }
 
 SessionPtr SessionManager::getSession(const string &sessionId)
 {
 	Session *session = NULL;
-	m_impl->rwlock.readLock();
-	SessionIdMapIterator it = m_impl->sessionIdMap.find(sessionId);
-	if (it != m_impl->sessionIdMap.end())
+	SessionShard &shard = m_impl->getShard(sessionId);
+	shard.rwlock.readLock();
+	SessionShardMapIterator it = shard.sessionMap.find(sessionId);
+	if (it != shard.sessionMap.end())
 		session = it->second;
 
 	// Making sessionPtr inside the lock is important. It icrements the
-	// used counter. Even if timerCb() is called back on an other thread
+	// used counter. Even if the session is expired on the sweeper thread
 	// soon after the following rwlock.unlock(), the instance itself
 	// is not deleted.
 	SessionPtr sessionPtr(session);
-	m_impl->rwlock.unlock();
+	shard.rwlock.unlock();
 
+	// The timer wheel is not touched here. The sweeper checks the last
+	// access time when the deadline comes.
 	if (session)
-		updateTimer(session);
+		session->touch();
 
 	return sessionPtr;
 }
@@ -182,28 +452,45 @@ SessionPtr SessionManager::getSession(const string &sessionId)
 bool SessionManager::remove(const string &sessionId)
 {
 	Session *session = NULL;
-	m_impl->rwlock.writeLock();
-	SessionIdMapIterator it = m_impl->sessionIdMap.find(sessionId);
-	if (it != m_impl->sessionIdMap.end()) {
+	SessionShard &shard = m_impl->getShard(sessionId);
+	shard.rwlock.writeLock();
+	SessionShardMapIterator it = shard.sessionMap.find(sessionId);
+	if (it != shard.sessionMap.end()) {
 		session = it->second;
-		m_impl->sessionIdMap.erase(it);
+		shard.sessionMap.erase(it);
 	}
-	m_impl->rwlock.unlock();
+	shard.rwlock.unlock();
 	if (!session)
 		return false;
+	m_impl->unschedule(session);
 	session->unref();
 	return true;
 }
 
-const SessionIdMap &SessionManager::getSessionIdMap(void)
+void SessionManager::getSessionIdMap(SessionIdMap &sessionIdMap)
 {
-	m_impl->rwlock.readLock();
-	return m_impl->sessionIdMap;
+	for (size_t i = 0; i < NUM_SHARDS; i++) {
+		SessionShard &shard = m_impl->shards[i];
+		shard.rwlock.readLock();
+		SessionShardMapIterator it = shard.sessionMap.begin();
+		for (; it != shard.sessionMap.end(); ++it) {
+			sessionIdMap.insert(
+			  pair<string, SessionPtr>(it->first, it->second));
+		}
+		shard.rwlock.unlock();
+	}
 }
 
-void SessionManager::releaseSessionIdMap(void)
+size_t SessionManager::getNumberOfSessions(void)
 {
-	m_impl->rwlock.unlock();
+	size_t num = 0;
+	for (size_t i = 0; i < NUM_SHARDS; i++) {
+		SessionShard &shard = m_impl->shards[i];
+		shard.rwlock.readLock();
+		num += shard.sessionMap.size();
+		shard.rwlock.unlock();
+	}
+	return num;
 }
 
 const size_t SessionManager::getDefaultTimeout(void)
@@ -233,49 +520,3 @@ string SessionManager::generateSessionId(void)
 	string sessionId = uuidBuf;
 	return sessionId;
 }
-
-void SessionManager::updateTimer(Session *session)
-{
-	session->lock.lock();
-	Impl *impl = session->sessionMgr->m_impl.get();
-	session->cancelTimer();
-
-	if (session->timeout) {
-		session->timerId = g_timeout_add(session->timeout * 1000,
-		                                 timerCb, session);
-		session->ref();
-	}
-	session->lastAccessTime.setCurrTime();
-	session->lock.unlock();
-
-	// If timerCb() is called just before here on on an another thread,
-	// the session registered above is removed from sessionIdMap.
-	// So we have to insert session into sessionIdMap every time.
-	impl->rwlock.writeLock();
-	impl->sessionIdMap[session->id] = session;
-	impl->rwlock.unlock();
-};
-
-gboolean SessionManager::timerCb(gpointer data)
-{
-	Session *session = static_cast<Session *>(data);
-	Reaper<UsedCountable> sessionUnref(session, UsedCountable::unref);
-	session->lock.lock();
-	session->timerId = INVALID_EVENT_ID;
-	SessionManager *sessionMgr = session->sessionMgr;
-	if (!sessionMgr) {
-		MLPL_BUG("Session Manager: NULL, %s\n", session->id.c_str());
-		session->lock.unlock();
-		return G_SOURCE_REMOVE;
-	}
-
-	// Make a copy, because session may be deleted in the follwoing
-	// remove(). However, it is used only when the remove() fails, 
-	// which is a rare event. So this is a kind of wasted way.
-	string sessionId = session->id;
-	session->lock.unlock();
-
-	if (!sessionMgr->remove(session->id))
-		MLPL_BUG("Failed to remove session: %s\n", sessionId.c_str());
-	return G_SOURCE_REMOVE;
-}
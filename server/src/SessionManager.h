@@ -23,44 +23,53 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <list>
 #include "Params.h"
 #include "SmartTime.h"
+#include "AtomicValue.h"
 #include "UsedCountablePtr.h"
 #include "UsedCountable.h"
-#include "Mutex.h"
 
 class SessionManager;
 struct Session : public UsedCountable {
 	UserIdType userId;
 	std::string id;
 	mlpl::SmartTime loginTime;
-	mlpl::SmartTime lastAccessTime;
 	size_t timeout;
-	guint timerId;
-	mlpl::Mutex lock;
 	SessionManager *sessionMgr;
 
+	// The time of the last access in nsec. It is updated without lock.
+	mlpl::AtomicValue<uint64_t> lastAccessNSec;
+
+	// The position in the timer wheel. These are used by SessionManager
+	// with the lock of the wheel. wheelLevel is -1 when the session
+	// is not in the wheel.
+	int                            wheelLevel;
+	size_t                         wheelSlot;
+	std::list<Session *>::iterator wheelPosition;
+
 	// constructor
 	Session(void);
 
+	mlpl::SmartTime getLastAccessTime(void) const;
+
 	/**
-	 * Cancel the timer. This method is suppose to be called with
-	 * lock taken.
+	 * Update the last access time. This method takes no lock.
 	 */
-	void cancelTimer(void);
+	void touch(void);
 
 protected:
 	virtual ~Session(); // makes delete impossible. Use unref().
 };
 
-// Key: session ID, value: user ID
-typedef std::map<std::string, Session *>           SessionIdMap;
-typedef std::map<std::string, Session *>::iterator SessionIdMapIterator;
-typedef std::map<std::string, Session *>::const_iterator
-   SessionIdMapConstIterator;
-
 typedef UsedCountablePtr<Session> SessionPtr;
 
+// Key: session ID
+typedef std::map<std::string, SessionPtr>           SessionIdMap;
+typedef std::map<std::string, SessionPtr>::iterator SessionIdMapIterator;
+typedef std::map<std::string, SessionPtr>::const_iterator
+   SessionIdMapConstIterator;
+
 class SessionManager {
 public:
 	static const size_t SESSION_ID_LEN;
@@ -68,6 +77,8 @@ public:
 	static const size_t DEFAULT_TIMEOUT;
 	static const size_t NO_TIMEOUT;
 	static const char * ENV_NAME_TIMEOUT;
+	static const size_t NUM_SHARDS;
+	static const size_t TIMER_WHEEL_TICK_MSEC;
 
 	static void reset(void);
 	static SessionManager *getInstance(void);
@@ -107,16 +118,15 @@ public:
 	bool remove(const std::string &sessionId);
 
 	/**
-	 * Get a reference of the seesion ID map.
+	 * Get a snapshot of all sessions.
 	 *
-	 * After the returned map is used, the caller must call
-	 * releaseSessionIdMap(). Until it is called, some operations
-	 * of this class are blocked.
-	 *
-	 * @return a reference of the session ID map.
+	 * @param sessionIdMap
+	 * The sessions are inserted to this map. Each session is referenced
+	 * by SessionPtr. So it is valid even after it is removed.
 	 */
-	const SessionIdMap &getSessionIdMap(void);
-	void releaseSessionIdMap(void);
+	void getSessionIdMap(SessionIdMap &sessionIdMap);
+
+	size_t getNumberOfSessions(void);
 
 	static const size_t getDefaultTimeout(void);
 
@@ -125,8 +135,6 @@ protected:
 	virtual ~SessionManager();
 
 	static std::string generateSessionId(void);
-	static void updateTimer(Session *session);
-	static gboolean timerCb(gpointer data);
 
 private:
 	struct Impl;
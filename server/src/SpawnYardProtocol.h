@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SpawnYardProtocol_h
+#define SpawnYardProtocol_h
+
+#include <cstdlib>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+// hatohol-spawn-yard is a small process launched by Hatohol in advance.
+// It creates child processes on behalf of Hatohol, because forking
+// a small process is much cheaper than forking Hatohol that has a large
+// address space. The master (Hatohol) and the slave (hatohol-spawn-yard)
+// communicate over a stream socket whose file descriptor number is passed
+// to the slave as the first argument.
+
+// definitions of packet types
+enum
+{
+	SPAWN_YARD_PROTO_PKT_TYPE_SPAWN,
+	SPAWN_YARD_PROTO_PKT_TYPE_SPAWNED,
+	SPAWN_YARD_PROTO_PKT_TYPE_EXITED,
+};
+
+// NOTE: Characters in Bytes column in this file means the following.
+//  'U': Unsigned integer.
+//  'S': Signed integer.
+//  'V': variable length.
+// * Byte order: Host order (Both ends are always on the same machine.)
+
+// [Header]
+// All packets have a header with the following structure.
+//
+// Bytes: Description
+//    4U: Packet body size (not including the header size)
+//    2U: packet type defined the above
+
+static const size_t SPAWN_YARD_PROTO_HEADER_PKT_SIZE_LEN = 4;
+static const size_t SPAWN_YARD_PROTO_HEADER_PKT_TYPE_LEN = 2;
+
+static const size_t SPAWN_YARD_PROTO_HEADER_LEN =
+  SPAWN_YARD_PROTO_HEADER_PKT_SIZE_LEN + SPAWN_YARD_PROTO_HEADER_PKT_TYPE_LEN;
+
+static const size_t SPAWN_YARD_PROTO_MAX_BODY_SIZE = 16 * 1024 * 1024;
+
+// [Spawn]
+// Direction: Master -> Slave
+// packet type: SPAWN_YARD_PROTO_PKT_TYPE_SPAWN
+// <Body>
+// Bytes: Description
+//    2U: Number of arguments (N).
+//    2U: Number of environment variables (M). If it is 0, the child
+//        inherits the environment of the slave.
+//    2U: Length of the working directory.
+//     V: The working directory. If it is empty, the child runs in the
+//        current directory of the slave.
+//  The following two fields are repeated N times and then M times.
+//    2U: Length of the argument or the environment variable.
+//     V: The argument or the environment variable in the form of
+//        'NAME=VALUE'.
+//
+// The first argument is the path of the executed file. It is not
+// searched in PATH. The strings don't include a NULL terminator.
+// The master sends the next request only after it receives the reply of
+// the previous one.
+
+static const size_t SPAWN_YARD_PROTO_SPAWN_NUM_ARGS_LEN = 2;
+static const size_t SPAWN_YARD_PROTO_SPAWN_NUM_ENVS_LEN = 2;
+static const size_t SPAWN_YARD_PROTO_SPAWN_STRING_LEN   = 2;
+
+// [Spawned]
+// Direction: Slave -> Master
+// packet type: SPAWN_YARD_PROTO_PKT_TYPE_SPAWNED
+// <Body>
+// Bytes: Description
+//    4S: The process ID of the child. It is -1 on failure.
+//    2U: The stage at which the spawn fails. (See the following enum.)
+//    4S: errno of the failure.
+enum {
+	SPAWN_YARD_PROTO_STAGE_NONE,
+	SPAWN_YARD_PROTO_STAGE_FORK,
+	SPAWN_YARD_PROTO_STAGE_CHDIR,
+	SPAWN_YARD_PROTO_STAGE_EXEC,
+};
+
+static const size_t SPAWN_YARD_PROTO_SPAWNED_BODY_LEN = 4 + 2 + 4;
+
+// [Exited]
+// Direction: Slave -> Master
+// packet type: SPAWN_YARD_PROTO_PKT_TYPE_EXITED
+// <Body>
+// Bytes: Description
+//    4S: The process ID of the child.
+//    4S: si_code of the child. (CLD_EXITED, CLD_KILLED, or CLD_DUMPED)
+//    4S: si_status of the child.
+//
+// The slave sends this packet after the [Spawned] packet of the child.
+
+static const size_t SPAWN_YARD_PROTO_EXITED_BODY_LEN = 4 + 4 + 4;
+
+//
+// Helper functions used by both ends.
+//
+
+/**
+ * Read data of the specified size from a socket.
+ *
+ * @return true on success. false on an error or the end of the stream.
+ */
+static inline bool spawnYardRead(const int &fd, void *buf, size_t size)
+{
+	char *ptr = static_cast<char *>(buf);
+	while (size > 0) {
+		ssize_t ret = recv(fd, ptr, size, 0);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		ptr += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+/**
+ * Write data of the specified size to a socket.
+ *
+ * MSG_NOSIGNAL is used, so SIGPIPE isn't raised even when the peer
+ * has exited.
+ *
+ * @return true on success. Otherwise false.
+ */
+static inline bool spawnYardWrite(const int &fd, const void *buf, size_t size)
+{
+	const char *ptr = static_cast<const char *>(buf);
+	while (size > 0) {
+		ssize_t ret = send(fd, ptr, size, MSG_NOSIGNAL);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		ptr += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+#endif // SpawnYardProtocol_h
@@ -17,9 +17,10 @@
  * <http://www.gnu.org/licenses/>.
  */
 
-#include <map>
 #include <list>
 #include <Mutex.h>
+#include <SimpleSemaphore.h>
+#include <SmartTime.h>
 #include "Params.h"
 #include "ThreadLocalDBCache.h"
 using namespace std;
@@ -30,123 +31,248 @@ using namespace mlpl;
 // the following MySQL command.
 //   > show global variables like 'max_connections';
 // We chose the default maximum value that doesn't exceed
-// the above value.
-// However, it naturally be changed by user setting. So this parameter
-// should also be configurable.
-static const size_t DEFAULT_MAX_NUM_CACHE_MYSQL = 100;
+// the above value. It can be changed by --db-pool-size.
+//
+// A DBAgentSQLite3 instance also keeps to open a databa file (i.e.
+// use a file descriptor). So the same limit is applied to it.
+const size_t ThreadLocalDBCache::DEFAULT_MAX_POOL_SIZE = 100;
+
+const size_t ThreadLocalDBCache::CHECKOUT_TIMEOUT_MSEC = 60 * 1000;
+const int    ThreadLocalDBCache::HEALTH_CHECK_IDLE_SEC = 30;
+
+struct PooledDBHatohol {
+	DBHatohol *dbHatohol;
+	time_t     checkinTime;
+};
 
-// A DBAgentSQLite3 instance keeps to open a databa file (i.e.
-// use a file descriptor). So we cannot have the instances unlimitedly.
-static const size_t DEFAULT_MAX_NUM_CACHE_SQLITE3 = 100;
+typedef list<PooledDBHatohol>          PooledDBHatoholList;
+typedef PooledDBHatoholList::iterator  PooledDBHatoholListIterator;
 
-typedef list<DB *>         DBList;
-typedef DBList::iterator   DBListIterator;
+// This has to be a POD to be a __thread variable.
+struct ThreadContext {
+	// The number of ThreadLocalDBCache instances of the thread.
+	size_t     numCaches;
+
+	// The instance checked out from the pool. It is shared by all
+	// ThreadLocalDBCache instances of the thread and checked in when
+	// the last one of them is destroyed.
+	DBHatohol *dbHatohol;
+	size_t     generation;
+
+	// The instance used last time. It is preferred at the next checkout
+	// so that each thread uses the same connection as far as possible.
+	DBHatohol *lastDBHatohol;
+};
 
-typedef map<DB *, DBListIterator> DBListItrMap;
-typedef DBListItrMap::iterator    DBListItrMapIterator;
+struct ThreadLocalDBCache::Impl {
+	static Mutex                   lock;
+	static PooledDBHatoholList     idleList;  // The head is the newest.
+	static size_t                  numCheckedOut;
+	static size_t                  maxPoolSize;
+	static SimpleSemaphore         slotSem;
+
+	// The number of posts of slotSem that should be skipped because
+	// maxPoolSize was reduced while instances were checked out.
+	static size_t                  slotDebt;
 
-struct ThreadLocalDBCacheLRU {
-	DBList       list;
-	DBListItrMap map;
+	// Incremented by reset(). Instances of the older generation are
+	// deleted at checkin, because the DB parameters may be changed.
+	static size_t                  generation;
+	static PoolStats               stats;
+	static __thread ThreadContext  ctx;
 
-	void touch(DB *db)
+	static void reset(void)
 	{
-		DBListItrMapIterator it = map.find(db);
-		if (it != map.end())
-			list.erase(it->second);
-		map[db] = list.insert(list.begin(), db);
+		// The instances checked out by other threads are deleted
+		// when they are checked in.
+		//
+		// NOTE: Some threads (such as ActorCollector) don't exit
+		// at reset().
+		PooledDBHatoholList deletedList;
+		lock.lock();
+		generation++;
+		deletedList.swap(idleList);
+		stats = PoolStats();
+		lock.unlock();
+		deleteInstances(deletedList);
+		setMaxPoolSize(DEFAULT_MAX_POOL_SIZE);
 	}
 
-	void erase(DB *db)
+	static void cleanup(void)
 	{
-		DBListItrMapIterator it = map.find(db);
-		HATOHOL_ASSERT(it != map.end(), "Not found. db: %p", db);
-		list.erase(it->second);
-		map.erase(it);
+		// A thread may exit without destroying its caches, for example,
+		// by pthread_exit().
+		if (ctx.dbHatohol)
+			checkin();
+		ctx.numCaches = 0;
+		ctx.lastDBHatohol = NULL;
 	}
-};
-
-struct ThreadContext {
-	DBHatohol   *dbHatohol;
 
-	ThreadContext(void)
-	: dbHatohol(NULL)
+	static void setMaxPoolSize(const size_t &size)
 	{
+		HATOHOL_ASSERT(size > 0, "The pool size must not be 0.");
+		PooledDBHatoholList deletedList;
+		lock.lock();
+		for (; maxPoolSize < size; maxPoolSize++)
+			releaseSlot();
+		for (; maxPoolSize > size; maxPoolSize--) {
+			if (slotSem.tryWait() != 0)
+				slotDebt++;
+		}
+		while (!idleList.empty() &&
+		       idleList.size() + numCheckedOut > maxPoolSize) {
+			deletedList.push_back(idleList.back());
+			idleList.pop_back();
+		}
+		lock.unlock();
+		deleteInstances(deletedList);
 	}
 
-	virtual ~ThreadContext()
+	// Should be called with lock
+	static void releaseSlot(void)
 	{
-		delete dbHatohol;
+		if (slotDebt > 0)
+			slotDebt--;
+		else
+			slotSem.post();
 	}
-};
 
-typedef set<ThreadContext *>       ThreadContextSet;
-typedef ThreadContextSet::iterator ThreadContextSetIterator;
+	static void waitSlot(void)
+	{
+		if (slotSem.tryWait() == 0)
+			return;
 
-struct ThreadLocalDBCache::Impl {
-	// TODO: The limitation of cahed objects is now WIP.
-	static size_t maxNumCacheMySQL;
-	static size_t maxNumCacheSQLite3;
+		SmartTime waitTime(SmartTime::INIT_CURR_TIME);
+		SimpleSemaphore::Status status =
+		  slotSem.timedWait(CHECKOUT_TIMEOUT_MSEC);
+		if (status != SimpleSemaphore::STAT_OK) {
+			THROW_HATOHOL_EXCEPTION(
+			  "Failed to check out a DB connection in %zd ms. "
+			  "max pool size: %zd\n",
+			  CHECKOUT_TIMEOUT_MSEC, maxPoolSize);
+		}
+		SmartTime elapsedTime(SmartTime::INIT_CURR_TIME);
+		elapsedTime -= waitTime;
+		const double waitTimeMSec = elapsedTime.getAsMSec();
 
-	static Mutex                   lock;
-	static ThreadContextSet        ctxSet;
-	static ThreadLocalDBCacheLRU   dbCacheLRU;
-	static __thread ThreadContext *ctx;
+		AutoMutex autoMutex(&lock);
+		stats.numWaits++;
+		stats.totalWaitTimeMSec += waitTimeMSec;
+		if (waitTimeMSec > stats.maxWaitTimeMSec)
+			stats.maxWaitTimeMSec = waitTimeMSec;
+	}
 
-	static ThreadContext *getContext(void)
+	static PooledDBHatohol takeIdleInstance(void)
 	{
-		AutoMutex autoMutex(&lock);
-		if (!ctx) {
-			ctx = new ThreadContext();
-			ctxSet.insert(ctx);
+		PooledDBHatohol pooled = {NULL, 0};
+		if (idleList.empty())
+			return pooled;
+		PooledDBHatoholListIterator it = idleList.begin();
+		for (; it != idleList.end(); ++it) {
+			if (it->dbHatohol == ctx.lastDBHatohol)
+				break;
 		}
-		return ctx;
+		if (it == idleList.end())
+			it = idleList.begin();
+		pooled = *it;
+		idleList.erase(it);
+		return pooled;
 	}
 
-	static void reset(void)
+	static DBHatohol *createInstance(void)
 	{
-		// This only free the DBClientMap instance of the current
-		// thread. For the other, cleanup() should be called from
-		// HatoholThreadBase::threadCleanup(). This implies this
-		// method is called from the main thread that is not based
-		// on HatoholThreadBase.
-		//
-		// NOTE: We don't free all elements in dbClientMapSet here.
-		// because some threads (such as ActorCollector) don't exit
-		// at reset().
-		cleanup();
+		try {
+			return new DBHatohol();
+		} catch (...) {
+			lock.lock();
+			numCheckedOut--;
+			releaseSlot();
+			lock.unlock();
+			throw;
+		}
+		return NULL;
 	}
 
-	static void insert(DB *db)
+	static void checkout(void)
 	{
-		AutoMutex autoMutex(&lock);
-		dbCacheLRU.touch(db);
+		waitSlot();
+
+		lock.lock();
+		numCheckedOut++;
+		stats.numCheckouts++;
+		PooledDBHatohol pooled = takeIdleInstance();
+		ctx.generation = generation;
+		lock.unlock();
+
+		// Health check for the instance that hasn't been used for
+		// a while. The DB server may have closed the connection.
+		if (pooled.dbHatohol &&
+		    time(NULL) - pooled.checkinTime >= HEALTH_CHECK_IDLE_SEC &&
+		    !pooled.dbHatohol->getDBAgent().isAlive()) {
+			MLPL_WARN("Discard an unusable DB connection.\n");
+			delete pooled.dbHatohol;
+			pooled.dbHatohol = NULL;
+			AutoMutex autoMutex(&lock);
+			stats.numDiscarded++;
+		}
+		if (!pooled.dbHatohol)
+			pooled.dbHatohol = createInstance();
+		ctx.dbHatohol = pooled.dbHatohol;
+		ctx.lastDBHatohol = pooled.dbHatohol;
 	}
 
-	static void cleanup(void)
+	static void checkin(void)
 	{
-		if (!ctx)
-			return;
-		AutoMutex autoMutex(&lock);
-		ThreadContextSetIterator it = ctxSet.find(ctx);
-		const bool found = (it != ctxSet.end());
-		HATOHOL_ASSERT(found, "Failed to found: ctx: %p\n", ctx);
-		ctxSet.erase(it);
-		dbCacheLRU.erase(ctx->dbHatohol);
-		delete ctx;
-		ctx = NULL;
+		DBHatohol *deletedDBHatohol = NULL;
+		lock.lock();
+		numCheckedOut--;
+		if (ctx.generation == generation &&
+		    idleList.size() + numCheckedOut < maxPoolSize) {
+			PooledDBHatohol pooled = {ctx.dbHatohol, time(NULL)};
+			idleList.push_front(pooled);
+		} else {
+			deletedDBHatohol = ctx.dbHatohol;
+		}
+		releaseSlot();
+		lock.unlock();
+		delete deletedDBHatohol;
+		ctx.dbHatohol = NULL;
+	}
+
+	static void deleteInstances(const PooledDBHatoholList &pooledList)
+	{
+		PooledDBHatoholList::const_iterator it = pooledList.begin();
+		for (; it != pooledList.end(); ++it)
+			delete it->dbHatohol;
 	}
 };
 
-size_t ThreadLocalDBCache::Impl::maxNumCacheMySQL
-  = DEFAULT_MAX_NUM_CACHE_MYSQL;
-size_t ThreadLocalDBCache::Impl::maxNumCacheSQLite3
-  = DEFAULT_MAX_NUM_CACHE_SQLITE3;
+Mutex               ThreadLocalDBCache::Impl::lock;
+PooledDBHatoholList ThreadLocalDBCache::Impl::idleList;
+size_t              ThreadLocalDBCache::Impl::numCheckedOut = 0;
+size_t              ThreadLocalDBCache::Impl::maxPoolSize =
+  ThreadLocalDBCache::DEFAULT_MAX_POOL_SIZE;
+SimpleSemaphore     ThreadLocalDBCache::Impl::slotSem(
+  ThreadLocalDBCache::DEFAULT_MAX_POOL_SIZE);
+size_t              ThreadLocalDBCache::Impl::slotDebt = 0;
+size_t              ThreadLocalDBCache::Impl::generation = 0;
+ThreadLocalDBCache::PoolStats ThreadLocalDBCache::Impl::stats;
+__thread ThreadContext ThreadLocalDBCache::Impl::ctx;
 
-Mutex                   ThreadLocalDBCache::Impl::lock;
-ThreadContextSet        ThreadLocalDBCache::Impl::ctxSet;
-ThreadLocalDBCacheLRU              ThreadLocalDBCache::Impl::dbCacheLRU;
-__thread ThreadContext *ThreadLocalDBCache::Impl::ctx = NULL;
+// ---------------------------------------------------------------------------
+// PoolStats
+// ---------------------------------------------------------------------------
+ThreadLocalDBCache::PoolStats::PoolStats(void)
+: maxPoolSize(0),
+  numInstances(0),
+  numCheckedOut(0),
+  numCheckouts(0),
+  numWaits(0),
+  numDiscarded(0),
+  totalWaitTimeMSec(0),
+  maxWaitTimeMSec(0)
+{
+}
 
 // ---------------------------------------------------------------------------
 // Public methods
@@ -164,24 +290,46 @@ void ThreadLocalDBCache::cleanup(void)
 size_t ThreadLocalDBCache::getNumberOfDBClientMaps(void)
 {
 	AutoMutex autoMutex(&Impl::lock);
-	return Impl::dbCacheLRU.list.size();
+	return Impl::idleList.size() + Impl::numCheckedOut;
+}
+
+void ThreadLocalDBCache::setMaxPoolSize(const size_t &size)
+{
+	Impl::setMaxPoolSize(size);
+}
+
+size_t ThreadLocalDBCache::getMaxPoolSize(void)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	return Impl::maxPoolSize;
+}
+
+void ThreadLocalDBCache::getPoolStats(PoolStats &stats)
+{
+	AutoMutex autoMutex(&Impl::lock);
+	stats = Impl::stats;
+	stats.maxPoolSize   = Impl::maxPoolSize;
+	stats.numCheckedOut = Impl::numCheckedOut;
+	stats.numInstances  = Impl::idleList.size() + Impl::numCheckedOut;
 }
 
 ThreadLocalDBCache::ThreadLocalDBCache(void)
 {
+	Impl::ctx.numCaches++;
 }
 
 ThreadLocalDBCache::~ThreadLocalDBCache()
 {
+	Impl::ctx.numCaches--;
+	if (Impl::ctx.numCaches == 0 && Impl::ctx.dbHatohol)
+		Impl::checkin();
 }
 
 DBHatohol &ThreadLocalDBCache::getDBHatohol(void)
 {
-	ThreadContext *ctx = Impl::getContext();
-	if (!ctx->dbHatohol)
-		ctx->dbHatohol = new DBHatohol();
-	Impl::insert(ctx->dbHatohol);
-	return *ctx->dbHatohol;
+	if (!Impl::ctx.dbHatohol)
+		Impl::checkout();
+	return *Impl::ctx.dbHatohol;
 }
 
 DBTablesConfig &ThreadLocalDBCache::getConfig(void)
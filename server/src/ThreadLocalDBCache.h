@@ -26,17 +26,71 @@
 #include "DBTablesAction.h"
 #include "DBHatohol.h"
 
+/**
+ * DBHatohol instances are shared by threads with a bounded pool.
+ *
+ * An instance is checked out from the pool when getDBHatohol() (or
+ * one of the other accessors) is called first in the thread. It is shared
+ * by all ThreadLocalDBCache instances of the thread and checked in when
+ * the last one of them is destroyed. When all instances are checked out,
+ * the checkout waits until one of them is checked in.
+ */
 class ThreadLocalDBCache
 {
 public:
+	static const size_t DEFAULT_MAX_POOL_SIZE;
+	static const size_t CHECKOUT_TIMEOUT_MSEC;
+
+	// An instance idle for this period is checked with
+	// DBAgent::isAlive() before it is reused.
+	static const int    HEALTH_CHECK_IDLE_SEC;
+
+	struct PoolStats {
+		size_t maxPoolSize;
+		size_t numInstances;  // Checked out and idle ones
+		size_t numCheckedOut;
+		size_t numCheckouts;
+		size_t numWaits;      // Checkouts that waited for a checkin
+		size_t numDiscarded;  // Instances failed in the health check
+
+		// The time that a checkout waits for a checkin.
+		double totalWaitTimeMSec;
+		double maxWaitTimeMSec;
+
+		PoolStats(void);
+	};
+
+	/**
+	 * Delete the idle instances in the pool and reset the statistics
+	 * and the pool size. The instances checked out at this time are
+	 * deleted when they are checked in.
+	 */
 	static void reset(void);
 
 	/**
-	 * Delete cache for the caller thread.
+	 * Check in the instance of the caller thread if it remains.
 	 */
 	static void cleanup(void);
+
+	/**
+	 * Get the number of DBHatohol instances including idle ones.
+	 */
 	static size_t getNumberOfDBClientMaps(void);
 
+	/**
+	 * Set the maximum number of DBHatohol instances. It can be
+	 * specified by --db-pool-size <NUM>.
+	 */
+	static void setMaxPoolSize(const size_t &size);
+	static size_t getMaxPoolSize(void);
+
+	/**
+	 * Get the statistics of the pool since the last reset().
+	 *
+	 * @param stats The statistics are copied to this.
+	 */
+	static void getPoolStats(PoolStats &stats);
+
 	ThreadLocalDBCache(void);
 	virtual ~ThreadLocalDBCache();
 
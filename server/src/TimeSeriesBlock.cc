@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <StringUtils.h>
+#include "TimeSeriesBlock.h"
+using namespace std;
+using namespace mlpl;
+
+// The maximum number of the digits after the decimal point of a value
+// stored as a double
+static const uint8_t MAX_DECIMALS = 20;
+static const size_t  NUM_DECIMALS_BITS = 5;
+
+static const size_t  NUM_NSEC_BITS = 30;
+
+// It means that the window of the meaningful bits of the XORed value
+// has not been decided yet.
+static const uint8_t NO_WINDOW = 0xff;
+static const size_t  NUM_LEADING_ZEROS_BITS = 6;
+static const size_t  NUM_MEANINGFUL_BITS_BITS = 6;
+
+// Delta-of-delta buckets: the number of the control bits, the control
+// bits and the number of the bits of the zigzag encoded value.
+struct DeltaBucket {
+	size_t   numControlBits;
+	uint64_t controlBits;
+	size_t   numValueBits;
+};
+
+static const DeltaBucket DELTA_BUCKETS[] = {
+	{2, 0x2,  7},  // '10'
+	{3, 0x6,  9},  // '110'
+	{4, 0xe, 12},  // '1110'
+	{4, 0xf, 64},  // '1111'
+};
+static const size_t NUM_DELTA_BUCKETS =
+  sizeof(DELTA_BUCKETS) / sizeof(DeltaBucket);
+
+static uint64_t zigzagEncode(const int64_t &value)
+{
+	return (static_cast<uint64_t>(value) << 1) ^
+	       static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t zigzagDecode(const uint64_t &value)
+{
+	return static_cast<int64_t>(value >> 1) ^
+	       -static_cast<int64_t>(value & 1);
+}
+
+static uint64_t getBitsOfDouble(const double &value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static double getDoubleOfBits(const uint64_t &bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static string formatDecimal(const double &value, const uint8_t &decimals)
+{
+	return StringUtils::sprintf("%.*f", decimals, value);
+}
+
+/**
+ * Parse a string like "-12.345".
+ *
+ * @return
+ * true if the string is restored from the parsed value and decimals.
+ */
+static bool parseDecimal(const string &str, double &value, uint8_t &decimals)
+{
+	const size_t len = str.size();
+	size_t idx = 0;
+	if (idx < len && str[idx] == '-')
+		idx++;
+	size_t numIntegerDigits = 0;
+	for (; idx < len && isdigit(str[idx]); idx++)
+		numIntegerDigits++;
+	if (numIntegerDigits == 0)
+		return false;
+
+	size_t numDecimals = 0;
+	if (idx < len && str[idx] == '.') {
+		idx++;
+		for (; idx < len && isdigit(str[idx]); idx++)
+			numDecimals++;
+		if (numDecimals == 0)
+			return false;
+	}
+	if (idx != len || numDecimals > MAX_DECIMALS)
+		return false;
+
+	value = strtod(str.c_str(), NULL);
+	decimals = numDecimals;
+	return formatDecimal(value, decimals) == str;
+}
+
+struct TimeSeriesBitReader {
+	const vector<uint64_t> &words;
+	size_t                  position;
+
+	TimeSeriesBitReader(const vector<uint64_t> &_words)
+	: words(_words),
+	  position(0)
+	{
+	}
+
+	uint64_t read(const size_t &numBits)
+	{
+		const size_t offset = position % 64;
+		const size_t space = 64 - offset;
+		uint64_t bits = words[position / 64] << offset;
+		if (numBits > space)
+			bits |= words[position / 64 + 1] >> space;
+		position += numBits;
+		return bits >> (64 - numBits);
+	}
+
+	bool readBit(void)
+	{
+		return read(1);
+	}
+
+	size_t readLength(void)
+	{
+		size_t length = 0;
+		for (size_t shift = 0; ; shift += 7) {
+			const uint64_t group = read(8);
+			length |= (group & 0x7f) << shift;
+			if (!(group & 0x80))
+				break;
+		}
+		return length;
+	}
+};
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+TimeSeriesBlock::TimeSeriesBlock(void)
+: m_numBits(0),
+  m_numSamples(0),
+  m_beginTime(0),
+  m_lastTime(0),
+  m_lastDelta(0),
+  m_lastValueBits(0),
+  m_lastLeadingZeros(NO_WINDOW),
+  m_lastTrailingZeros(0),
+  m_lastDecimals(0)
+{
+}
+
+void TimeSeriesBlock::append(const timespec &clock, const string &value)
+{
+	appendTime(clock);
+	appendValue(value);
+	m_numSamples++;
+}
+
+void TimeSeriesBlock::append(const HistoryInfo &historyInfo)
+{
+	append(historyInfo.clock, historyInfo.value);
+}
+
+void TimeSeriesBlock::decode(HistoryInfoVect &historyInfoVect,
+                             const ServerIdType &serverId,
+                             const ItemIdType &itemId) const
+{
+	TimeSeriesBitReader reader(m_words);
+	time_t   time = m_beginTime;
+	int64_t  delta = 0;
+	uint64_t valueBits = 0;
+	uint8_t  leadingZeros = NO_WINDOW;
+	uint8_t  trailingZeros = 0;
+	uint8_t  decimals = 0;
+
+	historyInfoVect.reserve(historyInfoVect.size() + m_numSamples);
+	for (size_t i = 0; i < m_numSamples; i++) {
+		HistoryInfo historyInfo;
+		historyInfo.serverId = serverId;
+		historyInfo.itemId = itemId;
+
+		// Time
+		if (i > 0 && reader.readBit()) {
+			size_t idx = 0;
+			while (idx < NUM_DELTA_BUCKETS - 1 && reader.readBit())
+				idx++;
+			const DeltaBucket &bucket = DELTA_BUCKETS[idx];
+			delta += zigzagDecode(reader.read(bucket.numValueBits));
+		}
+		if (i > 0)
+			time += delta;
+		historyInfo.clock.tv_sec = time;
+		historyInfo.clock.tv_nsec =
+		  reader.readBit() ? reader.read(NUM_NSEC_BITS) : 0;
+
+		// Value
+		if (reader.readBit()) {
+			const size_t length = reader.readLength();
+			historyInfo.value.reserve(length);
+			for (size_t n = 0; n < length; n++)
+				historyInfo.value += static_cast<char>(
+				  reader.read(8));
+		} else {
+			if (reader.readBit())
+				decimals = reader.read(NUM_DECIMALS_BITS);
+			if (reader.readBit()) {
+				if (reader.readBit()) {
+					leadingZeros = reader.read(
+					  NUM_LEADING_ZEROS_BITS);
+					const size_t numMeaningfulBits =
+					  reader.read(
+					    NUM_MEANINGFUL_BITS_BITS) + 1;
+					trailingZeros = 64 - leadingZeros -
+					                numMeaningfulBits;
+				}
+				const size_t numMeaningfulBits =
+				  64 - leadingZeros - trailingZeros;
+				valueBits ^= reader.read(numMeaningfulBits)
+				               << trailingZeros;
+			}
+			historyInfo.value =
+			  formatDecimal(getDoubleOfBits(valueBits), decimals);
+		}
+		historyInfoVect.push_back(historyInfo);
+	}
+}
+
+size_t TimeSeriesBlock::getNumberOfSamples(void) const
+{
+	return m_numSamples;
+}
+
+time_t TimeSeriesBlock::getBeginTime(void) const
+{
+	return m_beginTime;
+}
+
+time_t TimeSeriesBlock::getEndTime(void) const
+{
+	return m_lastTime;
+}
+
+size_t TimeSeriesBlock::getMemorySize(void) const
+{
+	return sizeof(TimeSeriesBlock) + m_words.capacity() * sizeof(uint64_t);
+}
+
+void TimeSeriesBlock::shrink(void)
+{
+	m_words.shrink_to_fit();
+}
+
+// ---------------------------------------------------------------------------
+// Private methods
+// ---------------------------------------------------------------------------
+void TimeSeriesBlock::writeBits(const uint64_t &bits, const size_t &numBits)
+{
+	const uint64_t maskedBits =
+	  (numBits == 64) ? bits : (bits & ((1ULL << numBits) - 1));
+	const size_t offset = m_numBits % 64;
+	if (offset == 0)
+		m_words.push_back(0);
+	const size_t space = 64 - offset;
+	if (numBits <= space) {
+		m_words.back() |= maskedBits << (space - numBits);
+	} else {
+		m_words.back() |= maskedBits >> (numBits - space);
+		m_words.push_back(maskedBits << (64 - (numBits - space)));
+	}
+	m_numBits += numBits;
+}
+
+void TimeSeriesBlock::appendTime(const timespec &clock)
+{
+	if (m_numSamples == 0) {
+		m_beginTime = clock.tv_sec;
+	} else {
+		const int64_t delta = clock.tv_sec - m_lastTime;
+		const int64_t deltaOfDelta = delta - m_lastDelta;
+		if (deltaOfDelta == 0) {
+			writeBits(0, 1);
+		} else {
+			const uint64_t zigzag = zigzagEncode(deltaOfDelta);
+			size_t idx = 0;
+			for (; idx < NUM_DELTA_BUCKETS - 1; idx++) {
+				if (zigzag <
+				    (1ULL << DELTA_BUCKETS[idx].numValueBits))
+					break;
+			}
+			const DeltaBucket &bucket = DELTA_BUCKETS[idx];
+			writeBits(bucket.controlBits, bucket.numControlBits);
+			writeBits(zigzag, bucket.numValueBits);
+		}
+		m_lastDelta = delta;
+	}
+	m_lastTime = clock.tv_sec;
+
+	if (clock.tv_nsec == 0) {
+		writeBits(0, 1);
+	} else {
+		writeBits(1, 1);
+		writeBits(clock.tv_nsec, NUM_NSEC_BITS);
+	}
+}
+
+void TimeSeriesBlock::appendValue(const string &value)
+{
+	double number;
+	uint8_t decimals;
+	if (parseDecimal(value, number, decimals)) {
+		writeBits(0, 1);
+		appendDouble(number, decimals);
+	} else {
+		writeBits(1, 1);
+		appendString(value);
+	}
+}
+
+void TimeSeriesBlock::appendDouble(const double &value,
+                                   const uint8_t &decimals)
+{
+	if (decimals == m_lastDecimals) {
+		writeBits(0, 1);
+	} else {
+		writeBits(1, 1);
+		writeBits(decimals, NUM_DECIMALS_BITS);
+		m_lastDecimals = decimals;
+	}
+
+	const uint64_t bits = getBitsOfDouble(value);
+	const uint64_t xorBits = bits ^ m_lastValueBits;
+	m_lastValueBits = bits;
+	if (xorBits == 0) {
+		writeBits(0, 1);
+		return;
+	}
+
+	const uint8_t leadingZeros = __builtin_clzll(xorBits);
+	const uint8_t trailingZeros = __builtin_ctzll(xorBits);
+	if (m_lastLeadingZeros != NO_WINDOW &&
+	    leadingZeros >= m_lastLeadingZeros &&
+	    trailingZeros >= m_lastTrailingZeros) {
+		// The previous window is reused.
+		writeBits(0x2, 2);
+		writeBits(xorBits >> m_lastTrailingZeros,
+		          64 - m_lastLeadingZeros - m_lastTrailingZeros);
+		return;
+	}
+
+	const size_t numMeaningfulBits = 64 - leadingZeros - trailingZeros;
+	writeBits(0x3, 2);
+	writeBits(leadingZeros, NUM_LEADING_ZEROS_BITS);
+	writeBits(numMeaningfulBits - 1, NUM_MEANINGFUL_BITS_BITS);
+	writeBits(xorBits >> trailingZeros, numMeaningfulBits);
+	m_lastLeadingZeros = leadingZeros;
+	m_lastTrailingZeros = trailingZeros;
+}
+
+void TimeSeriesBlock::appendString(const string &value)
+{
+	// The length is written in 7 bits groups with a continuation bit.
+	size_t length = value.size();
+	do {
+		const uint64_t group = length & 0x7f;
+		length >>= 7;
+		writeBits((length ? 0x80 : 0) | group, 8);
+	} while (length);
+
+	for (size_t i = 0; i < value.size(); i++)
+		writeBits(static_cast<uint8_t>(value[i]), 8);
+}
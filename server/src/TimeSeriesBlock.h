@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TimeSeriesBlock_h
+#define TimeSeriesBlock_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Params.h"
+#include "Monitoring.h"
+
+/**
+ * A compact block of time-ordered samples of an item.
+ *
+ * The samples are encoded into a bit stream in the manner of Gorilla:
+ * - The seconds of the timestamps are stored as a delta of the delta.
+ * - The nanoseconds take only a bit when they are 0.
+ * - A value that is a decimal number is stored as a double XORed with
+ *   the previous one together with the number of the digits after the
+ *   decimal point, so that the original string is restored exactly.
+ * - Other values, such as texts, are stored as raw strings.
+ *
+ * This is a value type because it is held in a large number.
+ */
+class TimeSeriesBlock {
+public:
+	TimeSeriesBlock(void);
+
+	/**
+	 * Append a sample. The samples must be appended in the order of
+	 * the time.
+	 */
+	void append(const timespec &clock, const std::string &value);
+	void append(const HistoryInfo &historyInfo);
+
+	/**
+	 * Decode the samples.
+	 *
+	 * @param historyInfoVect The samples are added to this.
+	 * @param serverId A server ID set to the samples.
+	 * @param itemId An item ID set to the samples.
+	 */
+	void decode(HistoryInfoVect &historyInfoVect,
+	            const ServerIdType &serverId,
+	            const ItemIdType &itemId) const;
+
+	size_t getNumberOfSamples(void) const;
+
+	/**
+	 * The seconds of the first and the last samples.
+	 * They are meaningful only when the block is not empty.
+	 */
+	time_t getBeginTime(void) const;
+	time_t getEndTime(void) const;
+
+	size_t getMemorySize(void) const;
+
+	/**
+	 * Release the unused capacity of the buffer. It should be called
+	 * when no sample will be appended.
+	 */
+	void shrink(void);
+
+private:
+	std::vector<uint64_t> m_words;
+	size_t                m_numBits;
+	size_t                m_numSamples;
+	time_t                m_beginTime;
+
+	// The states to encode the next sample
+	time_t                m_lastTime;
+	int64_t               m_lastDelta;
+	uint64_t              m_lastValueBits;
+	uint8_t               m_lastLeadingZeros;
+	uint8_t               m_lastTrailingZeros;
+	uint8_t               m_lastDecimals;
+
+	void writeBits(const uint64_t &bits, const size_t &numBits);
+	void appendTime(const timespec &clock);
+	void appendValue(const std::string &value);
+	void appendDouble(const double &value, const uint8_t &decimals);
+	void appendString(const std::string &value);
+};
+
+typedef std::vector<TimeSeriesBlock>        TimeSeriesBlockVect;
+typedef TimeSeriesBlockVect::iterator       TimeSeriesBlockVectIterator;
+typedef TimeSeriesBlockVect::const_iterator TimeSeriesBlockVectConstIterator;
+
+#endif // TimeSeriesBlock_h
@@ -20,28 +20,14 @@
 #ifndef TriggerFetchWorker_h
 #define TriggerFetchWorker_h
 
-#include "Params.h"
-#include "Closure.h"
-#include "DataStore.h"
+#include "FetchCoordinator.h"
 
-class TriggerFetchWorker
+class TriggerFetchWorker : public FetchCoordinator
 {
-public:
-	TriggerFetchWorker(void);
-	virtual ~TriggerFetchWorker();
-
-	bool start(const ServerIdType &targetServerId = ALL_SERVERS,
-	           Closure0 *closure = NULL);
-	bool updateIsNeeded(void);
-	void waitCompletion(void);
-
 protected:
-	void updatedCallback(Closure0 *closure);
-	bool runFetcher(DataStore *dataStore);
-
-private:
-	struct Impl;
-	std::unique_ptr<Impl> m_impl;
+	virtual bool isFetchSupported(DataStore *dataStore) override;
+	virtual bool startFetch(DataStore *dataStore, Closure0 *closure)
+	  override;
 };
 
 #endif // TriggerFetchWorker_h
@@ -32,6 +32,9 @@
 #include "DataStoreFactory.h"
 #include "ArmIncidentTracker.h"
 #include "IncidentSenderManager.h"
+#include "HotEventRing.h"
+#include "IngestionQueue.h"
+#include "ConfigManager.h"
 
 using namespace std;
 using namespace mlpl;
@@ -299,6 +302,7 @@ struct UnifiedDataStore::Impl
 
 	void start(const bool &autoRun)
 	{
+		startIngestionQueueIfNeeded();
 		startAllDataStores(autoRun);
 		startAllArmIncidentTrackers(autoRun);
 		isStarted = true;
@@ -308,9 +312,23 @@ struct UnifiedDataStore::Impl
 	{
 		stopAllDataStores();
 		stopAllArmIncidentTrackers();
+
+		// The arms that add the data have been stopped.
+		IngestionQueue::getInstance()->stop();
 		isStarted = false;
 	}
 
+	void startIngestionQueueIfNeeded(void)
+	{
+		ConfigManager *confMgr = ConfigManager::getInstance();
+		const int numWriters = confMgr->getIngestionNumWriters();
+		IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+		if (numWriters <= 0 || ingestionQueue->isStarted())
+			return;
+		ingestionQueue->start(numWriters,
+		                      confMgr->getIngestionQueueSize());
+	}
+
 	ReadWriteLock            serverIdDataStoreMapLock;
 	ServerIdDataStoreMap     serverIdDataStoreMap;
 	DataStoreManager         dataStoreManager;
@@ -366,14 +384,7 @@ void UnifiedDataStore::fetchItems(const ServerIdType &targetServerId)
 {
 	if (!getCopyOnDemandEnabled())
 		return;
-	if (!m_impl->itemFetchWorker.updateIsNeeded())
-		return;
-
-	bool started = m_impl->itemFetchWorker.start(targetServerId, NULL);
-	if (!started)
-		return;
-
-	m_impl->itemFetchWorker.waitCompletion();
+	m_impl->itemFetchWorker.fetch(targetServerId);
 }
 
 void UnifiedDataStore::getTriggerList(TriggerInfoList &triggerList,
@@ -397,6 +408,11 @@ HatoholError UnifiedDataStore::getEventList(EventInfoList &eventList,
 					    EventsQueryOption &option,
 					    IncidentInfoVect *incidentVect)
 {
+	// The rings don't have the incidents.
+	if (!incidentVect &&
+	    HotEventRing::getInstance()->getEventInfoList(eventList, option))
+		return HTERR_OK;
+
 	ThreadLocalDBCache cache;
 	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
 	return dbMonitoring.getEventInfoList(eventList, option, incidentVect);
@@ -424,18 +440,12 @@ bool UnifiedDataStore::fetchItemsAsync(Closure0 *closure,
 {
 	if (!getCopyOnDemandEnabled())
 		return false;
-	if (!m_impl->itemFetchWorker.updateIsNeeded())
-		return false;
-
 	return m_impl->itemFetchWorker.start(targetServerId, closure);
 }
 
 bool UnifiedDataStore::fetchTriggerAsync(Closure0 *closure,
 					 const ServerIdType &targetServerId)
 {
-	if (!m_impl->triggerFetchWorker.updateIsNeeded())
-		return false;
-
 	return m_impl->triggerFetchWorker.start(targetServerId, closure);
 }
 
@@ -500,24 +510,19 @@ HatoholError UnifiedDataStore::upsertHosts(
 
 HatoholError UnifiedDataStore::syncHosts(
   const ServerHostDefVect &svHostDefs, const ServerIdType &serverId,
-  HostInfoCache &hostInfoCache)
+  HostInfoCache &hostInfoCache, bool *storedHostsChanged)
 {
 	ThreadLocalDBCache cache;
 	HostHostIdMap hostHostIdMap;
 	HatoholError err = cache.getHost().syncHosts(svHostDefs, serverId,
-	                                             &hostHostIdMap);
+	                                             &hostHostIdMap,
+	                                             storedHostsChanged);
 	if (err != HTERR_OK)
 		return err;
 	hostInfoCache.update(svHostDefs, &hostHostIdMap);
 	return HTERR_OK;
 }
 
-bool UnifiedDataStore::wasStoredHostsChanged(void)
-{
-	ThreadLocalDBCache cache;
-	return cache.getHost().wasStoredHostsChanged();
-}
-
 HatoholError UnifiedDataStore::upsertHostgroups(const HostgroupVect &hostgroups)
 {
 	ThreadLocalDBCache cache;
@@ -585,6 +590,24 @@ HatoholError UnifiedDataStore::getNumberOfMonitoredItemsPerSecond(
 	return dbMonitoring.getNumberOfMonitoredItemsPerSecond(option, serverStatus);
 }
 
+bool UnifiedDataStore::getOverviewTriggerCounts(
+  OverviewCounter::TriggerCounts &counts, DataQueryContext &dataQueryContext,
+  const ServerIdType &serverId, const HostgroupIdType &hostgroupId)
+{
+	return OverviewCounter::getInstance()->getTriggerCounts(
+	  counts, dataQueryContext, serverId, hostgroupId);
+}
+
+bool UnifiedDataStore::getOverviewNumberOfItems(
+  size_t &numItems, DataQueryContext &dataQueryContext,
+  const ServerIdType &serverId, bool fetchItemsSynchronously)
+{
+	if (fetchItemsSynchronously)
+		fetchItems(serverId);
+	return OverviewCounter::getInstance()->getNumberOfItems(
+	  numItems, dataQueryContext, serverId);
+}
+
 bool UnifiedDataStore::getCopyOnDemandEnabled(void) const
 {
 	return m_impl->isCopyOnDemandEnabled;
@@ -602,16 +625,38 @@ HatoholError UnifiedDataStore::addAction(ActionDef &actionDef,
 	return cache.getAction().addAction(actionDef, privilege);
 }
 
-void UnifiedDataStore::addEventList(EventInfoList &eventList)
+void UnifiedDataStore::addEventList(EventInfoList &eventList,
+                                    Closure1<bool> *committedCb)
 {
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	if (ingestionQueue->isStarted()) {
+		ingestionQueue->addEventList(eventList, committedCb);
+		return;
+	}
+	unique_ptr<Closure1<bool> > committedCbPtr(committedCb);
 	ThreadLocalDBCache cache;
 	ActionManager actionManager;
 	cache.getMonitoring().addEventInfoList(eventList);
+	if (committedCb)
+		(*committedCb)(true);
 	actionManager.checkEvents(eventList);
 }
 
+bool UnifiedDataStore::flushIngestion(const ServerIdType &serverId)
+{
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	if (!ingestionQueue->isStarted())
+		return true;
+	return ingestionQueue->flush(serverId);
+}
+
 void UnifiedDataStore::addItemList(const ItemInfoList &itemList)
 {
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	if (ingestionQueue->isStarted()) {
+		ingestionQueue->addItemList(itemList);
+		return;
+	}
 	ThreadLocalDBCache cache;
 	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
 	dbMonitoring.addItemInfoList(itemList);
@@ -620,6 +665,11 @@ void UnifiedDataStore::addItemList(const ItemInfoList &itemList)
 void UnifiedDataStore::addMonitoringServerStatus(
   const MonitoringServerStatus &serverStatus)
 {
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	if (ingestionQueue->isStarted()) {
+		ingestionQueue->addMonitoringServerStatus(serverStatus);
+		return;
+	}
 	ThreadLocalDBCache cache;
 	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
 	dbMonitoring.addMonitoringServerStatus(serverStatus);
@@ -28,6 +28,7 @@
 #include "Closure.h"
 #include "DataStore.h"
 #include "HostInfoCache.h"
+#include "OverviewCounter.h"
 
 struct ServerConnStatus {
 	ServerIdType serverId;
@@ -61,10 +62,31 @@ public:
 
 	/**
 	 * Add events in the Hatohol DB and executes action if needed.
+	 * When IngestionQueue is started, the events are added to the
+	 * queue and written by its writer threads. So the unified IDs of
+	 * the events are not set in that case.
 	 *
 	 * @param eventList A list of EventInfo.
+	 * @param committedCb
+	 * A callback that is called with true after the events are stored,
+	 * or with false when IngestionQueue drops them. It is deleted after
+	 * the call. NULL can be passed.
 	 */
-	void addEventList(EventInfoList &eventList);
+	void addEventList(EventInfoList &eventList,
+	                  Closure1<bool> *committedCb = NULL);
+
+	/**
+	 * Wait until the data of the server added to IngestionQueue are
+	 * written. It returns soon when the queue isn't started. It should
+	 * be called before the data stored by the server are read back.
+	 *
+	 * @param serverId A server ID.
+	 *
+	 * @return
+	 * false if some data of the server have been dropped since the
+	 * previous call. Otherwise true.
+	 */
+	bool flushIngestion(const ServerIdType &serverId);
 
 	void addItemList(const ItemInfoList &itemList);
 
@@ -105,7 +127,8 @@ public:
 	/*
 	 *  We don't provide a function to get history.
 	 *  Please get a DataStore by getDataStore() and use
-	 *  DataStore::startOnDemandFetchHistory() directly.
+	 *  HistoryCache::fetch() that calls
+	 *  DataStore::startOnDemandFetchHistory() for the missing ranges.
 	 */
 	/*
 	void fetchHistoryAsync(Closure1<HistoryInfoVect> *closure,
@@ -155,11 +178,11 @@ public:
 
 	/**
 	 * call upsertHosts for given hosts and update HostInfoCache.
+	 * See DBTablesHost::syncHosts() for storedHostsChanged.
 	 */
 	HatoholError syncHosts(
 	  const ServerHostDefVect &svHostDefs, const ServerIdType &serverId,
-	  HostInfoCache &hostInfoCache);
-	bool wasStoredHostsChanged(void);
+	  HostInfoCache &hostInfoCache, bool *storedHostsChanged = NULL);
 
 	HatoholError upsertHostgroups(const HostgroupVect &hostgroups);
 	HatoholError upsertHostgroupMembers(
@@ -191,6 +214,25 @@ public:
 	HatoholError getNumberOfMonitoredItemsPerSecond(const DataQueryOption &option,
 	                                                MonitoringServerStatus &serverStatus);
 
+	/**
+	 * Get the counts for the overview from the counters in memory.
+	 * They are equivalent to the above methods with
+	 * EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING.
+	 *
+	 * @return
+	 * false if the requester can see only a part of the target.
+	 * In that case, the above methods should be used.
+	 */
+	bool getOverviewTriggerCounts(OverviewCounter::TriggerCounts &counts,
+	                              DataQueryContext &dataQueryContext,
+	                              const ServerIdType &serverId,
+	                              const HostgroupIdType &hostgroupId
+	                                = ALL_HOST_GROUPS);
+	bool getOverviewNumberOfItems(size_t &numItems,
+	                              DataQueryContext &dataQueryContext,
+	                              const ServerIdType &serverId,
+	                              bool fetchItemsSynchronously = false);
+
 	// User
 	void getUserList(UserInfoList &userList,
 	                 const UserQueryOption &option);
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+#include <list>
+#include <Mutex.h>
+#include <ReadWriteLock.h>
+#include <Reaper.h>
+#include "UserPrivilegeCache.h"
+#include "DataQueryContext.h"
+#include "ThreadLocalDBCache.h"
+
+using namespace std;
+using namespace mlpl;
+
+const size_t UserPrivilegeCache::MAX_CONDITIONS_PER_USER = 64;
+
+struct UserPrivilegeCacheEntry {
+	bool                   hasSrvHostGrpSetMap;
+	ServerHostGrpSetMap    srvHostGrpSetMap;
+
+	bool                   hasValidServerIdSet;
+	OperationPrivilegeFlag validServerIdSetFlags;
+	ServerIdSet            validServerIdSet;
+
+	bool                   hasHostIdBitmapMap;
+	ServerHostIdBitmapMap  hostIdBitmapMap;
+	size_t                 numHostIdRanges;
+
+	map<string, string>    conditionMap;
+	list<string>           conditionKeys; // The head is the oldest.
+
+	UserPrivilegeCacheEntry(void)
+	: hasSrvHostGrpSetMap(false),
+	  hasValidServerIdSet(false),
+	  validServerIdSetFlags(0),
+	  hasHostIdBitmapMap(false),
+	  numHostIdRanges(0)
+	{
+	}
+};
+
+typedef map<UserIdType, UserPrivilegeCacheEntry> UserPrivilegeCacheEntryMap;
+typedef UserPrivilegeCacheEntryMap::iterator UserPrivilegeCacheEntryMapIterator;
+
+struct UserPrivilegeCache::Impl {
+	static Mutex               initLock;
+	static UserPrivilegeCache *instance;
+
+	ReadWriteLock              rwlock;
+	Generation                 generation;
+	UserPrivilegeCacheEntryMap entryMap;
+
+	Impl(void)
+	: generation(0)
+	{
+	}
+
+	// This method shall be called with rwlock taken.
+	UserPrivilegeCacheEntry *findEntry(const UserIdType &userId)
+	{
+		UserPrivilegeCacheEntryMapIterator it = entryMap.find(userId);
+		if (it == entryMap.end())
+			return NULL;
+		return &it->second;
+	}
+};
+
+static size_t countHostIdRanges(const ServerHostIdBitmapMap &hostIdBitmapMap)
+{
+	size_t numRanges = 0;
+	ServerHostIdBitmapMapConstIterator it = hostIdBitmapMap.begin();
+	for (; it != hostIdBitmapMap.end(); ++it) {
+		HostIdRangeVect ranges;
+		it->second.getRanges(ranges);
+		numRanges += ranges.size();
+	}
+	return numRanges;
+}
+
+Mutex               UserPrivilegeCache::Impl::initLock;
+UserPrivilegeCache *UserPrivilegeCache::Impl::instance = NULL;
+
+// ---------------------------------------------------------------------------
+// Public methods
+// ---------------------------------------------------------------------------
+void UserPrivilegeCache::reset(void)
+{
+	getInstance()->invalidateAll();
+}
+
+UserPrivilegeCache *UserPrivilegeCache::getInstance(void)
+{
+	Impl::initLock.lock();
+	if (!Impl::instance)
+		Impl::instance = new UserPrivilegeCache();
+	Impl::initLock.unlock();
+	return Impl::instance;
+}
+
+UserPrivilegeCache::Generation UserPrivilegeCache::getServerHostGrpSetMap(
+  ServerHostGrpSetMap &srvHostGrpSetMap, const UserIdType &userId)
+{
+	m_impl->rwlock.readLock();
+	const Generation generation = m_impl->generation;
+	UserPrivilegeCacheEntry *entry = m_impl->findEntry(userId);
+	if (entry && entry->hasSrvHostGrpSetMap) {
+		srvHostGrpSetMap = entry->srvHostGrpSetMap;
+		m_impl->rwlock.unlock();
+		return generation;
+	}
+	m_impl->rwlock.unlock();
+
+	ThreadLocalDBCache cache;
+	cache.getUser().getServerHostGrpSetMap(srvHostGrpSetMap, userId);
+
+	m_impl->rwlock.writeLock();
+	if (m_impl->generation == generation) {
+		UserPrivilegeCacheEntry &newEntry = m_impl->entryMap[userId];
+		newEntry.srvHostGrpSetMap = srvHostGrpSetMap;
+		newEntry.hasSrvHostGrpSetMap = true;
+	}
+	m_impl->rwlock.unlock();
+	return generation;
+}
+
+void UserPrivilegeCache::getValidServerIdSet(
+  ServerIdSet &serverIdSet, DataQueryContext *dataQueryContext)
+{
+	const OperationPrivilege &privilege =
+	  dataQueryContext->getOperationPrivilege();
+	const UserIdType userId = privilege.getUserId();
+	const OperationPrivilegeFlag flags = privilege.getFlags();
+
+	m_impl->rwlock.readLock();
+	const Generation generation = m_impl->generation;
+	UserPrivilegeCacheEntry *entry = m_impl->findEntry(userId);
+	if (entry && entry->hasValidServerIdSet &&
+	    entry->validServerIdSetFlags == flags) {
+		serverIdSet = entry->validServerIdSet;
+		m_impl->rwlock.unlock();
+		return;
+	}
+	m_impl->rwlock.unlock();
+
+	ThreadLocalDBCache cache;
+	cache.getConfig().getServerIdSet(serverIdSet, dataQueryContext);
+
+	m_impl->rwlock.writeLock();
+	if (m_impl->generation == generation) {
+		UserPrivilegeCacheEntry &newEntry = m_impl->entryMap[userId];
+		newEntry.validServerIdSet = serverIdSet;
+		newEntry.validServerIdSetFlags = flags;
+		newEntry.hasValidServerIdSet = true;
+	}
+	m_impl->rwlock.unlock();
+}
+
+void UserPrivilegeCache::getHostIdBitmapMap(
+  ServerHostIdBitmapMap &hostIdBitmapMap, const UserIdType &userId)
+{
+	m_impl->rwlock.readLock();
+	const Generation generation = m_impl->generation;
+	UserPrivilegeCacheEntry *entry = m_impl->findEntry(userId);
+	if (entry && entry->hasHostIdBitmapMap) {
+		hostIdBitmapMap = entry->hostIdBitmapMap;
+		m_impl->rwlock.unlock();
+		return;
+	}
+	m_impl->rwlock.unlock();
+
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	getServerHostGrpSetMap(srvHostGrpSetMap, userId);
+
+	HostgroupMemberVect hostgrpMembers;
+	HostgroupMembersQueryOption option(userId);
+	// Avoid the recursion to this method.
+	option.setAuthorizationStrategy(
+	  HostResourceQueryOption::AUTHORIZATION_STRATEGY_HOSTGROUP);
+	ThreadLocalDBCache cache;
+	cache.getHost().getHostgroupMembers(hostgrpMembers, option);
+
+	HostgroupMemberVectConstIterator memberItr = hostgrpMembers.begin();
+	for (; memberItr != hostgrpMembers.end(); ++memberItr) {
+		const HostgroupMember &member = *memberItr;
+		ServerHostGrpSetMapConstIterator svItr =
+		  srvHostGrpSetMap.find(member.serverId);
+		if (svItr == srvHostGrpSetMap.end())
+			continue;
+		const HostgroupIdSet &hostgrpIdSet = svItr->second;
+		if (hostgrpIdSet.count(ALL_HOST_GROUPS))
+			continue;
+		if (!hostgrpIdSet.count(member.hostgroupIdInServer))
+			continue;
+		hostIdBitmapMap[member.serverId].add(member.hostId);
+	}
+
+	m_impl->rwlock.writeLock();
+	if (m_impl->generation == generation) {
+		UserPrivilegeCacheEntry &newEntry = m_impl->entryMap[userId];
+		newEntry.hostIdBitmapMap = hostIdBitmapMap;
+		newEntry.numHostIdRanges = countHostIdRanges(hostIdBitmapMap);
+		newEntry.hasHostIdBitmapMap = true;
+	}
+	m_impl->rwlock.unlock();
+}
+
+size_t UserPrivilegeCache::getNumberOfHostIdRanges(const UserIdType &userId)
+{
+	m_impl->rwlock.readLock();
+	UserPrivilegeCacheEntry *entry = m_impl->findEntry(userId);
+	if (entry && entry->hasHostIdBitmapMap) {
+		const size_t numRanges = entry->numHostIdRanges;
+		m_impl->rwlock.unlock();
+		return numRanges;
+	}
+	m_impl->rwlock.unlock();
+
+	ServerHostIdBitmapMap hostIdBitmapMap;
+	getHostIdBitmapMap(hostIdBitmapMap, userId);
+	return countHostIdRanges(hostIdBitmapMap);
+}
+
+bool UserPrivilegeCache::getCondition(
+  string &condition, const UserIdType &userId, const string &key)
+{
+	bool found = false;
+	m_impl->rwlock.readLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	UserPrivilegeCacheEntry *entry = m_impl->findEntry(userId);
+	if (!entry)
+		return false;
+	map<string, string>::const_iterator it = entry->conditionMap.find(key);
+	if (it != entry->conditionMap.end()) {
+		condition = it->second;
+		found = true;
+	}
+	return found;
+}
+
+void UserPrivilegeCache::setCondition(
+  const UserIdType &userId, const Generation &generation,
+  const string &key, const string &condition)
+{
+	m_impl->rwlock.writeLock();
+	Reaper<ReadWriteLock> unlocker(&m_impl->rwlock, ReadWriteLock::unlock);
+	if (m_impl->generation != generation)
+		return;
+	UserPrivilegeCacheEntry &entry = m_impl->entryMap[userId];
+	pair<map<string, string>::iterator, bool> result =
+	  entry.conditionMap.insert(make_pair(key, condition));
+	if (!result.second) {
+		result.first->second = condition;
+		return;
+	}
+	entry.conditionKeys.push_back(key);
+
+	// The keys contain the target IDs of requests. So the oldest one is
+	// dropped to keep the memory usage bounded.
+	if (entry.conditionKeys.size() > MAX_CONDITIONS_PER_USER) {
+		entry.conditionMap.erase(entry.conditionKeys.front());
+		entry.conditionKeys.pop_front();
+	}
+}
+
+void UserPrivilegeCache::invalidate(const UserIdType &userId)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generation++;
+	m_impl->entryMap.erase(userId);
+	m_impl->rwlock.unlock();
+}
+
+void UserPrivilegeCache::invalidateAll(void)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generation++;
+	m_impl->entryMap.clear();
+	m_impl->rwlock.unlock();
+}
+
+void UserPrivilegeCache::invalidateHostIdBitmaps(void)
+{
+	m_impl->rwlock.writeLock();
+	m_impl->generation++;
+	UserPrivilegeCacheEntryMapIterator it = m_impl->entryMap.begin();
+	for (; it != m_impl->entryMap.end(); ++it) {
+		UserPrivilegeCacheEntry &entry = it->second;
+		entry.hasHostIdBitmapMap = false;
+		entry.hostIdBitmapMap.clear();
+		entry.conditionMap.clear();
+		entry.conditionKeys.clear();
+	}
+	m_impl->rwlock.unlock();
+}
+
+UserPrivilegeCache::Generation UserPrivilegeCache::getGeneration(void) const
+{
+	m_impl->rwlock.readLock();
+	const Generation generation = m_impl->generation;
+	m_impl->rwlock.unlock();
+	return generation;
+}
+
+size_t UserPrivilegeCache::getNumberOfUsers(void) const
+{
+	m_impl->rwlock.readLock();
+	const size_t numUsers = m_impl->entryMap.size();
+	m_impl->rwlock.unlock();
+	return numUsers;
+}
+
+// ---------------------------------------------------------------------------
+// Protected methods
+// ---------------------------------------------------------------------------
+UserPrivilegeCache::UserPrivilegeCache(void)
+: m_impl(new Impl())
+{
+}
+
+UserPrivilegeCache::~UserPrivilegeCache()
+{
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UserPrivilegeCache_h
+#define UserPrivilegeCache_h
+
+#include <string>
+#include <memory>
+#include "Params.h"
+#include "OperationPrivilege.h"
+#include "HostIdBitmap.h"
+
+class DataQueryContext;
+
+/**
+ * A process-wide cache of the privilege information for each user.
+ *
+ * The cached data is derived from the access_list, users and servers
+ * tables. The methods of DBTablesUser and DBTablesConfig that change
+ * them call invalidate() or invalidateAll(). The bitmaps of the
+ * accessible hosts additionally depend on the hostgroup_member table,
+ * so DBTablesHost calls invalidateHostIdBitmaps() when it is changed.
+ * Each invalidation advances a generation counter, so data computed from
+ * the stale information is never stored after the invalidation.
+ */
+class UserPrivilegeCache {
+public:
+	typedef uint64_t Generation;
+
+	/**
+	 * The maximum number of the condition fragments of a user.
+	 * The oldest one is dropped when a new one exceeds it.
+	 */
+	static const size_t MAX_CONDITIONS_PER_USER;
+
+	static void reset(void);
+	static UserPrivilegeCache *getInstance(void);
+
+	/**
+	 * Get the server IDs and the host group IDs accessible by the user.
+	 * They are loaded from the DB when they aren't cached.
+	 *
+	 * @param srvHostGrpSetMap The obtained data is stored in this.
+	 * @param userId A user ID.
+	 *
+	 * @return The generation of the obtained data.
+	 */
+	Generation getServerHostGrpSetMap(
+	  ServerHostGrpSetMap &srvHostGrpSetMap, const UserIdType &userId);
+
+	/**
+	 * Get the IDs of the servers that can be seen with the privilege
+	 * of the specified context. They are loaded from the DB when they
+	 * aren't cached for the pair of the user ID and the flags.
+	 *
+	 * @param serverIdSet The obtained data is stored in this.
+	 * @param dataQueryContext A DataQueryContext instance.
+	 */
+	void getValidServerIdSet(ServerIdSet &serverIdSet,
+	                         DataQueryContext *dataQueryContext);
+
+	/**
+	 * Get the global host IDs of the members of the host groups that
+	 * are accessible by the user. They are loaded from the DB when they
+	 * aren't cached. Servers for which the user can see all host groups
+	 * don't have an element.
+	 *
+	 * @param hostIdBitmapMap The obtained data is stored in this.
+	 * @param userId A user ID.
+	 */
+	void getHostIdBitmapMap(ServerHostIdBitmapMap &hostIdBitmapMap,
+	                        const UserIdType &userId);
+
+	/**
+	 * Get the number of the ranges of the consecutive host IDs in the
+	 * bitmaps returned by getHostIdBitmapMap().
+	 *
+	 * @param userId A user ID.
+	 *
+	 * @return The total number of the ranges of all the servers.
+	 */
+	size_t getNumberOfHostIdRanges(const UserIdType &userId);
+
+	/**
+	 * Get a pre-rendered SQL condition fragment.
+	 *
+	 * @param condition The obtained condition is stored in this.
+	 * @param userId A user ID.
+	 * @param key A key that identifies the fragment.
+	 *
+	 * @return true if the fragment is found. Otherwise false.
+	 */
+	bool getCondition(std::string &condition, const UserIdType &userId,
+	                  const std::string &key);
+
+	/**
+	 * Store a pre-rendered SQL condition fragment. The fragment is
+	 * discarded if an invalidation happened after the generation.
+	 * Up to MAX_CONDITIONS_PER_USER fragments are kept for a user.
+	 *
+	 * @param userId A user ID.
+	 * @param generation
+	 * A generation returned from getServerHostGrpSetMap() whose result
+	 * the condition is made from.
+	 * @param key A key that identifies the fragment.
+	 * @param condition A condition to be stored.
+	 */
+	void setCondition(const UserIdType &userId,
+	                  const Generation &generation,
+	                  const std::string &key,
+	                  const std::string &condition);
+
+	void invalidate(const UserIdType &userId);
+	void invalidateAll(void);
+
+	/**
+	 * Drop the host ID bitmaps and the condition fragments that may be
+	 * made from them. The other data is kept.
+	 */
+	void invalidateHostIdBitmaps(void);
+
+	Generation getGeneration(void) const;
+	size_t getNumberOfUsers(void) const;
+
+protected:
+	UserPrivilegeCache(void);
+	virtual ~UserPrivilegeCache();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_impl;
+};
+
+#endif // UserPrivilegeCache_h
@@ -24,6 +24,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 #include <glib.h>
 #include <glib-object.h>
 #include <inttypes.h>
@@ -94,8 +95,7 @@ static gboolean writePipeCb
 static void eventCb(GIOStatus stat, SmartBuffer &sbuf, size_t size,
                     Impl *impl);
 
-static void gotNotifyEventBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
-                                 size_t size, Impl *impl)
+static uint32_t notifyEvent(SmartBuffer &sbuf, Impl *impl)
 {
 	ResidentNotifyEventArg arg;
 	arg.actionId        = *sbuf.getPointerAndIncIndex<uint32_t>();
@@ -116,7 +116,13 @@ static void gotNotifyEventBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	sbuf.incIndex(HATOHOL_SESSION_ID_LEN);
 
 	// call a user action
-	uint32_t resultCode = (*impl->module->notifyEvent)(&arg);
+	return (*impl->module->notifyEvent)(&arg);
+}
+
+static void gotNotifyEventBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
+                                 size_t size, Impl *impl)
+{
+	uint32_t resultCode = notifyEvent(sbuf, impl);
 	ResidentCommunicator comm;
 	comm.setNotifyEventAck(resultCode);
 	comm.push(impl->pipeWr);
@@ -125,6 +131,43 @@ static void gotNotifyEventBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
 	impl->pullHeader(eventCb);
 }
 
+static void gotNotifyEventBatchBodyCb(GIOStatus stat, mlpl::SmartBuffer &sbuf,
+                                      size_t size, Impl *impl)
+{
+	if (stat != G_IO_STATUS_NORMAL) {
+		MLPL_ERR("Error: status: %x\n", stat);
+		requestQuit(impl);
+		return;
+	}
+
+	const uint32_t firstSequence = *sbuf.getPointerAndIncIndex<uint32_t>();
+	const uint16_t numEvents = *sbuf.getPointerAndIncIndex<uint16_t>();
+	vector<uint32_t> resultCodes;
+	resultCodes.reserve(numEvents);
+	for (uint16_t i = 0; i < numEvents; i++) {
+		const uint32_t eventSize =
+		  *sbuf.getPointerAndIncIndex<uint32_t>();
+		const size_t nextIndex = sbuf.index() + eventSize;
+		if (nextIndex > size) {
+			MLPL_ERR("Too large event size: %" PRIu32 ", "
+			         "index: %zd, body size: %zd\n",
+			         eventSize, sbuf.index(), size);
+			requestQuit(impl);
+			return;
+		}
+		resultCodes.push_back(notifyEvent(sbuf, impl));
+		sbuf.setIndex(nextIndex);
+	}
+
+	// The results are returned in one packet in the order of the events.
+	ResidentCommunicator comm;
+	comm.setNotifyEventBatchAck(firstSequence, resultCodes);
+	comm.push(impl->pipeWr);
+
+	// request to get the envet
+	impl->pullHeader(eventCb);
+}
+
 static void eventCb(GIOStatus stat, SmartBuffer &sbuf, size_t size,
                     Impl *impl)
 {
@@ -139,6 +182,9 @@ static void eventCb(GIOStatus stat, SmartBuffer &sbuf, size_t size,
 		// request to get the body
 		impl->pullData(ResidentCommunicator::getBodySize(sbuf),
 		               gotNotifyEventBodyCb);
+	} else if (pktType == RESIDENT_PROTO_PKT_TYPE_NOTIFY_EVENT_BATCH) {
+		impl->pullData(ResidentCommunicator::getBodySize(sbuf),
+		               gotNotifyEventBatchBodyCb);
 	} else {
 		MLPL_ERR("Unexpected packet: %d\n", pktType);
 		requestQuit(impl);
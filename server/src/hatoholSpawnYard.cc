@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <exception>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <Logger.h>
+#include <SmartBuffer.h>
+#include "SpawnYardProtocol.h"
+using namespace std;
+using namespace mlpl;
+
+// This program intentionally doesn't link libhatohol, so that it is kept
+// small and fork() in it is cheap.
+
+struct SpawnRequest {
+	string         workingDirectory;
+	vector<string> args;
+	vector<string> envs;
+};
+
+struct Impl {
+	int      fd;
+	int      sigFd;
+	sigset_t origSigMask;
+
+	Impl(void)
+	: fd(-1),
+	  sigFd(-1)
+	{
+	}
+};
+
+static bool sendPacket(Impl &impl, const uint16_t &type, SmartBuffer &body)
+{
+	SmartBuffer pkt(SPAWN_YARD_PROTO_HEADER_LEN + body.index());
+	pkt.add32(body.index());
+	pkt.add16(type);
+	pkt.add(static_cast<const char *>(body), body.index());
+	return spawnYardWrite(impl.fd, static_cast<const char *>(pkt),
+	                      pkt.index());
+}
+
+static bool sendSpawned(Impl &impl, const pid_t &pid, const uint16_t &stage,
+                        const int &err)
+{
+	SmartBuffer body(SPAWN_YARD_PROTO_SPAWNED_BODY_LEN);
+	body.add32(pid);
+	body.add16(stage);
+	body.add32(err);
+	return sendPacket(impl, SPAWN_YARD_PROTO_PKT_TYPE_SPAWNED, body);
+}
+
+static bool sendExited(Impl &impl, const siginfo_t &siginfo)
+{
+	SmartBuffer body(SPAWN_YARD_PROTO_EXITED_BODY_LEN);
+	body.add32(siginfo.si_pid);
+	body.add32(siginfo.si_code);
+	body.add32(siginfo.si_status);
+	return sendPacket(impl, SPAWN_YARD_PROTO_PKT_TYPE_EXITED, body);
+}
+
+static bool collectChildren(Impl &impl)
+{
+	// Drain the signal. Pending SIGCHLDs are merged into one, so we
+	// collect all exited children below regardless of the number of
+	// the read signals.
+	signalfd_siginfo fdsi;
+	while (read(impl.sigFd, &fdsi, sizeof(fdsi)) == -1 && errno == EINTR)
+		;
+
+	while (true) {
+		siginfo_t siginfo;
+		siginfo.si_pid = 0;
+		int ret = waitid(P_ALL, 0, &siginfo, WEXITED|WNOHANG);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret == -1 && errno == ECHILD)
+			return true;
+		if (ret == -1) {
+			MLPL_ERR("Failed to call waitid: %d\n", errno);
+			return true;
+		}
+		if (siginfo.si_pid == 0)
+			return true;
+		if (!sendExited(impl, siginfo))
+			return false;
+	}
+}
+
+static bool parseRequest(SmartBuffer &body, SpawnRequest &req)
+{
+	size_t remaining = body.size();
+	struct {
+		bool operator()(SmartBuffer &buf, size_t &remaining,
+		                string &str)
+		{
+			if (remaining < SPAWN_YARD_PROTO_SPAWN_STRING_LEN)
+				return false;
+			const size_t len = buf.getValue<uint16_t>();
+			remaining -= SPAWN_YARD_PROTO_SPAWN_STRING_LEN;
+			if (remaining < len)
+				return false;
+			str = buf.getStringAndIncIndex<uint16_t>();
+			remaining -= len;
+			return true;
+		}
+	} getString;
+
+	const size_t baseLen = SPAWN_YARD_PROTO_SPAWN_NUM_ARGS_LEN +
+	                       SPAWN_YARD_PROTO_SPAWN_NUM_ENVS_LEN;
+	if (remaining < baseLen)
+		return false;
+	const size_t numArgs = body.getValueAndIncIndex<uint16_t>();
+	const size_t numEnvs = body.getValueAndIncIndex<uint16_t>();
+	remaining -= baseLen;
+	if (numArgs == 0)
+		return false;
+
+	if (!getString(body, remaining, req.workingDirectory))
+		return false;
+	req.args.resize(numArgs);
+	for (size_t i = 0; i < numArgs; i++) {
+		if (!getString(body, remaining, req.args[i]))
+			return false;
+	}
+	req.envs.resize(numEnvs);
+	for (size_t i = 0; i < numEnvs; i++) {
+		if (!getString(body, remaining, req.envs[i]))
+			return false;
+	}
+	return true;
+}
+
+static void reportFailureAndExit(const int &errFd, const int32_t &stage)
+{
+	const int32_t failure[2] = {stage, errno};
+	ssize_t ret;
+	do {
+		ret = write(errFd, failure, sizeof(failure));
+	} while (ret == -1 && errno == EINTR);
+	_exit(127);
+}
+
+static pid_t spawn(Impl &impl, const SpawnRequest &req,
+                   uint16_t &stage, int &err)
+{
+	// Build the arrays before fork() so that the child doesn't allocate
+	// memory.
+	vector<char *> argv;
+	for (size_t i = 0; i < req.args.size(); i++)
+		argv.push_back(const_cast<char *>(req.args[i].c_str()));
+	argv.push_back(NULL);
+
+	vector<char *> envp;
+	for (size_t i = 0; i < req.envs.size(); i++)
+		envp.push_back(const_cast<char *>(req.envs[i].c_str()));
+	envp.push_back(NULL);
+
+	// The child reports a failure through this pipe. It is closed
+	// without any data on a successful exec.
+	int errPipe[2];
+	if (pipe2(errPipe, O_CLOEXEC) == -1) {
+		stage = SPAWN_YARD_PROTO_STAGE_FORK;
+		err = errno;
+		return -1;
+	}
+
+	const pid_t pid = fork();
+	if (pid == -1) {
+		stage = SPAWN_YARD_PROTO_STAGE_FORK;
+		err = errno;
+		close(errPipe[0]);
+		close(errPipe[1]);
+		return -1;
+	}
+
+	if (pid == 0) {
+		sigprocmask(SIG_SETMASK, &impl.origSigMask, NULL);
+		if (!req.workingDirectory.empty() &&
+		    chdir(req.workingDirectory.c_str()) == -1) {
+			reportFailureAndExit(errPipe[1],
+			                     SPAWN_YARD_PROTO_STAGE_CHDIR);
+		}
+		if (req.envs.empty())
+			execv(argv[0], &argv[0]);
+		else
+			execve(argv[0], &argv[0], &envp[0]);
+		reportFailureAndExit(errPipe[1], SPAWN_YARD_PROTO_STAGE_EXEC);
+	}
+
+	close(errPipe[1]);
+	int32_t failure[2];
+	ssize_t ret;
+	do {
+		ret = read(errPipe[0], failure, sizeof(failure));
+	} while (ret == -1 && errno == EINTR);
+	close(errPipe[0]);
+	if (ret != sizeof(failure)) {
+		stage = SPAWN_YARD_PROTO_STAGE_NONE;
+		err = 0;
+		return pid;
+	}
+
+	// The child has already exited with 127. It is reaped here so that
+	// the master isn't notified of the unknown process.
+	while (waitpid(pid, NULL, 0) == -1 && errno == EINTR)
+		;
+	stage = failure[0];
+	err = failure[1];
+	return -1;
+}
+
+static bool handleRequest(Impl &impl)
+{
+	SmartBuffer header(SPAWN_YARD_PROTO_HEADER_LEN);
+	if (!spawnYardRead(impl.fd, static_cast<char *>(header),
+	                   SPAWN_YARD_PROTO_HEADER_LEN))
+		return false; // The master has gone.
+	const size_t bodySize = header.getValueAndIncIndex<uint32_t>();
+	const int pktType = header.getValueAndIncIndex<uint16_t>();
+	if (pktType != SPAWN_YARD_PROTO_PKT_TYPE_SPAWN) {
+		MLPL_ERR("Unexpected packet: %d\n", pktType);
+		return false;
+	}
+	if (bodySize > SPAWN_YARD_PROTO_MAX_BODY_SIZE) {
+		MLPL_ERR("Too large packet: %zd\n", bodySize);
+		return false;
+	}
+
+	SmartBuffer body(bodySize);
+	if (!spawnYardRead(impl.fd, static_cast<char *>(body), bodySize))
+		return false;
+
+	SpawnRequest req;
+	if (!parseRequest(body, req)) {
+		MLPL_ERR("Broken spawn request.\n");
+		return sendSpawned(impl, -1, SPAWN_YARD_PROTO_STAGE_FORK,
+		                   EINVAL);
+	}
+
+	uint16_t stage;
+	int err;
+	const pid_t pid = spawn(impl, req, stage, err);
+	return sendSpawned(impl, pid, stage, err);
+}
+
+static int mainRoutine(int argc, char *argv[])
+{
+	Impl impl;
+
+	if (argc < 2) {
+		MLPL_ERR("The socket is not given. (%d)\n", argc);
+		return EXIT_FAILURE;
+	}
+	impl.fd = atoi(argv[1]);
+	if (fcntl(impl.fd, F_SETFD, FD_CLOEXEC) == -1) {
+		MLPL_ERR("Invalid socket: %s, %d\n", argv[1], errno);
+		return EXIT_FAILURE;
+	}
+
+	// SIGCHLD is received with signalfd so that it is handled in
+	// the same loop as the requests.
+	sigset_t sigChld;
+	sigemptyset(&sigChld);
+	sigaddset(&sigChld, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &sigChld, &impl.origSigMask) == -1) {
+		MLPL_ERR("Failed to block SIGCHLD: %d\n", errno);
+		return EXIT_FAILURE;
+	}
+	impl.sigFd = signalfd(-1, &sigChld, SFD_CLOEXEC);
+	if (impl.sigFd == -1) {
+		MLPL_ERR("Failed to call signalfd: %d\n", errno);
+		return EXIT_FAILURE;
+	}
+
+	pollfd fds[2];
+	fds[0].fd = impl.fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = impl.sigFd;
+	fds[1].events = POLLIN;
+	while (true) {
+		if (poll(fds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			MLPL_ERR("Failed to call poll: %d\n", errno);
+			return EXIT_FAILURE;
+		}
+		if (fds[1].revents & POLLIN) {
+			if (!collectChildren(impl))
+				break;
+		}
+		if (fds[0].revents & (POLLIN|POLLHUP|POLLERR)) {
+			if (!handleRequest(impl))
+				break;
+		}
+	}
+
+	// The running children are left as they are. They are adopted by
+	// init after this process exits.
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret = EXIT_FAILURE;
+	try {
+		ret = mainRoutine(argc, argv);
+	} catch (const exception &e) {
+		MLPL_ERR("Got exception: %s", e.what());
+	}
+	return ret;
+}
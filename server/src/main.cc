@@ -43,6 +43,7 @@ using namespace mlpl;
 #include "DBTablesConfig.h"
 #include "ActorCollector.h"
 #include "DBTablesAction.h"
+#include "DBTablesMonitoring.h"
 #include "ConfigManager.h"
 #include "ThreadLocalDBCache.h"
 #include "ChildProcessManager.h"
@@ -79,6 +80,7 @@ static void exitFuncOnWaitThread(ExecContext *ctx)
 
 	ctx->unifiedDataStore->stop();
 	DBTablesAction::stop();
+	DBTablesMonitoring::stop();
 
 	// TODO: implement
 	// ChildProcessManager::getInstance()->quit();
@@ -234,6 +236,16 @@ int mainRoutine(int argc, char *argv[])
 	}
 	hatoholInitChildProcessManager();
 
+	// Launching a spawn yard forks this process. So it's done before
+	// the arms and FaceRest start while this process is still small.
+	const int numSpawnYards = confMgr->getNumberOfSpawnYards();
+	if (numSpawnYards > 0) {
+		const string spawnYardPath =
+		  confMgr->getResidentYardDirectory() + "/hatohol-spawn-yard";
+		ChildProcessManager::getInstance()->startSpawnYards(
+		  numSpawnYards, spawnYardPath);
+	}
+
 	// setup signal handlers for exit
 	setupGizmoForExit(&ctx);
 	setupSignalHandlerForExit(SIGTERM);
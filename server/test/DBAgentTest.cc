@@ -156,6 +156,36 @@ const DBAgent::TableProfile tableProfileTestAutoInc(
   NUM_IDX_TEST_TABLE_AUTO_INC
 );
 
+// table for time partition test
+const char *TABLE_NAME_TEST_TIME_PARTITION = "test_table_time_partition";
+static const ColumnDef COLUMN_DEF_TEST_TIME_PARTITION[] = {
+{
+	"id",                              // columnName
+	SQL_COLUMN_TYPE_INT,               // type
+	11,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_PRI,                       // keyType
+	SQL_COLUMN_FLAG_AUTO_INC,          // flags
+	NULL,                              // defaultValue
+},{
+	"time_sec",                        // columnName
+	SQL_COLUMN_TYPE_INT,               // type
+	11,                                // columnLength
+	0,                                 // decFracLength
+	false,                             // canBeNull
+	SQL_KEY_NONE,                      // keyType
+	0,                                 // flags
+	NULL,                              // defaultValue
+}
+};
+
+const DBAgent::TableProfile tableProfileTestTimePartition(
+  TABLE_NAME_TEST_TIME_PARTITION, COLUMN_DEF_TEST_TIME_PARTITION,
+  NUM_IDX_TEST_TABLE_TIME_PARTITION, NULL,
+  IDX_TEST_TABLE_TIME_PARTITION_TIME_SEC
+);
+
 static ItemDataNullFlagType calcNullFlag(set<size_t> *nullIndexes, size_t idx)
 {
 	if (!nullIndexes)
@@ -1048,6 +1078,34 @@ void dbAgentUpsertBySameData(DBAgent &dbAgent, DBAgentChecker &checker)
 	assertDBContent(&dbAgent, statement, expectedLine);
 }
 
+void dbAgentTestPurgeOldRows(DBAgent &dbAgent)
+{
+	const DBAgent::TableProfile &tableProfile =
+	  tableProfileTestTimePartition;
+	const time_t DAY = DBAgent::TIME_PARTITION_SEC;
+	const time_t today = time(NULL) / DAY * DAY;
+	dbAgent.createTable(tableProfile);
+	dbAgent.addTimePartitions(tableProfile, today + DAY * 10);
+
+	// Each row is in the middle of a partition.
+	const time_t times[] = {
+	  today + DAY / 2, today + DAY * 3 + DAY / 2, today + DAY * 9 + DAY / 2};
+	for (size_t i = 0; i < ARRAY_SIZE(times); i++) {
+		DBAgent::InsertArg arg(tableProfile);
+		arg.row->addNewItem(AUTO_INCREMENT_VALUE, ITEM_DATA_NULL);
+		arg.row->addNewItem(static_cast<int>(times[i]));
+		dbAgent.insert(arg);
+	}
+	dbAgent.purgeOldRows(tableProfile, today + DAY * 2);
+
+	const string statement = StringUtils::sprintf(
+	  "select time_sec from %s order by time_sec asc",
+	  TABLE_NAME_TEST_TIME_PARTITION);
+	const string expected = StringUtils::sprintf(
+	  "%ld\n%ld", times[1], times[2]);
+	assertDBContent(&dbAgent, statement, expected);
+}
+
 // --------------------------------------------------------------------------
 // DBAgentChecker
 // --------------------------------------------------------------------------
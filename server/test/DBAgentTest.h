@@ -41,6 +41,15 @@ enum {
 extern const DBAgent::TableProfile tableProfileTest;
 extern const DBAgent::TableProfile tableProfileTestAutoInc;
 
+enum {
+	IDX_TEST_TABLE_TIME_PARTITION_ID,
+	IDX_TEST_TABLE_TIME_PARTITION_TIME_SEC,
+	NUM_IDX_TEST_TABLE_TIME_PARTITION,
+};
+
+extern const char *TABLE_NAME_TEST_TIME_PARTITION;
+extern const DBAgent::TableProfile tableProfileTestTimePartition;
+
 extern const size_t NUM_TEST_DATA;
 extern const uint64_t ID[];
 extern const int AGE[];
@@ -131,5 +140,6 @@ void dbAgentUpdateIfExistEleseInsert(DBAgent &dbAgent, DBAgentChecker &checker);
 void dbAgentGetLastInsertId(DBAgent &dbAgent, DBAgentChecker &checker);
 void dbAgentGetNumberOfAffectedRows(DBAgent &dbAgent, DBAgentChecker &checker);
 void dbAgentUpsertBySameData(DBAgent &dbAgent, DBAgentChecker &checker);
+void dbAgentTestPurgeOldRows(DBAgent &dbAgent);
 
 #endif // DBAgentTestCommon_h
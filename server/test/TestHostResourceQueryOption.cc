@@ -61,3 +61,21 @@ string TestHostResourceQueryOption::callMakeCondition(
 	                     targetHostgroupId,
 	                     targetHostId);
 }
+
+string TestHostResourceQueryOption::callMakeConditionWithHostIdBitmap(
+  const ServerHostGrpSetMap &srvHostGrpSetMap,
+  const ServerHostIdBitmapMap &hostIdBitmapMap,
+  const string &serverIdColumnName,
+  const string &globalHostIdColumnName,
+  const string &hostIdColumnName,
+  const ServerIdType &targetServerId,
+  const LocalHostIdType &targetHostId) const
+{
+	return makeConditionWithHostIdBitmap(srvHostGrpSetMap,
+	                                     hostIdBitmapMap,
+	                                     serverIdColumnName,
+	                                     globalHostIdColumnName,
+	                                     hostIdColumnName,
+	                                     targetServerId,
+	                                     targetHostId);
+}
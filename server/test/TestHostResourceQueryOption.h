@@ -41,6 +41,15 @@ public:
 	  const ServerIdType &targetServerId = ALL_SERVERS,
 	  const HostgroupIdType &targetHostgroupId = ALL_HOST_GROUPS,
 	  const LocalHostIdType &targetHostId = ALL_LOCAL_HOSTS) const;
+
+	std::string callMakeConditionWithHostIdBitmap(
+	  const ServerHostGrpSetMap &srvHostGrpSetMap,
+	  const ServerHostIdBitmapMap &hostIdBitmapMap,
+	  const std::string &serverIdColumnName,
+	  const std::string &globalHostIdColumnName,
+	  const std::string &hostIdColumnName,
+	  const ServerIdType &targetServerId = ALL_SERVERS,
+	  const LocalHostIdType &targetHostId = ALL_LOCAL_HOSTS) const;
 };
 
 #endif // TestHostResourceQueryOption_h
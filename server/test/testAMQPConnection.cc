@@ -53,6 +53,33 @@ namespace testAMQPConnection {
 		AMQPMessage m_message;
 	};
 
+	class TestBatchMessageHandler : public AMQPMessageHandler {
+	public:
+		TestBatchMessageHandler()
+		: m_numMessages(0)
+		{
+		}
+
+		virtual bool handle(AMQPConnection &connection,
+				    const AMQPMessage &message) override
+		{
+			m_batchSizes.push_back(1);
+			m_numMessages.add(1);
+			return true;
+		}
+
+		virtual bool handleBatch(AMQPConnection &connection,
+					 const AMQPMessageVect &messages) override
+		{
+			m_batchSizes.push_back(messages.size());
+			m_numMessages.add(messages.size());
+			return true;
+		}
+
+		AtomicValue<size_t> m_numMessages;
+		vector<size_t> m_batchSizes;
+	};
+
 	AMQPConnectionInfo &getConnectionInfo(void)
 	{
 		if (!connectionInfo)
@@ -141,4 +168,44 @@ namespace testAMQPConnection {
 		cppcut_assert_equal(message.body,
 				    handler.m_message.body);
 	}
+
+	void test_consumeBatch(void)
+	{
+		const size_t numMessages = 5;
+		AMQPPublisher publisher(getConnectionInfo());
+		for (size_t i = 0; i < numMessages; i++) {
+			AMQPJSONMessage message;
+			message.body = StringUtils::sprintf(
+			  "{\"body\":\"example%zd\"}", i);
+			publisher.setMessage(message);
+			cppcut_assert_equal(true, publisher.publish());
+		}
+
+		connectionInfo->setPrefetchCount(numMessages);
+		connectionInfo->setBatchSize(numMessages);
+		connectionInfo->setBatchTimeoutMSec(1000);
+		TestBatchMessageHandler handler;
+		AMQPConsumer consumer(*connectionInfo, &handler);
+		consumer.start();
+		gdouble timeout = 2.0, elapsed = 0.0;
+		GTimer *timer = startTimer();
+		while (handler.m_numMessages < numMessages &&
+		       elapsed < timeout) {
+			g_usleep(0.1 * G_USEC_PER_SEC);
+			elapsed = g_timer_elapsed(timer, NULL);
+		}
+		consumer.exitSync();
+
+		cut_assert_true(elapsed < timeout);
+		cppcut_assert_equal(static_cast<size_t>(1),
+				    handler.m_batchSizes.size());
+		cppcut_assert_equal(numMessages, handler.m_batchSizes[0]);
+
+		// All messages have been acknowledged.
+		AMQPMessage message;
+		connection = getConnection();
+		cppcut_assert_equal(true, connection->connect());
+		cppcut_assert_equal(true, connection->startConsuming());
+		cppcut_assert_equal(false, connection->consume(message));
+	}
 } // namespace testAMQPConnection
@@ -78,5 +78,23 @@ namespace defaultValue {
 		time_t defaultTimeout = 1;
 		cppcut_assert_equal(defaultTimeout, info->getTimeout());
 	}
+
+	void test_prefetchCount(void)
+	{
+		cppcut_assert_equal(static_cast<uint16_t>(0),
+				    info->getPrefetchCount());
+	}
+
+	void test_batchSize(void)
+	{
+		cppcut_assert_equal(static_cast<size_t>(1),
+				    info->getBatchSize());
+	}
+
+	void test_batchTimeoutMSec(void)
+	{
+		cppcut_assert_equal(static_cast<size_t>(0),
+				    info->getBatchTimeoutMSec());
+	}
 }
 } // namespace testAMQPConnectionInfo
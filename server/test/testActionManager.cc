@@ -758,6 +758,113 @@ static void _assertWaitEventBody(ExecCommandContext *ctx)
 }
 #define assertWaitEventBody(CTX) cut_trace(_assertWaitEventBody(CTX))
 
+static void _assertActionLogStatus(
+  ActionLog &actionLog, const ActionLogIdType &logId,
+  const ActionLogStatus &expectedStatus)
+{
+	ThreadLocalDBCache cache;
+	cppcut_assert_equal(true, cache.getAction().getLog(actionLog, logId));
+	cppcut_assert_equal((int)expectedStatus, actionLog.status,
+	  cut_message("logId: %" FMT_ACTION_LOG_ID, logId));
+}
+#define assertActionLogStatus(LOG, ID, STAT) \
+cut_trace(_assertActionLogStatus(LOG, ID, STAT))
+
+static void _assertWaitForActionLogStatus(
+  ExecCommandContext *ctx, const ActionLogIdType &logId,
+  const ActionLogStatus &expectedStatus)
+{
+	ThreadLocalDBCache cache;
+	DBTablesAction &dbAction = cache.getAction();
+	ActionLog actionLog;
+	while (true) {
+		cppcut_assert_equal(true, dbAction.getLog(actionLog, logId));
+		if (actionLog.status == expectedStatus)
+			break;
+		g_main_context_iteration(NULL, FALSE);
+		cppcut_assert_equal(false, ctx->timedOut);
+	}
+}
+#define assertWaitForActionLogStatus(CTX, ID, STAT) \
+cut_trace(_assertWaitForActionLogStatus(CTX, ID, STAT))
+
+static void _assertExecBlockedResidentActions(
+  ExecCommandContext *ctx, const size_t &numEvents,
+  vector<ActorInfo> &actorVect)
+{
+	// The module blocks the reply of the first event until
+	// sendAllowReplyNotifyEvent() is called.
+	static const char *pipeName = "test-resident-action";
+	if (ctx->pipeName.empty())
+		ctx->initPipes(pipeName);
+	for (size_t i = 0; i < numEvents; i++) {
+		ExecActionArg arg(0x4ab3fd32, ACTION_RESIDENT);
+		arg.option = StringUtils::sprintf(
+		  "--pipename %s --block-reply-notify-event", pipeName);
+		assertExecAction(ctx, arg);
+		actorVect.push_back(ctx->actorInfo);
+	}
+}
+#define assertExecBlockedResidentActions(CTX, NUM, VECT) \
+cut_trace(_assertExecBlockedResidentActions(CTX, NUM, VECT))
+
+static gboolean ignorePipeErrCb(GIOChannel *source, GIOCondition condition,
+                                gpointer data)
+{
+	// The reader is closed when ActionManager closes the resident.
+	return FALSE;
+}
+
+static void pushNotifyEventBatchAck(NamedPipe &pipe, const uint32_t &sequence)
+{
+	ResidentCommunicator comm;
+	vector<uint32_t> resultCodes(1, RESIDENT_MOD_NOTIFY_EVENT_ACK_OK);
+	comm.setNotifyEventBatchAck(sequence, resultCodes);
+	comm.push(pipe);
+}
+
+static void _assertCloseResidentByUnexpectedAck(const bool &duplicate)
+{
+	g_execCommandCtx = new ExecCommandContext();
+	ExecCommandContext *ctx = g_execCommandCtx; // just an alias
+	ctx->expectHup = true;
+
+	vector<ActorInfo> actorVect;
+	assertExecBlockedResidentActions(ctx, 1, actorVect);
+	assertWaitForActionLogStatus(ctx, actorVect[0].logId,
+	                             ACTLOG_STAT_STARTED);
+
+	// Inject acks to the pipe from hatohol-resident-yard while the
+	// module blocks the actual reply. The sequence of the first event
+	// is 0.
+	NamedPipe pipe(NamedPipe::END_TYPE_SLAVE_WRITE);
+	const string residentPipeName =
+	  StringUtils::sprintf("resident-%d", ctx->actDef.id);
+	cppcut_assert_equal(
+	  true, pipe.init(residentPipeName, ignorePipeErrCb, NULL));
+	uint32_t sequence = 1;
+	if (duplicate) {
+		pushNotifyEventBatchAck(pipe, 0);
+		assertWaitForActionLogStatus(ctx, actorVect[0].logId,
+		                             ACTLOG_STAT_SUCCEEDED);
+		assertExecBlockedResidentActions(ctx, 1, actorVect);
+		assertWaitForActionLogStatus(ctx, actorVect[1].logId,
+		                             ACTLOG_STAT_STARTED);
+		sequence = 0;
+	}
+	pushNotifyEventBatchAck(pipe, sequence);
+
+	assertWaitForActionLogStatus(ctx, actorVect.back().logId,
+	                             ACTLOG_STAT_FAILED);
+	ActionLog actionLog;
+	assertActionLogStatus(actionLog, actorVect.back().logId,
+	                      ACTLOG_STAT_FAILED);
+	cppcut_assert_equal((int)ACTLOG_EXECFAIL_PIPE_READ_DATA_UNEXPECTED,
+	                    actionLog.failureCode);
+}
+#define assertCloseResidentByUnexpectedAck(DUP) \
+cut_trace(_assertCloseResidentByUnexpectedAck(DUP))
+
 static void _assertWaitRemoveWatching(ExecCommandContext *ctx)
 {
 	while (ActorCollector::isWatching(ctx->actionTpPid)) {
@@ -1199,6 +1306,78 @@ void test_execResidentActionCheckArg(void)
 	assertActionLogAfterExecResident(logarg);
 }
 
+void test_notifyEventsInBatch(void)
+{
+	g_execCommandCtx = new ExecCommandContext();
+	ExecCommandContext *ctx = g_execCommandCtx; // just an alias
+
+	// The events queued while the resident is being launched are sent
+	// in one batch.
+	const size_t numEvents = RESIDENT_PROTO_MAX_EVENTS_IN_BATCH;
+	vector<ActorInfo> actorVect;
+	assertExecBlockedResidentActions(ctx, numEvents, actorVect);
+	assertWaitForActionLogStatus(ctx, actorVect.back().logId,
+	                             ACTLOG_STAT_STARTED);
+	ActionLog actionLog;
+	for (size_t i = 0; i < numEvents; i++) {
+		assertActionLogStatus(actionLog, actorVect[i].logId,
+		                      ACTLOG_STAT_STARTED);
+	}
+
+	// All results come in one ack. So the logs are updated at once.
+	sendAllowReplyNotifyEvent(ctx);
+	assertWaitForActionLogStatus(ctx, actorVect[0].logId,
+	                             ACTLOG_STAT_SUCCEEDED);
+	for (size_t i = 0; i < numEvents; i++) {
+		assertActionLogStatus(actionLog, actorVect[i].logId,
+		                      ACTLOG_STAT_SUCCEEDED);
+	}
+}
+
+void test_limitNotifiedEventsByWindow(void)
+{
+	g_execCommandCtx = new ExecCommandContext();
+	ExecCommandContext *ctx = g_execCommandCtx; // just an alias
+
+	const size_t windowSize = RESIDENT_PROTO_NOTIFY_WINDOW_SIZE;
+	const size_t numEvents =
+	  windowSize + RESIDENT_PROTO_MAX_EVENTS_IN_BATCH;
+	vector<ActorInfo> actorVect;
+	assertExecBlockedResidentActions(ctx, numEvents, actorVect);
+
+	// No ack comes while the module blocks the reply. So the events
+	// beyond the window are kept in the queue.
+	assertWaitForActionLogStatus(ctx, actorVect[windowSize - 1].logId,
+	                             ACTLOG_STAT_STARTED);
+	ActionLog actionLog;
+	for (size_t i = 0; i < numEvents; i++) {
+		const ActionLogStatus expectedStatus =
+		  (i < windowSize) ?
+		    ACTLOG_STAT_STARTED : ACTLOG_STAT_RESIDENT_QUEUING;
+		assertActionLogStatus(actionLog, actorVect[i].logId,
+		                      expectedStatus);
+	}
+
+	// The rest are sent after the acks.
+	sendAllowReplyNotifyEvent(ctx);
+	assertWaitForActionLogStatus(ctx, actorVect.back().logId,
+	                             ACTLOG_STAT_SUCCEEDED);
+	for (size_t i = 0; i < numEvents; i++) {
+		assertActionLogStatus(actionLog, actorVect[i].logId,
+		                      ACTLOG_STAT_SUCCEEDED);
+	}
+}
+
+void test_closeResidentByOutOfOrderAck(void)
+{
+	assertCloseResidentByUnexpectedAck(false);
+}
+
+void test_closeResidentByDuplicateAck(void)
+{
+	assertCloseResidentByUnexpectedAck(true);
+}
+
 void test_shouldSkipByTime(void)
 {
 	TestActionManager actMgr;
@@ -1323,6 +1502,49 @@ void test_checkExitWaitedCommandAction(void)
 	                    actMgr.callGetNumberOfOnstageCommandActors());
 }
 
+void test_getCommandActionStats(void)
+{
+	test_checkExitWaitedCommandAction();
+
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	size_t maxNum = confMgr->getMaxNumberOfRunningCommandAction();
+	size_t expectedNumStarted = maxNum;
+	for (size_t i = maxNum; i < maxNum + numWaitingActions; i++) {
+		if (!isFailureCase(i))
+			expectedNumStarted++;
+	}
+
+	ActionManager::CommandActionStats stats;
+	ActionManager::getCommandActionStats(stats);
+	cppcut_assert_equal(expectedNumStarted, stats.numStarted);
+	cppcut_assert_equal(expectedNumStarted, stats.numFinished);
+	cppcut_assert_equal(numWaitingActions, stats.numQueued);
+	cppcut_assert_equal((size_t)0, stats.numRejected);
+	cppcut_assert_equal(true, stats.maxWaitTimeMSec > 0);
+	cppcut_assert_equal(true, stats.maxRunTimeMSec > 0);
+}
+
+void test_rejectCommandActionWhenQueueIsFull(void)
+{
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	confMgr->setMaxNumberOfWaitingCommandAction(numWaitingActions);
+	size_t maxNum = confMgr->getMaxNumberOfRunningCommandAction();
+	test_limitCommandAction(); // fill the running set and the queue.
+
+	ExecCommandContext *ctx = new ExecCommandContext();
+	g_execCommandCtxVect.push_back(ctx); // just an alias
+	ctx->eventInfo = testEventInfo[0];
+	ExecActionArg arg(352 + maxNum + numWaitingActions, ACTION_COMMAND);
+	assertExecAction(ctx, arg);
+	cppcut_assert_equal((pid_t)0, ctx->actorInfo.pid);
+	assertActionLogForFailure(ctx, ACTLOG_EXECFAIL_QUEUE_FULL);
+
+	ActionManager::CommandActionStats stats;
+	ActionManager::getCommandActionStats(stats);
+	cppcut_assert_equal(numWaitingActions, stats.numQueued);
+	cppcut_assert_equal((size_t)1, stats.numRejected);
+}
+
 static void _assertRunAction(
  const HatoholErrorCode expectedErrorCode, const ActionDef &actDef,
  const EventInfo &eventInfo)
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "ActionRuleIndex.h"
+#include "ThreadLocalDBCache.h"
+#include "Hatohol.h"
+#include "Helpers.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testActionRuleIndex {
+
+static string makeActionIdList(const ActionDefList &actionDefList)
+{
+	string list;
+	ActionDefListConstIterator it = actionDefList.begin();
+	for (; it != actionDefList.end(); ++it)
+		list += StringUtils::sprintf("%" FMT_ACTION_ID ",", it->id);
+	return list;
+}
+
+static void assertMatchedAsDB(const EventInfoList &eventList)
+{
+	vector<ActionDefList> actionDefListVect;
+	ActionRuleIndex::getInstance()->match(actionDefListVect, eventList);
+	cppcut_assert_equal(eventList.size(), actionDefListVect.size());
+
+	ThreadLocalDBCache cache;
+	EventInfoListConstIterator it = eventList.begin();
+	for (size_t i = 0; it != eventList.end(); ++it, ++i) {
+		ActionDefList expected;
+		ActionsQueryOption option(USER_ID_SYSTEM);
+		option.setActionType(ACTION_ALL);
+		option.setTargetEventInfo(&*it);
+		assertHatoholError(
+		  HTERR_OK,
+		  cache.getAction().getActionList(expected, option));
+		cppcut_assert_equal(makeActionIdList(expected),
+		                    makeActionIdList(actionDefListVect[i]));
+	}
+}
+
+static void makeTestEventList(EventInfoList &eventList)
+{
+	for (size_t i = 0; i < NumTestEventInfo; i++)
+		eventList.push_back(testEventInfo[i]);
+}
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBTablesConfig();
+	loadTestDBTablesUser();
+	loadTestDBHostgroup();
+	loadTestDBHostgroupMember();
+	loadTestDBAction();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_match(void)
+{
+	EventInfoList eventList;
+	makeTestEventList(eventList);
+	assertMatchedAsDB(eventList);
+	cppcut_assert_equal(true, ActionRuleIndex::getInstance()->isLoaded());
+}
+
+void test_matchWithActionConditions(void)
+{
+	// Make events that satisfy the conditions of each action.
+	EventInfoList eventList;
+	for (size_t i = 0; i < NumTestActionDef; i++) {
+		const ActionCondition &cond = testActionDef[i].condition;
+		EventInfo eventInfo = testEventInfo[0];
+		if (cond.isEnable(ACTCOND_SERVER_ID))
+			eventInfo.serverId = cond.serverId;
+		if (cond.isEnable(ACTCOND_HOST_ID))
+			eventInfo.hostIdInServer = cond.hostIdInServer;
+		if (cond.isEnable(ACTCOND_TRIGGER_ID))
+			eventInfo.triggerId = cond.triggerId;
+		if (cond.isEnable(ACTCOND_TRIGGER_STATUS)) {
+			eventInfo.status =
+			  static_cast<TriggerStatusType>(cond.triggerStatus);
+		}
+		if (cond.isEnable(ACTCOND_TRIGGER_SEVERITY)) {
+			eventInfo.severity =
+			  static_cast<TriggerSeverityType>(
+			    cond.triggerSeverity);
+		}
+		eventList.push_back(eventInfo);
+	}
+	assertMatchedAsDB(eventList);
+}
+
+void test_matchEmptyList(void)
+{
+	EventInfoList eventList;
+	vector<ActionDefList> actionDefListVect;
+	ActionRuleIndex::getInstance()->match(actionDefListVect, eventList);
+	cppcut_assert_equal(true, actionDefListVect.empty());
+}
+
+void test_invalidateOnAddAction(void)
+{
+	EventInfoList eventList;
+	makeTestEventList(eventList);
+	assertMatchedAsDB(eventList);
+
+	ActionDef actionDef = testActionDef[0];
+	actionDef.condition = ActionCondition();
+	ThreadLocalDBCache cache;
+	OperationPrivilege privilege(USER_ID_SYSTEM);
+	assertHatoholError(HTERR_OK,
+	                   cache.getAction().addAction(actionDef, privilege));
+	cppcut_assert_equal(false, ActionRuleIndex::getInstance()->isLoaded());
+
+	// The new action has no condition and matches all events.
+	vector<ActionDefList> actionDefListVect;
+	ActionRuleIndex::getInstance()->match(actionDefListVect, eventList);
+	for (size_t i = 0; i < actionDefListVect.size(); i++) {
+		cppcut_assert_equal(actionDef.id,
+		                    actionDefListVect[i].back().id);
+	}
+	assertMatchedAsDB(eventList);
+}
+
+void test_invalidateOnDeleteActions(void)
+{
+	EventInfoList eventList;
+	makeTestEventList(eventList);
+	assertMatchedAsDB(eventList);
+
+	ActionIdList idList;
+	idList.push_back(1);
+	ThreadLocalDBCache cache;
+	OperationPrivilege privilege(OPPRVLG_DELETE_ALL_ACTION);
+	privilege.setUserId(USER_ID_SYSTEM);
+	assertHatoholError(HTERR_OK,
+	                   cache.getAction().deleteActions(idList, privilege));
+	cppcut_assert_equal(false, ActionRuleIndex::getInstance()->isLoaded());
+	assertMatchedAsDB(eventList);
+}
+
+} // namespace testActionRuleIndex
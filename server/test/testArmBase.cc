@@ -406,6 +406,12 @@ struct TestFetchCtx {
 		return true;
 	}
 
+	static bool oneProcFetchItemsFailureHook(void *data)
+	{
+		oneProcFetchItemsHook(data);
+		return false;
+	}
+
 	static bool oneProcFetchHistoryHook(void *data)
 	{
 		TestFetchCtx *obj
@@ -479,6 +485,30 @@ void test_fetchItems(void)
 	cppcut_assert_equal(true, ctx.fetchItemsClosureDeleted.get());
 }
 
+void test_fetchItemsFailure(void)
+{
+	TestFetchCtx ctx;
+
+	MonitoringServerInfo serverInfo;
+	initServerInfo(serverInfo);
+
+	TestArmBase armBase(__func__, serverInfo);
+	armBase.setOneProcHook(TestFetchCtx::oneProcHook, &ctx);
+	armBase.setOneProcFetchItemsHook(
+	  TestFetchCtx::oneProcFetchItemsFailureHook, &ctx);
+
+	armBase.fetchItems(ctx.fetchItemClosure);
+	// will be deleted by ArmBase
+	ctx.fetchItemClosure = NULL;
+	armBase.start();
+	ctx.waitForFirstProc();
+	armBase.callRequestExitAndWait();
+
+	cppcut_assert_equal(1, ctx.oneProcFetchItemsCount.get());
+	cppcut_assert_equal(false, ctx.fetchItemsClosureCalled.get());
+	cppcut_assert_equal(true, ctx.fetchItemsClosureDeleted.get());
+}
+
 void test_fetchHistory(void)
 {
 	TestFetchCtx ctx;
@@ -22,6 +22,7 @@
 #include "ArmNagiosNDOUtils.h"
 #include "Helpers.h"
 #include "DBTablesTest.h"
+#include "ThreadLocalDBCache.h"
 using namespace std;
 
 namespace testArmNagiosNDOUtils {
@@ -47,6 +48,27 @@ public:
 	{
 		ArmNagiosNDOUtils::connect();
 	} 
+
+	void pollConcurrently(void)
+	{
+		ArmNagiosNDOUtils::pollConcurrently();
+	}
+
+	void pollSerially(void)
+	{
+		getHost();
+		getHostgroup();
+		getHostgroupMembers();
+		ArmNagiosNDOUtils::getTrigger(true);
+		ArmNagiosNDOUtils::getEvent();
+		if (!getCopyOnDemandEnabled())
+			getItem();
+	}
+
+	size_t getNumberOfCreatedPoolConnections(void)
+	{
+		return ArmNagiosNDOUtils::getNumberOfCreatedPoolConnections();
+	}
 };
 
 static ArmNagiosNDOUtils *g_armNagi = NULL;
@@ -81,6 +103,24 @@ static void createGlobalInstance(void)
 	g_armNagiTestee->connect();
 }
 
+static string dumpStoredData(void)
+{
+	ThreadLocalDBCache cache;
+	DBAgent &dbAgent = cache.getMonitoring().getDBAgent();
+	string dump;
+	dump += execSQL(&dbAgent,
+	  "SELECT server_id,host_id_in_server,name FROM server_host_def "
+	  "ORDER BY server_id,host_id_in_server");
+	dump += execSQL(&dbAgent,
+	  "SELECT server_id,id,time_sec,time_ns,event_value,trigger_id,"
+	  "status,severity,host_id_in_server FROM events "
+	  "ORDER BY server_id,id");
+	dump += execSQL(&dbAgent,
+	  "SELECT server_id,id,host_id_in_server,brief FROM items "
+	  "ORDER BY server_id,id");
+	return dump;
+}
+
 void cut_setup(void)
 {
 	hatoholInit();
@@ -115,5 +155,32 @@ void test_getEvent(void)
 	g_armNagiTestee->getEvent();
 }
 
+void test_pollConcurrently(void)
+{
+	// The result of the serial polling is the reference.
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	g_armNagiTestee->pollSerially();
+	const string expected = dumpStoredData();
+	delete g_armNagi;
+	g_armNagi = NULL;
+	g_armNagiTestee = NULL;
+	hatoholInit();
+	setupTestDB();
+
+	createGlobalInstance<ArmNagiosNDOUtilsTestee>();
+	g_armNagiTestee->pollConcurrently();
+	cppcut_assert_equal(expected, dumpStoredData());
+	const size_t numConnections =
+	  g_armNagiTestee->getNumberOfCreatedPoolConnections();
+	cppcut_assert_equal(true, numConnections > 0);
+
+	// The connections of the pool are reused in the next polling.
+	// The events are fetched incrementally. So nothing is duplicated.
+	g_armNagiTestee->pollConcurrently();
+	cppcut_assert_equal(expected, dumpStoredData());
+	cppcut_assert_equal(
+	  numConnections, g_armNagiTestee->getNumberOfCreatedPoolConnections());
+}
+
 } // namespace testArmNagiosNDOUtils
 
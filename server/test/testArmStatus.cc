@@ -43,6 +43,9 @@ void test_getArmInfoInitial(void)
 	cppcut_assert_equal(initTime, armInfo.lastFailureTime);
 	cppcut_assert_equal((size_t)0, armInfo.numUpdate);
 	cppcut_assert_equal((size_t)0, armInfo.numFailure);
+	cppcut_assert_equal((size_t)0, armInfo.lastPollCostMSec);
+	cppcut_assert_equal((size_t)0, armInfo.lastPollNumFetchedRows);
+	cppcut_assert_equal((uint64_t)0, armInfo.totalNumFetchedRows);
 }
 
 void test_logSuccess(void)
@@ -103,4 +106,19 @@ void test_setArmInfo(void)
 	assertEqual(armInfo, actual);
 }
 
+void test_logPollStats(void)
+{
+	ArmStatus armStatus;
+	armStatus.logPollStats(30, 100);
+	armStatus.logPollStats(20, 5);
+	ArmInfo armInfo = armStatus.getArmInfo();
+	cppcut_assert_equal((size_t)20, armInfo.lastPollCostMSec);
+	cppcut_assert_equal((size_t)5, armInfo.lastPollNumFetchedRows);
+	cppcut_assert_equal((uint64_t)105, armInfo.totalNumFetchedRows);
+
+	// The status is not changed.
+	cppcut_assert_equal(ARM_WORK_STAT_INIT, armInfo.stat);
+	cppcut_assert_equal((size_t)0, armInfo.numUpdate);
+}
+
 } // namespace testArmStatus
@@ -18,6 +18,7 @@
  */
 
 #include <cppcutter.h>
+#include <climits>
 #include <errno.h>
 #include <fstream>
 #include <unistd.h>
@@ -42,9 +43,35 @@ static void _assertCreate(ChildProcessManager::CreateArg &arg)
 }
 #define assertCreate(A) cut_trace(_assertCreate(A))
 
+static void _assertStartSpawnYards(const size_t &numYards = 1)
+{
+	const string path = cut_build_path(getBaseDir().c_str(), "..", "src",
+	                                   ".libs", "hatohol-spawn-yard",
+	                                   NULL);
+	cppcut_assert_equal(
+	  numYards,
+	  ChildProcessManager::getInstance()->startSpawnYards(numYards, path));
+}
+#define assertStartSpawnYards(...) \
+cut_trace(_assertStartSpawnYards(__VA_ARGS__))
+
+static pid_t getParentPid(const pid_t &pid)
+{
+	// The 4th field of /proc/<pid>/stat is the parent PID.
+	const string path = StringUtils::sprintf("/proc/%d/stat", pid);
+	ifstream ifs(path.c_str());
+	string pidStr;
+	string name;
+	string stat;
+	pid_t ppid = 0;
+	ifs >> pidStr >> name >> stat >> ppid;
+	return ppid;
+}
+
 void cut_teardown(void)
 {
 	ChildProcessManager::getInstance()->reset();
+	ChildProcessManager::getInstance()->stopSpawnYards();
 }
 
 // ---------------------------------------------------------------------------
@@ -297,5 +324,112 @@ void test_ignore_sigstop(void)
 	cppcut_assert_equal(true, (bool)ctx->calledFinalized);
 }
 
+void test_createBySpawnYard(void)
+{
+	assertStartSpawnYards();
+	ChildProcessManager::CreateArg arg;
+	assertCreate(arg);
+	const pid_t ppid = getParentPid(arg.pid);
+	cppcut_assert_not_equal(0, ppid);
+	cppcut_assert_not_equal(getpid(), ppid);
+}
+
+void test_createBySpawnYardWithEnvAndWorkingDirectory(void)
+{
+	assertStartSpawnYards();
+	ChildProcessManager::CreateArg arg;
+	arg.envs.push_back("A=123");
+	arg.envs.push_back("XYZ=^_^");
+	arg.workingDirectory = "/tmp";
+	assertCreate(arg);
+
+	string expect;
+	for (size_t i = 0; i < arg.envs.size(); i++) {
+		expect += arg.envs[i].c_str();
+		expect += '\0';
+	}
+	string path = StringUtils::sprintf("/proc/%d/environ", arg.pid);
+	assertFileContent(expect, path);
+
+	char cwd[PATH_MAX];
+	path = StringUtils::sprintf("/proc/%d/cwd", arg.pid);
+	const ssize_t len = readlink(path.c_str(), cwd, sizeof(cwd) - 1);
+	cppcut_assert_equal(true, len > 0);
+	cppcut_assert_equal(string("/tmp"), string(cwd, len));
+}
+
+void test_executedCbWithErrorBySpawnYard(void)
+{
+	struct Ctx : public ChildProcessManager::EventCallback {
+		bool called;
+		virtual void onExecuted(const bool &succeeded, GError *gerror) override
+		{
+			cppcut_assert_equal(false, succeeded);
+			cppcut_assert_not_null(gerror);
+			cppcut_assert_equal(G_SPAWN_ERROR, gerror->domain);
+			cppcut_assert_equal((gint)G_SPAWN_ERROR_NOENT,
+			                    gerror->code);
+			called = true;
+		}
+	} *ctx = new Ctx();
+	ctx->called = false;
+
+	assertStartSpawnYards();
+	ChildProcessManager::CreateArg arg;
+	arg.args.push_back("non-exisiting-command");
+	arg.eventCb = ctx;
+	assertHatoholError(HTERR_FAILED_TO_SPAWN,
+	                   ChildProcessManager::getInstance()->create(arg));
+	cppcut_assert_equal(true, ctx->called);
+}
+
+void test_collectedCbBySpawnYard(void)
+{
+	struct Ctx : public ChildProcessManager::EventCallback {
+		AtomicValue<int> code;
+		AtomicValue<int> status;
+		AtomicValue<bool> calledFinalized;
+		GMainLoopAgent mainLoop;
+
+		Ctx(void)
+		: code(0),
+		  status(0),
+		  calledFinalized(false)
+		{
+		}
+
+		virtual void onCollected(const siginfo_t *siginfo) override
+		{
+			code = siginfo->si_code;
+			status = siginfo->si_status;
+		}
+
+		virtual void onFinalized(void) override
+		{
+			calledFinalized = true;
+			mainLoop.quit();
+		}
+	} *ctx = new Ctx();
+
+	assertStartSpawnYards(2);
+	ChildProcessManager::CreateArg arg;
+	arg.eventCb = ctx;
+	assertCreate(arg);
+	cppcut_assert_equal(0, kill(arg.pid, SIGKILL));
+	ctx->mainLoop.run();
+	cppcut_assert_equal(CLD_KILLED, (int)ctx->code);
+	cppcut_assert_equal(SIGKILL, (int)ctx->status);
+	cppcut_assert_equal(true, (bool)ctx->calledFinalized);
+}
+
+void test_createWithFlagsIsNotBySpawnYard(void)
+{
+	assertStartSpawnYards();
+	ChildProcessManager::CreateArg arg;
+	arg.addFlag(G_SPAWN_STDERR_TO_DEV_NULL);
+	assertCreate(arg);
+	cppcut_assert_equal(getpid(), getParentPid(arg.pid));
+}
+
 
 } // namespace testChildProcessManager
@@ -100,6 +100,48 @@ void test_parseConfigServerWithPort(void)
 	cppcut_assert_equal(3333, confMgr->getDBServerPort());
 }
 
+void test_parseDBReplicasDefault(void)
+{
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(true, confMgr->getDBReplicas().empty());
+	cppcut_assert_equal(DBConnectInfo::DEFAULT_MAX_REPLICA_LAG_SEC,
+	                    confMgr->getDBReplicaMaxLagSec());
+}
+
+void test_parseDBReplicas(void)
+{
+	CommandArgHelper cmds;
+	cmds << "--db-replicas";
+	cmds << "umi.example.com:3333,sora.example.com";
+	cmds << "--db-replica-max-lag";
+	cmds << "30";
+	cmds.activate();
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	const DBReplicaInfoVect replicas = confMgr->getDBReplicas();
+	cppcut_assert_equal(static_cast<size_t>(2), replicas.size());
+	cppcut_assert_equal(string("umi.example.com"), replicas[0].host);
+	cppcut_assert_equal(static_cast<size_t>(3333), replicas[0].port);
+	cppcut_assert_equal(string("sora.example.com"), replicas[1].host);
+	cppcut_assert_equal(static_cast<size_t>(0), replicas[1].port);
+	cppcut_assert_equal(30, confMgr->getDBReplicaMaxLagSec());
+}
+
+void test_parseSpawnYardsDefault(void)
+{
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(0, confMgr->getNumberOfSpawnYards());
+}
+
+void test_parseSpawnYards(void)
+{
+	CommandArgHelper cmds;
+	cmds << "--spawn-yards";
+	cmds << "4";
+	cmds.activate();
+	ConfigManager *confMgr = ConfigManager::getInstance();
+	cppcut_assert_equal(4, confMgr->getNumberOfSpawnYards());
+}
+
 void test_parseTestModeDefault(void)
 {
 	cppcut_assert_equal(false, ConfigManager::getInstance()->isTestMode());
@@ -634,6 +634,94 @@ void test_delete(void)
 	dbAgentTestDelete(dbAgent, dbAgentChecker);
 }
 
+void test_purgeOldRows(void)
+{
+	DBAgentMySQL dbAgent(TEST_DB_NAME);
+	dbAgentTestPurgeOldRows(dbAgent);
+}
+
+void test_getReadAgentWithoutReplicas(void)
+{
+	DBAgentMySQL dbAgent(TEST_DB_NAME);
+	cppcut_assert_equal(static_cast<DBAgent *>(&dbAgent),
+	                    &dbAgent.getReadAgent());
+}
+
+void test_getReadAgentWithUnusableReplica(void)
+{
+	// The test server isn't a replica. So its lag is unknown.
+	DBAgentMySQL dbAgent(TEST_DB_NAME);
+	cppcut_assert_equal(-1, dbAgent.getReplicationLagSec());
+
+	DBReplicaInfoVect replicas;
+	DBReplicaInfo replicaInfo;
+	replicaInfo.host = "localhost";
+	replicaInfo.port = 0;
+	replicas.push_back(replicaInfo);
+	dbAgent.setReplicas(replicas);
+	cppcut_assert_equal(static_cast<DBAgent *>(&dbAgent),
+	                    &dbAgent.getReadAgent());
+}
+
+void data_selectOnReadAgentWithUnusableReplica(void)
+{
+	gcut_add_datum("Not a replica",
+	               "host", G_TYPE_STRING, "localhost",
+	               "port", G_TYPE_INT, 0, NULL);
+	gcut_add_datum("Unreachable",
+	               "host", G_TYPE_STRING, "127.0.0.1",
+	               "port", G_TYPE_INT, 1, NULL);
+}
+
+void test_selectOnReadAgentWithUnusableReplica(gconstpointer data)
+{
+	DBAgentMySQL dbAgent(TEST_DB_NAME);
+	DBAgentChecker::createTable(dbAgent);
+	DBAgentChecker::makeTestData(dbAgent);
+
+	DBReplicaInfoVect replicas;
+	DBReplicaInfo replicaInfo;
+	replicaInfo.host = gcut_data_get_string(data, "host");
+	replicaInfo.port = gcut_data_get_int(data, "port");
+	replicas.push_back(replicaInfo);
+	dbAgent.setReplicas(replicas);
+
+	// The rows are selected on the primary.
+	DBAgent::SelectExArg arg(tableProfileTest);
+	arg.add("count(*)", SQL_COLUMN_TYPE_TEXT);
+	dbAgent.selectOnReadAgent(arg);
+
+	const ItemGroupList &itemList = arg.dataTable->getItemGroupList();
+	cppcut_assert_equal((size_t)1, itemList.size());
+	const ItemGroup *itemGroup = *itemList.begin();
+	cppcut_assert_equal(StringUtils::sprintf("%zd", NUM_TEST_DATA),
+	                    itemGroup->getItemAt(0)->getString());
+}
+
+void test_addTimePartitions(void)
+{
+	DBAgentMySQL dbAgent(TEST_DB_NAME);
+	const DBAgent::TableProfile &tableProfile =
+	  tableProfileTestTimePartition;
+	const time_t DAY = DBAgent::TIME_PARTITION_SEC;
+	const time_t today = time(NULL) / DAY * DAY;
+	dbAgent.createTable(tableProfile);
+	dbAgent.addTimePartitions(tableProfile, today + DAY * 10);
+
+	vector<DBAgentMySQL::TimePartitionStruct> partitions;
+	dbAgent.getTimePartitions(partitions, TABLE_NAME_TEST_TIME_PARTITION);
+	cppcut_assert_equal(static_cast<size_t>(11 + 1), partitions.size());
+	cppcut_assert_equal(today + DAY, partitions.front().lessThan);
+	cppcut_assert_equal(today + DAY * 11, partitions[10].lessThan);
+	cppcut_assert_equal(true, partitions.back().isMaxValue);
+
+	dbAgent.purgeOldRows(tableProfile, today + DAY * 2);
+	partitions.clear();
+	dbAgent.getTimePartitions(partitions, TABLE_NAME_TEST_TIME_PARTITION);
+	cppcut_assert_equal(static_cast<size_t>(9 + 1), partitions.size());
+	cppcut_assert_equal(today + DAY * 3, partitions.front().lessThan);
+}
+
 void test_addColumns(void)
 {
 	DBAgentMySQL dbAgent(TEST_DB_NAME);
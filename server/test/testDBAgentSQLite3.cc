@@ -292,6 +292,11 @@ public:
 	{
 		execSql("%s", statement.c_str());
 	}
+
+	static string callMakeDBPathFromName(const string &name)
+	{
+		return makeDBPathFromName(name);
+	}
 };
 
 static void deleteDB(void)
@@ -338,6 +343,35 @@ void test_createdWithSpecifiedDbPath(void)
 	cut_assert_exist_path(expectPath.c_str());
 }
 
+void test_walMode(void)
+{
+	const string dbName = "test-database-wal";
+	const string dbPath =
+	  TestDBAgentSQLite3::callMakeDBPathFromName(dbName);
+	unlink(dbPath.c_str());
+	unlink((dbPath + "-wal").c_str());
+	unlink((dbPath + "-shm").c_str());
+
+	DBAgentSQLite3 walAgent(dbName, "", true);
+	cppcut_assert_equal(true, walAgent.isWALMode());
+	walAgent.createTable(tableProfileTest);
+	string output = executeCommand(StringUtils::sprintf(
+	  "sqlite3 %s \"PRAGMA journal_mode\"", dbPath.c_str()));
+	cppcut_assert_equal(string("wal\n"), output);
+
+	// A reader isn't blocked by a writer in a transaction.
+	walAgent.begin();
+	DBAgentChecker::insert(walAgent, ID[0], AGE[0], NAME[0], HEIGHT[0],
+	                       TIME[0]);
+	DBAgentSQLite3 reader(dbName, "", true);
+	cppcut_assert_equal(true, reader.isTableExisting(TABLE_NAME_TEST));
+	cppcut_assert_equal(false,
+	                    reader.isRecordExisting(TABLE_NAME_TEST, "id=1"));
+	walAgent.commit();
+	cppcut_assert_equal(true,
+	                    reader.isRecordExisting(TABLE_NAME_TEST, "id=1"));
+}
+
 void test_getIndexes(void)
 {
 	const string tableName = "footable";
@@ -559,6 +593,12 @@ void test_delete(void)
 	dbAgentTestDelete(dbAgent, dbAgentChecker);
 }
 
+void test_purgeOldRows(void)
+{
+	DBAgentSQLite3 dbAgent;
+	dbAgentTestPurgeOldRows(dbAgent);
+}
+
 void test_renameTable(void)
 {
 	DBAgentSQLite3 dbAgent;
@@ -674,6 +674,7 @@ void test_endExecAction(void)
 
 	// update one log
 	dbAction.logEndExecAction(logArg);
+	dbAction.flushActionLogs();
 
 	// validate
 	string expectedLine =
@@ -683,6 +684,35 @@ void test_endExecAction(void)
 	assertDBContent(&dbAction.getDBAgent(), statement, expect);
 }
 
+void test_logUpdatesAreBufferedUntilFlush(void)
+{
+	DECLARE_DBTABLES_ACTION(dbAction);
+	const ActionLogIdType logId =
+	  dbAction.createActionLog(testActionDef[0], testEventInfo[0],
+	                           ACTLOG_EXECFAIL_NONE, ACTLOG_STAT_QUEUING);
+	const string statement = StringUtils::sprintf(
+	  "select status from action_logs where action_log_id=%"
+	  FMT_ACTION_LOG_ID, logId);
+
+	DBTablesAction::LogEndExecActionArg logArg;
+	logArg.logId = logId;
+	logArg.status = ACTLOG_STAT_SUCCEEDED;
+	dbAction.updateLogStatusToStart(logId);
+	dbAction.logEndExecAction(logArg);
+	assertDBContent(&dbAction.getDBAgent(), statement,
+	                StringUtils::sprintf("%d", ACTLOG_STAT_QUEUING));
+
+	// The transitions are merged and the last status is written.
+	dbAction.flushActionLogs();
+	assertDBContent(&dbAction.getDBAgent(), statement,
+	                StringUtils::sprintf("%d", ACTLOG_STAT_SUCCEEDED));
+
+	ActionLog actionLog;
+	cppcut_assert_equal(true, dbAction.getLog(actionLog, logId));
+	cppcut_assert_equal((uint32_t)0, actionLog.nullFlags & ACTLOG_FLAG_START_TIME);
+	cppcut_assert_equal((uint32_t)0, actionLog.nullFlags & ACTLOG_FLAG_END_TIME);
+}
+
 void test_getTriggerActionList(void)
 {
 	loadTestDBAction();
@@ -1098,4 +1098,113 @@ void test_syncHostsAddNewHost(void)
 	assertDBContent(&dbAgent, statement, expect);
 }
 
+void test_syncHostsMarkRemovedOfValidServer(void)
+{
+	loadTestDBServer();
+	loadTestDBServerHostDef();
+	DECLARE_DBTABLES_HOST(dbHost);
+	const ServerIdType targetServerId = 1;
+
+	// Only the hosts whose id is even are passed.
+	ServerHostDefVect svHostDefs;
+	string expect;
+	for (size_t i = 0; i < NumTestServerHostDef; i++) {
+		const ServerHostDef &svHostDef = testServerHostDef[i];
+		if (svHostDef.serverId != targetServerId)
+			continue;
+		const bool removed = svHostDef.hostId % 2;
+		if (!removed)
+			svHostDefs.push_back(svHostDef);
+		expect += StringUtils::sprintf(
+		  "%" FMT_HOST_ID "|%d\n", svHostDef.hostId,
+		  removed ? HOST_STAT_REMOVED : HOST_STAT_NORMAL);
+	}
+	cppcut_assert_equal(false, svHostDefs.empty());
+
+	HostHostIdMap hostHostIdMap;
+	assertHatoholError(
+	  HTERR_OK,
+	  dbHost.syncHosts(svHostDefs, targetServerId, &hostHostIdMap));
+	cppcut_assert_equal(false, dbHost.wasStoredHostsChanged());
+	cppcut_assert_equal(static_cast<HostIdType>(11),
+	                    hostHostIdMap["235013"]);
+
+	DBAgent &dbAgent = dbHost.getDBAgent();
+	const ColumnDef *coldef = tableProfileServerHostDef.columnDefs;
+	string statement = StringUtils::sprintf(
+	  "select %s,%s from %s where %s=%" FMT_SERVER_ID " order by %s asc;",
+	  coldef[IDX_HOST_SERVER_HOST_DEF_HOST_ID].columnName,
+	  coldef[IDX_HOST_SERVER_HOST_DEF_HOST_STATUS].columnName,
+	  tableProfileServerHostDef.name,
+	  coldef[IDX_HOST_SERVER_HOST_DEF_SERVER_ID].columnName,
+	  targetServerId,
+	  coldef[IDX_HOST_SERVER_HOST_DEF_HOST_ID].columnName);
+	assertDBContent(&dbAgent, statement, expect);
+
+	// Nothing is changed by the same hosts.
+	assertHatoholError(HTERR_OK,
+	                   dbHost.syncHosts(svHostDefs, targetServerId));
+	cppcut_assert_equal(true, dbHost.wasStoredHostsChanged());
+	assertDBContent(&dbAgent, statement, expect);
+}
+
+void test_syncHostsReturnStoredHostsChanged(void)
+{
+	loadTestDBServer();
+	loadTestDBServerHostDef();
+	DECLARE_DBTABLES_HOST(dbHost);
+	const ServerIdType targetServerId = 1;
+
+	// All the hosts of the server are marked as removed.
+	ServerHostDefVect svHostDefs;
+	bool storedHostsChanged = true;
+	assertHatoholError(
+	  HTERR_OK,
+	  dbHost.syncHosts(svHostDefs, targetServerId, NULL,
+	                   &storedHostsChanged));
+	cppcut_assert_equal(false, storedHostsChanged);
+
+	// Nothing is changed at the second time.
+	assertHatoholError(
+	  HTERR_OK,
+	  dbHost.syncHosts(svHostDefs, targetServerId, NULL,
+	                   &storedHostsChanged));
+	cppcut_assert_equal(true, storedHostsChanged);
+	cppcut_assert_equal(dbHost.wasStoredHostsChanged(),
+	                    storedHostsChanged);
+}
+
+void test_syncHostsUpdateName(void)
+{
+	loadTestDBServerHostDef();
+	DECLARE_DBTABLES_HOST(dbHost);
+	const ServerIdType targetServerId = 1;
+
+	ServerHostDefVect svHostDefs;
+	string expect;
+	for (size_t i = 0; i < NumTestServerHostDef; i++) {
+		const ServerHostDef &svHostDef = testServerHostDef[i];
+		if (svHostDef.serverId != targetServerId)
+			continue;
+		ServerHostDef newSvHostDef = svHostDef;
+		if (svHostDefs.empty())
+			newSvHostDef.name = "renamed host";
+		svHostDefs.push_back(newSvHostDef);
+		expect += makeHostsOutput(newSvHostDef, i);
+	}
+	cppcut_assert_equal(false, svHostDefs.empty());
+
+	assertHatoholError(HTERR_OK,
+	                   dbHost.syncHosts(svHostDefs, targetServerId));
+	DBAgent &dbAgent = dbHost.getDBAgent();
+	const ColumnDef *coldef = tableProfileServerHostDef.columnDefs;
+	string statement = StringUtils::sprintf(
+	  "select * from %s where %s=%" FMT_SERVER_ID " order by %s asc;",
+	  tableProfileServerHostDef.name,
+	  coldef[IDX_HOST_SERVER_HOST_DEF_SERVER_ID].columnName,
+	  targetServerId,
+	  coldef[IDX_HOST_SERVER_HOST_DEF_ID].columnName);
+	assertDBContent(&dbAgent, statement, expect);
+}
+
 } // namespace testDBTablesHost
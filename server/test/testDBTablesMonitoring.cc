@@ -686,6 +686,56 @@ void test_addEventInfoUnifiedId(void)
 			"select * from events", expected);
 }
 
+void test_addMonitoringData(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	EventInfoList eventInfoList;
+	for (size_t i = 0; i < NumTestEventInfo; i++)
+		eventInfoList.push_back(testEventInfo[i]);
+	ItemInfoList itemInfoList;
+	for (size_t i = 0; i < NumTestItemInfo; i++)
+		itemInfoList.push_back(testItemInfo[i]);
+	MonitoringServerStatusList serverStatusList;
+	MonitoringServerStatus serverStatus;
+	serverStatus.serverId = 1;
+	serverStatus.nvps = 1.5;
+	serverStatusList.push_back(serverStatus);
+	dbMonitoring.addMonitoringData(eventInfoList, itemInfoList,
+	                               serverStatusList);
+
+	DBAgent &dbAgent = dbMonitoring.getDBAgent();
+	assertDBContent(&dbAgent, "select count(*) from events",
+	                StringUtils::sprintf("%zd", NumTestEventInfo));
+	assertDBContent(&dbAgent, "select count(*) from items",
+	                StringUtils::sprintf("%zd", NumTestItemInfo));
+	assertDBContent(&dbAgent, "select count(*) from server_status", "1");
+	cppcut_assert_equal(false, eventInfoList.front().unifiedId == 0);
+}
+
+void test_addMonitoringDataRollbackAll(void)
+{
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	EventInfoList eventInfoList;
+	for (size_t i = 0; i < NumTestEventInfo; i++)
+		eventInfoList.push_back(testEventInfo[i]);
+	ItemInfoList itemInfoList;
+	for (size_t i = 0; i < NumTestItemInfo; i++)
+		itemInfoList.push_back(testItemInfo[i]);
+
+	// The events are written first. They are rolled back with the items.
+	DBAgent &dbAgent = dbMonitoring.getDBAgent();
+	dbAgent.dropTable("items");
+	bool gotException = false;
+	try {
+		dbMonitoring.addMonitoringData(eventInfoList, itemInfoList,
+		                               MonitoringServerStatusList());
+	} catch (const HatoholException &e) {
+		gotException = true;
+	}
+	cppcut_assert_equal(true, gotException);
+	assertDBContent(&dbAgent, "select count(*) from events", "0");
+}
+
 void data_addDupEventInfoList(void)
 {
 	prepareTestDataForFilterForDataOfDefunctServers();
@@ -1170,6 +1220,84 @@ void test_getEventWithTriggerId(gconstpointer data)
 	assertGetEventsWithFilter(arg);
 }
 
+static string makeUnifiedIdList(const EventInfoList &eventInfoList)
+{
+	string list;
+	EventInfoListConstIterator it = eventInfoList.begin();
+	for (; it != eventInfoList.end(); ++it)
+		list += StringUtils::sprintf("%" FMT_UNIFIED_EVENT_ID ",",
+		                             it->unifiedId);
+	return list;
+}
+
+static void assertGetEventsWithCursor(
+  const EventsQueryOption::SortType &sortType,
+  const DataQueryOption::SortDirection &sortDirection)
+{
+	loadTestDBEvents();
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	EventsQueryOption option(USER_ID_SYSTEM);
+	option.setSortType(sortType, sortDirection);
+	EventInfoList expected;
+	assertHatoholError(HTERR_OK,
+	                   dbMonitoring.getEventInfoList(expected, option));
+	cppcut_assert_equal(true, expected.size() > 3);
+
+	// Go forward by 2 events.
+	EventInfoList actual;
+	option.setMaximumNumber(2);
+	while (true) {
+		EventInfoList page;
+		assertHatoholError(HTERR_OK,
+		                   dbMonitoring.getEventInfoList(page, option));
+		if (page.empty())
+			break;
+		const EventInfo &last = page.back();
+		option.setCursor(last.unifiedId, last.time,
+		                 EventsQueryOption::CURSOR_NEXT);
+		actual.splice(actual.end(), page);
+	}
+	cppcut_assert_equal(makeUnifiedIdList(expected),
+	                    makeUnifiedIdList(actual));
+
+	// Go back from the last event.
+	const EventInfo &last = expected.back();
+	option.setCursor(last.unifiedId, last.time,
+	                 EventsQueryOption::CURSOR_PREV);
+	EventInfoList page;
+	assertHatoholError(HTERR_OK,
+	                   dbMonitoring.getEventInfoList(page, option));
+	expected.pop_back();
+	while (expected.size() > 2)
+		expected.pop_front();
+	cppcut_assert_equal(makeUnifiedIdList(expected),
+	                    makeUnifiedIdList(page));
+}
+
+void test_getEventWithCursorSortUnifiedIdAscending(void)
+{
+	assertGetEventsWithCursor(EventsQueryOption::SORT_UNIFIED_ID,
+	                          DataQueryOption::SORT_ASCENDING);
+}
+
+void test_getEventWithCursorSortUnifiedIdDescending(void)
+{
+	assertGetEventsWithCursor(EventsQueryOption::SORT_UNIFIED_ID,
+	                          DataQueryOption::SORT_DESCENDING);
+}
+
+void test_getEventWithCursorSortTimeAscending(void)
+{
+	assertGetEventsWithCursor(EventsQueryOption::SORT_TIME,
+	                          DataQueryOption::SORT_ASCENDING);
+}
+
+void test_getEventWithCursorSortTimeDescending(void)
+{
+	assertGetEventsWithCursor(EventsQueryOption::SORT_TIME,
+	                          DataQueryOption::SORT_DESCENDING);
+}
+
 void test_addIncidentInfo(void)
 {
 	DECLARE_DBTABLES_MONITORING(dbMonitoring);
@@ -1271,4 +1399,51 @@ void test_getLastUpdateTimeOfIncidentsWithNoRecord(void)
 	  expected, dbMonitoring.getLastUpdateTimeOfIncidents(trackerId));
 }
 
+void test_getEventInfoListWithEachAuthorizationStrategy(void)
+{
+	loadTestDBEvents();
+	loadTestDBServerHostDef();
+	loadTestDBHostgroupMember();
+
+	struct {
+		string operator()(const EventInfoList &eventInfoList)
+		{
+			string list;
+			EventInfoListConstIterator it = eventInfoList.begin();
+			for (; it != eventInfoList.end(); ++it) {
+				list += StringUtils::sprintf(
+				  "%" FMT_UNIFIED_EVENT_ID ",", it->unifiedId);
+			}
+			return list;
+		}
+	} makeUnifiedIdList;
+
+	// The host ID bitmaps and the host group join return the same
+	// events for every user.
+	DECLARE_DBTABLES_MONITORING(dbMonitoring);
+	for (size_t i = 0; i < NumTestUserInfo; i++) {
+		const UserIdType userId = i + 1;
+		EventsQueryOption option(userId);
+		option.setSortType(EventsQueryOption::SORT_UNIFIED_ID,
+		                   DataQueryOption::SORT_ASCENDING);
+
+		option.setAuthorizationStrategy(
+		  HostResourceQueryOption::AUTHORIZATION_STRATEGY_HOSTGROUP);
+		EventInfoList expected;
+		assertHatoholError(
+		  HTERR_OK, dbMonitoring.getEventInfoList(expected, option));
+
+		option.setAuthorizationStrategy(
+		  HostResourceQueryOption::
+		    AUTHORIZATION_STRATEGY_HOST_ID_BITMAP);
+		EventInfoList actual;
+		assertHatoholError(
+		  HTERR_OK, dbMonitoring.getEventInfoList(actual, option));
+		cppcut_assert_equal(makeUnifiedIdList(expected),
+		                    makeUnifiedIdList(actual),
+		                    cut_message("userId: %" FMT_USER_ID,
+		                                userId));
+	}
+}
+
 } // namespace testDBTablesMonitoring
@@ -332,6 +332,20 @@ void test_setGetTableNameAlways(gconstpointer data)
 	cppcut_assert_equal(enable, option.getTableNameAlways());
 }
 
+void test_getStaleDataAllowedDefault(void)
+{
+	DataQueryOption option;
+	cppcut_assert_equal(false, option.getStaleDataAllowed());
+}
+
+void test_copyStaleDataAllowed(void)
+{
+	DataQueryOption option;
+	option.setStaleDataAllowed();
+	DataQueryOption copied(option);
+	cppcut_assert_equal(true, copied.getStaleDataAllowed());
+}
+
 } // namespace testDataQueryOption
 
 namespace testDataQueryOptionWithDB {
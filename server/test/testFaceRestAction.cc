@@ -156,6 +156,17 @@ static void _assertActions(const string &path, const string &callbackName = "",
 		g_parser->endElement();
 	}
 	g_parser->endObject();
+
+	// No command action is executed in this test.
+	assertStartObject(g_parser, "commandActionStats");
+	assertValueInParser(g_parser, "numStarted", 0);
+	assertValueInParser(g_parser, "numFinished", 0);
+	assertValueInParser(g_parser, "numQueued", 0);
+	assertValueInParser(g_parser, "numRejected", 0);
+	assertValueInParser(g_parser, "maxWaitTimeMSec", 0);
+	assertValueInParser(g_parser, "maxRunTimeMSec", 0);
+	g_parser->endObject();
+
 	assertServersIdNameHashInParser(g_parser);
 }
 #define assertActions(P,...) cut_trace(_assertActions(P,##__VA_ARGS__))
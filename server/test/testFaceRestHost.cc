@@ -27,6 +27,7 @@
 #include "FaceRestTestUtils.h"
 #include "RestResourceHost.h"
 #include "ThreadLocalDBCache.h"
+#include "HistoryCache.h"
 using namespace std;
 using namespace mlpl;
 
@@ -527,6 +528,8 @@ void cut_teardown(void)
 
 	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
 	dataStore->setCopyOnDemandEnabled(false);
+	dataStore->stop();
+	HistoryCache::getInstance()->invalidateAll();
 }
 
 void test_hosts(void)
@@ -684,4 +687,93 @@ void test_getHistoryWithInvalidItemId(void)
 	assertErrorCode(parser, HTERR_NOT_FOUND_TARGET_RECORD);
 }
 
+void test_getHistoryWithZeroMaxPoints(void)
+{
+	startFaceRest();
+
+	RequestArg arg("/history");
+	StringMap params;
+	params["serverId"] = StringUtils::toString(testItemInfo[0].serverId);
+	params["itemId"] = testItemInfo[0].id;
+	params["maxPoints"] = "0";
+	arg.parameters = params;
+	arg.userId = findUserWith(OPPRVLG_GET_ALL_SERVER);
+	JSONParser *parser = getResponseAsJSONParser(arg);
+	unique_ptr<JSONParser> parserPtr(parser);
+	assertErrorCode(parser, HTERR_INVALID_PARAMETER);
+}
+
+void test_getHistoryWithBucket(void)
+{
+	startFaceRest();
+	loadTestDBServer();
+	loadTestDBItems();
+	loadTestDBServerHostDef();
+	UnifiedDataStore::getInstance()->start(false);
+
+	// The samples are served from the cache without fetching.
+	const ItemInfo &itemInfo = testItemInfo[1];
+	cppcut_assert_equal(ITEM_INFO_VALUE_TYPE_INTEGER, itemInfo.valueType);
+	const time_t beginTime = 1000;
+	const time_t endTime = 1059;
+	const char *values[] = {"1", "5", "3", "10", "2", "6"};
+	const size_t numValues = sizeof(values) / sizeof(const char *);
+	HistoryInfoVect historyInfoVect;
+	for (size_t i = 0; i < numValues; i++) {
+		HistoryInfo historyInfo;
+		historyInfo.serverId = itemInfo.serverId;
+		historyInfo.itemId = itemInfo.id;
+		historyInfo.value = values[i];
+		historyInfo.clock.tv_sec = beginTime + 10 * i;
+		historyInfo.clock.tv_nsec = 0;
+		historyInfoVect.push_back(historyInfo);
+	}
+	HistoryCache::getInstance()->add(itemInfo.serverId, itemInfo.id,
+	                                 beginTime, endTime, time(NULL),
+	                                 historyInfoVect);
+
+	RequestArg arg("/history");
+	StringMap params;
+	params["serverId"] = StringUtils::toString(itemInfo.serverId);
+	params["itemId"] = itemInfo.id;
+	params["beginTime"] = StringUtils::sprintf("%ld", beginTime);
+	params["endTime"] = StringUtils::sprintf("%ld", endTime);
+	params["bucket"] = "30";
+	arg.parameters = params;
+	arg.userId = findUserWith(OPPRVLG_GET_ALL_SERVER);
+	JSONParser *parser = getResponseAsJSONParser(arg);
+	unique_ptr<JSONParser> parserPtr(parser);
+	assertErrorCode(parser, HTERR_OK);
+	assertValueInParser(parser, "bucket", static_cast<uint64_t>(30));
+
+	struct {
+		time_t      clock;
+		const char *value;
+		const char *min;
+		const char *max;
+		const char *last;
+	} expected[] = {
+		{1000, "3", "1", "5",  "3"},
+		{1030, "6", "2", "10", "6"},
+	};
+	const size_t numBuckets = sizeof(expected) / sizeof(expected[0]);
+	assertStartObject(parser, "history");
+	cppcut_assert_equal(numBuckets,
+	                    static_cast<size_t>(parser->countElements()));
+	for (size_t i = 0; i < numBuckets; i++) {
+		parser->startElement(i);
+		assertValueInParser(parser, "clock",
+		                    static_cast<uint64_t>(expected[i].clock));
+		assertValueInParser(parser, "ns", 0);
+		assertValueInParser(parser, "value",
+		                    string(expected[i].value));
+		assertValueInParser(parser, "min", string(expected[i].min));
+		assertValueInParser(parser, "max", string(expected[i].max));
+		assertValueInParser(parser, "last", string(expected[i].last));
+		assertValueInParser(parser, "count", static_cast<uint64_t>(3));
+		parser->endElement();
+	}
+	parser->endObject();
+}
+
 } // namespace testFaceRestHost
@@ -42,6 +42,13 @@ public:
 	{
 		return parseEventParameter(option, query);
 	}
+
+	static string callMakeEventCursor(
+	  const EventInfo &eventInfo,
+	  const EventsQueryOption::CursorDirection &direction)
+	{
+		return makeEventCursor(eventInfo, direction);
+	}
 };
 
 template<typename PARAM_TYPE>
@@ -297,6 +304,57 @@ void test_parseEventParameterSortTypeInvalidInput(void)
 	  HTERR_INVALID_PARAMETER);
 }
 
+void data_parseEventParameterCursor(void)
+{
+	gcut_add_datum("Next",
+	               "direction", G_TYPE_INT, EventsQueryOption::CURSOR_NEXT,
+	               NULL);
+	gcut_add_datum("Prev",
+	               "direction", G_TYPE_INT, EventsQueryOption::CURSOR_PREV,
+	               NULL);
+}
+
+void test_parseEventParameterCursor(gconstpointer data)
+{
+	const EventsQueryOption::CursorDirection direction =
+	  static_cast<EventsQueryOption::CursorDirection>(
+	    gcut_data_get_int(data, "direction"));
+	EventInfo eventInfo;
+	initEventInfo(eventInfo);
+	eventInfo.unifiedId = 12345678901234ULL;
+	eventInfo.time.tv_sec = 1415232279;
+	eventInfo.time.tv_nsec = 925280073;
+	const string cursor =
+	  TestFaceRestNoInit::callMakeEventCursor(eventInfo, direction);
+
+	EventsQueryOption option;
+	GHashTable *query = g_hash_table_new(g_str_hash, g_str_equal);
+	Reaper<GHashTable> queryReaper(query, g_hash_table_unref);
+	g_hash_table_insert(query, (gpointer) "cursor",
+	                    (gpointer) cursor.c_str());
+	assertHatoholError(
+	  HTERR_OK, TestFaceRestNoInit::callParseEventParameter(option, query));
+	cppcut_assert_equal(true, option.hasCursor());
+	cppcut_assert_equal(direction, option.getCursorDirection());
+	cppcut_assert_equal(eventInfo.unifiedId, option.getCursorUnifiedId());
+	cppcut_assert_equal(eventInfo.time.tv_sec,
+	                    option.getCursorTime().tv_sec);
+	cppcut_assert_equal(eventInfo.time.tv_nsec,
+	                    option.getCursorTime().tv_nsec);
+}
+
+void test_parseEventParameterCursorInvalidInput(void)
+{
+	EventsQueryOption option;
+	GHashTable *query = g_hash_table_new(g_str_hash, g_str_equal);
+	Reaper<GHashTable> queryReaper(query, g_hash_table_unref);
+	g_hash_table_insert(query, (gpointer) "cursor", (gpointer) "lion");
+	assertHatoholError(
+	  HTERR_INVALID_PARAMETER,
+	  TestFaceRestNoInit::callParseEventParameter(option, query));
+	cppcut_assert_equal(false, option.hasCursor());
+}
+
 void test_parseEventParameterMaximumNumberNotFound(void)
 {
 	EventsQueryOption option;
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "FetchCoordinator.h"
+#include "ConfigManager.h"
+#include "Hatohol.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testFetchCoordinator {
+
+class TestDataStore : public DataStore {
+public:
+	TestDataStore(const ServerIdType &serverId)
+	{
+		m_serverInfo.id = serverId;
+	}
+
+	virtual const MonitoringServerInfo
+	  &getMonitoringServerInfo(void) const override
+	{
+		return m_serverInfo;
+	}
+
+	virtual const ArmStatus &getArmStatus(void) const override
+	{
+		return m_armStatus;
+	}
+
+private:
+	MonitoringServerInfo m_serverInfo;
+	ArmStatus            m_armStatus;
+};
+
+class TestFetchCoordinator : public FetchCoordinator {
+public:
+	DataStoreVector   dataStores;
+	vector<Closure0 *> startedClosures;
+	bool               startFailure;
+
+	TestFetchCoordinator(void)
+	: startFailure(false)
+	{
+	}
+
+	virtual ~TestFetchCoordinator()
+	{
+		for (size_t i = 0; i < dataStores.size(); i++)
+			dataStores[i]->unref();
+	}
+
+	void addDataStores(const size_t &numDataStores)
+	{
+		for (size_t i = 0; i < numDataStores; i++) {
+			const ServerIdType serverId = dataStores.size() + 1;
+			dataStores.push_back(new TestDataStore(serverId));
+		}
+	}
+
+	// Finish a started fetch in the order of the start.
+	void finishFetch(void)
+	{
+		cppcut_assert_equal(false, startedClosures.empty());
+		Closure0 *closure = startedClosures.front();
+		startedClosures.erase(startedClosures.begin());
+		(*closure)();
+		delete closure;
+	}
+
+	// Delete a started closure without calling it like a DataStore
+	// whose fetch failed.
+	void abortFetch(void)
+	{
+		cppcut_assert_equal(false, startedClosures.empty());
+		Closure0 *closure = startedClosures.front();
+		startedClosures.erase(startedClosures.begin());
+		delete closure;
+	}
+
+	void finishAllFetches(void)
+	{
+		while (!startedClosures.empty())
+			finishFetch();
+	}
+
+protected:
+	virtual DataStoreVector getDataStoreVector(void) override
+	{
+		for (size_t i = 0; i < dataStores.size(); i++)
+			dataStores[i]->ref();
+		return dataStores;
+	}
+
+	virtual bool isFetchSupported(DataStore *dataStore) override
+	{
+		return true;
+	}
+
+	virtual bool startFetch(DataStore *dataStore, Closure0 *closure)
+	  override
+	{
+		// The closure is held even on failure.
+		startedClosures.push_back(closure);
+		return !startFailure;
+	}
+};
+
+struct TestClosure : public Closure0 {
+	size_t &numCalled;
+
+	TestClosure(size_t &_numCalled)
+	: numCalled(_numCalled)
+	{
+	}
+
+	virtual void operator()(void) override
+	{
+		numCalled++;
+	}
+};
+
+void cut_setup(void)
+{
+	hatoholInit();
+}
+
+void cut_teardown(void)
+{
+	ConfigManager::getInstance()->setFetchStalenessSec(
+	  ConfigManager::DEFAULT_FETCH_STALENESS_SEC);
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_start(void)
+{
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(2);
+	size_t numCalled = 0;
+	cppcut_assert_equal(
+	  true, coordinator.start(ALL_SERVERS, new TestClosure(numCalled)));
+	cppcut_assert_equal(static_cast<size_t>(2),
+	                    coordinator.startedClosures.size());
+
+	coordinator.finishFetch();
+	cppcut_assert_equal(static_cast<size_t>(0), numCalled);
+	coordinator.finishFetch();
+	cppcut_assert_equal(static_cast<size_t>(1), numCalled);
+}
+
+void test_startTargetServer(void)
+{
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(3);
+	cppcut_assert_equal(true, coordinator.start(2));
+	cppcut_assert_equal(static_cast<size_t>(1),
+	                    coordinator.startedClosures.size());
+	coordinator.finishAllFetches();
+}
+
+void test_coalesceRequests(void)
+{
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(2);
+	size_t numCalled = 0;
+	cppcut_assert_equal(
+	  true, coordinator.start(1, new TestClosure(numCalled)));
+	cppcut_assert_equal(
+	  true, coordinator.start(ALL_SERVERS, new TestClosure(numCalled)));
+	// Only server 2 is started by the second request.
+	cppcut_assert_equal(static_cast<size_t>(2),
+	                    coordinator.startedClosures.size());
+
+	// Both requests wait for server 1.
+	coordinator.finishFetch();
+	cppcut_assert_equal(static_cast<size_t>(1), numCalled);
+	coordinator.finishFetch();
+	cppcut_assert_equal(static_cast<size_t>(2), numCalled);
+}
+
+void test_freshResultIsNotFetched(void)
+{
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(1);
+	cppcut_assert_equal(true, coordinator.start());
+	coordinator.finishAllFetches();
+
+	size_t numCalled = 0;
+	TestClosure *closure = new TestClosure(numCalled);
+	cppcut_assert_equal(false, coordinator.start(ALL_SERVERS, closure));
+	cppcut_assert_equal(true, coordinator.startedClosures.empty());
+	delete closure;
+	cppcut_assert_equal(true, coordinator.getLatencyMSec(1) > 0);
+}
+
+void test_staleResultIsFetched(void)
+{
+	ConfigManager::getInstance()->setFetchStalenessSec(0);
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(1);
+	cppcut_assert_equal(true, coordinator.start());
+	coordinator.finishAllFetches();
+	cppcut_assert_equal(true, coordinator.start());
+	coordinator.finishAllFetches();
+}
+
+void test_concurrencyFromLatency(void)
+{
+	// The default latency of each server is used at first.
+	const size_t numServers = 32;
+	const size_t expectedMax =
+	  numServers * FetchCoordinator::DEFAULT_LATENCY_MSEC /
+	  FetchCoordinator::TARGET_ROUND_MSEC;
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(numServers);
+	cppcut_assert_equal(true, coordinator.start());
+	cppcut_assert_equal(expectedMax, coordinator.getMaxRunningFetchers());
+	cppcut_assert_equal(expectedMax, coordinator.startedClosures.size());
+
+	// The queued one is started when a fetch finishes.
+	coordinator.finishFetch();
+	cppcut_assert_equal(expectedMax, coordinator.startedClosures.size());
+	coordinator.finishAllFetches();
+	cppcut_assert_equal(FetchCoordinator::MIN_RUNNING_FETCHERS,
+	                    coordinator.getMaxRunningFetchers());
+}
+
+void test_abortedFetch(void)
+{
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(1);
+	size_t numCalled = 0;
+	cppcut_assert_equal(
+	  true, coordinator.start(ALL_SERVERS, new TestClosure(numCalled)));
+	coordinator.abortFetch();
+	cppcut_assert_equal(static_cast<size_t>(1), numCalled);
+
+	// The failed fetch neither updates the latency nor is fresh.
+	cppcut_assert_equal(0.0, coordinator.getLatencyMSec(1));
+	cppcut_assert_equal(true, coordinator.start());
+	cppcut_assert_equal(static_cast<size_t>(1),
+	                    coordinator.startedClosures.size());
+	coordinator.finishAllFetches();
+	cppcut_assert_equal(true, coordinator.getLatencyMSec(1) > 0);
+}
+
+void test_closureOfFailedStartIsIgnored(void)
+{
+	TestFetchCoordinator coordinator;
+	coordinator.addDataStores(1);
+	coordinator.startFailure = true;
+	size_t numCalled = 0;
+	cppcut_assert_equal(
+	  true, coordinator.start(ALL_SERVERS, new TestClosure(numCalled)));
+	cppcut_assert_equal(static_cast<size_t>(1), numCalled);
+
+	// A new fetch is started while the closure of the failed one is
+	// still held.
+	coordinator.startFailure = false;
+	numCalled = 0;
+	cppcut_assert_equal(
+	  true, coordinator.start(ALL_SERVERS, new TestClosure(numCalled)));
+	cppcut_assert_equal(static_cast<size_t>(2),
+	                    coordinator.startedClosures.size());
+
+	// The late call of the failed one doesn't finish the new one.
+	coordinator.finishFetch();
+	cppcut_assert_equal(static_cast<size_t>(0), numCalled);
+	coordinator.finishFetch();
+	cppcut_assert_equal(static_cast<size_t>(1), numCalled);
+	cppcut_assert_equal(FetchCoordinator::MIN_RUNNING_FETCHERS,
+	                    coordinator.getMaxRunningFetchers());
+}
+
+} // namespace testFetchCoordinator
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <StringUtils.h>
+#include "HistoryAggregator.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testHistoryAggregator {
+
+static void addSample(HistoryInfoVect &historyInfoVect,
+                      const time_t &time, const string &value)
+{
+	HistoryInfo historyInfo;
+	historyInfo.clock.tv_sec = time;
+	historyInfo.clock.tv_nsec = 0;
+	historyInfo.value = value;
+	historyInfoVect.push_back(historyInfo);
+}
+
+static string makeBucketList(const HistoryBucketVect &buckets)
+{
+	string list;
+	HistoryBucketVectConstIterator it = buckets.begin();
+	for (; it != buckets.end(); ++it) {
+		list += StringUtils::sprintf(
+		  "%ld:%zd:%g:%g:%g:%s,", it->beginTime, it->numSamples,
+		  it->min, it->max, it->avg, it->last.c_str());
+	}
+	return list;
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_calcBucketWidth(void)
+{
+	cppcut_assert_equal(static_cast<time_t>(87),
+	                    HistoryAggregator::calcBucketWidth(0, 86399, 1000));
+}
+
+void test_calcBucketWidthForShortRange(void)
+{
+	cppcut_assert_equal(static_cast<time_t>(1),
+	                    HistoryAggregator::calcBucketWidth(100, 109, 1000));
+}
+
+void test_aggregate(void)
+{
+	HistoryInfoVect historyInfoVect;
+	addSample(historyInfoVect, 100, "3");
+	addSample(historyInfoVect, 105, "1.5");
+	addSample(historyInfoVect, 109, "-0.5");
+	addSample(historyInfoVect, 110, "10");
+	// No samples in 120-129
+	addSample(historyInfoVect, 135, "7");
+	addSample(historyInfoVect, 139, "8");
+
+	HistoryBucketVect buckets;
+	cppcut_assert_equal(
+	  true,
+	  HistoryAggregator::aggregate(buckets, historyInfoVect, 100, 10));
+	cppcut_assert_equal(string("100:3:-0.5:3:1.33333:-0.5,"
+	                           "110:1:10:10:10:10,"
+	                           "130:2:7:8:7.5:8,"),
+	                    makeBucketList(buckets));
+}
+
+void test_aggregateEmpty(void)
+{
+	HistoryInfoVect historyInfoVect;
+	HistoryBucketVect buckets;
+	cppcut_assert_equal(
+	  true,
+	  HistoryAggregator::aggregate(buckets, historyInfoVect, 100, 10));
+	cppcut_assert_equal(true, buckets.empty());
+}
+
+void test_aggregateText(void)
+{
+	HistoryInfoVect historyInfoVect;
+	addSample(historyInfoVect, 100, "1");
+	addSample(historyInfoVect, 101, "Text value");
+	HistoryBucketVect buckets;
+	cppcut_assert_equal(
+	  false,
+	  HistoryAggregator::aggregate(buckets, historyInfoVect, 100, 10));
+	cppcut_assert_equal(true, buckets.empty());
+}
+
+} // namespace testHistoryAggregator
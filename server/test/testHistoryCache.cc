@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "HistoryCache.h"
+#include "Helpers.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testHistoryCache {
+
+static const ServerIdType TEST_SERVER_ID = 1;
+static const time_t TEST_FETCH_TIME = 100000;
+
+class TestDataStore : public DataStore {
+public:
+	HistoryCache::TimeRangeVect requestedRanges;
+
+	virtual const MonitoringServerInfo
+	  &getMonitoringServerInfo(void) const override
+	{
+		return m_serverInfo;
+	}
+
+	virtual const ArmStatus &getArmStatus(void) const override
+	{
+		return m_armStatus;
+	}
+
+	// Returns a sample every 10 seconds.
+	virtual void startOnDemandFetchHistory(
+	  const ItemInfo &itemInfo, const time_t &beginTime,
+	  const time_t &endTime, Closure1<HistoryInfoVect> *closure) override
+	{
+		requestedRanges.push_back(
+		  HistoryCache::TimeRange(beginTime, endTime));
+		HistoryInfoVect historyInfoVect;
+		for (time_t t = (beginTime + 9) / 10 * 10; t <= endTime;
+		     t += 10) {
+			historyInfoVect.push_back(
+			  makeHistoryInfo(itemInfo.id, t));
+		}
+		(*closure)(historyInfoVect);
+		delete closure;
+	}
+
+	static HistoryInfo makeHistoryInfo(const ItemIdType &itemId,
+	                                   const time_t &time)
+	{
+		HistoryInfo historyInfo;
+		historyInfo.serverId = TEST_SERVER_ID;
+		historyInfo.itemId = itemId;
+		historyInfo.value = StringUtils::sprintf("%ld", time);
+		historyInfo.clock.tv_sec = time;
+		historyInfo.clock.tv_nsec = 0;
+		return historyInfo;
+	}
+
+private:
+	MonitoringServerInfo m_serverInfo;
+	ArmStatus            m_armStatus;
+};
+
+struct TestClosure : public Closure1<HistoryInfoVect> {
+	HistoryInfoVect &result;
+	bool            &called;
+
+	TestClosure(HistoryInfoVect &_result, bool &_called)
+	: result(_result),
+	  called(_called)
+	{
+	}
+
+	virtual void operator()(const HistoryInfoVect &historyInfoVect)
+	  override
+	{
+		result = historyInfoVect;
+		called = true;
+	}
+};
+
+static HistoryInfoVect makeSamples(const ItemIdType &itemId,
+                                   const time_t &beginTime,
+                                   const time_t &endTime)
+{
+	HistoryInfoVect historyInfoVect;
+	for (time_t t = beginTime; t <= endTime; t += 10) {
+		historyInfoVect.push_back(
+		  TestDataStore::makeHistoryInfo(itemId, t));
+	}
+	return historyInfoVect;
+}
+
+static string makeClockList(const HistoryInfoVect &historyInfoVect)
+{
+	string list;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it)
+		list += StringUtils::sprintf("%ld,", it->clock.tv_sec);
+	return list;
+}
+
+static string makeRangeList(const HistoryCache::TimeRangeVect &ranges)
+{
+	string list;
+	HistoryCache::TimeRangeVectConstIterator it = ranges.begin();
+	for (; it != ranges.end(); ++it)
+		list += StringUtils::sprintf("%ld-%ld,",
+		                             it->beginTime, it->endTime);
+	return list;
+}
+
+static void addSamples(const ItemIdType &itemId,
+                       const time_t &beginTime, const time_t &endTime)
+{
+	HistoryCache::getInstance()->add(
+	  TEST_SERVER_ID, itemId, beginTime, endTime, TEST_FETCH_TIME,
+	  makeSamples(itemId, beginTime, endTime));
+}
+
+static void assertGet(const string &expectedClocks,
+                      const string &expectedMissingRanges,
+                      const ItemIdType &itemId,
+                      const time_t &beginTime, const time_t &endTime)
+{
+	HistoryInfoVect historyInfoVect;
+	HistoryCache::TimeRangeVect missingRanges;
+	HistoryCache::getInstance()->get(historyInfoVect, missingRanges,
+	                                 TEST_SERVER_ID, itemId,
+	                                 beginTime, endTime);
+	cppcut_assert_equal(expectedClocks, makeClockList(historyInfoVect));
+	cppcut_assert_equal(expectedMissingRanges,
+	                    makeRangeList(missingRanges));
+}
+
+void cut_setup(void)
+{
+	HistoryCache::reset();
+}
+
+void cut_teardown(void)
+{
+	HistoryCache::reset();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_getWithoutEntry(void)
+{
+	assertGet("", "100-200,", "1", 100, 200);
+}
+
+void test_getCoveredRange(void)
+{
+	addSamples("1", 100, 200);
+	assertGet("120,130,140,", "", "1", 120, 140);
+}
+
+void test_getMissingRanges(void)
+{
+	addSamples("1", 100, 200);
+	addSamples("1", 300, 400);
+	assertGet("100,110,120,130,140,150,160,170,180,190,200,"
+	          "300,310,320,330,340,350,360,370,380,390,400,",
+	          "50-99,201-299,401-500,", "1", 50, 500);
+}
+
+void test_mergeAdjacentRanges(void)
+{
+	addSamples("1", 100, 150);
+	addSamples("1", 151, 200);
+	assertGet("100,110,120,130,140,150,160,170,180,190,200,", "",
+	          "1", 100, 200);
+}
+
+void test_replaceSamples(void)
+{
+	addSamples("1", 100, 200);
+	HistoryInfoVect samples;
+	samples.push_back(TestDataStore::makeHistoryInfo("1", 155));
+	HistoryCache::getInstance()->add(TEST_SERVER_ID, "1", 150, 160,
+	                                 TEST_FETCH_TIME, samples);
+	assertGet("140,155,170,", "", "1", 140, 170);
+}
+
+void test_replaceSamplesOverBlocks(void)
+{
+	// The samples are split into some blocks.
+	const time_t endTime =
+	  HistoryCache::MAX_SAMPLES_PER_BLOCK * 10 * 3;
+	addSamples("1", 0, endTime);
+	HistoryInfoVect samples;
+	samples.push_back(TestDataStore::makeHistoryInfo("1", 5115));
+	HistoryCache::getInstance()->add(TEST_SERVER_ID, "1", 5000, 5200,
+	                                 TEST_FETCH_TIME, samples);
+	assertGet("4990,5115,5210,", "", "1", 4990, 5210);
+
+	HistoryInfoVect historyInfoVect;
+	HistoryCache::TimeRangeVect missingRanges;
+	HistoryCache::getInstance()->get(historyInfoVect, missingRanges,
+	                                 TEST_SERVER_ID, "1", 0, endTime);
+	cppcut_assert_equal(static_cast<size_t>(endTime / 10 + 1 - 20),
+	                    historyInfoVect.size());
+	cppcut_assert_equal(static_cast<time_t>(0),
+	                    historyInfoVect.front().clock.tv_sec);
+	cppcut_assert_equal(endTime, historyInfoVect.back().clock.tv_sec);
+}
+
+void test_recentRangeIsNotCovered(void)
+{
+	const time_t endTime = TEST_FETCH_TIME;
+	const time_t coveredEnd = endTime - HistoryCache::RECENT_MARGIN_SEC;
+	HistoryCache::getInstance()->add(
+	  TEST_SERVER_ID, "1", endTime - 100, endTime, TEST_FETCH_TIME,
+	  makeSamples("1", endTime - 100, endTime));
+	const string expectedMissingRanges =
+	  StringUtils::sprintf("%ld-%ld,", coveredEnd + 1, endTime);
+	HistoryInfoVect historyInfoVect;
+	HistoryCache::TimeRangeVect missingRanges;
+	HistoryCache::getInstance()->get(historyInfoVect, missingRanges,
+	                                 TEST_SERVER_ID, "1",
+	                                 endTime - 100, endTime);
+	cppcut_assert_equal(expectedMissingRanges,
+	                    makeRangeList(missingRanges));
+	cppcut_assert_equal(coveredEnd, historyInfoVect.back().clock.tv_sec);
+}
+
+void test_evictLeastRecentlyUsed(void)
+{
+	HistoryCache *historyCache = HistoryCache::getInstance();
+	addSamples("1", 100, 200);
+	const size_t entrySize = historyCache->getMemorySize();
+	addSamples("2", 100, 200);
+	cppcut_assert_equal(static_cast<size_t>(2),
+	                    historyCache->getNumberOfEntries());
+
+	// "1" becomes the most recently used one.
+	assertGet("100,", "", "1", 100, 100);
+	historyCache->setMaxMemorySize(entrySize * 2);
+	addSamples("3", 100, 200);
+	cppcut_assert_equal(static_cast<size_t>(2),
+	                    historyCache->getNumberOfEntries());
+	assertGet("100,", "", "1", 100, 100);
+	assertGet("", "100-100,", "2", 100, 100);
+	assertGet("100,", "", "3", 100, 100);
+	cppcut_assert_equal(true, historyCache->getMemorySize() <=
+	                          historyCache->getMaxMemorySize());
+}
+
+void test_invalidate(void)
+{
+	HistoryCache *historyCache = HistoryCache::getInstance();
+	addSamples("1", 100, 200);
+	historyCache->add(TEST_SERVER_ID + 1, "1", 100, 200, TEST_FETCH_TIME,
+	                  makeSamples("1", 100, 200));
+	historyCache->invalidate(TEST_SERVER_ID);
+	cppcut_assert_equal(static_cast<size_t>(1),
+	                    historyCache->getNumberOfEntries());
+	assertGet("", "100-200,", "1", 100, 200);
+}
+
+void test_fetchOnlyMissingRanges(void)
+{
+	addSamples("1", 100, 200);
+	TestDataStore *dataStore = new TestDataStore();
+	DataStorePtr dataStorePtr(dataStore, false);
+	ItemInfo itemInfo;
+	itemInfo.serverId = TEST_SERVER_ID;
+	itemInfo.id = "1";
+
+	HistoryInfoVect result;
+	bool called = false;
+	HistoryCache::getInstance()->fetch(dataStorePtr, itemInfo, 50, 250,
+	                                   new TestClosure(result, called));
+	cppcut_assert_equal(true, called);
+	cppcut_assert_equal(string("50-99,201-250,"),
+	                    makeRangeList(dataStore->requestedRanges));
+	cppcut_assert_equal(makeClockList(makeSamples("1", 50, 250)),
+	                    makeClockList(result));
+
+	// The fetched ranges are served from the cache.
+	dataStore->requestedRanges.clear();
+	called = false;
+	HistoryCache::getInstance()->fetch(dataStorePtr, itemInfo, 60, 240,
+	                                   new TestClosure(result, called));
+	cppcut_assert_equal(true, called);
+	cppcut_assert_equal(true, dataStore->requestedRanges.empty());
+	cppcut_assert_equal(makeClockList(makeSamples("1", 60, 240)),
+	                    makeClockList(result));
+}
+
+} // namespace testHistoryCache
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "HostIdBitmap.h"
+using namespace std;
+
+namespace testHostIdBitmap {
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_add(void)
+{
+	HostIdBitmap bitmap;
+	cppcut_assert_equal(true, bitmap.empty());
+	bitmap.add(5);
+	bitmap.add(70000);
+	bitmap.add(5);
+	cppcut_assert_equal(false, bitmap.empty());
+	cppcut_assert_equal((size_t)2, bitmap.size());
+	cppcut_assert_equal(true, bitmap.contains(5));
+	cppcut_assert_equal(true, bitmap.contains(70000));
+	cppcut_assert_equal(false, bitmap.contains(6));
+	cppcut_assert_equal(false, bitmap.contains(65541));
+}
+
+void test_clear(void)
+{
+	HostIdBitmap bitmap;
+	bitmap.add(5);
+	bitmap.clear();
+	cppcut_assert_equal(true, bitmap.empty());
+	cppcut_assert_equal(false, bitmap.contains(5));
+}
+
+void test_convertToBitset(void)
+{
+	HostIdBitmap bitmap;
+	const size_t maxSize = HostIdBitmap::MAX_ARRAY_CONTAINER_SIZE;
+	for (HostIdType hostId = 0; hostId < maxSize; hostId++)
+		bitmap.add(hostId * 2);
+	cppcut_assert_equal((size_t)0, bitmap.getNumberOfBitsetContainers());
+
+	bitmap.add(maxSize * 2);
+	cppcut_assert_equal((size_t)1, bitmap.getNumberOfBitsetContainers());
+	cppcut_assert_equal(maxSize + 1, bitmap.size());
+	cppcut_assert_equal(true, bitmap.contains(maxSize * 2));
+	cppcut_assert_equal(true, bitmap.contains(2));
+	cppcut_assert_equal(false, bitmap.contains(3));
+}
+
+void test_getRanges(void)
+{
+	HostIdBitmap bitmap;
+	bitmap.add(3);
+	bitmap.add(1);
+	bitmap.add(2);
+	bitmap.add(10);
+	for (HostIdType hostId = 65530; hostId < 65545; hostId++)
+		bitmap.add(hostId);
+
+	HostIdRangeVect ranges;
+	bitmap.getRanges(ranges);
+	cppcut_assert_equal((size_t)3, ranges.size());
+	cppcut_assert_equal((HostIdType)1, ranges[0].first);
+	cppcut_assert_equal((HostIdType)3, ranges[0].second);
+	cppcut_assert_equal((HostIdType)10, ranges[1].first);
+	cppcut_assert_equal((HostIdType)10, ranges[1].second);
+	cppcut_assert_equal((HostIdType)65530, ranges[2].first);
+	cppcut_assert_equal((HostIdType)65544, ranges[2].second);
+}
+
+void test_getRangesFromBitset(void)
+{
+	HostIdBitmap bitmap;
+	const HostIdType numHosts = HostIdBitmap::MAX_ARRAY_CONTAINER_SIZE + 1;
+	for (HostIdType hostId = 100; hostId < 100 + numHosts; hostId++)
+		bitmap.add(hostId);
+	cppcut_assert_equal((size_t)1, bitmap.getNumberOfBitsetContainers());
+
+	HostIdRangeVect ranges;
+	bitmap.getRanges(ranges);
+	cppcut_assert_equal((size_t)1, ranges.size());
+	cppcut_assert_equal((HostIdType)100, ranges[0].first);
+	cppcut_assert_equal(100 + numHosts - 1, ranges[0].second);
+}
+
+} // namespace testHostIdBitmap
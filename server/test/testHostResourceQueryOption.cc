@@ -711,4 +711,64 @@ void test_makeConditionComplicated(void)
 	assertMakeCondition(srvHostGrpSetMap, expect);
 }
 
+void test_makeConditionWithHostIdBitmap(void)
+{
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	srvHostGrpSetMap[5].insert("205");
+	srvHostGrpSetMap[14].insert(ALL_HOST_GROUPS);
+	srvHostGrpSetMap[768].insert("817");
+
+	ServerHostIdBitmapMap hostIdBitmapMap;
+	for (HostIdType hostId = 10; hostId <= 20; hostId++)
+		hostIdBitmapMap[5].add(hostId);
+	hostIdBitmapMap[5].add(30);
+	hostIdBitmapMap[5].add(32);
+	hostIdBitmapMap[768].add(100);
+
+	const string globalHostIdColumnName = "global_host_id";
+	string expect = StringUtils::sprintf(
+	  "((%s=5 AND (%s BETWEEN 10 AND 20 OR %s IN (30,32))) OR "
+	  "%s=14 OR "
+	  "(%s=768 AND %s IN (100)))",
+	  serverIdColumnName.c_str(),
+	  globalHostIdColumnName.c_str(), globalHostIdColumnName.c_str(),
+	  serverIdColumnName.c_str(),
+	  serverIdColumnName.c_str(), globalHostIdColumnName.c_str());
+
+	TestHostResourceQueryOption option;
+	cppcut_assert_equal(expect,
+	  option.callMakeConditionWithHostIdBitmap(
+	    srvHostGrpSetMap, hostIdBitmapMap, serverIdColumnName,
+	    globalHostIdColumnName, hostIdColumnName));
+}
+
+void test_makeConditionWithHostIdBitmapWithoutMember(void)
+{
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	srvHostGrpSetMap[5].insert("205");
+	ServerHostIdBitmapMap hostIdBitmapMap;
+
+	TestHostResourceQueryOption option;
+	cppcut_assert_equal(DBHatohol::getAlwaysFalseCondition(),
+	  option.callMakeConditionWithHostIdBitmap(
+	    srvHostGrpSetMap, hostIdBitmapMap, serverIdColumnName,
+	    "global_host_id", hostIdColumnName));
+}
+
+void test_defaultAuthorizationStrategy(void)
+{
+	HostResourceQueryOption option(TEST_SYNAPSE);
+	cppcut_assert_equal(
+	  HostResourceQueryOption::AUTHORIZATION_STRATEGY_AUTO,
+	  option.getAuthorizationStrategy());
+}
+
+void test_isHostIdBitmapUsedWithoutGlobalHostIdColumn(void)
+{
+	HostResourceQueryOption option(TEST_SYNAPSE);
+	option.setAuthorizationStrategy(
+	  HostResourceQueryOption::AUTHORIZATION_STRATEGY_HOST_ID_BITMAP);
+	cppcut_assert_equal(false, option.isHostIdBitmapUsed());
+}
+
 } // namespace testHostResourceQueryOptionWithoutDBSetup
@@ -415,6 +415,22 @@ void test_eventQueryOptionWithTriggerStatus(gconstpointer data)
 	cppcut_assert_equal(expected, option.getCondition());
 }
 
+void data_eventQueryOptionWithTimeRange(void)
+{
+	prepareTestDataForFilterForDataOfDefunctServers();
+}
+
+void test_eventQueryOptionWithTimeRange(gconstpointer data)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	option.setTimeRange(1000, 2000);
+	string expected = "time_sec>=1000 AND time_sec<=2000";
+	fixupForFilteringDefunctServer(data, expected, option);
+	cppcut_assert_equal(static_cast<time_t>(1000), option.getBeginTime());
+	cppcut_assert_equal(static_cast<time_t>(2000), option.getEndTime());
+	cppcut_assert_equal(expected, option.getCondition());
+}
+
 void data_eventQueryOptionGetServerIdColumnName(void)
 {
 	prepareTestDataForFilterForDataOfDefunctServers();
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "HotEventRing.h"
+#include "ThreadLocalDBCache.h"
+#include "ConfigManager.h"
+#include "Hatohol.h"
+#include "Helpers.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testHotEventRing {
+
+static string makeUnifiedIdList(const EventInfoList &eventInfoList)
+{
+	string list;
+	EventInfoListConstIterator it = eventInfoList.begin();
+	for (; it != eventInfoList.end(); ++it)
+		list += StringUtils::sprintf("%" FMT_UNIFIED_EVENT_ID ",",
+		                             it->unifiedId);
+	return list;
+}
+
+static void assertServedAsDB(const EventsQueryOption &option,
+                             const bool &expectServed = true)
+{
+	EventInfoList actual;
+	const bool served =
+	  HotEventRing::getInstance()->getEventInfoList(actual, option);
+	cppcut_assert_equal(expectServed, served);
+	if (!served)
+		return;
+
+	EventInfoList expected;
+	ThreadLocalDBCache cache;
+	assertHatoholError(
+	  HTERR_OK,
+	  cache.getMonitoring().getEventInfoList(expected, option));
+	cppcut_assert_equal(makeUnifiedIdList(expected),
+	                    makeUnifiedIdList(actual));
+}
+
+static void setupOption(EventsQueryOption &option,
+                        const EventsQueryOption::SortType &sortType,
+                        const size_t &limit, const size_t &offset = 0)
+{
+	option.setSortType(sortType, DataQueryOption::SORT_DESCENDING);
+	option.setMaximumNumber(limit);
+	option.setOffset(offset);
+}
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBTablesConfig();
+	loadTestDBTablesUser();
+	loadTestDBEvents();
+}
+
+void cut_teardown(void)
+{
+	HotEventRing::getInstance()->setCapacity(
+	  HotEventRing::DEFAULT_CAPACITY);
+	ConfigManager::getInstance()->setEventRetentionDays(0);
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void data_getEventInfoList(void)
+{
+	gcut_add_datum("Unified ID",
+	               "sortType", G_TYPE_INT, EventsQueryOption::SORT_UNIFIED_ID,
+	               NULL);
+	gcut_add_datum("Time",
+	               "sortType", G_TYPE_INT, EventsQueryOption::SORT_TIME,
+	               NULL);
+}
+
+void test_getEventInfoList(gconstpointer data)
+{
+	const EventsQueryOption::SortType sortType =
+	  static_cast<EventsQueryOption::SortType>(
+	    gcut_data_get_int(data, "sortType"));
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, sortType, 3, 1);
+	assertServedAsDB(option);
+	cppcut_assert_equal(true, HotEventRing::getInstance()->isLoaded(
+	                            testEventInfo[0].serverId));
+}
+
+void data_getEventInfoListWithSmallCapacity(void)
+{
+	data_getEventInfoList();
+}
+
+void test_getEventInfoListWithSmallCapacity(gconstpointer data)
+{
+	const EventsQueryOption::SortType sortType =
+	  static_cast<EventsQueryOption::SortType>(
+	    gcut_data_get_int(data, "sortType"));
+	HotEventRing::getInstance()->setCapacity(2);
+	EventsQueryOption option(USER_ID_SYSTEM);
+	option.setTargetServerId(testEventInfo[0].serverId);
+
+	// The results have to be the same as the DB if they are served.
+	setupOption(option, sortType, 1);
+	EventInfoList eventInfoList;
+	if (HotEventRing::getInstance()->getEventInfoList(eventInfoList,
+	                                                  option))
+		assertServedAsDB(option);
+
+	setupOption(option, sortType, 2, 1);
+	assertServedAsDB(option, false);
+}
+
+void test_getEventInfoListWithFilter(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, EventsQueryOption::SORT_TIME, 5);
+	option.setMinimumSeverity(TRIGGER_SEVERITY_WARNING);
+	option.setTriggerStatus(TRIGGER_STATUS_PROBLEM);
+	assertServedAsDB(option);
+}
+
+void test_addEventInfo(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, EventsQueryOption::SORT_UNIFIED_ID, 3);
+	assertServedAsDB(option);
+
+	EventInfo eventInfo = testEventInfo[0];
+	eventInfo.id = "hot-event-ring-test";
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addEventInfo(&eventInfo);
+
+	// The ring is updated without reloading.
+	cppcut_assert_equal(true, HotEventRing::getInstance()->isLoaded(
+	                            eventInfo.serverId));
+	EventInfoList eventInfoList;
+	cppcut_assert_equal(true,
+	  HotEventRing::getInstance()->getEventInfoList(eventInfoList, option));
+	cppcut_assert_equal(eventInfo.unifiedId,
+	                    eventInfoList.front().unifiedId);
+	assertServedAsDB(option);
+}
+
+void test_ascendingOrderIsNotServed(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	option.setSortType(EventsQueryOption::SORT_UNIFIED_ID,
+	                   DataQueryOption::SORT_ASCENDING);
+	option.setMaximumNumber(3);
+	assertServedAsDB(option, false);
+}
+
+void test_withoutLimitIsNotServed(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, EventsQueryOption::SORT_UNIFIED_ID,
+	            DataQueryOption::NO_LIMIT);
+	assertServedAsDB(option, false);
+}
+
+void test_targetHostgroupIsNotServed(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, EventsQueryOption::SORT_UNIFIED_ID, 3);
+	option.setTargetHostgroupId("1");
+	assertServedAsDB(option, false);
+}
+
+void test_timeRangeIsNotServed(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, EventsQueryOption::SORT_TIME, 3);
+	option.setTimeRange(testEventInfo[0].time.tv_sec,
+	                    testEventInfo[0].time.tv_sec);
+	assertServedAsDB(option, false);
+
+	option.setTimeRange(0, testEventInfo[0].time.tv_sec);
+	assertServedAsDB(option, false);
+}
+
+void test_purgedEventsAreNotServed(void)
+{
+	EventsQueryOption option(USER_ID_SYSTEM);
+	setupOption(option, EventsQueryOption::SORT_UNIFIED_ID, 3);
+	assertServedAsDB(option);
+
+	// All the test events are older than the retention period.
+	const time_t now = time(NULL) + DBAgent::TIME_PARTITION_SEC * 30;
+	ConfigManager::getInstance()->setEventRetentionDays(1);
+	struct callgate : public DBTablesMonitoring {
+		static void rotate(DBTablesMonitoring &dbMonitoring,
+		                   const time_t &now)
+		{
+			(dbMonitoring.*
+			  &callgate::rotateEventPartitions)(now);
+		}
+	};
+	ThreadLocalDBCache cache;
+	callgate::rotate(cache.getMonitoring(), now);
+
+	cppcut_assert_equal(false, HotEventRing::getInstance()->isLoaded(
+	                             testEventInfo[0].serverId));
+	EventInfoList eventInfoList;
+	cppcut_assert_equal(true,
+	  HotEventRing::getInstance()->getEventInfoList(eventInfoList, option));
+	cppcut_assert_equal(static_cast<size_t>(0), eventInfoList.size());
+	assertServedAsDB(option);
+}
+
+} // namespace testHotEventRing
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "IngestionQueue.h"
+#include "UnifiedDataStore.h"
+#include "ThreadLocalDBCache.h"
+#include "Hatohol.h"
+#include "Helpers.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testIngestionQueue {
+
+static void assertNumberOfRows(const string &tableName, const size_t &expected)
+{
+	ThreadLocalDBCache cache;
+	assertDBContent(&cache.getMonitoring().getDBAgent(),
+	                "select count(*) from " + tableName,
+	                StringUtils::sprintf("%zd", expected));
+}
+
+static void addTestEventsOneByOne(void)
+{
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	for (size_t i = 0; i < NumTestEventInfo; i++) {
+		EventInfoList eventList;
+		eventList.push_back(testEventInfo[i]);
+		ingestionQueue->addEventList(eventList);
+	}
+}
+
+static void addTestItems(void)
+{
+	ItemInfoList itemList;
+	for (size_t i = 0; i < NumTestItemInfo; i++)
+		itemList.push_back(testItemInfo[i]);
+	IngestionQueue::getInstance()->addItemList(itemList);
+}
+
+// An action is run for every new event. It fails soon because
+// the command doesn't exist, but leaves an action log.
+static void addActionForAllEvents(void)
+{
+	ActionDef actDef = {
+	  0,                      // id (this field is ignored)
+	  ActionCondition(),      // condition
+	  ACTION_COMMAND,         // type
+	  "",                     // working dir
+	  "non-existing-command-for-ingestion-queue", // command
+	  0,                      // timeout
+	  1,                      // ownerUserId
+	};
+	ThreadLocalDBCache cache;
+	OperationPrivilege privilege(USER_ID_SYSTEM);
+	cache.getAction().addAction(actDef, privilege);
+}
+
+static void addNewEvent(void)
+{
+	EventInfo eventInfo = testEventInfo[0];
+	eventInfo.time.tv_sec = time(NULL);
+	EventInfoList eventList;
+	eventList.push_back(eventInfo);
+	IngestionQueue::getInstance()->addEventList(eventList);
+}
+
+struct CommittedCb : public Closure1<bool> {
+	vector<bool> &results;
+
+	CommittedCb(vector<bool> &_results)
+	: results(_results)
+	{
+	}
+
+	virtual void operator()(const bool &committed) override
+	{
+		results.push_back(committed);
+	}
+};
+
+// The events are added through UnifiedDataStore one by one as an arm does.
+static void addTestEventsOfServer(const ServerIdType &serverId,
+                                  vector<bool> &results)
+{
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	for (size_t i = 0; i < NumTestEventInfo; i++) {
+		if (testEventInfo[i].serverId != serverId)
+			continue;
+		EventInfoList eventList;
+		eventList.push_back(testEventInfo[i]);
+		dataStore->addEventList(eventList, new CommittedCb(results));
+	}
+}
+
+static size_t countTestEventsOfServer(const ServerIdType &serverId)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < NumTestEventInfo; i++) {
+		if (testEventInfo[i].serverId == serverId)
+			count++;
+	}
+	return count;
+}
+
+static void dropTable(const string &tableName)
+{
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().getDBAgent().dropTable(tableName);
+}
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+}
+
+void cut_teardown(void)
+{
+	IngestionQueue::reset();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_groupCommit(void)
+{
+	addTestEventsOneByOne();
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	ingestionQueue->start(1);
+	ingestionQueue->flush();
+
+	IngestionQueue::Stats stats;
+	ingestionQueue->getStats(stats);
+	cppcut_assert_equal(NumTestEventInfo, stats.numEnqueued);
+	cppcut_assert_equal(NumTestEventInfo, stats.numCommitted);
+	cppcut_assert_equal((size_t)0, stats.numDropped);
+	cppcut_assert_equal((size_t)0, stats.queueDepth);
+	cppcut_assert_equal(NumTestEventInfo, stats.maxQueueDepth);
+	cppcut_assert_equal((size_t)1, stats.numTransactions);
+	assertNumberOfRows("events", NumTestEventInfo);
+}
+
+void test_flushWithoutWriters(void)
+{
+	ItemInfoList itemList;
+	for (size_t i = 0; i < NumTestItemInfo; i++)
+		itemList.push_back(testItemInfo[i]);
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	ingestionQueue->addItemList(itemList);
+	assertNumberOfRows("items", 0);
+
+	ingestionQueue->flush();
+	IngestionQueue::Stats stats;
+	ingestionQueue->getStats(stats);
+	cppcut_assert_equal((size_t)1, stats.numCommitted);
+	cppcut_assert_equal((size_t)0, stats.queueDepth);
+	assertNumberOfRows("items", NumTestItemInfo);
+}
+
+void test_useLatestServerStatus(void)
+{
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	MonitoringServerStatus serverStatus;
+	serverStatus.serverId = 1;
+	serverStatus.nvps = 1.0;
+	ingestionQueue->addMonitoringServerStatus(serverStatus);
+	serverStatus.nvps = 2.0;
+	ingestionQueue->addMonitoringServerStatus(serverStatus);
+	ingestionQueue->flush();
+
+	IngestionQueue::Stats stats;
+	ingestionQueue->getStats(stats);
+	cppcut_assert_equal((size_t)2, stats.numCommitted);
+	cppcut_assert_equal((size_t)1, stats.numTransactions);
+	assertNumberOfRows("server_status", 1);
+}
+
+void test_boundedQueue(void)
+{
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	const size_t maxQueueSize = 1;
+	ingestionQueue->start(2, maxQueueSize);
+	addTestEventsOneByOne();
+	ingestionQueue->flush();
+
+	IngestionQueue::Stats stats;
+	ingestionQueue->getStats(stats);
+	cppcut_assert_equal(maxQueueSize, stats.maxQueueSize);
+	cppcut_assert_equal(maxQueueSize, stats.maxQueueDepth);
+	cppcut_assert_equal(NumTestEventInfo, stats.numCommitted);
+	cppcut_assert_equal((size_t)0, stats.queueDepth);
+	assertNumberOfRows("events", NumTestEventInfo);
+}
+
+void test_stopAfterWritingAll(void)
+{
+	addTestEventsOneByOne();
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	ingestionQueue->start(2);
+	ingestionQueue->stop();
+	cppcut_assert_equal(false, ingestionQueue->isStarted());
+	assertNumberOfRows("events", NumTestEventInfo);
+}
+
+void test_writeOneByOneAfterFailure(void)
+{
+	// The events are written with the items in a transaction at first.
+	addTestEventsOneByOne();
+	addTestItems();
+	dropTable("items");
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	ingestionQueue->flush();
+
+	// The events aren't duplicated by the retry.
+	IngestionQueue::Stats stats;
+	ingestionQueue->getStats(stats);
+	cppcut_assert_equal(NumTestEventInfo, stats.numCommitted);
+	cppcut_assert_equal((size_t)1, stats.numDropped);
+	cppcut_assert_equal((size_t)0, stats.queueDepth);
+	assertNumberOfRows("events", NumTestEventInfo);
+}
+
+void test_runActionsAfterCommit(void)
+{
+	addActionForAllEvents();
+	addNewEvent();
+	const string actionLogTableName =
+	  DBTablesAction::getTableNameActionLogs();
+	assertNumberOfRows(actionLogTableName, 0);
+
+	IngestionQueue::getInstance()->flush();
+	assertNumberOfRows("events", 1);
+	assertNumberOfRows(actionLogTableName, 1);
+}
+
+void test_runActionsForEventsWrittenOneByOne(void)
+{
+	addActionForAllEvents();
+	addNewEvent();
+	addTestItems();
+	dropTable("items");
+	IngestionQueue::getInstance()->flush();
+	assertNumberOfRows("events", 1);
+	assertNumberOfRows(DBTablesAction::getTableNameActionLogs(), 1);
+}
+
+void test_noActionsForDroppedEvents(void)
+{
+	addActionForAllEvents();
+	addNewEvent();
+	dropTable("events");
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	ingestionQueue->flush();
+
+	IngestionQueue::Stats stats;
+	ingestionQueue->getStats(stats);
+	cppcut_assert_equal((size_t)0, stats.numCommitted);
+	cppcut_assert_equal((size_t)1, stats.numDropped);
+	assertNumberOfRows(DBTablesAction::getTableNameActionLogs(), 0);
+}
+
+void test_flushServerBeforeReadingLastEventId(void)
+{
+	const ServerIdType serverId = testEventInfo[0].serverId;
+	IngestionQueue::getInstance()->start(2);
+	vector<bool> results;
+	addTestEventsOfServer(serverId, results);
+
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	cppcut_assert_equal(true, dataStore->flushIngestion(serverId));
+	cppcut_assert_equal(countTestEventsOfServer(serverId), results.size());
+	for (size_t i = 0; i < results.size(); i++)
+		cppcut_assert_equal(true, (bool)results[i]);
+
+	ThreadLocalDBCache cache;
+	cppcut_assert_equal(findLastEventId(serverId),
+	                    cache.getMonitoring().getMaxEventId(serverId));
+}
+
+void test_flushServerReportsDroppedEvents(void)
+{
+	const ServerIdType serverId = testEventInfo[0].serverId;
+	dropTable("events");
+	IngestionQueue::getInstance()->start(1);
+	vector<bool> results;
+	addTestEventsOfServer(serverId, results);
+
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	cppcut_assert_equal(false, dataStore->flushIngestion(serverId));
+	cppcut_assert_equal(countTestEventsOfServer(serverId), results.size());
+	for (size_t i = 0; i < results.size(); i++)
+		cppcut_assert_equal(false, (bool)results[i]);
+
+	// The drop is reported only once.
+	cppcut_assert_equal(true, dataStore->flushIngestion(serverId));
+}
+
+void test_flushServerDoesNotReportDropOfOtherServers(void)
+{
+	const ServerIdType serverId = testEventInfo[0].serverId;
+	MonitoringServerStatus serverStatus;
+	serverStatus.serverId = serverId + 1;
+	serverStatus.nvps = 1.0;
+	dropTable("server_status");
+	IngestionQueue *ingestionQueue = IngestionQueue::getInstance();
+	ingestionQueue->start(1);
+	ingestionQueue->addMonitoringServerStatus(serverStatus);
+	vector<bool> results;
+	addTestEventsOfServer(serverId, results);
+	ingestionQueue->flush();
+
+	UnifiedDataStore *dataStore = UnifiedDataStore::getInstance();
+	cppcut_assert_equal(true, dataStore->flushIngestion(serverId));
+	cppcut_assert_equal(false,
+	                    dataStore->flushIngestion(serverStatus.serverId));
+}
+
+} // namespace testIngestionQueue
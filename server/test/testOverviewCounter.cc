@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "OverviewCounter.h"
+#include "DataQueryContext.h"
+#include "ThreadLocalDBCache.h"
+#include "Hatohol.h"
+#include "Helpers.h"
+#include "DBTablesTest.h"
+using namespace std;
+
+namespace testOverviewCounter {
+
+static void assertTriggerCounts(const ServerIdType &serverId,
+                                const HostgroupIdType &hostgroupId)
+{
+	DataQueryContextPtr dqctx(new DataQueryContext(USER_ID_SYSTEM), false);
+	OverviewCounter::TriggerCounts counts;
+	cppcut_assert_equal(true,
+	  OverviewCounter::getInstance()->getTriggerCounts(
+	    counts, *dqctx, serverId, hostgroupId));
+
+	ThreadLocalDBCache cache;
+	DBTablesMonitoring &dbMonitoring = cache.getMonitoring();
+	TriggersQueryOption option(USER_ID_SYSTEM);
+	option.setExcludeFlags(EXCLUDE_INVALID_HOST|EXCLUDE_SELF_MONITORING);
+	option.setTargetServerId(serverId);
+	option.setTargetHostgroupId(hostgroupId);
+	cppcut_assert_equal(dbMonitoring.getNumberOfTriggers(option),
+	                    counts.numTriggers);
+	cppcut_assert_equal(
+	  dbMonitoring.getNumberOfBadTriggers(option, TRIGGER_SEVERITY_ALL),
+	  counts.getNumberOfBadTriggers(TRIGGER_SEVERITY_ALL));
+	for (int severity = 0; severity < NUM_TRIGGER_SEVERITY; severity++) {
+		const TriggerSeverityType sev = (TriggerSeverityType)severity;
+		cppcut_assert_equal(
+		  dbMonitoring.getNumberOfBadTriggers(option, sev),
+		  counts.getNumberOfBadTriggers(sev));
+	}
+	cppcut_assert_equal(dbMonitoring.getNumberOfBadHosts(option),
+	                    counts.numBadHosts);
+	cppcut_assert_equal(dbMonitoring.getNumberOfGoodHosts(option),
+	                    counts.getNumberOfGoodHosts());
+}
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBTablesConfig();
+	loadTestDBTablesUser();
+	loadTestDBTriggers();
+	loadTestDBItems();
+	loadTestDBHostgroupMember();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_getTriggerCounts(void)
+{
+	assertTriggerCounts(testTriggerInfo[0].serverId, ALL_HOST_GROUPS);
+	cppcut_assert_equal(true, OverviewCounter::getInstance()->isLoaded(
+	                            testTriggerInfo[0].serverId));
+}
+
+void test_getTriggerCountsOfHostgroup(void)
+{
+	const HostgroupMember &member = testHostgroupMember[0];
+	assertTriggerCounts(member.serverId, member.hostgroupIdInServer);
+}
+
+void test_addTriggerInfo(void)
+{
+	const ServerIdType serverId = testTriggerInfo[0].serverId;
+	assertTriggerCounts(serverId, ALL_HOST_GROUPS);
+
+	TriggerInfo triggerInfo = testTriggerInfo[0];
+	triggerInfo.id = "overview-test-trigger";
+	triggerInfo.status = TRIGGER_STATUS_PROBLEM;
+	triggerInfo.validity = TRIGGER_VALID;
+	ThreadLocalDBCache cache;
+	cache.getMonitoring().addTriggerInfo(&triggerInfo);
+
+	// The counter is updated without reloading.
+	cppcut_assert_equal(true,
+	                    OverviewCounter::getInstance()->isLoaded(serverId));
+	assertTriggerCounts(serverId, ALL_HOST_GROUPS);
+
+	// Toggle the status
+	triggerInfo.status = TRIGGER_STATUS_OK;
+	cache.getMonitoring().addTriggerInfo(&triggerInfo);
+	assertTriggerCounts(serverId, ALL_HOST_GROUPS);
+}
+
+void test_getNumberOfItems(void)
+{
+	const ServerIdType serverId = testItemInfo[0].serverId;
+	DataQueryContextPtr dqctx(new DataQueryContext(USER_ID_SYSTEM), false);
+	OverviewCounter *counter = OverviewCounter::getInstance();
+	size_t numItems = 0;
+	cppcut_assert_equal(true,
+	  counter->getNumberOfItems(numItems, *dqctx, serverId));
+
+	ThreadLocalDBCache cache;
+	ItemsQueryOption option(USER_ID_SYSTEM);
+	option.setTargetServerId(serverId);
+	const size_t expected = cache.getMonitoring().getNumberOfItems(option);
+	cppcut_assert_equal(expected, numItems);
+
+	ItemInfo itemInfo = testItemInfo[0];
+	itemInfo.id = "overview-test-item";
+	cache.getMonitoring().addItemInfo(&itemInfo);
+	cppcut_assert_equal(true,
+	  counter->getNumberOfItems(numItems, *dqctx, serverId));
+	cppcut_assert_equal(expected + 1, numItems);
+}
+
+void test_getTriggerCountsWithoutPrivilege(void)
+{
+	DataQueryContextPtr dqctx(new DataQueryContext(INVALID_USER_ID), false);
+	OverviewCounter::TriggerCounts counts;
+	cppcut_assert_equal(false,
+	  OverviewCounter::getInstance()->getTriggerCounts(
+	    counts, *dqctx, testTriggerInfo[0].serverId));
+}
+
+} // namespace testOverviewCounter
@@ -28,16 +28,6 @@ using namespace mlpl;
 
 namespace testSessionManager {
 
-static SessionManager *g_sessionIdMapOwner = NULL;
-
-const SessionIdMap &safeGetSessionIdMap(SessionManager *sessionMgr)
-{
-	cppcut_assert_equal(static_cast<SessionManager *>(NULL),
-	                    g_sessionIdMapOwner);
-	g_sessionIdMapOwner = sessionMgr;
-	return sessionMgr->getSessionIdMap();
-}
-
 class TimeoutEnvManager {
 	bool   m_saved;
 	string m_originalEnv;
@@ -87,11 +77,6 @@ void cut_setup(void)
 
 void cut_teardown(void)
 {
-	if (g_sessionIdMapOwner) {
-		g_sessionIdMapOwner->releaseSessionIdMap();
-		g_sessionIdMapOwner = NULL;
-	}
-
 	g_timeoutEnvMgr.restore();
 }
 
@@ -118,13 +103,14 @@ void test_create(void)
 	string sessionId = sessionMgr->create(userId);
 	cppcut_assert_equal(false, sessionId.empty());
 
-	const SessionIdMap &sessionIdMap = safeGetSessionIdMap(sessionMgr);
+	SessionIdMap sessionIdMap;
+	sessionMgr->getSessionIdMap(sessionIdMap);
 	cppcut_assert_equal((size_t)1, sessionIdMap.size());
 	cppcut_assert_equal(sessionId, sessionIdMap.begin()->first);
 	const Session *session = sessionIdMap.begin()->second;
 	cppcut_assert_equal(userId, session->userId);
 	assertTimeIsNow(session->loginTime);
-	assertTimeIsNow(session->lastAccessTime);
+	assertTimeIsNow(session->getLastAccessTime());
 }
 
 void test_createWithoutTimeout(void)
@@ -136,7 +122,10 @@ void test_createWithoutTimeout(void)
 	SessionPtr sessionPtr = sessionMgr->getSession(sessionId);
 	cppcut_assert_equal(true, sessionPtr.hasData()); 
 	cppcut_assert_equal(SessionManager::NO_TIMEOUT, sessionPtr->timeout);
-	cppcut_assert_equal(INVALID_EVENT_ID, sessionPtr->timerId);
+	cppcut_assert_equal(-1, sessionPtr->wheelLevel);
+	// 1st: added when it was created.
+	// 2nd: added due to getSession().
+	cppcut_assert_equal(2, sessionPtr->getUsedCount());
 }
 
 void test_timeout(void)
@@ -148,23 +137,41 @@ void test_timeout(void)
 	SessionPtr sessionPtr = sessionMgr->getSession(sessionId);
 	cppcut_assert_equal(true, sessionPtr.hasData()); 
 	cppcut_assert_equal(timeout, sessionPtr->timeout);
-	cppcut_assert_not_equal(INVALID_EVENT_ID, sessionPtr->timerId);
+	cppcut_assert_not_equal(-1, sessionPtr->wheelLevel);
 
 	// wait for the session's timeout
 	struct : public Watcher
 	{
-		guint *timerId;
-		virtual bool watch(void)
+		SessionManager *sessionMgr;
+		virtual bool watch(void) override
 		{
-			return *timerId == INVALID_EVENT_ID;
+			return sessionMgr->getNumberOfSessions() == 0;
 		}
 	} watcher;
-	watcher.timerId = &sessionPtr->timerId;
+	watcher.sessionMgr = sessionMgr;
 
 	const size_t watcherTimeout = 5*1000; // 5sec
 	cppcut_assert_equal(true, watcher.start(watcherTimeout));
-	const SessionIdMap &sessionIdMap = safeGetSessionIdMap(sessionMgr);
-	cppcut_assert_equal((size_t)0, sessionIdMap.size());
+
+	// Only sessionPtr has the reference.
+	cppcut_assert_equal(-1, sessionPtr->wheelLevel);
+	cppcut_assert_equal(1, sessionPtr->getUsedCount());
+}
+
+void test_notTimedOutWhileAccessed(void)
+{
+	const size_t timeout = 1;
+	const UserIdType userId = 103;
+	SessionManager *sessionMgr = SessionManager::getInstance();
+	string sessionId = sessionMgr->create(userId, timeout);
+
+	// Keep accessing the session for twice the timeout.
+	const size_t accessIntervalMSec = 200;
+	for (size_t i = 0; i < 2 * 1000 / accessIntervalMSec; i++) {
+		usleep(accessIntervalMSec * 1000);
+		SessionPtr sessionPtr = sessionMgr->getSession(sessionId);
+		cppcut_assert_equal(true, sessionPtr.hasData());
+	}
 }
 
 void test_getSession(void)
@@ -177,18 +184,20 @@ void test_getSession(void)
 		cppcut_assert_equal(true, session.hasData());
 		cppcut_assert_equal(userId, session->userId);
 		// 1st: added when it was created.
-		// 2nd: added in updateTimer().
+		// 2nd: added for the timer wheel.
 		// 3rd: added due to getSession().
 		cppcut_assert_equal(3, session->getUsedCount());
 	}
 
 	// check the used count of the session
-	const SessionIdMap &sessionIdMap = safeGetSessionIdMap(sessionMgr);
+	SessionIdMap sessionIdMap;
+	sessionMgr->getSessionIdMap(sessionIdMap);
 	cppcut_assert_equal((size_t)1, sessionIdMap.size());
 	cppcut_assert_equal(sessionId, sessionIdMap.begin()->first);
 	const Session *session = sessionIdMap.begin()->second;
 	cppcut_assert_equal(userId, session->userId);
-	cppcut_assert_equal(2, session->getUsedCount());
+	// The 3rd one is the reference of sessionIdMap.
+	cppcut_assert_equal(3, session->getUsedCount());
 }
 
 void test_update(void)
@@ -199,8 +208,7 @@ void test_update(void)
 	SessionPtr sessionPtr = sessionMgr->getSession(sessionId);
 	cppcut_assert_equal(true, sessionPtr.hasData()); 
 
-	SmartTime prevAccessTime = sessionPtr->lastAccessTime;
-	guint     prevTimerId    = sessionPtr->timerId;
+	SmartTime prevAccessTime = sessionPtr->getLastAccessTime();
 
 	// call getSession a short time later
 	const int sleepTimeMSec = 1;
@@ -209,13 +217,11 @@ void test_update(void)
 	cppcut_assert_equal(true, sessionPtr.hasData()); 
 
 	// check
-	SmartTime diffAccessTime = sessionPtr->lastAccessTime;
+	SmartTime diffAccessTime = sessionPtr->getLastAccessTime();
 	diffAccessTime -= prevAccessTime;
 	cppcut_assert_equal(true, diffAccessTime.getAsMSec() > sleepTimeMSec);
-	cppcut_assert_not_equal(prevTimerId, sessionPtr->timerId);
 
-	const SessionIdMap &sessionIdMap = safeGetSessionIdMap(sessionMgr);
-	cppcut_assert_equal((size_t)1, sessionIdMap.size());
+	cppcut_assert_equal((size_t)1, sessionMgr->getNumberOfSessions());
 }
 
 void test_getNonExistingSession(void)
@@ -233,8 +239,7 @@ void test_remove(void)
 	cppcut_assert_equal(true, sessionMgr->remove(sessionId));
 
 	// check the session sessionMgr is removed
-	const SessionIdMap &sessionIdMap = safeGetSessionIdMap(sessionMgr);
-	cppcut_assert_equal((size_t)0, sessionIdMap.size());
+	cppcut_assert_equal((size_t)0, sessionMgr->getNumberOfSessions());
 }
 
 void test_removeNonExistingSession(void)
@@ -270,21 +275,35 @@ void test_setTimeoutByEnv(void)
 	cppcut_assert_equal(timeout, SessionManager::getDefaultTimeout());
 }
 
-void test_sessionCancelTimer(void)
+void test_removeFromTimerWheel(void)
 {
 	SessionManager *sessionMgr = SessionManager::getInstance();
 	const UserIdType userId = 103;
 	const string sessionId = sessionMgr->create(userId);
 	SessionPtr sessionPtr = sessionMgr->getSession(sessionId);
-	guint origTimerId = sessionPtr->timerId;
-	cppcut_assert_not_equal(INVALID_EVENT_ID, sessionPtr->timerId);
-	sessionPtr->cancelTimer();
-	cppcut_assert_equal(INVALID_EVENT_ID, sessionPtr->timerId);
-
-	// This test will show a GLib-CRITICAL message, since the same source
-	// is removed again.
-	cppcut_assert_equal(false, Utils::removeGSourceIfNeeded(origTimerId));
+	cppcut_assert_not_equal(-1, sessionPtr->wheelLevel);
+	cppcut_assert_equal(true, sessionMgr->remove(sessionId));
+	cppcut_assert_equal(-1, sessionPtr->wheelLevel);
+	cppcut_assert_equal(1, sessionPtr->getUsedCount());
 }
 
-} // namespace testSessionManager
+void test_sessionsInShards(void)
+{
+	SessionManager *sessionMgr = SessionManager::getInstance();
+	const size_t numSessions = SessionManager::NUM_SHARDS * 4;
+	for (size_t i = 0; i < numSessions; i++)
+		sessionMgr->create(i);
+	cppcut_assert_equal(numSessions, sessionMgr->getNumberOfSessions());
+
+	SessionIdMap sessionIdMap;
+	sessionMgr->getSessionIdMap(sessionIdMap);
+	cppcut_assert_equal(numSessions, sessionIdMap.size());
+	SessionIdMapIterator it = sessionIdMap.begin();
+	for (; it != sessionIdMap.end(); ++it) {
+		SessionPtr sessionPtr = sessionMgr->getSession(it->first);
+		cppcut_assert_equal(true, sessionPtr.hasData());
+		cppcut_assert_equal(it->first, sessionPtr->id);
+	}
+}
 
+} // namespace testSessionManager
@@ -30,11 +30,18 @@ using namespace mlpl;
 
 namespace testThreadLocalDBCache {
 
+// The thread keeps the checked-out instance for this period
+// when the hold parameter of callGetHatohol() is true.
+static const size_t HOLD_TIME_MSEC = 60 * 1000;
+
 class TestCacheServiceThread : public HatoholThreadBase {
 
 	DBHatohol       *m_dbHatohol;
 	SimpleSemaphore  m_requestSem;
 	SimpleSemaphore  m_completSem;
+	SimpleSemaphore  m_releaseSem;
+	SimpleSemaphore  m_checkinSem;
+	size_t           m_holdTimeMSec;
 	bool             m_hasError;
 	bool             m_exitRequest;
 
@@ -43,18 +50,38 @@ public:
 	: m_dbHatohol(NULL),
 	  m_requestSem(0),
 	  m_completSem(0),
+	  m_releaseSem(0),
+	  m_checkinSem(0),
+	  m_holdTimeMSec(0),
 	  m_hasError(false),
 	  m_exitRequest(false)
 	{
 	}
 
-	DBHatohol *callGetHatohol(void)
+	/**
+	 * Get the DBHatohol instance in the thread.
+	 *
+	 * @param holdTimeMSec
+	 * If this is 0, this method returns after the instance is checked
+	 * in. Otherwise the instance is kept checked out for the period or
+	 * until releaseCache() is called.
+	 */
+	DBHatohol *callGetHatohol(const size_t &holdTimeMSec = 0)
 	{
+		m_holdTimeMSec = holdTimeMSec;
 		m_requestSem.post();
 		m_completSem.wait();
+		if (!holdTimeMSec)
+			m_checkinSem.wait();
 		return m_dbHatohol;
 	}
 
+	void releaseCache(void)
+	{
+		m_releaseSem.post();
+		m_checkinSem.wait();
+	}
+
 	bool hasError(void)
 	{
 		return m_hasError;
@@ -68,6 +95,7 @@ public:
 	virtual void stop(void)
 	{
 		m_exitRequest = true;
+		m_releaseSem.post();
 		m_requestSem.post();
 		HatoholThreadBase::waitExit();
 	}
@@ -79,9 +107,14 @@ protected:
 			m_requestSem.wait();
 			if (m_exitRequest)
 				break;
-			ThreadLocalDBCache cache;
-			m_dbHatohol = &cache.getDBHatohol();
-			m_completSem.post();
+			{
+				ThreadLocalDBCache cache;
+				m_dbHatohol = &cache.getDBHatohol();
+				m_completSem.post();
+				if (m_holdTimeMSec)
+					m_releaseSem.timedWait(m_holdTimeMSec);
+			}
+			m_checkinSem.post();
 		}
 		return NULL;
 	}
@@ -142,7 +175,7 @@ void test_hasInstanceByThread(void)
 		g_threads.push_back(thr);
 		thr->start();
 		pair<DBHatoholSetIterator, bool> result =
-		  dbAddrs.insert(thr->callGetHatohol());
+		  dbAddrs.insert(thr->callGetHatohol(HOLD_TIME_MSEC));
 		cppcut_assert_equal(true, result.second,
 		                    cut_message("i: %zd\n", i));
 	}
@@ -151,6 +184,10 @@ void test_hasInstanceByThread(void)
 void test_ensureCached(void)
 {
 	test_hasInstanceByThread();
+	for (size_t i = 0; i < g_threads.size(); i++)
+		g_threads[i]->releaseCache();
+
+	// Each thread gets the instance that it used last time.
 	for (size_t i = 0; i < g_threads.size(); i++) {
 		TestCacheServiceThread *thr = g_threads[i];
 		DBHatohol *prevDBCHatohol = thr->getPrevDBCHatohol();
@@ -159,27 +196,95 @@ void test_ensureCached(void)
 	}
 }
 
-void test_cleanupOnThreadExit(void)
+void test_reuseAfterCheckin(void)
+{
+	TestCacheServiceThread *thr = new TestCacheServiceThread();
+	g_threads.push_back(thr);
+	thr->start();
+	DBHatohol *dbHatohol = thr->callGetHatohol();
+
+	// The instance checked in by the other thread is reused.
+	ThreadLocalDBCache cache;
+	cppcut_assert_equal(dbHatohol, &cache.getDBHatohol());
+}
+
+void test_shareInstanceInNestedCaches(void)
+{
+	ThreadLocalDBCache::PoolStats stats0, stats;
+	ThreadLocalDBCache::getPoolStats(stats0);
+	ThreadLocalDBCache cache0;
+	DBHatohol *dbHatohol = &cache0.getDBHatohol();
+	{
+		ThreadLocalDBCache cache1;
+		cppcut_assert_equal(dbHatohol, &cache1.getDBHatohol());
+	}
+	ThreadLocalDBCache::getPoolStats(stats);
+	cppcut_assert_equal(stats0.numCheckouts + 1, stats.numCheckouts);
+}
+
+void test_checkinOnLastCacheDestruction(void)
+{
+	// Some thread may be running with the cache when this test is
+	// executed. So we see the difference of the number.
+	ThreadLocalDBCache::PoolStats stats0, stats;
+	ThreadLocalDBCache::getPoolStats(stats0);
+	{
+		ThreadLocalDBCache cache;
+		cache.getDBHatohol();
+		ThreadLocalDBCache::getPoolStats(stats);
+		cppcut_assert_equal(stats0.numCheckedOut + 1,
+		                    stats.numCheckedOut);
+	}
+	ThreadLocalDBCache::getPoolStats(stats);
+	cppcut_assert_equal(stats0.numCheckedOut, stats.numCheckedOut);
+}
+
+void test_keepInstancesAfterThreadExit(void)
 {
-	// Some thread may be running with the cache when this test is executed
-	// So the number of the cached DB may not be zero. We have to
-	// take into account it.
-	size_t numCached0 = ThreadLocalDBCache::getNumberOfDBClientMaps();
 	test_hasInstanceByThread();
-	size_t numCached = ThreadLocalDBCache::getNumberOfDBClientMaps();
-	cppcut_assert_equal(g_threads.size() + numCached0, numCached);
+	const size_t numCached = ThreadLocalDBCache::getNumberOfDBClientMaps();
 	for (size_t i = 0; i < g_threads.size(); i++) {
 		TestCacheServiceThread *thr = g_threads[i];
 		bool hasError = deleteTestCacheServiceThread(thr);
 		g_threads[i] = NULL;
 		cppcut_assert_equal(true, hasError);
-		size_t newNumCached =
-		  ThreadLocalDBCache::getNumberOfDBClientMaps();
-		cppcut_assert_equal(numCached - 1, newNumCached);
-		numCached = newNumCached;
+		cppcut_assert_equal(
+		  numCached, ThreadLocalDBCache::getNumberOfDBClientMaps());
 	}
 }
 
+void test_waitForCheckin(void)
+{
+	ThreadLocalDBCache::setMaxPoolSize(1);
+	TestCacheServiceThread *thr = new TestCacheServiceThread();
+	g_threads.push_back(thr);
+	thr->start();
+	const size_t holdTimeMSec = 100;
+	DBHatohol *dbHatohol = thr->callGetHatohol(holdTimeMSec);
+
+	ThreadLocalDBCache cache;
+	cppcut_assert_equal(dbHatohol, &cache.getDBHatohol());
+	ThreadLocalDBCache::PoolStats stats;
+	ThreadLocalDBCache::getPoolStats(stats);
+	cppcut_assert_equal((size_t)1, stats.maxPoolSize);
+	cppcut_assert_equal((size_t)1, stats.numInstances);
+	cppcut_assert_equal((size_t)1, stats.numWaits);
+	cppcut_assert_equal(true, stats.maxWaitTimeMSec > 0);
+	cppcut_assert_equal(stats.maxWaitTimeMSec, stats.totalWaitTimeMSec);
+}
+
+void test_shrinkPool(void)
+{
+	test_hasInstanceByThread();
+	for (size_t i = 0; i < g_threads.size(); i++)
+		g_threads[i]->releaseCache();
+	cppcut_assert_equal(true,
+	  ThreadLocalDBCache::getNumberOfDBClientMaps() >= g_threads.size());
+	ThreadLocalDBCache::setMaxPoolSize(1);
+	cppcut_assert_equal((size_t)1,
+	                    ThreadLocalDBCache::getNumberOfDBClientMaps());
+}
+
 void test_getMonitoring(void)
 {
 	ThreadLocalDBCache cache;
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include <StringUtils.h>
+#include "TimeSeriesBlock.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testTimeSeriesBlock {
+
+static const ServerIdType TEST_SERVER_ID = 1;
+static const ItemIdType   TEST_ITEM_ID = "1";
+static const time_t       TEST_BEGIN_TIME = 1400000000;
+
+static HistoryInfo makeHistoryInfo(const time_t &sec, const long &nsec,
+                                   const string &value)
+{
+	HistoryInfo historyInfo;
+	historyInfo.serverId = TEST_SERVER_ID;
+	historyInfo.itemId = TEST_ITEM_ID;
+	historyInfo.clock.tv_sec = sec;
+	historyInfo.clock.tv_nsec = nsec;
+	historyInfo.value = value;
+	return historyInfo;
+}
+
+static string makeSampleList(const HistoryInfoVect &historyInfoVect)
+{
+	string list;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it) {
+		list += StringUtils::sprintf(
+		  "%ld.%09ld|%s\n", it->clock.tv_sec, it->clock.tv_nsec,
+		  it->value.c_str());
+	}
+	return list;
+}
+
+static void assertRoundTrip(const HistoryInfoVect &historyInfoVect)
+{
+	TimeSeriesBlock block;
+	HistoryInfoVectConstIterator it = historyInfoVect.begin();
+	for (; it != historyInfoVect.end(); ++it)
+		block.append(*it);
+	cppcut_assert_equal(historyInfoVect.size(),
+	                    block.getNumberOfSamples());
+
+	HistoryInfoVect decoded;
+	block.decode(decoded, TEST_SERVER_ID, TEST_ITEM_ID);
+	cppcut_assert_equal(makeSampleList(historyInfoVect),
+	                    makeSampleList(decoded));
+	cppcut_assert_equal(TEST_SERVER_ID, decoded.front().serverId);
+	cppcut_assert_equal(TEST_ITEM_ID, decoded.front().itemId);
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_empty(void)
+{
+	TimeSeriesBlock block;
+	HistoryInfoVect decoded;
+	block.decode(decoded, TEST_SERVER_ID, TEST_ITEM_ID);
+	cppcut_assert_equal(static_cast<size_t>(0), decoded.size());
+	cppcut_assert_equal(static_cast<size_t>(0),
+	                    block.getNumberOfSamples());
+}
+
+void test_roundTripFloat(void)
+{
+	HistoryInfoVect historyInfoVect;
+	for (time_t i = 0; i < 100; i++) {
+		historyInfoVect.push_back(makeHistoryInfo(
+		  TEST_BEGIN_TIME + i * 60, 0,
+		  StringUtils::sprintf("%.4f", 20.0 + (i % 10) * 0.125)));
+	}
+	assertRoundTrip(historyInfoVect);
+}
+
+void test_roundTripInteger(void)
+{
+	HistoryInfoVect historyInfoVect;
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME, 0, "0"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 1, 0,
+	                                          "-123"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 2, 0,
+	                                          "9007199254740992"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 3, 0,
+	                                          "0.5"));
+	assertRoundTrip(historyInfoVect);
+}
+
+void test_roundTripText(void)
+{
+	HistoryInfoVect historyInfoVect;
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME, 0,
+	                                          "Text value"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 1, 0, ""));
+	// They look like numbers, but can't be restored from a double.
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 2, 0,
+	                                          "007"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 3, 0,
+	                                          "1e5"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 4, 0,
+	                                          "12345678901234567890"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 5, 0,
+	                                          string(300, 'a')));
+	assertRoundTrip(historyInfoVect);
+}
+
+void test_roundTripIrregularTime(void)
+{
+	HistoryInfoVect historyInfoVect;
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME, 0, "1"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME, 1, "1"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 30,
+	                                          999999999, "1"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 31, 0,
+	                                          "1"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 3600, 0,
+	                                          "1"));
+	historyInfoVect.push_back(makeHistoryInfo(TEST_BEGIN_TIME + 86400 * 365,
+	                                          0, "1"));
+	assertRoundTrip(historyInfoVect);
+}
+
+void test_beginAndEndTime(void)
+{
+	TimeSeriesBlock block;
+	block.append(makeHistoryInfo(TEST_BEGIN_TIME, 0, "1"));
+	block.append(makeHistoryInfo(TEST_BEGIN_TIME + 60, 0, "2"));
+	cppcut_assert_equal(TEST_BEGIN_TIME, block.getBeginTime());
+	cppcut_assert_equal(TEST_BEGIN_TIME + 60, block.getEndTime());
+}
+
+void test_compressionRatio(void)
+{
+	TimeSeriesBlock block;
+	size_t rawSize = 0;
+	for (time_t i = 0; i < 512; i++) {
+		const HistoryInfo historyInfo = makeHistoryInfo(
+		  TEST_BEGIN_TIME + i * 60, 0, (i % 4) ? "0.2500" : "0.5000");
+		block.append(historyInfo);
+		rawSize += sizeof(HistoryInfo) + historyInfo.value.size();
+	}
+	block.shrink();
+	cppcut_assert_equal(true, block.getMemorySize() * 10 <= rawSize,
+	                    cut_message("raw: %zd, compressed: %zd",
+	                                rawSize, block.getMemorySize()));
+}
+
+} // namespace testTimeSeriesBlock
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppcutter.h>
+#include "UserPrivilegeCache.h"
+#include "DataQueryContext.h"
+#include "ThreadLocalDBCache.h"
+#include "Hatohol.h"
+#include "Helpers.h"
+#include "DBTablesTest.h"
+using namespace std;
+using namespace mlpl;
+
+namespace testUserPrivilegeCache {
+
+static const UserIdType targetUserId = 1;
+
+void cut_setup(void)
+{
+	hatoholInit();
+	setupTestDB();
+	loadTestDBTablesConfig();
+	loadTestDBTablesUser();
+}
+
+// ---------------------------------------------------------------------------
+// Test cases
+// ---------------------------------------------------------------------------
+void test_getServerHostGrpSetMap(void)
+{
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	ServerHostGrpSetMap expected;
+	makeServerHostGrpSetMap(expected, targetUserId);
+
+	ServerHostGrpSetMap actual;
+	cache->getServerHostGrpSetMap(actual, targetUserId);
+	cppcut_assert_equal(true, expected == actual);
+	cppcut_assert_equal((size_t)1, cache->getNumberOfUsers());
+
+	// from the cache
+	ServerHostGrpSetMap cached;
+	cache->getServerHostGrpSetMap(cached, targetUserId);
+	cppcut_assert_equal(true, expected == cached);
+}
+
+void test_addAccessInfoInvalidatesCache(void)
+{
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	cache->getServerHostGrpSetMap(srvHostGrpSetMap, targetUserId);
+	const UserPrivilegeCache::Generation generation =
+	  cache->getGeneration();
+
+	AccessInfo accessInfo;
+	accessInfo.id = AUTO_INCREMENT_VALUE;
+	accessInfo.userId = targetUserId;
+	accessInfo.serverId = 1000;
+	accessInfo.hostgroupId = "55";
+	ThreadLocalDBCache dbCache;
+	OperationPrivilege privilege(ALL_PRIVILEGES);
+	assertHatoholError(
+	  HTERR_OK, dbCache.getUser().addAccessInfo(accessInfo, privilege));
+	cppcut_assert_equal(generation + 1, cache->getGeneration());
+	cppcut_assert_equal((size_t)0, cache->getNumberOfUsers());
+
+	ServerHostGrpSetMap updated;
+	cache->getServerHostGrpSetMap(updated, targetUserId);
+	cppcut_assert_equal(true,
+	  updated[accessInfo.serverId].count(accessInfo.hostgroupId) > 0);
+}
+
+void test_setAndGetCondition(void)
+{
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	const UserPrivilegeCache::Generation generation =
+	  cache->getServerHostGrpSetMap(srvHostGrpSetMap, targetUserId);
+	cache->setCondition(targetUserId, generation, "key", "server_id=1");
+
+	string condition;
+	cppcut_assert_equal(true,
+	  cache->getCondition(condition, targetUserId, "key"));
+	cppcut_assert_equal(string("server_id=1"), condition);
+}
+
+void test_setConditionWithStaleGeneration(void)
+{
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	const UserPrivilegeCache::Generation generation =
+	  cache->getServerHostGrpSetMap(srvHostGrpSetMap, targetUserId);
+	cache->invalidate(targetUserId);
+	cache->setCondition(targetUserId, generation, "key", "server_id=1");
+
+	string condition;
+	cppcut_assert_equal(false,
+	  cache->getCondition(condition, targetUserId, "key"));
+}
+
+void test_setConditionOverLimit(void)
+{
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	ServerHostGrpSetMap srvHostGrpSetMap;
+	const UserPrivilegeCache::Generation generation =
+	  cache->getServerHostGrpSetMap(srvHostGrpSetMap, targetUserId);
+	const size_t numConditions =
+	  UserPrivilegeCache::MAX_CONDITIONS_PER_USER + 1;
+	for (size_t i = 0; i < numConditions; i++) {
+		const string key = StringUtils::sprintf("key%zd", i);
+		cache->setCondition(targetUserId, generation, key, key);
+	}
+
+	// The oldest one is dropped.
+	string condition;
+	cppcut_assert_equal(false,
+	  cache->getCondition(condition, targetUserId, "key0"));
+	for (size_t i = 1; i < numConditions; i++) {
+		const string key = StringUtils::sprintf("key%zd", i);
+		cppcut_assert_equal(true,
+		  cache->getCondition(condition, targetUserId, key));
+		cppcut_assert_equal(key, condition);
+	}
+}
+
+void test_getValidServerIdSet(void)
+{
+	DataQueryContextPtr dqctx(new DataQueryContext(targetUserId), false);
+	ServerIdSet expected;
+	ThreadLocalDBCache dbCache;
+	dbCache.getConfig().getServerIdSet(expected, dqctx);
+
+	UserPrivilegeCache *cache = UserPrivilegeCache::getInstance();
+	ServerIdSet actual;
+	cache->getValidServerIdSet(actual, dqctx);
+	cppcut_assert_equal(true, expected == actual);
+	cppcut_assert_equal((size_t)1, cache->getNumberOfUsers());
+}
+
+} // namespace testUserPrivilegeCache
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2015 Project Hatohol
+ *
+ * This file is part of Hatohol.
+ *
+ * Hatohol is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License, version 3
+ * as published by the Free Software Foundation.
+ *
+ * Hatohol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Hatohol. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <inttypes.h>
+#include <glib.h>
+#include <StringUtils.h>
+#include <Tracer.h>
+using namespace std;
+using namespace mlpl;
+
+typedef map<uint16_t, string>      EventNameMap;
+typedef map<int32_t, EventNameMap> EventNameMapMap; // key: pid
+
+struct Event {
+	int32_t     pid;
+	TraceRecord record;
+
+	bool operator<(const Event &rhs) const
+	{
+		return record.timestamp < rhs.record.timestamp;
+	}
+};
+
+static void printUsage(void)
+{
+	printf("Usage:\n");
+	printf("\n");
+	printf("  $ hatohol-trace-converter directory > trace.json\n");
+	printf("\n");
+	printf("directory:\n");
+	printf("  A directory specified with MLPL_TRACE_DIR.\n");
+	printf("\n");
+	printf("The output can be loaded with chrome://tracing.\n");
+	printf("\n");
+}
+
+static bool loadDirectory(const string &directory,
+                          EventNameMapMap &namesMap, vector<Event> &events)
+{
+	GError *error = NULL;
+	GDir *dir = g_dir_open(directory.c_str(), 0, &error);
+	if (!dir) {
+		fprintf(stderr, "Failed to open: %s: %s\n",
+		        directory.c_str(), error->message);
+		g_error_free(error);
+		return false;
+	}
+
+	const gchar *fileName;
+	while ((fileName = g_dir_read_name(dir))) {
+		const string path = directory + "/" + fileName;
+		int32_t pid;
+		if (g_str_has_suffix(fileName, ".names")) {
+			if (sscanf(fileName, "trace-%" SCNd32, &pid) != 1)
+				continue;
+			Tracer::readNamesFile(path, namesMap[pid]);
+		} else if (g_str_has_suffix(fileName, ".ring")) {
+			TraceFileHeader header;
+			vector<TraceRecord> records;
+			if (!Tracer::readRingFile(path, header, records))
+				continue;
+			for (size_t i = 0; i < records.size(); i++) {
+				Event event;
+				event.pid = header.pid;
+				event.record = records[i];
+				events.push_back(event);
+			}
+		}
+	}
+	g_dir_close(dir);
+	return true;
+}
+
+static string getEventName(const EventNameMapMap &namesMap, const Event &event)
+{
+	EventNameMapMap::const_iterator it = namesMap.find(event.pid);
+	if (it != namesMap.end()) {
+		EventNameMap::const_iterator nameIt =
+		  it->second.find(event.record.eventId);
+		if (nameIt != it->second.end())
+			return nameIt->second;
+	}
+	return StringUtils::sprintf("event-%" PRIu16, event.record.eventId);
+}
+
+static const char *getPhaseString(const uint8_t &phase)
+{
+	switch (phase) {
+	case MLPL_TRACE_PHASE_BEGIN:
+		return "B";
+	case MLPL_TRACE_PHASE_END:
+		return "E";
+	default:
+		return "i";
+	}
+}
+
+static void printChromeTrace(const EventNameMapMap &namesMap,
+                             const vector<Event> &events)
+{
+	// Timestamps in the Chrome trace format are in microseconds.
+	printf("{\"traceEvents\":[\n");
+	for (size_t i = 0; i < events.size(); i++) {
+		const Event &event = events[i];
+		const TraceRecord &rec = event.record;
+		printf("%s{\"name\":\"%s\",\"ph\":\"%s\","
+		       "\"ts\":%" PRIu64 ".%03" PRIu64 ","
+		       "\"pid\":%" PRId32 ",\"tid\":%" PRId32 ","
+		       "\"args\":{\"arg0\":%" PRIu64 ",\"arg1\":%" PRIu64 "}}",
+		       i ? ",\n" : "",
+		       getEventName(namesMap, event).c_str(),
+		       getPhaseString(rec.phase),
+		       rec.timestamp / 1000, rec.timestamp % 1000,
+		       event.pid, rec.tid, rec.arg0, rec.arg1);
+	}
+	printf("\n]}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	EventNameMapMap namesMap;
+	vector<Event> events;
+	if (!loadDirectory(argv[1], namesMap, events))
+		return EXIT_FAILURE;
+	stable_sort(events.begin(), events.end());
+	printChromeTrace(namesMap, events);
+
+	return EXIT_SUCCESS;
+}